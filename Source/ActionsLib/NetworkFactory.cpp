@@ -179,7 +179,11 @@ ComputationNetworkPtr GetModelFromConfig(const ConfigRecordType& config, const w
         // By not compiling the network before patching, we avoid double log output for validation.
         net = make_shared<ComputationNetwork>(deviceId);
         net->SetTraceLevel(config(L"traceLevel", 0));
-        net->Read<ElemType>(modelPath);
+        // mapParameters: map the parameter values from '<modelPath>.params' (created on first use) instead of copying them
+        if (config(L"mapParameters", false))
+            net->ReadWithMappedParameters<ElemType>(modelPath);
+        else
+            net->Read<ElemType>(modelPath);
         if (outputNodeNames.size() > 0)
             PatchOutputNodes(net, outputNodeNames, outputNodeNamesVector);
         net->CompileNetwork();
@@ -24,6 +24,7 @@
 #include "ModelEditLanguage.h"
 #include "CPUMatrix.h" // used for SetNumThreads()
 #include "CommonMatrix.h"
+#include "ConvolutionEngine.h"
 #include "SGD.h"
 #include "MPIWrapper.h"
 #include "Config.h"
@@ -79,7 +80,9 @@ void SetupProfiling(ProfilerContext& profilerContext, const ConfigParamType& con
         profilerContext.Init(workDir + L"/profiler",
                              config(L"profilerBufferSize", static_cast<uint64_t>(32 * 1024 * 1024)),
                              std::to_wstring(nodeRank),
-                             config(L"profilerSyncGpu", true));
+                             config(L"profilerSyncGpu", true),
+                             config(L"profilerTrace", false),
+                             config(L"profilerTraceBufferSize", static_cast<uint64_t>(256 * 1024 * 1024)));
     }
 }
 
@@ -586,6 +589,8 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
     Globals::SetHyperCompressMemory(config(L"hyperCompressMemory", false));
+    ConvolutionEngineAutotuner::SetEnabled(config(L"autotuneConvolution", false));
+    ConvolutionEngineAutotuner::SetCacheFile(config(L"autotuneConvolutionCacheFile", L""));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -730,6 +735,8 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
     Globals::SetShareNodeValueMatrices(config(L"shareNodeValueMatrices", true));
     Globals::SetGradientAccumulationOptimization(config(L"optimizeGradientAccumulation", true));
     Globals::SetHyperCompressMemory(config(L"hyperCompressMemory", false));
+    ConvolutionEngineAutotuner::SetEnabled(config(L"autotuneConvolution", false));
+    ConvolutionEngineAutotuner::SetCacheFile(config(L"autotuneConvolutionCacheFile", L""));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -3249,6 +3249,17 @@ namespace CNTK
     ///
     CNTK_API FunctionPtr AsComposite(const FunctionPtr& rootFunction, const std::wstring& name = L"");
 
+    namespace Internal
+    {
+        ///
+        /// Loads a model like Function::LoadModel and optimizes it for inference: batch normalization is folded into the
+        /// preceding convolution or times, pass-through nodes are removed and constant subexpressions are precomputed.
+        /// The returned Function can no longer be trained. Models in the V2 format are lowered to their ComputationNetwork
+        /// for the optimization and converted back; if that fails, the model is loaded unchanged, with a warning.
+        ///
+        CNTK_API FunctionPtr LoadModelForInference(const std::wstring& modelFile, const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice());
+    }
+
     namespace Sequence
     {
         CNTK_API FunctionPtr IsFirst(const Variable& operand, const std::wstring& name = L"");
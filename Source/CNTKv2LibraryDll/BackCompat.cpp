@@ -455,28 +455,23 @@ namespace CNTK
             }
         };
 
-        FunctionPtr LoadLegacyModel(const std::wstring& modelFile, const DeviceDescriptor& computeDevice /*= DeviceDescriptor::UseDefaultDevice()*/)
+        static void OptimizeNetworkForInference(const ComputationNetworkPtr& net)
         {
-            ComputationNetworkPtr net = make_shared<ComputationNetwork>(AsCNTKImplDeviceId(computeDevice));
-            net->SetTraceLevel(Internal::GetComputationNetworkTraceLevel());
-
-            auto dataType = DetectLegacyModelDataType(modelFile);
-            switch (dataType)
-            {
-            case LegacyModelDataType::Auto:
-                net->Load<float>(modelFile); // the actual template type will be ignored.
-                break;
-            case LegacyModelDataType::Float:
-                net->Load<float>(modelFile);
-                break;
-            case LegacyModelDataType::Double:
-                net->Load<double>(modelFile);
-                break;
-            default:
-                NOT_IMPLEMENTED;
-            }
+            ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+            const auto& roots = net->RootNodes();
+            size_t numRemoved;
+            if (!roots.empty() && ComputationNetwork::IsNodePtr<ComputationNode<double>>(roots.front()))
+                numRemoved = net->OptimizeForInference<double>(roots);
+            else
+                numRemoved = net->OptimizeForInference<float>(roots);
+            if (net->TraceLevel() > 0)
+                fprintf(stderr, "OptimizeForInference: Removed %d nodes by optimizing the network for inference.\n", (int) numRemoved);
+            net->CompileNetwork();
+        }
 
-            // Now traverse the model and construct the Function graph
+        // Traverses the network and constructs the Function graph
+        static FunctionPtr ConvertToFunction(const ComputationNetworkPtr& net)
+        {
             std::unordered_map<ComputationNodeBasePtr, Variable> nodeToVariableMap;
             std::unordered_map<Variable, Variable> placeholderReplacements;
             std::vector<Variable> rootVariables;
@@ -506,6 +501,58 @@ namespace CNTK
             return rootComposite;
         }
 
+        FunctionPtr LoadLegacyModel(const std::wstring& modelFile, const DeviceDescriptor& computeDevice /*= DeviceDescriptor::UseDefaultDevice()*/, bool optimizeForInference /*= false*/)
+        {
+            ComputationNetworkPtr net = make_shared<ComputationNetwork>(AsCNTKImplDeviceId(computeDevice));
+            net->SetTraceLevel(Internal::GetComputationNetworkTraceLevel());
+
+            auto dataType = DetectLegacyModelDataType(modelFile);
+            switch (dataType)
+            {
+            case LegacyModelDataType::Auto:
+                net->Load<float>(modelFile); // the actual template type will be ignored.
+                break;
+            case LegacyModelDataType::Float:
+                net->Load<float>(modelFile);
+                break;
+            case LegacyModelDataType::Double:
+                net->Load<double>(modelFile);
+                break;
+            default:
+                NOT_IMPLEMENTED;
+            }
+
+            if (optimizeForInference)
+                OptimizeNetworkForInference(net);
+
+            return ConvertToFunction(net);
+        }
+
+        FunctionPtr OptimizeForInference(const FunctionPtr& rootFunction, const DeviceDescriptor& computeDevice)
+        {
+            CompositeFunction* compositeFunction = dynamic_cast<CompositeFunction*>(rootFunction.get());
+            if (compositeFunction == nullptr)
+                InvalidArgument("Primitive (aka non-composite) Function instances cannot be optimized for inference");
+
+            // the network shares the parameter values with the Function
+            ComputationNetworkPtr net;
+            DataType dataType = rootFunction->Outputs()[0].GetDataType();
+            switch (dataType)
+            {
+            case DataType::Float:
+                net = compositeFunction->GetComputationNetwork<float>(computeDevice, {}, {}, false);
+                break;
+            case DataType::Double:
+                net = compositeFunction->GetComputationNetwork<double>(computeDevice, {}, {}, false);
+                break;
+            default:
+                LogicError("Unknown DataType %s", DataTypeName(dataType));
+            }
+
+            OptimizeNetworkForInference(net);
+            return ConvertToFunction(net);
+        }
+
         void SaveAsLegacyModel(const FunctionPtr& rootFunction, const std::wstring& modelFile)
         {
             CompositeFunction* compositeFunction = dynamic_cast<CompositeFunction*>(rootFunction.get());
@@ -13,7 +13,11 @@ namespace CNTK
 {
     namespace Internal
     {
-        FunctionPtr LoadLegacyModel(const std::wstring& modelFile, const DeviceDescriptor& computeDevice);
+        FunctionPtr LoadLegacyModel(const std::wstring& modelFile, const DeviceDescriptor& computeDevice, bool optimizeForInference = false);
+
+        // Lowers a composite Function to its ComputationNetwork, optimizes that for inference and converts it back.
+        // The parameters of the given Function may be changed, so it must not be used afterwards.
+        FunctionPtr OptimizeForInference(const FunctionPtr& rootFunction, const DeviceDescriptor& computeDevice);
 
         inline bool IsLegacyModel(std::fstream& stream)
         {
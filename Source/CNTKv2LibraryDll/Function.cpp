@@ -322,6 +322,29 @@ namespace CNTK
         }
     }
 
+    namespace Internal
+    {
+        FunctionPtr LoadModelForInference(const std::wstring& modelFile, const DeviceDescriptor& computeDevice)
+        {
+            auto stream = GetFstream(modelFile, true);
+            if (IsLegacyModel(*stream))
+                return LoadLegacyModel(modelFile, computeDevice, /*optimizeForInference=*/ true);
+
+            Dictionary model;
+            *stream >> model;
+            try
+            {
+                return OptimizeForInference(Function::Deserialize(model, computeDevice), computeDevice);
+            }
+            catch (const std::exception& e)
+            {
+                // the optimization may have changed the parameters in place already, hence deserialize the model again
+                fprintf(stderr, "WARNING: LoadModelForInference: The model '%S' could not be optimized for inference (%s); loading it unchanged.\n", modelFile.c_str(), e.what());
+                return Function::Deserialize(model, computeDevice);
+            }
+        }
+    }
+
     void Function::RestoreModel(const std::wstring& modelFilePath)
     {
         auto stream = GetFstream(modelFilePath, true);
@@ -127,6 +127,7 @@ namespace CNTK
         if (m_additionalOptions.l2RegularizationWeight > 0)
         {
             // multiply by actualMBSize so that it's invariant to minibatch size since learning rate is per sample
+            // For a block-sparse gradient (e.g. of an embedding lookup on the CPU), this only decays the columns that have a gradient.
             const auto weight = m_additionalOptions.l2RegularizationWeight * actualMBSize;
             const auto& parameterMatrix = parameterValue->GetWritableMatrix<ElementType>();
             Matrix<ElementType>::ScaleAndAdd(ElementType(weight), *parameterMatrix, *gradientMatrix);
@@ -42,6 +42,11 @@ public:
 
     //
     // Create a network based on an (NDL) network description.
+    // quantizeTimes=true replaces the products of weight matrices with the data by 16-bit integer products
+    // (QuantizedTimes nodes, CPU only); quantizeBitShiftA/quantizeBitShiftB set the bit shifts of their quantizers.
+    // mapParameters=true memory-maps the parameter values from '<modelPath>.params', which is written next to the
+    // model file on first use, instead of reading them out of the model file (CPU only). Processes that load the
+    // same model then share the parameter memory.
     //
     virtual void CreateNetwork(const std::string& networkDescription) = 0;
 
@@ -296,6 +301,9 @@ class VariableSchema : public std::vector<VariableLayout>
         }
 };
 
+template <typename ElemType>
+class IBatchingEvaluator;
+
 //
 // Extended interface, allowing for sparse input.
 // Implementation constraints: 
@@ -316,6 +324,10 @@ public:
     //
     // Allocate internal state for calling ForwardPass(). The call restricts the network (inputs and outputs)
     // to the functions represented by the output name.
+    // With blockedImageLayout=true in the configuration, the CPU convolution, pooling and batch normalization nodes
+    // pass the images between them in a channel-interleaved layout (see ComputationNetwork::ConvertToBlockedImageLayout()).
+    // With optimizeForInference=true, batch normalization is folded into the preceding convolution or times, pass-through
+    // nodes are removed, and constant subexpressions are precomputed first (see ComputationNetwork::OptimizeForInference()).
     //
     virtual void StartForwardEvaluation(const std::vector<std::wstring>& outputs) = 0;
 
@@ -332,7 +344,8 @@ public:
     // The layout and shape of the data in inputs vector must match the schema returned by GetInputLayouts.
     // Output must be preallocated and sized to avoid memory allocation / deallocation across DLL
     // boundaries.
-    // This method is not reentrant, as the forward pass keeps internal state.
+    // This method is not reentrant, as the forward pass keeps internal state. To evaluate on several threads
+    // concurrently, give each thread its own evaluator from CreateWorker().
     // inputs - vector of input buffers, one for every input as given by GetInputLayouts()
     // outputs - vector of output buffers. Must be sized to fit output schema.
     //
@@ -355,6 +368,49 @@ public:
     // resetRNN - flags whether to reset memory cells of RNN. 
     //
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) = 0;
+
+    //
+    // CreateWorker - create another evaluator for the same outputs, which shares the model parameters with this one
+    // but has its own activations and minibatch layout. ForwardPass() can be called concurrently on this evaluator
+    // and all of its workers, one thread per evaluator, while the parameters are kept only once in memory.
+    // Must be called after StartForwardEvaluation(), and not concurrently with ForwardPass() on this evaluator.
+    // Every worker must be released with Destroy(); it can outlive the evaluator that created it.
+    //
+    virtual IEvaluateModelExtended<ElemType>* CreateWorker() = 0;
+
+    //
+    // CreateBatchingEvaluator - create a front end that evaluates requests from several threads together in one
+    // minibatch, on a worker of this evaluator (see CreateWorker()).
+    // maxBatchSize - maximum number of requests evaluated together
+    // maxLatencyMicroseconds - maximum time a request waits for others to arrive before its minibatch is evaluated
+    // Must be called after StartForwardEvaluation(). The front end must be released with Destroy().
+    //
+    virtual IBatchingEvaluator<ElemType>* CreateBatchingEvaluator(size_t maxBatchSize, size_t maxLatencyMicroseconds) = 0;
+};
+
+//
+// Batching front end for online evaluation, where requests arrive one sample or one sequence at a time.
+// Requests that arrive close together are evaluated in one minibatch, which is far more efficient than one forward
+// pass per request.
+//
+template <typename ElemType>
+class IBatchingEvaluator
+{
+public:
+    //
+    // Evaluate - evaluate a single request. Thread-safe: blocks until the minibatch containing the request
+    // has been evaluated and the outputs have been written.
+    // Every request is evaluated as a sequence of its own, i.e. RNN memory cells are reset for every request.
+    // inputs - vector of input buffers, as for ForwardPass(); each holds one sample or one sequence of samples.
+    //          Only dense inputs are supported.
+    // outputs - vector of output buffers. Must be sized to fit output schema.
+    //
+    virtual void Evaluate(const Values<ElemType>& inputs, Values<ElemType>& outputs) = 0;
+
+    //
+    // Destroy - finish all pending requests and release the front end
+    //
+    virtual void Destroy() = 0;
 };
 
 template <typename ElemType>
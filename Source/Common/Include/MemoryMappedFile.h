@@ -0,0 +1,147 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// MemoryMappedFile.h -- read-only memory mapping of a whole file, on Windows and Linux
+//
+// The mapping is shared, so the pages come straight out of the OS page cache and are shared by all
+// processes that map the same file. Data must not be written through the returned pointer, unless the file is
+// mapped copy-on-write, in which case written pages become private to the process (the file is never modified).
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+class MemoryMappedFile
+{
+public:
+    explicit MemoryMappedFile(const std::wstring& path, bool copyOnWrite = false)
+        : m_path(path), m_data(nullptr), m_size(0), m_copyOnWrite(copyOnWrite)
+    {
+#ifdef _WIN32
+        m_mapping = NULL;
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            RuntimeError("MemoryMappedFile: Error opening file '%ls' (error %d).", path.c_str(), (int)GetLastError());
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            RuntimeError("MemoryMappedFile: Error getting the size of file '%ls' (error %d).", path.c_str(), (int)GetLastError());
+        }
+        m_size = (size_t)size.QuadPart;
+        if (m_size > 0)
+        {
+            m_mapping = CreateFileMappingW(file, NULL, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+            if (m_mapping != NULL)
+                m_data = MapViewOfFile(m_mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+        }
+        CloseHandle(file); // the mapping keeps the file open
+        if (m_size > 0 && m_data == nullptr)
+        {
+            int error = (int)GetLastError();
+            if (m_mapping != NULL)
+                CloseHandle(m_mapping);
+            RuntimeError("MemoryMappedFile: Error mapping file '%ls' (error %d).", path.c_str(), error);
+        }
+#else
+        std::string utf8Path = msra::strfun::utf8(path);
+        int fd = open(utf8Path.c_str(), O_RDONLY);
+        if (fd < 0)
+            RuntimeError("MemoryMappedFile: Error opening file '%ls': %s.", path.c_str(), strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            int error = errno;
+            close(fd);
+            RuntimeError("MemoryMappedFile: Error getting the size of file '%ls': %s.", path.c_str(), strerror(error));
+        }
+        m_size = (size_t)st.st_size;
+        if (m_size > 0)
+        {
+            void* data = copyOnWrite ? mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)
+                                     : mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                int error = errno;
+                close(fd);
+                RuntimeError("MemoryMappedFile: Error mapping file '%ls': %s.", path.c_str(), strerror(error));
+            }
+            m_data = data;
+        }
+        close(fd); // the mapping keeps the file open
+#endif
+    }
+
+    ~MemoryMappedFile()
+    {
+#ifdef _WIN32
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping != NULL)
+            CloseHandle(m_mapping);
+#else
+        if (m_data)
+            munmap(m_data, m_size);
+#endif
+    }
+
+    const void* Data() const { return m_data; }
+    void* MutableData() const
+    {
+        if (!m_copyOnWrite)
+            LogicError("MemoryMappedFile: File '%ls' is mapped read-only.", m_path.c_str());
+        return m_data;
+    }
+    size_t Size() const { return m_size; }
+    const std::wstring& Path() const { return m_path; }
+
+    // Tell the OS that the given range will be read sequentially soon (best effort).
+    void WillNeed(size_t offset, size_t size) const
+    {
+#ifndef _WIN32
+        if (!m_data || offset >= m_size)
+            return;
+        // madvise() needs a page-aligned start
+        size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        size_t begin = offset - offset % pageSize;
+        size_t end = std::min(offset + size, m_size);
+        madvise((char*)m_data + begin, end - begin, MADV_WILLNEED);
+#else
+        // PrefetchVirtualMemory() is not available on all supported Windows versions
+        UNUSED(offset);
+        UNUSED(size);
+#endif
+    }
+
+private:
+    std::wstring m_path;
+    void* m_data;
+    size_t m_size;
+    bool m_copyOnWrite;
+#ifdef _WIN32
+    HANDLE m_mapping;
+#endif
+
+    DISABLE_COPY_AND_MOVE(MemoryMappedFile);
+};
+
+}}}
@@ -0,0 +1,137 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// RingAllReduce.h -- bandwidth-optimal sum-allreduce of CPU buffers over MPI point-to-point messages
+//
+// Ring: the buffer is cut into one chunk per rank. In N-1 reduce-scatter steps, every rank sends one chunk to its right
+// neighbor and adds the chunk it receives from its left neighbor into its own copy, after which rank r holds the full
+// sum of chunk (r+1) % N. In N-1 allgather steps, the reduced chunks are passed around the ring once more. Every rank
+// sends and receives 2(N-1)/N times the buffer size, independent of the number of ranks.
+//
+// Hierarchical: the ranks on the same host first reduce to one leader per host through shared memory, the leaders
+// run the ring across the hosts, and each leader broadcasts the result to the ranks on its host. Only one rank per host
+// puts the buffer on the network.
+//
+
+#pragma once
+
+#include "MPIWrapper.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+enum class AllReduceAlgorithm : int
+{
+    mpi = 0,             // MPI_Iallreduce of the MPI implementation
+    ring = 1,            // RingAllReduce over all ranks
+    hierarchicalRing = 2 // RingAllReduce over one leader per host
+};
+
+template <class ElemType>
+class RingAllReduce
+{
+public:
+    RingAllReduce(MPI_Comm comm, bool hierarchical)
+        : m_comm(comm), m_hierarchical(hierarchical), m_ringComm(MPI_COMM_NULL), m_hostComm(MPI_COMM_NULL), m_initialized(false)
+    {}
+
+    ~RingAllReduce()
+    {
+        if (m_ringComm != MPI_COMM_NULL)
+            MPI_Comm_free(&m_ringComm);
+        if (m_hostComm != MPI_COMM_NULL)
+            MPI_Comm_free(&m_hostComm);
+    }
+
+    // In-place sum of data across all ranks of the communicator. Must be called by all ranks with the same numElements.
+    void AllReduce(ElemType* data, size_t numElements)
+    {
+        // Creating the communicators is collective, so it happens on the first (collective) call. The ring uses its own
+        // communicator, so that its messages cannot be matched by point-to-point receives the caller has posted on comm.
+        if (!m_initialized)
+        {
+            if (!m_hierarchical)
+                MPI_Comm_dup(m_comm, &m_ringComm) || MpiFail("RingAllReduce: MPI_Comm_dup");
+            else
+            {
+                int rank;
+                MPI_Comm_rank(m_comm, &rank) || MpiFail("RingAllReduce: MPI_Comm_rank");
+                MPI_Comm_split_type(m_comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &m_hostComm) || MpiFail("RingAllReduce: MPI_Comm_split_type");
+                int hostRank;
+                MPI_Comm_rank(m_hostComm, &hostRank) || MpiFail("RingAllReduce: MPI_Comm_rank");
+                MPI_Comm_split(m_comm, hostRank == 0 ? 0 : MPI_UNDEFINED, rank, &m_ringComm) || MpiFail("RingAllReduce: MPI_Comm_split");
+            }
+            m_initialized = true;
+        }
+
+        if (!m_hierarchical)
+        {
+            Ring(m_ringComm, data, numElements);
+            return;
+        }
+
+        bool isLeader = m_ringComm != MPI_COMM_NULL;
+        MPI_Reduce(isLeader ? MPI_IN_PLACE : data, data, (int) numElements, MPIWrapper::GetDataType(data), MPI_SUM, 0, m_hostComm) || MpiFail("RingAllReduce: MPI_Reduce");
+        if (isLeader)
+            Ring(m_ringComm, data, numElements);
+        MPI_Bcast(data, (int) numElements, MPIWrapper::GetDataType(data), 0, m_hostComm) || MpiFail("RingAllReduce: MPI_Bcast");
+    }
+
+    // Bus bandwidth is the algorithm bandwidth (buffer size / time) times this factor. It is the fraction of the buffer
+    // every rank of a ring sends, and thus comparable to the peak bandwidth of the links, independent of the number of ranks.
+    static double BusBandwidthFactor(size_t numRanks)
+    {
+        return numRanks > 1 ? 2.0 * (numRanks - 1) / numRanks : 0.0;
+    }
+
+private:
+    void Ring(MPI_Comm comm, ElemType* data, size_t numElements)
+    {
+        int rank, numRanks;
+        MPI_Comm_rank(comm, &rank) || MpiFail("RingAllReduce: MPI_Comm_rank");
+        MPI_Comm_size(comm, &numRanks) || MpiFail("RingAllReduce: MPI_Comm_size");
+        if (numRanks == 1)
+            return;
+
+        const int left = (rank + numRanks - 1) % numRanks;
+        const int right = (rank + 1) % numRanks;
+        auto chunkBegin = [=](int chunk) { return numElements * chunk / numRanks; };
+        auto chunkSize = [=](int chunk) { return chunkBegin(chunk + 1) - chunkBegin(chunk); };
+        m_recvBuffer.resize(chunkSize(numRanks - 1) + 1);
+
+        // reduce-scatter: in step s, send the partial sum of chunk (rank - s) and add to chunk (rank - s - 1)
+        for (int step = 0; step < numRanks - 1; step++)
+        {
+            const int sendChunk = (rank - step + numRanks) % numRanks;
+            const int recvChunk = (rank - step - 1 + numRanks) % numRanks;
+            MPI_Sendrecv(data + chunkBegin(sendChunk), (int) chunkSize(sendChunk), MPIWrapper::GetDataType(data), right, step,
+                         m_recvBuffer.data(), (int) chunkSize(recvChunk), MPIWrapper::GetDataType(data), left, step,
+                         comm, MPI_STATUS_IGNORE) || MpiFail("RingAllReduce: MPI_Sendrecv");
+            ElemType* target = data + chunkBegin(recvChunk);
+            const ElemType* received = m_recvBuffer.data();
+            const size_t n = chunkSize(recvChunk);
+            for (size_t i = 0; i < n; i++)
+                target[i] += received[i];
+        }
+
+        // allgather: in step s, pass on the reduced chunk (rank + 1 - s) and receive chunk (rank - s)
+        for (int step = 0; step < numRanks - 1; step++)
+        {
+            const int sendChunk = (rank + 1 - step + numRanks) % numRanks;
+            const int recvChunk = (rank - step + numRanks) % numRanks;
+            MPI_Sendrecv(data + chunkBegin(sendChunk), (int) chunkSize(sendChunk), MPIWrapper::GetDataType(data), right, numRanks + step,
+                         data + chunkBegin(recvChunk), (int) chunkSize(recvChunk), MPIWrapper::GetDataType(data), left, numRanks + step,
+                         comm, MPI_STATUS_IGNORE) || MpiFail("RingAllReduce: MPI_Sendrecv");
+        }
+    }
+
+    MPI_Comm m_comm;
+    bool m_hierarchical;
+    MPI_Comm m_ringComm; // copy of m_comm, or if hierarchical, rank 0 of each host (MPI_COMM_NULL on the other ranks)
+    MPI_Comm m_hostComm; // ranks on this host (hierarchical only)
+    bool m_initialized;
+    std::vector<ElemType> m_recvBuffer;
+};
+
+}}}
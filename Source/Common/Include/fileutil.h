@@ -172,6 +172,14 @@ void unlinkOrDie(const std::wstring& pathname);
 void renameOrDie(const std::string& from, const std::string& to);
 void renameOrDie(const std::wstring& from, const std::wstring& to);
 
+// ----------------------------------------------------------------------------
+// renameReplacing(): rename() that replaces an existing destination in one step,
+// so that readers of the destination see either the old or the new file.
+// Returns false on failure.
+// ----------------------------------------------------------------------------
+
+bool renameReplacing(const std::wstring& from, const std::wstring& to);
+
 // ----------------------------------------------------------------------------
 // fexists(): test if a file exists
 // ----------------------------------------------------------------------------
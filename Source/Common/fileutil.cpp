@@ -679,6 +679,19 @@ void renameOrDie(const std::wstring& from, const std::wstring& to)
 #endif
 }
 
+// ----------------------------------------------------------------------------
+// renameReplacing(): rename() that replaces an existing destination in one step
+// ----------------------------------------------------------------------------
+
+bool renameReplacing(const std::wstring& from, const std::wstring& to)
+{
+#ifdef _WIN32
+    return MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(wtocharpath(from.c_str()).c_str(), wtocharpath(to.c_str()).c_str()) == 0;
+#endif
+}
+
 // ----------------------------------------------------------------------------
 // fputstring(): write a 0-terminated string
 // ----------------------------------------------------------------------------
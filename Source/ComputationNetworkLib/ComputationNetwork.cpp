@@ -21,6 +21,7 @@
 #include "SpecialPurposeNodes.h"
 #include "DeprecatedNodes.h" // (for SaveToDbnFile(), which is also deprecated)
 #include "MPIWrapper.h" // TODO: does not belong here
+#include "ParameterImage.h"
 #include <string>
 #include <vector>
 #include <stack>
@@ -47,6 +48,38 @@ vector<shared_ptr<Matrix<double>>>& MatrixPool::GetReleasedMatrices<double>()
     return m_releasedDoubleMatrices;
 }
 
+size_t MatrixPool::GetPlannedBytesPerSample() const
+{
+    size_t plannedBytes = 0;
+    for (const auto& iter : m_buffers)
+        plannedBytes += iter.second.plannedBytes;
+    return plannedBytes;
+}
+
+size_t MatrixPool::GetAllocatedBytes() const
+{
+    size_t allocatedBytes = 0;
+    for (const auto& iter : m_buffers)
+    {
+        MatrixBasePtr matrix = iter.second.matrix.lock();
+        if (auto floatMatrix = dynamic_pointer_cast<Matrix<float>>(matrix))
+            allocatedBytes += floatMatrix->BufferSize();
+        else if (auto doubleMatrix = dynamic_pointer_cast<Matrix<double>>(matrix))
+            allocatedBytes += doubleMatrix->BufferSize();
+    }
+    return allocatedBytes;
+}
+
+void MatrixPool::PrintStatistics() const
+{
+    fprintf(stderr, "\nMemory planning: %d requests served by %d matrices. Per sample: %.1f KB planned, %.1f KB peak of live matrices, %.1f KB without sharing.\n",
+            (int) m_numRequests, (int) m_buffers.size(),
+            GetPlannedBytesPerSample() / 1024.0, m_peakLiveBytes / 1024.0, m_unsharedBytes / 1024.0);
+    size_t allocatedBytes = GetAllocatedBytes();
+    if (allocatedBytes > 0)
+        fprintf(stderr, "Memory planning: %.1f MB currently allocated in shared matrices.\n", allocatedBytes / (1024.0 * 1024.0));
+}
+
 // -----------------------------------------------------------------------
 // construction
 // -----------------------------------------------------------------------
@@ -200,7 +233,7 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
 // This is also used for reloading a model without recreating it, e.g. during training.
 // TODO: Why not just reload it? Because SGD::Train() holds pointers to the parameters directly? That should be fixed.
 template <class ElemType> // ElemType is the default for models prior to CNTK_MODEL_VERSION_7; after that, it is serialized, and ElemType is ignored
-void ComputationNetwork::ReadPersistableParameters(File& fstream, bool create)
+void ComputationNetwork::ReadPersistableParameters(File& fstream, bool create, ParameterImage* parameterImage)
 {
     fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BCN");
 
@@ -240,7 +273,15 @@ void ComputationNetwork::ReadPersistableParameters(File& fstream, bool create)
         else
             RuntimeError("Read: Unexpected precision tag '%ls'", precision.c_str());
 
-        node->Load(fstream, modelVersion);
+        // parameter values may come from a mapped parameter image instead of the model file
+        auto floatParameter  = parameterImage ? dynamic_pointer_cast<LearnableParameter<float>>(node)  : nullptr;
+        auto doubleParameter = parameterImage ? dynamic_pointer_cast<LearnableParameter<double>>(node) : nullptr;
+        if (floatParameter)
+            floatParameter->Load(fstream, modelVersion, parameterImage);
+        else if (doubleParameter)
+            doubleParameter->Load(fstream, modelVersion, parameterImage);
+        else
+            node->Load(fstream, modelVersion);
 
         if (create) // loaded from scratch
             AddNodeToNet(node);
@@ -264,13 +305,13 @@ void ComputationNetwork::ReadPersistableParameters(File& fstream, bool create)
 // deserialize the model
 // This does not post-process the model (CompileNetwork()). Use Load() instead.
 template <class ElemType> // for ReadPersistableParameters()
-void ComputationNetwork::Read(const wstring& fileName)
+void ComputationNetwork::Read(const wstring& fileName, ParameterImage* parameterImage)
 {
     ClearNetwork();
 
     File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
 
-    ReadPersistableParameters<ElemType>(fstream, true);
+    ReadPersistableParameters<ElemType>(fstream, true, parameterImage);
 
     size_t numNodes = m_nameToNodeMap.size();
 
@@ -391,6 +432,30 @@ void ComputationNetwork::Read(const wstring& fileName)
     fstream.GetMarker(FileMarker::fileMarkerEndSection, L"ECN");
 }
 
+template <class ElemType>
+void ComputationNetwork::ReadWithMappedParameters(const wstring& fileName)
+{
+    // mapped values are only usable in place on the CPU
+    if (m_deviceId != CPUDEVICE)
+        return Read<ElemType>(fileName);
+
+    let imagePath = ParameterImage::PathFor(fileName);
+    if (!ParameterImage::IsUpToDate(imagePath, fileName))
+    {
+        // first use of this model file: read it the regular way, and write the image for next time
+        Read<ElemType>(fileName);
+        if (!ParameterImage::Write(*this, fileName, imagePath))
+        {
+            fprintf(stderr, "WARNING: ReadWithMappedParameters: Cannot write the parameter image '%ls', using the parameters read from the model.\n", imagePath.c_str());
+            return;
+        }
+    }
+
+    // the values keep the image alive; it is released when the last of them goes away
+    auto parameterImage = make_shared<ParameterImage>(imagePath);
+    Read<ElemType>(fileName, parameterImage.get());
+}
+
 // -----------------------------------------------------------------------
 // node construction
 // -----------------------------------------------------------------------
@@ -1504,8 +1569,9 @@ void ComputationNetwork::SaveToDbnFile(ComputationNetworkPtr net, const std::wst
 }
 
 template void ComputationNetwork::InitLearnableParametersWithBilinearFill<float>(const ComputationNodeBasePtr& node, size_t kernelWidth, size_t kernelHeight);
-template void ComputationNetwork::Read<float>(const wstring& fileName);
-template void ComputationNetwork::ReadPersistableParameters<float>(File& fstream, bool create);
+template void ComputationNetwork::Read<float>(const wstring& fileName, ParameterImage* parameterImage);
+template void ComputationNetwork::ReadWithMappedParameters<float>(const wstring& fileName);
+template void ComputationNetwork::ReadPersistableParameters<float>(File& fstream, bool create, ParameterImage* parameterImage);
 template void ComputationNetwork::PerformSVDecomposition<float>(const map<wstring, float>& SVDConfig, size_t alignedsize);
 template /*static*/ void ComputationNetwork::SetDropoutRate<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate);
 template /*static*/ void ComputationNetwork::SetIRngUserSeed<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t randSeedBase);
@@ -1515,8 +1581,9 @@ template void ComputationNetwork::SetSeqParam<float>(ComputationNetworkPtr net,
 template void ComputationNetwork::SaveToDbnFile<float>(ComputationNetworkPtr net, const std::wstring& fileName) const;
 
 template void ComputationNetwork::InitLearnableParametersWithBilinearFill<double>(const ComputationNodeBasePtr& node, size_t kernelWidth, size_t kernelHeight);
-template void ComputationNetwork::Read<double>(const wstring& fileName);
-template void ComputationNetwork::ReadPersistableParameters<double>(File& fstream, bool create);
+template void ComputationNetwork::Read<double>(const wstring& fileName, ParameterImage* parameterImage);
+template void ComputationNetwork::ReadWithMappedParameters<double>(const wstring& fileName);
+template void ComputationNetwork::ReadPersistableParameters<double>(File& fstream, bool create, ParameterImage* parameterImage);
 template void ComputationNetwork::PerformSVDecomposition<double>(const map<wstring, float>& SVDConfig, size_t alignedsize);
 template /*static*/ void ComputationNetwork::SetDropoutRate<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate);
 template /*static*/ void ComputationNetwork::SetIRngUserSeed<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t randSeedBase);
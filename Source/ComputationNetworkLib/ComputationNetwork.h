@@ -32,6 +32,8 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+class ParameterImage;
+
 // ===========================================================================
 // ComputationNetwork -- computation graph and operations
 // ===========================================================================
@@ -90,7 +92,7 @@ public:
     // -----------------------------------------------------------------------
 
     template <class ElemType>
-    void ReadPersistableParameters(File& fstream, bool create);
+    void ReadPersistableParameters(File& fstream, bool create, ParameterImage* parameterImage = nullptr);
     // reload node content only, e.g. used by SGD::Train() when going back to an older model that had better training objective
     template <class ElemType>
     void RereadPersistableParameters(const std::wstring& fileName)
@@ -100,7 +102,10 @@ public:
     }
     // design BUGBUG: binary files do not know whether they are float or double.
     // TODO: modify file format to know this; then eliminate the <ElemType> dependency (and in some future, allow nodes to be different)
-    template <class ElemType> void Read(const std::wstring& fileName);
+    template <class ElemType> void Read(const std::wstring& fileName, ParameterImage* parameterImage = nullptr);
+    // like Read(), but the LearnableParameter values reference a memory-mapped parameter image next to the model
+    // file instead of being copied out of it (CPU only); the image is (re-)created if it is missing or stale
+    template <class ElemType> void ReadWithMappedParameters(const std::wstring& fileName);
     template <class ElemType> void Load(const std::wstring& fileName)
     {
         Read<ElemType>(fileName);
@@ -134,7 +139,10 @@ public:
     void ForwardProp(const ComputationNodeBasePtr rootNode);
 
     // main entry point for backprop
-    void Backprop(const ComputationNodeBasePtr rootNode);
+    // If onGradientReady is given, it is called for every LearnableParameter that gets updated as soon as its gradient is
+    // final, while the remainder of the network is still being backpropagated (e.g. to start aggregating it early).
+    typedef std::function<void(const ComputationNodeBasePtr&)> GradientReadyCallback;
+    void Backprop(const ComputationNodeBasePtr rootNode, const GradientReadyCallback& onGradientReady = nullptr);
 
     template <class NODESET> // version that takes multiple nodes
     void ForwardProp(const NODESET& nodes)
@@ -192,6 +200,9 @@ private:
 public:
     void AllocateAllMatrices(const std::vector<ComputationNodeBasePtr>& evalRootNodes, const std::vector<ComputationNodeBasePtr>& outValueRootNodes, ComputationNodeBasePtr trainRootNode);
 
+    // log planned vs. actual memory of the shared matrices; call again after the first minibatch to see the actual sizes
+    void PrintMemoryPlan() const { m_matrixPool.PrintStatistics(); }
+
     // From the set of nodes extract all nodes which are used as accumulator nodes.
     std::set<ComputationNodeBasePtr> ExtractNodesWhichAccumulateResult(std::set<ComputationNodeBasePtr> nodes);
 
@@ -405,6 +416,14 @@ public:
     void AddFeatureNode(ComputationNodeBasePtr featureNode);
     //ComputationNodeBasePtr RemoveFeatureNode(ComputationNodeBasePtr featureNode);
     void SetLearnableNodesBelowLearningRateMultiplier(const float learningRateMultiplier, const ComputationNodeBasePtr& rootNode = nullptr);
+    template <class ElemType>
+    size_t ConvertTimesToQuantizedTimes(size_t bitShiftA, size_t bitShiftB);
+    template <class ElemType>
+    size_t OptimizeForInference(const std::vector<ComputationNodeBasePtr>& outputNodes);
+    template <class ElemType>
+    size_t ConvertToBlockedImageLayout(const std::vector<ComputationNodeBasePtr>& outputNodes);
+    template <class ElemType>
+    ComputationNetworkPtr CloneSharingParameters();
 
     // -----------------------------------------------------------------------
     // node access
@@ -1111,6 +1130,7 @@ protected:
         {
         }
         virtual void Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) override;
+        void Backprop(const FrameRange& fr, const GradientReadyCallback& onGradientReady);
         virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool);
         virtual void ReleaseMatricesAfterForwardProp(MatrixPool& matrixPool);
         virtual void AllocateGradientMatricesForInputs(MatrixPool& matrixPool);
@@ -10,6 +10,11 @@
 #include "ComputationNetwork.h"
 #include "InputAndParamNodes.h"
 #include "TrainingNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "NonlinearityNodes.h"
+#include "ReshapingNodes.h"
+#include "ConvolutionalNodes.h"
+#include "BlockedLayout.h"
 #include <string>
 #include <vector>
 #include <list>
@@ -367,4 +372,493 @@ void ComputationNetwork::SetLearnableNodesBelowLearningRateMultiplier(const floa
     }
 }
 
+// replace all TimesNodes that multiply a LearnableParameter with a non-constant right operand by QuantizedTimesNodes,
+// which compute the product in 16-bit integers (inference on the CPU only)
+// A QuantizedTimesNode computes products with a sparse operand unquantized, so TimesNodes whose right operand is
+// a sparse input are kept (and reported with traceLevel > 0).
+// Returns the number of nodes replaced. The network must be compiled again afterwards.
+template <class ElemType>
+size_t ComputationNetwork::ConvertTimesToQuantizedTimes(size_t bitShiftA, size_t bitShiftB)
+{
+    if (GetDeviceId() != CPUDEVICE)
+        InvalidArgument("ConvertTimesToQuantizedTimes: Quantized products are only supported on the CPU.");
+
+    // collect them first, since ReplaceNode() modifies the node map
+    vector<shared_ptr<TimesNode<ElemType>>> timesNodes;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        auto node = dynamic_pointer_cast<TimesNode<ElemType>>(iter.second);
+        if (node &&
+            dynamic_pointer_cast<LearnableParameter<ElemType>>(node->GetInputs()[0]) &&
+            !dynamic_pointer_cast<LearnableParameter<ElemType>>(node->GetInputs()[1]))
+        {
+            // the value matrices of inputs exist before the network is compiled; those of other nodes may not
+            auto rightValue = dynamic_pointer_cast<Matrix<ElemType>>(node->GetInputs()[1]->ValuePtr());
+            if (rightValue && rightValue->GetMatrixType() == MatrixType::SPARSE)
+            {
+                if (TraceLevel() > 0)
+                    fprintf(stderr, "ConvertTimesToQuantizedTimes: Keeping the Times node %ls, since its right operand %ls is sparse.\n",
+                            node->NodeName().c_str(), node->GetInputs()[1]->NodeName().c_str());
+                continue;
+            }
+            timesNodes.push_back(node);
+        }
+    }
+
+    for (const auto& node : timesNodes)
+    {
+        auto quantizedNode = New<QuantizedTimesNode<ElemType>>(GetDeviceId(), node->NodeName(), bitShiftA, bitShiftB, node->OutputRank(), node->InferInputRankToMap());
+        ReplaceNode(node->NodeName(), quantizedNode);
+    }
+
+    return timesNodes.size();
+}
+
+template size_t ComputationNetwork::ConvertTimesToQuantizedTimes<float>(size_t bitShiftA, size_t bitShiftB);
+template size_t ComputationNetwork::ConvertTimesToQuantizedTimes<double>(size_t bitShiftA, size_t bitShiftB);
+
+// rewrite the network for faster inference (inference only, the network cannot be trained afterwards)
+//  - Nodes whose inputs are all LearnableParameters, directly or through other such nodes, are evaluated once and
+//    replaced by a LearnableParameter with learning rate multiplier 0 that holds their value.
+//  - Nodes that pass their input through in inference (Pass, Dropout, and Reshape to the same shape) are bypassed.
+//  - A BatchNormalization of the output of a Convolution or Times whose weights are a LearnableParameter, possibly
+//    with a LearnableParameter bias added by a Plus, is folded into the weights: the weights of output channel k are
+//    scaled by a[k] = scale[k] / sqrt(runVariance[k] + epsilon), and the BatchNormalization is replaced by a Plus of
+//    a[k] * (b[k] - runMean[k]) + bias[k], where b is the bias added before (or 0) and bias the one of the BatchNormalization.
+// Nodes in outputNodes or in a node group are neither bypassed nor changed, and a node is only folded into another
+// if nothing else uses its value. Nodes that are left without consumers are removed. Applying this again changes nothing.
+// Returns the number of nodes removed. The network must be compiled and in inference mode before and be compiled again afterwards.
+template <class ElemType>
+size_t ComputationNetwork::OptimizeForInference(const std::vector<ComputationNodeBasePtr>& outputNodes)
+{
+    VerifyIsCompiled("OptimizeForInference");
+    if (!Environment().IsInferring())
+        InvalidArgument("OptimizeForInference: The network must be in inference mode.");
+    const size_t numNodesBefore = m_nameToNodeMap.size();
+
+    set<ComputationNodeBasePtr> protectedNodes(outputNodes.begin(), outputNodes.end());
+    for (auto group : GetAllNodeGroups())
+        protectedNodes.insert(group->begin(), group->end());
+    auto isProtected = [&](const ComputationNodeBasePtr& node) { return protectedNodes.find(node) != protectedNodes.end(); };
+    auto numUses = [&](const ComputationNodeBasePtr& node)
+    {
+        size_t uses = 0;
+        for (const auto& iter : m_nameToNodeMap)
+            uses += count(iter.second->GetInputs().begin(), iter.second->GetInputs().end(), node);
+        return uses;
+    };
+
+    // the consumers of a removed node use replacement instead; its inputs may be left without consumers
+    set<ComputationNodeBasePtr> orphanCandidates;
+    auto removeNode = [&](const ComputationNodeBasePtr& node, const ComputationNodeBasePtr& replacement)
+    {
+        ChangeNodeInputs(node, replacement);
+        orphanCandidates.insert(node->GetInputs().begin(), node->GetInputs().end());
+        node->DetachInputs();
+        RemoveNodeFromNet(node);
+    };
+
+    // constant folding, which needs the evaluation order and thus comes first
+    set<ComputationNodeBasePtr> constants;
+    for (const auto& node : GetEvalOrder(nullptr))
+    {
+        bool isConstant;
+        if (node->IsLeaf())
+            isConstant = dynamic_pointer_cast<LearnableParameter<ElemType>>(node) != nullptr;
+        else
+        {
+            isConstant = !node->HasMBLayout() && !node->RequiresPreCompute() && node->GetSampleLayout().GetRank() > 0 &&
+                         dynamic_pointer_cast<ComputationNode<ElemType>>(node) &&
+                         !dynamic_pointer_cast<IRngUser>(node) && !dynamic_pointer_cast<IStatefulNode>(node);
+            for (const auto& input : node->GetInputs())
+                isConstant = isConstant && constants.find(input) != constants.end();
+        }
+        if (isConstant)
+            constants.insert(node);
+    }
+    // Evaluating them in the evaluation order is safe if matrices have already been allocated and are shared with
+    // other nodes, but a shared value may be overwritten later, so it is copied right away.
+    MatrixPool matrixPool; // for the nodes that do not have matrices yet
+    map<ComputationNodeBasePtr, Matrix<ElemType>> constantValues;
+    for (const auto& node : GetEvalOrder(nullptr))
+    {
+        if (node->IsLeaf() || constants.find(node) == constants.end())
+            continue;
+        node->RequestMatricesBeforeForwardProp(matrixPool);
+        node->BeginForwardProp();
+        node->ForwardProp(FrameRange(nullptr));
+        node->EndForwardProp();
+        const auto& value = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value();
+        if (value.GetMatrixType() == MatrixType::DENSE)
+            constantValues.emplace(node, value.DeepClone());
+    }
+
+    InvalidateCompiledNetwork();
+
+    // replace the constants that are used by other nodes, which leaves the ones they are computed from without consumers
+    for (const auto& node : constants)
+    {
+        if (node->IsLeaf() || isProtected(node))
+            continue;
+        bool usedByOthers = false;
+        for (const auto& iter : m_nameToNodeMap)
+        {
+            const auto& inputs = iter.second->GetInputs();
+            if (constants.find(iter.second) == constants.end() && find(inputs.begin(), inputs.end(), node) != inputs.end())
+                usedByOthers = true;
+        }
+        auto value = constantValues.find(node);
+        if (!usedByOthers || value == constantValues.end())
+            continue;
+        ComputationNodeBasePtr parameter = New<LearnableParameter<ElemType>>(GetDeviceId(), node->NodeName(), node->GetSampleLayout());
+        dynamic_pointer_cast<ComputationNode<ElemType>>(parameter)->Value().SetValue(value->second);
+        parameter->SetLearningRateMultiplier(0);
+        removeNode(node, parameter);
+        AddNodeToNet(parameter);
+    }
+
+    // bypass nodes that pass their input through
+    list<ComputationNodeBasePtr> nodes;
+    for (const auto& iter : m_nameToNodeMap)
+        nodes.push_back(iter.second);
+    for (const auto& node : nodes)
+    {
+        if ((!dynamic_pointer_cast<PassNode<ElemType>>(node) && !dynamic_pointer_cast<DropoutNode<ElemType>>(node) && !dynamic_pointer_cast<ReshapeNode<ElemType>>(node)) ||
+            isProtected(node))
+        {
+            continue;
+        }
+        const auto input = node->Input(0);
+        if (input->GetSampleLayout() == node->GetSampleLayout() && input->GetMBLayout() == node->GetMBLayout())
+            removeNode(node, input);
+    }
+
+    // fold BatchNormalization into the preceding Convolution or Times
+    auto toVector = [](const ComputationNodeBasePtr& node)
+    {
+        const auto& matrix = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value();
+        vector<ElemType> result(matrix.GetNumElements());
+        ElemType* data = result.data();
+        size_t size = result.size();
+        matrix.CopyToArray(data, size); // does not reallocate, since the size fits
+        return result;
+    };
+    for (const auto& node : nodes)
+    {
+        auto batchNormNode = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(node);
+        if (!batchNormNode || isProtected(node) || m_nameToNodeMap.find(node->NodeName()) == m_nameToNodeMap.end())
+            continue;
+        auto isParameter = [](const ComputationNodeBasePtr& p) { return dynamic_pointer_cast<LearnableParameter<ElemType>>(p) != nullptr; };
+        vector<ComputationNodeBasePtr> statistics(node->GetInputs().begin() + 1, node->GetInputs().end()); // scale, bias, runMean, runVariance
+        if (!all_of(statistics.begin(), statistics.end(), isParameter))
+            continue;
+
+        // producer, or Plus(producer, bias)
+        ComputationNodeBasePtr producer = node->GetInputs()[0];
+        ComputationNodeBasePtr biasPlus;
+        ComputationNodeBasePtr bias;
+        if (dynamic_pointer_cast<PlusNode<ElemType>>(producer))
+        {
+            biasPlus = producer;
+            for (size_t i = 0; i < 2 && !bias; i++)
+            {
+                if (isParameter(biasPlus->GetInputs()[i]))
+                {
+                    bias = biasPlus->GetInputs()[i];
+                    producer = biasPlus->GetInputs()[1 - i];
+                }
+            }
+            if (!bias || isProtected(biasPlus) || isProtected(bias) || numUses(biasPlus) != 1 || numUses(bias) != 1)
+                continue;
+        }
+        if (isProtected(producer) || numUses(producer) != 1 || producer->GetNumInputs() == 0)
+            continue;
+        ComputationNodeBasePtr weights = producer->GetInputs()[0];
+        if (!isParameter(weights) || isProtected(weights) || numUses(weights) != 1)
+            continue;
+
+        // The factors are applied to the columns (Convolution, one kernel per output channel) or rows (Times) of the weights.
+        const size_t n = statistics[0]->GetSampleLayout().GetNumElements();
+        const auto& shape = producer->GetSampleLayout();
+        const size_t rank = shape.GetRank();
+        const size_t weightsSize = weights->GetSampleLayout().GetNumElements();
+        bool perColumn;
+        TensorShape biasShape;
+        if (auto convolutionNode = dynamic_pointer_cast<ConvolutionNode<ElemType>>(producer))
+        {
+            // spatial BatchNormalization has a factor per output channel, the last axis
+            const size_t kernelSize = convolutionNode->KernelSizePerOutputChannel();
+            if (!batchNormNode->Spatial() || rank == 0 || shape[rank - 1] != n || kernelSize == 0 || kernelSize * n != weightsSize)
+                continue;
+            auto dims = shape.GetDims();
+            for (size_t i = 0; i + 1 < rank; i++)
+                dims[i] = 1;
+            biasShape = TensorShape(dims);
+            perColumn = true;
+        }
+        else if (auto timesNode = dynamic_pointer_cast<TimesNode<ElemType>>(producer))
+        {
+            // the output dimensions are the leading dimensions of the weights
+            const auto& weightsShape = weights->GetSampleLayout();
+            size_t numRows = 1;
+            for (size_t i = 0; i < timesNode->OutputRank() && i < weightsShape.GetRank(); i++)
+                numRows *= weightsShape[i];
+            if (shape.GetNumElements() != n || numRows != n)
+                continue;
+            biasShape = shape;
+            perColumn = false;
+        }
+        else
+            continue;
+        if (bias && !(bias->GetSampleLayout() == biasShape))
+            continue;
+
+        auto scale = toVector(statistics[0]);
+        auto shift = toVector(statistics[1]);
+        auto runMean = toVector(statistics[2]);
+        auto runVariance = toVector(statistics[3]);
+        auto oldBias = bias ? toVector(bias) : vector<ElemType>(n, 0);
+        vector<ElemType> factors(n), newBias(n);
+        for (size_t k = 0; k < n; k++)
+        {
+            factors[k] = (ElemType)(scale[k] / sqrt(runVariance[k] + batchNormNode->Epsilon()));
+            newBias[k] = shift[k] + factors[k] * (oldBias[k] - runMean[k]);
+        }
+
+        auto& weightsValue = dynamic_pointer_cast<ComputationNode<ElemType>>(weights)->Value();
+        auto weightsMatrix = weightsValue.ColumnSlice(0, weightsValue.GetNumCols());
+        if (perColumn)
+        {
+            weightsMatrix.Reshape(weightsSize / n, n);
+            weightsMatrix.RowElementMultiplyWith(Matrix<ElemType>(1, n, factors.data(), GetDeviceId()));
+        }
+        else
+        {
+            weightsMatrix.Reshape(n, weightsSize / n);
+            weightsMatrix.ColumnElementMultiplyWith(Matrix<ElemType>(n, 1, factors.data(), GetDeviceId()));
+        }
+
+        auto biasValue = New<LearnableParameter<ElemType>>(GetDeviceId(), node->NodeName() + L".foldedBias", biasShape);
+        biasValue->Value().SetValue(biasValue->Value().GetNumRows(), biasValue->Value().GetNumCols(), GetDeviceId(), newBias.data());
+        ComputationNodeBasePtr biasNode = biasValue;
+        biasNode->SetLearningRateMultiplier(0);
+        AddNodeToNetIfNotYet(biasNode, /*makeUniqueName=*/ true);
+        ComputationNodeBasePtr plusNode = New<PlusNode<ElemType>>(GetDeviceId(), node->NodeName());
+        plusNode->AttachInputs({ producer, biasNode });
+        removeNode(node, plusNode);
+        AddNodeToNet(plusNode);
+    }
+
+    // remove the nodes that have been left without consumers
+    while (!orphanCandidates.empty())
+    {
+        auto node = *orphanCandidates.begin();
+        orphanCandidates.erase(orphanCandidates.begin());
+        if (m_nameToNodeMap.find(node->NodeName()) != m_nameToNodeMap.end() && m_nameToNodeMap[node->NodeName()] == node &&
+            !isProtected(node) && numUses(node) == 0)
+        {
+            removeNode(node, nullptr);
+        }
+    }
+
+    return numNodesBefore - m_nameToNodeMap.size();
+}
+
+template size_t ComputationNetwork::OptimizeForInference<float>(const std::vector<ComputationNodeBasePtr>& outputNodes);
+template size_t ComputationNetwork::OptimizeForInference<double>(const std::vector<ComputationNodeBasePtr>& outputNodes);
+
+// keep the image values between CPU Convolution, Pooling and BatchNormalization nodes in the blocked layout of
+// BlockedLayout.h, which their engines process faster (inference only)
+// A value is kept blocked if it has a multiple of BlockedLayout::ChannelBlockSize channels, is neither one of the
+// outputNodes nor a root, and all nodes that consume it take it blocked: Convolution, Pooling and BatchNormalization
+// nodes as their image input, and elementwise nodes (e.g. Plus of a ResNet shortcut, or ReLU) whose inputs all have
+// its shape and are all blocked. The layout is converted only where such a region of the network begins or ends, by
+// the engines of the nodes at its border. A broadcasting Plus, e.g. of a convolution bias, ends a region.
+// Returns the number of nodes whose values are blocked. The network must be compiled before and again afterwards.
+template <class ElemType>
+size_t ComputationNetwork::ConvertToBlockedImageLayout(const std::vector<ComputationNodeBasePtr>& outputNodes)
+{
+    VerifyIsCompiled("ConvertToBlockedImageLayout");
+    if (GetDeviceId() != CPUDEVICE)
+        InvalidArgument("ConvertToBlockedImageLayout: The blocked layout is only supported on the CPU.");
+
+    // index of the image input of the nodes that support the blocked layout, or -1
+    auto blockedInputIndex = [](const ComputationNodeBasePtr& node) -> int
+    {
+        if (auto convolutionNode = dynamic_pointer_cast<ConvolutionNode<ElemType>>(node))
+            return convolutionNode->SupportsBlockedLayout() ? 1 : -1;
+        if (auto poolingNode = dynamic_pointer_cast<PoolingNode<ElemType>>(node))
+            return poolingNode->SupportsBlockedLayout() ? 0 : -1;
+        if (auto batchNormNode = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(node))
+            return batchNormNode->SupportsBlockedLayout() ? 0 : -1;
+        return -1;
+    };
+    auto isElementwise = [](const ComputationNodeBasePtr& node)
+    {
+        if (!dynamic_pointer_cast<IdentityTransformerNode>(node) || node->GetNumInputs() == 0)
+            return false;
+        for (const auto& input : node->GetInputs())
+        {
+            if (input->GetSampleLayout() != node->GetSampleLayout() || input->GetMBLayout() != node->GetMBLayout())
+                return false;
+        }
+        return true;
+    };
+
+    // start with all candidates and remove the ones that violate a condition, until none does
+    map<ComputationNodeBasePtr, vector<ComputationNodeBasePtr>> consumers;
+    set<ComputationNodeBasePtr> blocked;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        for (const auto& input : node->GetInputs())
+            consumers[input].push_back(node);
+        const auto& shape = node->GetSampleLayout();
+        if ((blockedInputIndex(node) >= 0 || isElementwise(node)) &&
+            shape.GetRank() == 3 && shape[2] % BlockedLayout::ChannelBlockSize == 0)
+        {
+            blocked.insert(node);
+        }
+    }
+    for (const auto& node : outputNodes)
+        blocked.erase(node);
+
+    auto takesBlocked = [&](const ComputationNodeBasePtr& consumer, const ComputationNodeBasePtr& node)
+    {
+        if (isElementwise(consumer))
+            return blocked.find(consumer) != blocked.end();
+        int index = blockedInputIndex(consumer);
+        if (index < 0)
+            return false;
+        for (size_t i = 0; i < consumer->GetNumInputs(); i++)
+        {
+            if (consumer->GetInputs()[i] == node && i != (size_t)index)
+                return false;
+        }
+        return true;
+    };
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (auto iter = blocked.begin(); iter != blocked.end();)
+        {
+            const auto& node = *iter;
+            bool keep = consumers.find(node) != consumers.end();
+            if (keep && isElementwise(node))
+            {
+                for (const auto& input : node->GetInputs())
+                    keep = keep && blocked.find(input) != blocked.end();
+            }
+            if (keep)
+            {
+                for (const auto& consumer : consumers[node])
+                    keep = keep && takesBlocked(consumer, node);
+            }
+            if (keep)
+                iter++;
+            else
+            {
+                iter = blocked.erase(iter);
+                changed = true;
+            }
+        }
+    }
+
+    // configure all nodes that support the blocked layout, which also resets them to the plain layout if needed
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        int index = blockedInputIndex(node);
+        if (index < 0)
+            continue;
+        bool blockedInput = blocked.find(node->GetInputs()[index]) != blocked.end();
+        bool blockedOutput = blocked.find(node) != blocked.end();
+        if (auto convolutionNode = dynamic_pointer_cast<ConvolutionNodeBase<ElemType>>(node))
+            convolutionNode->SetBlockedLayout(blockedInput, blockedOutput);
+        else
+            dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(node)->SetBlockedLayout(blockedInput, blockedOutput);
+    }
+
+    return blocked.size();
+}
+
+template size_t ComputationNetwork::ConvertToBlockedImageLayout<float>(const std::vector<ComputationNodeBasePtr>& outputNodes);
+template size_t ComputationNetwork::ConvertToBlockedImageLayout<double>(const std::vector<ComputationNodeBasePtr>& outputNodes);
+
+// create a copy of this network that can be evaluated concurrently with it
+// All nodes are duplicated, so that the copy has its own activations, MBLayouts and evaluation state, except for the
+// values of LearnableParameters and precomputed nodes, which are shared with this network, i.e. the model parameters
+// exist only once. They must not be modified while copies are in use. The copy is compiled, but not yet allocated.
+// This network must not be evaluated while this is called, since its values are taken out temporarily.
+template <class ElemType>
+ComputationNetworkPtr ComputationNetwork::CloneSharingParameters()
+{
+    VerifyIsCompiled("CloneSharingParameters");
+
+    auto net = make_shared<ComputationNetwork>(GetDeviceId());
+    net->SetTraceLevel(TraceLevel());
+    net->SetRandomSeedOffset(GetRandomSeedOffset());
+
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        auto node = dynamic_pointer_cast<ComputationNode<ElemType>>(iter.second);
+        if (!node)
+            LogicError("CloneSharingParameters: Node %ls does not match the element type of the network.", iter.second->NodeDescription().c_str());
+
+        bool isModelState = dynamic_pointer_cast<LearnableParameter<ElemType>>(node) || dynamic_pointer_cast<IPreComputeNode>(node);
+        bool isComputed = !isModelState && node->GetNumInputs() > 0;
+        if (!isModelState && !isComputed)
+        {
+            // input or other leaf: gets its own copy
+            net->AddNodeToNet(node->Duplicate(node->NodeName(), CopyNodeFlags::copyNodeValue));
+            continue;
+        }
+
+        // take the value out, so that Duplicate() does not copy it
+        shared_ptr<Matrix<ElemType>> value;
+        value.swap(node->ValuePtrRef());
+        ComputationNodeBasePtr newNode;
+        try
+        {
+            newNode = node->Duplicate(node->NodeName(), CopyNodeFlags::copyNodeValue);
+        }
+        catch (...)
+        {
+            value.swap(node->ValuePtrRef());
+            throw;
+        }
+        value.swap(node->ValuePtrRef());
+
+        if (isModelState)
+            dynamic_pointer_cast<ComputationNode<ElemType>>(newNode)->ValuePtrRef() = node->ValuePtrRef();
+        else
+            newNode->SetEvalTimeStampOutdatedWrtAll(); // activations are requested from the matrix pool of the copy, and must be computed
+        net->AddNodeToNet(newNode);
+    }
+
+    // link up the copies of the inputs
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        if (node->GetNumInputs() == 0)
+            continue;
+        vector<ComputationNodeBasePtr> inputs;
+        for (const auto& input : node->GetInputs())
+            inputs.push_back(net->GetNodeFromName(input->NodeName()));
+        net->GetNodeFromName(node->NodeName())->AttachInputs(inputs);
+    }
+
+    for (const auto& groupTag : { L"feature", L"label", L"criterion", L"evaluation", L"output" })
+    {
+        for (const auto& node : GetNodeGroup(groupTag))
+            net->AddToNodeGroup(groupTag, net->GetNodeFromName(node->NodeName()));
+    }
+
+    net->CompileNetwork();
+    return net;
+}
+
+template ComputationNetworkPtr ComputationNetwork::CloneSharingParameters<float>();
+template ComputationNetworkPtr ComputationNetwork::CloneSharingParameters<double>();
+
 }}}
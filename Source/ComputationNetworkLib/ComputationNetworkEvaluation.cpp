@@ -11,6 +11,7 @@
 #include "RecurrentNodes.h"
 #include "InputAndParamNodes.h"
 #include "LinearAlgebraNodes.h"
+#include "PerformanceProfiler.h"
 #include <string>
 #include <vector>
 #include <list>
@@ -64,7 +65,8 @@ static bool SetRootGradientToScalarOne(ComputationNodeBasePtr nodep)
 //  - ForwardProp() for eval nodes
 //  - ForwardProp() for the training criterion (which will reuse computation results from the previous step)
 //  - Backprop() for the training criterion
-void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode) // training criterion to compute the gradients for
+void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode, // training criterion to compute the gradients for
+                                  const GradientReadyCallback& onGradientReady)
 {
     if (!Environment().IsTraining())
         LogicError("Backprop: Requires network is to be in training mode.");
@@ -77,7 +79,10 @@ void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode) // trai
     ZeroInputGradients(rootNode);
 
     // backpropagate through the network
-    GetNestedNetwork(rootNode)->Backprop(FrameRange(nullptr), true, true);
+    let nestedNetwork = dynamic_pointer_cast<PARTraversalFlowControlNode>(GetNestedNetwork(rootNode));
+    if (!nestedNetwork)
+        LogicError("Backprop: Nested network for %ls %ls operation is not a PARTraversalFlowControlNode.", rootNode->NodeName().c_str(), rootNode->OperationName().c_str());
+    nestedNetwork->Backprop(FrameRange(nullptr), onGradientReady);
 }
 
 void ComputationNetwork::FormNestedNetwork(const ComputationNodeBasePtr& rootNode)
@@ -142,6 +147,7 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 #endif
         if (node->IsOutOfDateWrtInputs())
         {
+            TRACE_SCOPE(node->NodeName(), profilerTraceForward);
             node->BeginForwardProp();
             node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
             node->EndForwardProp();
@@ -157,11 +163,16 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) /*override*/
 {
     childrenInThisLoop, childrenInOuterLoop; // TODO: think through what these mean when coming from PAR mode
+    Backprop(fr, nullptr);
+}
+void ComputationNetwork::PARTraversalFlowControlNode::Backprop(const FrameRange& fr, const GradientReadyCallback& onGradientReady)
+{
     // process nodes in pre-determined order
     for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++) // iterate backwards over evaluation order
     {
         auto& node = *pnode;
 
+        TRACE_SCOPE(node->NodeName(), profilerTraceBackward);
         node->BeginBackprop();
         node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
         node->EndBackprop();
@@ -169,6 +180,10 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
         // Extreme Tracing, part 2/4
         if (node->HasEnvironmentPtr() && node->Environment().ShouldDumpNode() && node->NeedsGradient())
             DumpNode<float>(node, /*dumpGradient=*/true) || DumpNode<double>(node, true);
+
+        // All consumers of a node come after it in evaluation order, so a parameter's gradient is final once we get to it.
+        if (onGradientReady && node->IsParameterUpdateRequired() && node->NeedsGradient())
+            onGradientReady(node);
     }
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) /*override*/
@@ -250,6 +265,7 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     {
         for (auto& node : m_nestedNodes)
         {
+            TRACE_SCOPE(node->NodeName(), profilerTraceForward);
             node->ForwardProp(t);
             node->BumpEvalTimeStamp();
         }
@@ -290,6 +306,7 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
         for (auto nodeIter2 = recurrentNodes.rbegin(); nodeIter2 != recurrentNodes.rend(); ++nodeIter2)
         {
             auto& node2 = *nodeIter2;
+            TRACE_SCOPE(node2->NodeName(), profilerTraceBackward);
             node2->Backprop(t, true /*childrenInThisLoop*/, false /*childrenInOuterLoop*/);
             // The above flags tell Backprop() to skip back-propagation from inside a node into
             // a node that is outside the loop, which is done later in EndBackprop() in PAR mode.
@@ -314,6 +331,7 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     for (auto nodeIter2 = m_nestedNodes.rbegin(); nodeIter2 != m_nestedNodes.rend(); ++nodeIter2)
     {
         auto& node2 = *nodeIter2;
+        TRACE_SCOPE(node2->NodeName(), profilerTraceBackward);
         node2->Backprop(FrameRange(m_nestedNodes[0]->GetMBLayout()), false /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
     }
 
@@ -989,6 +1007,7 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
         fprintf(stderr, "\n\nAllocating matrices for forward and/or backward propagation.\n");
 
     VerifyIsCompiled("AllocateAllMatrices");
+    m_matrixPool.ResetStatistics();
 
     std::vector<ComputationNodeBasePtr> forwardPropRoots;
     forwardPropRoots.insert(forwardPropRoots.end(), evalRootNodes.begin(), evalRootNodes.end());
@@ -1131,7 +1150,10 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
 
     // print the memory sharing structure
     if (TraceLevel() > 0)
+    {
         PrintMemorySharingStructure(GetAllNodes());
+        PrintMemoryPlan();
+    }
 }
 
 void ComputationNetwork::ReleaseMatricesAfterEvalForChildren(ComputationNodeBasePtr n, std::unordered_map<ComputationNodeBasePtr, std::unordered_set<ComputationNodeBasePtr>>& parentsMap)
@@ -1868,7 +1868,7 @@ protected:
     {
         if (matrixPtr == nullptr)
         {
-            matrixPtr = matrixPool.Request<ElemType>(m_deviceId);
+            matrixPtr = matrixPool.Request<ElemType>(m_deviceId, GetSampleLayout().GetNumElements()); // value, gradient, and temps are assumed to scale like the output
         }
     }
 
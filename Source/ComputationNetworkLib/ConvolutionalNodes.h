@@ -53,7 +53,7 @@ class ConvolutionNodeBase : public ComputationNode<ElemType>
 
 public:
     ConvolutionNodeBase(DEVICEID_TYPE deviceId, const wstring& name)
-        : Base(deviceId, name), m_poolKind(PoolKind::None), m_transpose(false), m_maxTempMemSizeInSamples(0)
+        : Base(deviceId, name), m_poolKind(PoolKind::None), m_transpose(false), m_maxTempMemSizeInSamples(0), m_blockedInput(false), m_blockedOutput(false)
     {
     }
     ConvolutionNodeBase(DEVICEID_TYPE deviceId, const wstring& name, const TensorShape& kernelShape, const TensorShape& mapCount, const TensorShape& strideShape,
@@ -61,7 +61,7 @@ public:
                         PoolKind poolKind, bool transpose, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples)
                         : Base(deviceId, name), m_kernelShape(kernelShape), m_mapCount(mapCount), m_stride(strideShape), m_sharing(sharing),
                         m_autoPad(autoPadding), m_lowerPad(lowerPad), m_upperPad(upperPad), m_poolKind(poolKind), m_transpose(transpose),
-                        m_imageLayout(imageLayout), m_maxTempMemSizeInSamples(maxTempMemSizeInSamples)
+                        m_imageLayout(imageLayout), m_maxTempMemSizeInSamples(maxTempMemSizeInSamples), m_blockedInput(false), m_blockedOutput(false)
     {
     }
 
@@ -128,6 +128,8 @@ public:
             node->m_transpose = m_transpose;
             node->m_imageLayout = m_imageLayout;
             node->m_maxTempMemSizeInSamples = m_maxTempMemSizeInSamples;
+            node->m_blockedInput = m_blockedInput;
+            node->m_blockedOutput = m_blockedOutput;
         }
     }
 
@@ -151,6 +153,21 @@ public:
     size_t MaxTempMemSizeInSamples() const { return m_maxTempMemSizeInSamples; }
     PoolKind PoolingKind() const { return m_poolKind; }
 
+    // Inference only: whether the image input and the output value are in the blocked layout of BlockedLayout.h,
+    // see ComputationNetwork::ConvertToBlockedImageLayout(). The engine is recreated on the next validation.
+    bool SupportsBlockedLayout() const
+    {
+        return m_convEng != nullptr && !m_transpose && m_imageLayout == ImageLayoutKind::CHW &&
+               ConvolutionEngine<ElemType>::IsBlockedLayoutSupported(m_convEng->Geometry(), m_deviceId, m_poolKind);
+    }
+    void SetBlockedLayout(bool blockedInput, bool blockedOutput)
+    {
+        if (blockedInput != m_blockedInput || blockedOutput != m_blockedOutput)
+            m_convEng.reset();
+        m_blockedInput = blockedInput;
+        m_blockedOutput = blockedOutput;
+    }
+
     // bottomlessly expand shape to filterRank, then expand to inputRank using defaults or given 'from' values
     template<class V, typename T>
     static void FixVectorShape(size_t filterRank, size_t inputRank, V& shape, T deflt, const V& from = V())
@@ -222,6 +239,9 @@ protected:
     size_t m_maxTempMemSizeInSamples;
     shared_ptr<Matrix<ElemType>> m_tempMatrix;
 
+    bool m_blockedInput;
+    bool m_blockedOutput;
+
     std::unique_ptr<ConvolutionEngine<ElemType>> m_convEng;
 };
 
@@ -241,6 +261,8 @@ protected:                                  \
     using Base::m_maxTempMemSizeInSamples;  \
     using Base::m_tempMatrix;               \
     using Base::m_convEng;                  \
+    using Base::m_blockedInput;             \
+    using Base::m_blockedOutput;            \
     using Base::InferReductionDims;         \
 public:
 
@@ -482,9 +504,12 @@ public:
                 auto geometry = std::make_shared<ConvolveGeometry>(!m_transpose ? inputShape : outputShape,
                                                                    m_kernelShape, m_mapCount, m_stride, 
                                                                    m_sharing, m_autoPad, m_lowerPad, m_upperPad);
+                bool blocked = m_blockedInput || m_blockedOutput;
                 m_convEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, m_imageLayout,
                                                                 m_maxTempMemSizeInSamples, m_poolKind,
-                                                                ConvolutionEngineKind::All, NodeName(), Globals::ShouldForceDeterministicAlgorithms());
+                                                                blocked ? ConvolutionEngineKind::Blocked : ConvolutionEngineKind::All,
+                                                                NodeName(), Globals::ShouldForceDeterministicAlgorithms());
+                m_convEng->SetBlockedLayout(m_blockedInput, m_blockedOutput);
             }
 
             if (Input(0)->GetSampleLayout().GetNumElements() != m_kernelShape.GetNumElements() * m_convEng->Geometry()->KernelCount())
@@ -518,6 +543,21 @@ public:
 
     bool IsConvolution2D() const { return m_convolution2D; }
 
+    // Number of consecutive elements of the weights that form the kernel of each output channel, or 0 if the output
+    // channels do not have kernels of their own in this form (deconvolution, legacy layouts, or no full sharing).
+    // Used to fold a following batch normalization into the weights, see ComputationNetwork::OptimizeForInference().
+    size_t KernelSizePerOutputChannel() const
+    {
+        if (m_transpose || m_convolution2D || m_imageLayout != ImageLayoutKind::CHW)
+            return 0;
+        for (bool sharing : m_sharing)
+        {
+            if (!sharing)
+                return 0;
+        }
+        return m_kernelShape.GetNumElements();
+    }
+
 private:
     using TransformerNode::m_transforms;
     using ConvolutionNodeBase<ElemType>::ComputeFilterTransform;
@@ -804,9 +844,11 @@ public:
             {
                 auto geometry = std::make_shared<ConvolveGeometry>(inputShape, m_kernelShape, m_mapCount, m_stride,
                                                                    m_sharing, m_autoPad, m_lowerPad, m_upperPad);
+                bool blocked = m_blockedInput || m_blockedOutput;
                 m_convEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, m_imageLayout,
                                                                 m_maxTempMemSizeInSamples, m_poolKind,
-                                                                ConvolutionEngineKind::All, NodeName());
+                                                                blocked ? ConvolutionEngineKind::Blocked : ConvolutionEngineKind::All, NodeName());
+                m_convEng->SetBlockedLayout(m_blockedInput, m_blockedOutput);
             }
         }
     }
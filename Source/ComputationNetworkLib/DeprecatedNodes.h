@@ -100,8 +100,23 @@ public:
         auto mean      = Input(1)->ValueTensorFor(rank, fr.AllowBroadcast());
         auto invStdDev = Input(2)->ValueTensorFor(rank, fr.AllowBroadcast());
 
-        output.AssignDifferenceOf(input, mean);               // output = input - mean
-        output.AssignElementwiseProductOf(output, invStdDev); // output *= invStdDev
+        // output = (input - mean) .* invStdDev, in a single pass
+        ElementwiseOpChain chain(3);
+        chain.Binary(ElementWiseOperator::opElementwiseProduct, chain.Binary(ElementWiseOperator::opDifference, 0, 1), 2);
+        output.AssignChainOf(chain, { input, mean, invStdDev }, 1.0f, m_chainWorkspace);
+    }
+
+    // the chain's intermediate results when it is evaluated op by op
+    virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override
+    {
+        Base::RequestMatricesBeforeForwardProp(matrixPool);
+        RequestMatrixFromPool(m_chainWorkspace, matrixPool);
+    }
+
+    virtual void ReleaseMatricesAfterForwardProp(MatrixPool& matrixPool) override
+    {
+        Base::ReleaseMatricesAfterForwardProp(matrixPool);
+        ReleaseMatrixToPool(m_chainWorkspace, matrixPool);
     }
 
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
@@ -161,6 +176,9 @@ public:
 
         SetDims(Input(0));
     }
+
+private:
+    shared_ptr<Matrix<ElemType>> m_chainWorkspace;
 };
 
 template class PerDimMeanVarNormalizationNode<float>;
@@ -5,6 +5,7 @@
 
 #include "Basics.h"
 #include "InputAndParamNodes.h"
+#include "ParameterImage.h"
 #include "File.h"        // for LoadMatrixFromTextFile()
 #include "TensorShape.h" // for SmallVector<>
 #include "Globals.h"     // for ShouldForceConstantRandomSeed()
@@ -423,6 +424,12 @@ void LearnableParameter<ElemType>::Save(File& fstream) const /*override*/
 
 template <class ElemType>
 void LearnableParameter<ElemType>::Load(File& fstream, size_t modelVersion) /*override*/
+{
+    Load(fstream, modelVersion, nullptr);
+}
+
+template <class ElemType>
+void LearnableParameter<ElemType>::Load(File& fstream, size_t modelVersion, ParameterImage* parameterImage)
 {
     Base::Load(fstream, modelVersion);
 
@@ -451,7 +458,20 @@ void LearnableParameter<ElemType>::Load(File& fstream, size_t modelVersion) /*ov
         }
     }
 
-    LoadValue(fstream);
+    auto mappedValue = parameterImage ? parameterImage->GetValue<ElemType>(NodeName(), m_deviceId) : nullptr;
+    if (mappedValue)
+    {
+        // the model file still has to be read past the value, but the value itself comes from the mapped image
+        size_t rows, cols;
+        Matrix<ElemType>::SkipRead(fstream, rows, cols);
+        if (rows != mappedValue->GetNumRows() || cols != mappedValue->GetNumCols())
+            RuntimeError("Load: %ls %ls operation has dimensions [%d x %d] in the model file, but [%d x %d] in the parameter image.",
+                         NodeName().c_str(), OperationName().c_str(), (int)rows, (int)cols, (int)mappedValue->GetNumRows(), (int)mappedValue->GetNumCols());
+        m_value = mappedValue;
+        SetDims(TensorShape(rows, cols), false);
+    }
+    else
+        LoadValue(fstream);
     SetDims(sampleLayout, false); // note: call this after LoadValue() since LoadValue() overwrites m_sampleLayout
     VerifyDataSize(Value());      // sanity check
 
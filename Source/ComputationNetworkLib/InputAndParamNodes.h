@@ -14,6 +14,8 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+class ParameterImage;
+
 static const wchar_t* ConstantInitializerTypeName =         L"constant";
 static const wchar_t* UniformBSInitializerTypeName =        L"uniform";     // for legacy reason, "uniform" is taken in BrainScript to represent uniform distribution [-0.05, 0.05]
 static const wchar_t* UniformInitializerTypeName =          L"uniform1";
@@ -124,6 +126,8 @@ public:
 
     virtual void Save(File& fstream) const override;
     virtual void Load(File& fstream, size_t modelVersion) override;
+    // load, but take the value from a memory-mapped parameter image if it has one for this node (see ParameterImage.h)
+    void Load(File& fstream, size_t modelVersion, ParameterImage* parameterImage);
 
     virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
 
@@ -718,4 +722,107 @@ public:
 template class LookupTableNode<float>;
 template class LookupTableNode<double>;
 
+// -----------------------------------------------------------------------
+// EmbeddingLookupNode (embedding matrix, word indices)
+// Looks up columns of the embedding matrix by index: out[:,t] = embedding[:,indices[t]].
+// Unlike Times() with a one-hot input, the words are given as numeric indices (one or more per sample),
+// and the lookup is a gather. On the CPU, the gradient of the embedding is a SparseBlockCol matrix that
+// only holds the columns that were looked up, so that the learners only update those columns.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class EmbeddingLookupNode : public ComputationNode<ElemType>, public NumInputs<2>
+{
+    typedef ComputationNode<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"EmbeddingLookup"; }
+
+    // our inputs
+    static const size_t EMBEDDING = 0;
+    static const size_t INDICES = 1;
+
+public:
+    DeclareConstructorFromConfigWithNumInputs(EmbeddingLookupNode);
+    EmbeddingLookupNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name)
+    {
+    }
+
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
+    {
+        InputRef(INDICES).MaskMissingValueColumnsTo(fr, -1); // indicates an invalid column to Gather/Scatter
+        Matrix<ElemType> indices = IndicesFor(fr);
+        Matrix<ElemType> output = ValueFor(fr).Reshaped(EmbeddingDim(), indices.GetNumCols());
+        output.DoGatherColumnsOf(/*beta=*/0, indices, InputRef(EMBEDDING).ValueAsMatrix(), /*alpha=*/1);
+    }
+
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
+    {
+        if (inputIndex != EMBEDDING) // the indices have no gradient
+            return;
+
+        // adds to the looked-up columns only; if the gradient is block-sparse, this creates a block for each of them
+        Matrix<ElemType> indices = IndicesFor(fr);
+        Matrix<ElemType> outputGradient = GradientFor(fr).Reshaped(EmbeddingDim(), indices.GetNumCols());
+        InputRef(EMBEDDING).GradientAsMatrix().DoScatterColumnsOf(/*beta=*/1, indices, outputGradient, /*alpha=*/1);
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override { return childIndex == INDICES; }
+
+    virtual void AllocateGradientMatricesForInputs(MatrixPool& matrixPool) override
+    {
+        // Like TimesNode with a sparse input, the gradient of the embedding is allocated as a sparse matrix directly instead of
+        // from the pool. Only the CPU can scatter into a sparse matrix; on the GPU, the gradient stays dense.
+        if (Input(EMBEDDING)->NeedsGradient() && Gradient().GetPreferredDeviceId() == CPUDEVICE)
+        {
+            InputRef(EMBEDDING).GradientPtrRef() = std::make_shared<Matrix<ElemType>>(0, // size would be initialized later
+                                                                                      0,
+                                                                                      Gradient().GetPreferredDeviceId(),
+                                                                                      SPARSE,
+                                                                                      MatrixFormat::matrixFormatSparseBlockCol);
+        }
+
+        Base::AllocateGradientMatricesForInputs(matrixPool);
+    }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
+    {
+        Base::Validate(isFinalValidationPass);
+
+        // inherit MBLayout from the indices
+        m_pMBLayout = Input(INDICES)->GetMBLayout();
+        if (isFinalValidationPass && Input(EMBEDDING)->HasMBLayout())
+            InvalidArgument("%ls requires the first argument (embedding matrix) to not have a dynamic axis.", NodeDescription().c_str());
+        if (isFinalValidationPass && Input(EMBEDDING)->GetSampleLayout().GetRank() != 2)
+            InvalidArgument("%ls requires the first argument (embedding matrix) to be a matrix [embeddingDim x vocabularySize].", NodeDescription().c_str());
+
+        // an embedding column for each index; a single index per sample is not a tensor dimension of the output
+        const auto& indexShape = Input(INDICES)->GetSampleLayout();
+        SmallVector<size_t> dims{ EmbeddingDim() };
+        if (indexShape.GetNumElements() != 1)
+        {
+            for (size_t k = 0; k < indexShape.GetRank(); k++)
+                dims.push_back(indexShape[k]);
+        }
+        SetDims(TensorShape(dims), HasMBLayout());
+    }
+
+private:
+    size_t EmbeddingDim() const
+    {
+        const auto& embeddingShape = Input(EMBEDDING)->GetSampleLayout();
+        return embeddingShape.GetRank() > 0 ? embeddingShape[0] : 0;
+    }
+
+    // the indices of a frame range as a row vector, as expected by DoGatherColumnsOf()
+    Matrix<ElemType> IndicesFor(const FrameRange& fr)
+    {
+        Matrix<ElemType> indices = InputRef(INDICES).ValueFor(fr);
+        return indices.Reshaped(1, indices.GetNumElements());
+    }
+};
+
+template class EmbeddingLookupNode<float>;
+template class EmbeddingLookupNode<double>;
+
 }}}
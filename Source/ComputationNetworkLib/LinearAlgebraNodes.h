@@ -716,9 +716,7 @@ public:
         if (deviceId != CPUDEVICE)
             LogicError("Quantized operation is supposed to be used on CPU device only.");
 
-        shared_ptr<SymmetricQuantizer<ElemType, short>> pQA(new SymmetricQuantizer<ElemType, short>(m_bitShiftA));
-        shared_ptr<SymmetricQuantizer<ElemType, short>> qQB(new SymmetricQuantizer<ElemType, short>(m_bitShiftB));
-        this->m_pQuantizedMultiplier = shared_ptr<QuantizedMultiplier<ElemType>>(new QuantizedMultiplier<ElemType>(pQA, qQB));
+        CreateQuantizedMultiplier();
     }
 
     QuantizedTimesNode(const ScriptableObjects::IConfigRecordPtr configp)
@@ -735,6 +733,7 @@ public:
             auto node = dynamic_pointer_cast<QuantizedTimesNode<ElemType>>(nodeP);
             node->m_bitShiftA = m_bitShiftA;
             node->m_bitShiftB = m_bitShiftB;
+            node->CreateQuantizedMultiplier();
         }
     }
 
@@ -750,6 +749,7 @@ public:
         Base::Load(fstream, modelVersion);
         fstream >> m_bitShiftA;
         fstream >> m_bitShiftB;
+        CreateQuantizedMultiplier();
     }
 
     virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override
@@ -767,6 +767,15 @@ public:
         // This operation is intended only for inference
         NOT_IMPLEMENTED;
     }
+
+private:
+    // (re-)creates the quantizers for the current bit shifts; a constant operand is quantized again on the next ForwardProp()
+    void CreateQuantizedMultiplier()
+    {
+        shared_ptr<SymmetricQuantizer<ElemType, short>> pQA(new SymmetricQuantizer<ElemType, short>(m_bitShiftA));
+        shared_ptr<SymmetricQuantizer<ElemType, short>> qQB(new SymmetricQuantizer<ElemType, short>(m_bitShiftB));
+        this->m_pQuantizedMultiplier = shared_ptr<QuantizedMultiplier<ElemType>>(new QuantizedMultiplier<ElemType>(pQA, qQB));
+    }
 };
 
 template class QuantizedTimesNode<float>;
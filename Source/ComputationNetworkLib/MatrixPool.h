@@ -9,6 +9,7 @@
 #include <stdexcept>
 #include <vector>
 #include <algorithm>
+#include <map>
 #include <stdlib.h>
 
 #include "Basics.h"
@@ -20,6 +21,13 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 // MatrixPool -- class to support memory sharing
 // Despite the gather general name of this class, it is specifically designed to support the memory sharing of ComputationNodes.
 // Note: see #define SUPRESS_MEMSHARING below as for how to temporarily disable memory sharing altogether, for debugging
+//
+// The pool is filled while ComputationNetwork::AllocateAllMatrices() simulates the evaluation order, so the sequence of
+// Request() and Release() calls describes the live range of every matrix. Each request carries a size hint (elements per
+// sample of the requesting node's output), and is served best-fit: by the smallest released matrix whose planned size is
+// large enough, or else by the largest released matrix, which then has to grow the least. This keeps small matrices from
+// occupying buffers that some other live range has already grown to a large size.
+// Since the minibatch size is not known at planning time, all planned sizes are in bytes per sample.
 class MatrixPool
 {
     vector<shared_ptr<Matrix<float>>>  m_releasedFloatMatrices;
@@ -28,13 +36,55 @@ class MatrixPool
     template <class ElemType>
     vector<shared_ptr<Matrix<ElemType>>>& GetReleasedMatrices();
 
+    // a matrix that has passed through the pool
+    struct BufferInfo
+    {
+        size_t plannedBytes;         // largest request assigned to this matrix so far
+        size_t liveBytes;            // size of the current request; 0 while the matrix is in the released pool
+        weak_ptr<MatrixBase> matrix; // the pool does not own matrices that are in use
+    };
+    map<const MatrixBase*, BufferInfo> m_buffers;
+
+    // planning statistics, in bytes per sample
+    size_t m_numRequests;
+    size_t m_liveBytes;     // sum of the requests that are currently live
+    size_t m_peakLiveBytes; // peak of m_liveBytes, the lower bound for any assignment of requests to matrices
+    size_t m_unsharedBytes; // sum of all requests, i.e. the size without memory sharing
+
+    BufferInfo& GetBufferInfo(const shared_ptr<MatrixBase>& matrixPtr)
+    {
+        BufferInfo& info = m_buffers[matrixPtr.get()];
+        if (info.matrix.expired()) // new, or a previous matrix at the same address has gone away
+            info = BufferInfo{ 0, 0, matrixPtr };
+        return info;
+    }
+
 public:
+    MatrixPool()
+        : m_numRequests(0), m_liveBytes(0), m_peakLiveBytes(0), m_unsharedBytes(0)
+    {
+    }
+
+    // starts a new plan: forgets the planned sizes and the statistics of the previous one
+    // The released matrices stay in the pool and are reused.
+    void ResetStatistics()
+    {
+        m_buffers.clear();
+        m_numRequests = 0;
+        m_liveBytes = 0;
+        m_peakLiveBytes = 0;
+        m_unsharedBytes = 0;
+    }
+
     // release here means the matrix can be put back and shared by others
     template <class ElemType>
     void Release(shared_ptr<Matrix<ElemType>> freeMatrix)
     {
         if (freeMatrix == nullptr || freeMatrix->GetMatrixType() == SPARSE)
             LogicError("MatrixPool::Release: freeMatrix should not be null or sparse.");
+        BufferInfo& info = GetBufferInfo(freeMatrix);
+        m_liveBytes -= info.liveBytes;
+        info.liveBytes = 0;
 //#define SUPRESS_MEMSHARING // #define this to disable memory sharing through this structure
         // TODO: Make this a runtime option.
 #ifndef SUPRESS_MEMSHARING
@@ -51,9 +101,11 @@ public:
 #endif
     }
 
+    // 'numElementsPerSample' is the size hint used to pick the best-fitting released matrix
     template <class ElemType>
-    shared_ptr<Matrix<ElemType>> Request(DEVICEID_TYPE deviceId)
+    shared_ptr<Matrix<ElemType>> Request(DEVICEID_TYPE deviceId, size_t numElementsPerSample = 0)
     {
+        const size_t requestBytes = numElementsPerSample * sizeof(ElemType);
         vector<shared_ptr<Matrix<ElemType>>>& releasedMatrices = GetReleasedMatrices<ElemType>();
         shared_ptr<Matrix<ElemType>> matrixPtr;
         if (releasedMatrices.empty())
@@ -62,15 +114,44 @@ public:
         }
         else
         {
-            matrixPtr = releasedMatrices.back();
-            releasedMatrices.pop_back();
+            // best fit: the smallest one that is large enough, else the largest one
+            // Ties go to the most recently released matrix, as in plain LIFO order.
+            size_t best = releasedMatrices.size() - 1;
+            for (size_t i = best; i-- > 0;)
+            {
+                size_t bestBytes = GetBufferInfo(releasedMatrices[best]).plannedBytes;
+                size_t bytes     = GetBufferInfo(releasedMatrices[i]).plannedBytes;
+                bool fits        = bytes >= requestBytes;
+                bool bestFits    = bestBytes >= requestBytes;
+                if ((fits && (!bestFits || bytes < bestBytes)) || (!fits && !bestFits && bytes > bestBytes))
+                    best = i;
+            }
+            matrixPtr = releasedMatrices[best];
+            releasedMatrices.erase(releasedMatrices.begin() + best);
         }
 
         if (!matrixPtr) // this can't really happen
             LogicError("MatrixPool::Request: failed to get a valid matrix.");
 
+        BufferInfo& info = GetBufferInfo(matrixPtr);
+        info.plannedBytes = max(info.plannedBytes, requestBytes);
+        info.liveBytes = requestBytes;
+        m_numRequests++;
+        m_liveBytes += requestBytes;
+        m_peakLiveBytes = max(m_peakLiveBytes, m_liveBytes);
+        m_unsharedBytes += requestBytes;
         return matrixPtr;
     }
+
+    // sum of the planned sizes of all matrices that were handed out, in bytes per sample
+    size_t GetPlannedBytesPerSample() const;
+    // peak of the simultaneously live requests, in bytes per sample
+    size_t GetPeakLiveBytesPerSample() const { return m_peakLiveBytes; }
+    // memory currently allocated by the matrices that were handed out
+    size_t GetAllocatedBytes() const;
+
+    // log planned vs. actually allocated memory
+    void PrintStatistics() const;
 };
 
 }}}
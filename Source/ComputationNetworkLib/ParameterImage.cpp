@@ -0,0 +1,277 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ParameterImage.cpp -- memory-mappable image of the LearnableParameter values of a model file
+//
+// File layout (all integers are uint64_t):
+//   magic "CNTKPARM", version, size, modification time and content hash of the model file, number of entries
+//   per entry: length of the UTF-8 node name, node name, element size, rows, columns, offset of the data
+//   data of all entries, each starting at a multiple of 64 bytes
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "Basics.h"
+#include "ParameterImage.h"
+#include "ComputationNetwork.h"
+#include "InputAndParamNodes.h"
+#include "fileutil.h"
+#include <atomic>
+#include <string.h>
+#include <vector>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+static const char s_parameterImageMagic[8] = { 'C', 'N', 'T', 'K', 'P', 'A', 'R', 'M' };
+static const uint64_t s_parameterImageVersion = 2;
+static const size_t s_parameterImageAlignment = 64; // cache line, and enough for any SIMD load
+
+static size_t AlignUp(size_t offset)
+{
+    return (offset + s_parameterImageAlignment - 1) / s_parameterImageAlignment * s_parameterImageAlignment;
+}
+
+// The identity of a model file: its size, its exact modification time, and a hash of its content. The time alone is
+// not enough, since a model can be replaced by a file with an older time stamp (e.g. when copied with 'cp -p'), or
+// be written within the same second as the image.
+struct ModelFileStamp
+{
+    uint64_t size;
+    uint64_t modificationTime; // in the finest resolution the file system offers
+    uint64_t hash;             // 64-bit FNV-1a of the content
+
+    bool operator==(const ModelFileStamp& other) const
+    {
+        return size == other.size && modificationTime == other.modificationTime && hash == other.hash;
+    }
+};
+
+static bool GetModelFileStamp(const wstring& modelPath, ModelFileStamp& stamp)
+{
+#ifdef _WIN32
+    FILETIME time;
+    if (!getfiletime(modelPath, time))
+        return false;
+    stamp.modificationTime = ((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime;
+#else
+    struct stat buf;
+    if (stat(wtocharpath(modelPath.c_str()).c_str(), &buf) != 0)
+        return false;
+    stamp.modificationTime = (uint64_t)buf.st_mtim.tv_sec * 1000000000 + (uint64_t)buf.st_mtim.tv_nsec;
+#endif
+
+    FILE* f = _wfopen(modelPath.c_str(), L"rb");
+    if (f == nullptr)
+        return false;
+    stamp.size = 0;
+    stamp.hash = 14695981039346656037ull;
+    vector<unsigned char> buffer(1 << 20);
+    size_t numBytes;
+    while ((numBytes = fread(buffer.data(), 1, buffer.size(), f)) > 0)
+    {
+        for (size_t i = 0; i < numBytes; i++)
+            stamp.hash = (stamp.hash ^ buffer[i]) * 1099511628211ull;
+        stamp.size += numBytes;
+    }
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
+
+// reads the header fields of the mapped image, with bounds checks
+class ParameterImageParser
+{
+    const char* m_data;
+    size_t m_size;
+    size_t m_pos;
+    const wstring& m_path;
+
+public:
+    ParameterImageParser(const void* data, size_t size, const wstring& path)
+        : m_data((const char*)data), m_size(size), m_pos(0), m_path(path)
+    {
+    }
+
+    const char* Get(size_t numBytes)
+    {
+        if (numBytes > m_size - m_pos)
+            RuntimeError("ParameterImage: File '%ls' is truncated.", m_path.c_str());
+        const char* p = m_data + m_pos;
+        m_pos += numBytes;
+        return p;
+    }
+
+    uint64_t GetUInt64()
+    {
+        uint64_t value;
+        memcpy(&value, Get(sizeof(value)), sizeof(value));
+        return value;
+    }
+};
+
+ParameterImage::ParameterImage(const wstring& imagePath)
+    : m_file(imagePath, /*copyOnWrite=*/true)
+{
+    ParameterImageParser parser(m_file.Data(), m_file.Size(), imagePath);
+    if (memcmp(parser.Get(sizeof(s_parameterImageMagic)), s_parameterImageMagic, sizeof(s_parameterImageMagic)) != 0)
+        RuntimeError("ParameterImage: File '%ls' is not a parameter image.", imagePath.c_str());
+    let version = parser.GetUInt64();
+    if (version != s_parameterImageVersion)
+        RuntimeError("ParameterImage: File '%ls' has unsupported version %d.", imagePath.c_str(), (int)version);
+    for (size_t i = 0; i < 3; i++) // identity of the model file, only used by IsUpToDate()
+        parser.GetUInt64();
+    let numEntries = parser.GetUInt64();
+
+    for (size_t i = 0; i < numEntries; i++)
+    {
+        let nameLength = (size_t)parser.GetUInt64();
+        const char* name = parser.Get(nameLength);
+        Entry entry;
+        entry.elemSize = (size_t)parser.GetUInt64();
+        entry.numRows  = (size_t)parser.GetUInt64();
+        entry.numCols  = (size_t)parser.GetUInt64();
+        entry.offset   = (size_t)parser.GetUInt64();
+        let numBytes = entry.numRows * entry.numCols * entry.elemSize;
+        if (numBytes > 0 && (entry.offset > m_file.Size() || numBytes > m_file.Size() - entry.offset))
+            RuntimeError("ParameterImage: File '%ls' is truncated.", imagePath.c_str());
+        m_entries[msra::strfun::utf16(string(name, nameLength))] = entry;
+    }
+}
+
+/*static*/ bool ParameterImage::IsUpToDate(const wstring& imagePath, const wstring& modelPath)
+{
+    if (!fexists(imagePath))
+        return false;
+
+    FILE* f = fopenOrDie(imagePath, L"rb");
+    char magic[sizeof(s_parameterImageMagic)];
+    uint64_t version = 0;
+    ModelFileStamp imageStamp, modelStamp;
+    bool valid = fread(magic, sizeof(magic), 1, f) == 1 && memcmp(magic, s_parameterImageMagic, sizeof(magic)) == 0 &&
+                 fread(&version, sizeof(version), 1, f) == 1 && version == s_parameterImageVersion &&
+                 fread(&imageStamp.size, sizeof(uint64_t), 1, f) == 1 &&
+                 fread(&imageStamp.modificationTime, sizeof(uint64_t), 1, f) == 1 &&
+                 fread(&imageStamp.hash, sizeof(uint64_t), 1, f) == 1;
+    fclose(f);
+    return valid && GetModelFileStamp(modelPath, modelStamp) && imageStamp == modelStamp;
+}
+
+template <class ElemType>
+static bool GetParameterData(const ComputationNodeBasePtr& node, shared_ptr<ElemType>& data, size_t& numRows, size_t& numCols)
+{
+    auto parameter = dynamic_pointer_cast<LearnableParameter<ElemType>>(node);
+    if (!parameter || parameter->Value().GetMatrixType() != DENSE)
+        return false;
+    numRows = parameter->Value().GetNumRows();
+    numCols = parameter->Value().GetNumCols();
+    data = shared_ptr<ElemType>(parameter->Value().CopyToArray(), [](ElemType* p) { delete[] p; });
+    return true;
+}
+
+/*static*/ bool ParameterImage::Write(const ComputationNetwork& net, const wstring& modelPath, const wstring& imagePath)
+{
+    struct Parameter
+    {
+        string name;
+        Entry entry;
+        shared_ptr<void> data;
+    };
+    vector<Parameter> parameters;
+    for (const auto& node : net.GetAllNodes())
+    {
+        Parameter parameter;
+        shared_ptr<float> floatData;
+        shared_ptr<double> doubleData;
+        if (GetParameterData<float>(node, floatData, parameter.entry.numRows, parameter.entry.numCols))
+        {
+            parameter.entry.elemSize = sizeof(float);
+            parameter.data = floatData;
+        }
+        else if (GetParameterData<double>(node, doubleData, parameter.entry.numRows, parameter.entry.numCols))
+        {
+            parameter.entry.elemSize = sizeof(double);
+            parameter.data = doubleData;
+        }
+        else
+            continue;
+        parameter.name = msra::strfun::utf8(node->NodeName());
+        parameters.push_back(parameter);
+    }
+
+    // lay out the data behind the header
+    ModelFileStamp modelStamp;
+    if (!GetModelFileStamp(modelPath, modelStamp))
+        return false;
+    size_t headerSize = sizeof(s_parameterImageMagic) + 5 * sizeof(uint64_t);
+    for (const auto& parameter : parameters)
+        headerSize += parameter.name.size() + 5 * sizeof(uint64_t);
+    size_t offset = headerSize;
+    for (auto& parameter : parameters)
+    {
+        parameter.entry.offset = AlignUp(offset);
+        offset = parameter.entry.offset + parameter.entry.numRows * parameter.entry.numCols * parameter.entry.elemSize;
+    }
+
+    // Write to a temporary file of this process first and rename it, so that other processes loading the same
+    // model at the same time never see a partial image, and each of them writes a complete one.
+    static atomic<unsigned int> s_numTempFiles(0);
+    let tempPath = imagePath + L"." + to_wstring(GetCurrentProcessId()) + L"." + to_wstring(s_numTempFiles++) + L".tmp";
+    FILE* f = _wfopen(tempPath.c_str(), L"wb");
+    if (f == nullptr)
+        return false;
+    bool ok = true;
+    auto write = [&](const void* data, size_t numBytes)
+    {
+        ok = ok && (numBytes == 0 || fwrite(data, 1, numBytes, f) == numBytes);
+    };
+    write(s_parameterImageMagic, sizeof(s_parameterImageMagic));
+    uint64_t header[5] = { s_parameterImageVersion, modelStamp.size, modelStamp.modificationTime, modelStamp.hash, (uint64_t)parameters.size() };
+    write(header, sizeof(header));
+    for (const auto& parameter : parameters)
+    {
+        uint64_t nameLength = parameter.name.size();
+        write(&nameLength, sizeof(nameLength));
+        write(parameter.name.data(), parameter.name.size());
+        uint64_t entry[4] = { parameter.entry.elemSize, parameter.entry.numRows, parameter.entry.numCols, parameter.entry.offset };
+        write(entry, sizeof(entry));
+    }
+    size_t pos = headerSize;
+    const vector<char> padding(s_parameterImageAlignment, 0);
+    for (const auto& parameter : parameters)
+    {
+        write(padding.data(), parameter.entry.offset - pos);
+        let numBytes = parameter.entry.numRows * parameter.entry.numCols * parameter.entry.elemSize;
+        write(parameter.data.get(), numBytes);
+        pos = parameter.entry.offset + numBytes;
+    }
+    ok = fclose(f) == 0 && ok;
+    ok = ok && renameReplacing(tempPath, imagePath);
+    if (!ok)
+        _wunlink(tempPath.c_str());
+    return ok;
+}
+
+template <class ElemType>
+shared_ptr<Matrix<ElemType>> ParameterImage::GetValue(const wstring& nodeName, DEVICEID_TYPE deviceId)
+{
+    // other devices would copy the data anyway
+    if (deviceId != CPUDEVICE)
+        return nullptr;
+    let iter = m_entries.find(nodeName);
+    if (iter == m_entries.end() || iter->second.elemSize != sizeof(ElemType))
+        return nullptr;
+    const Entry& entry = iter->second;
+    ElemType* data = (ElemType*)((char*)m_file.MutableData() + entry.offset);
+    // the matrix does not own the mapped data; the deleter holds on to the image until the last matrix is gone
+    auto self = shared_from_this();
+    return shared_ptr<Matrix<ElemType>>(new Matrix<ElemType>(entry.numRows, entry.numCols, data, CPUDEVICE, matrixFlagDontOwnBuffer),
+                                        [self](Matrix<ElemType>* matrix) { delete matrix; });
+}
+
+template shared_ptr<Matrix<float>> ParameterImage::GetValue<float>(const wstring& nodeName, DEVICEID_TYPE deviceId);
+template shared_ptr<Matrix<double>> ParameterImage::GetValue<double>(const wstring& nodeName, DEVICEID_TYPE deviceId);
+
+}}}
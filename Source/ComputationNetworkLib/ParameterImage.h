@@ -0,0 +1,67 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ParameterImage.h -- memory-mappable image of the LearnableParameter values of a model file
+//
+// The model file format stores each matrix as a stream of individually serialized elements, which cannot be
+// used in place. A parameter image is a side file next to the model ("<model>.params") that holds the values of
+// all dense LearnableParameters as raw, 64-byte aligned blobs, so that they can be mapped straight into memory.
+// Parameters loaded from an image reference the mapping (copy-on-write, so the file is never modified), and all
+// processes that load the same model share the same physical pages.
+//
+// The image is tied to the model file it was written from: it records the model file's size, exact modification
+// time and a hash of its content, and is only used if all three still match. Otherwise it is stale, and
+// ComputationNetwork::ReadWithMappedParameters() rewrites it.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "Matrix.h"
+#include "MemoryMappedFile.h"
+#include <map>
+#include <memory>
+#include <string>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+class ComputationNetwork;
+
+class ParameterImage : public std::enable_shared_from_this<ParameterImage>
+{
+public:
+    // maps an existing image; use IsUpToDate() first to check that it belongs to the model
+    explicit ParameterImage(const std::wstring& imagePath);
+
+    // file name of the image that belongs to a model file
+    static std::wstring PathFor(const std::wstring& modelPath) { return modelPath + L".params"; }
+
+    // whether the image exists and was written from the current version of the model file
+    static bool IsUpToDate(const std::wstring& imagePath, const std::wstring& modelPath);
+
+    // write the values of the dense LearnableParameters of a network that was loaded from modelPath
+    // Returns false if the image cannot be written, e.g. because the directory is read-only.
+    static bool Write(const ComputationNetwork& net, const std::wstring& modelPath, const std::wstring& imagePath);
+
+    // Value matrix of a parameter that references the mapped data, or nullptr if the image has no values of this
+    // type for the node, or if deviceId is not the CPU. The matrix keeps the mapping alive.
+    template <class ElemType>
+    std::shared_ptr<Matrix<ElemType>> GetValue(const std::wstring& nodeName, DEVICEID_TYPE deviceId);
+
+    size_t GetNumEntries() const { return m_entries.size(); }
+
+private:
+    struct Entry
+    {
+        size_t elemSize;
+        size_t numRows;
+        size_t numCols;
+        size_t offset; // of the data, relative to the start of the file
+    };
+
+    MemoryMappedFile m_file;
+    std::map<std::wstring, Entry> m_entries;
+};
+
+}}}
@@ -398,8 +398,23 @@ public:
         auto mean      = InputRef(1).ValueTensorFor(rank, fr.AllowBroadcast());
         auto invStdDev = InputRef(2).ValueTensorFor(rank, fr.AllowBroadcast());
 
-        output.AssignElementwiseQuotientOf(input, invStdDev); // output = input / invStdDev
-        output.AddCopyOf(mean);                               // output += mean
+        // output = input ./ invStdDev + mean, in a single pass
+        ElementwiseOpChain chain(3);
+        chain.Binary(ElementWiseOperator::opSum, chain.Binary(ElementWiseOperator::opElementwiseQuotient, 0, 2), 1);
+        output.AssignChainOf(chain, { input, mean, invStdDev }, 1.0f, m_chainWorkspace);
+    }
+
+    // the chain's intermediate results when it is evaluated op by op
+    virtual void RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) override
+    {
+        Base::RequestMatricesBeforeForwardProp(matrixPool);
+        RequestMatrixFromPool(m_chainWorkspace, matrixPool);
+    }
+
+    virtual void ReleaseMatricesAfterForwardProp(MatrixPool& matrixPool) override
+    {
+        Base::ReleaseMatricesAfterForwardProp(matrixPool);
+        ReleaseMatrixToPool(m_chainWorkspace, matrixPool);
     }
 
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
@@ -418,6 +433,9 @@ public:
 
         SetDims(Input(0));
     }
+
+private:
+    shared_ptr<Matrix<ElemType>> m_chainWorkspace;
 };
 
 template class PerDimMeanVarDeNormalizationNode<float>;
@@ -2271,14 +2271,14 @@ public:
     BatchNormalizationNode(DEVICEID_TYPE deviceId, const wstring& name) :
         Base(deviceId, name), m_spatial(false), m_normTimeConst(0), m_blendTimeConst(0), m_epsilon(0), m_useCntkEngine(true),
         m_samplesSeen(0), m_imageLayoutKind(ImageLayoutKind::CHW),
-        m_convertRunningVariancePending(false)
+        m_convertRunningVariancePending(false), m_blockedInput(false), m_blockedOutput(false)
     {
     }
     BatchNormalizationNode(DEVICEID_TYPE deviceId, const wstring& name, bool spatial, double normalizationTimeConstant, double blendTimeConstant,
                            double epsilon, bool useCntkEngine, ImageLayoutKind imageLayoutKind, size_t samplesSeen = 0) :
         Base(deviceId, name), m_spatial(spatial), m_normTimeConst(normalizationTimeConstant), m_blendTimeConst(blendTimeConstant),
         m_epsilon(epsilon), m_useCntkEngine(useCntkEngine), m_imageLayoutKind(imageLayoutKind), m_samplesSeen(samplesSeen),
-        m_convertRunningVariancePending(false)
+        m_convertRunningVariancePending(false), m_blockedInput(false), m_blockedOutput(false)
     {
     }
     BatchNormalizationNode(const ScriptableObjects::IConfigRecordPtr configp) :
@@ -2394,11 +2394,28 @@ public:
             node->m_samplesSeen = m_samplesSeen;
             node->m_epsilon = m_epsilon;
             node->m_useCntkEngine = m_useCntkEngine;
+            node->m_blockedInput = m_blockedInput;
+            node->m_blockedOutput = m_blockedOutput;
         }
     }
 
     size_t GetSamplesSeen() const { return m_samplesSeen; }
 
+    // Inference only: whether the input and the output value are in the blocked layout of BlockedLayout.h,
+    // see ComputationNetwork::ConvertToBlockedImageLayout(). The engine is recreated on the next validation.
+    bool SupportsBlockedLayout() const
+    {
+        return m_bnEng != nullptr && m_useCntkEngine &&
+               BatchNormEngine<ElemType>::IsBlockedLayoutSupported(m_deviceId, GetSampleLayout(), m_spatial, m_imageLayoutKind);
+    }
+    void SetBlockedLayout(bool blockedInput, bool blockedOutput)
+    {
+        if (blockedInput != m_blockedInput || blockedOutput != m_blockedOutput)
+            m_bnEng.reset();
+        m_blockedInput = blockedInput;
+        m_blockedOutput = blockedOutput;
+    }
+
 private: // time-constant conversions
 
     // map time constants to exp avg factor
@@ -2664,6 +2681,7 @@ public:
                 auto shape = GetSampleLayout();
                 m_bnEng = BatchNormEngine<ElemType>::Create(m_deviceId, shape, m_spatial, m_imageLayoutKind,
                                                             m_useCntkEngine ? BatchNormEngineKind::Cntk : BatchNormEngineKind::CuDnn);
+                m_bnEng->SetBlockedLayout(m_blockedInput, m_blockedOutput);
             }
         }
     }
@@ -2797,6 +2815,9 @@ private:
     std::unique_ptr<BatchNormEngine<ElemType>> m_bnEng;
 
     bool m_convertRunningVariancePending;
+
+    bool m_blockedInput;
+    bool m_blockedOutput;
 };
 
 template class BatchNormalizationNode<float>;
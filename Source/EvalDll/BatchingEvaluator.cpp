@@ -0,0 +1,114 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// BatchingEvaluator.cpp : batching front end of the extended evaluation interface
+//
+
+#include <algorithm>
+#define EVAL_EXPORTS // creating the exports here
+#include "BatchingEvaluator.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <typename ElemType>
+BatchingEvaluator<ElemType>::BatchingEvaluator(CNTKEvalExtended<ElemType>* worker, size_t maxBatchSize, size_t maxLatencyMicroseconds)
+    : m_worker(worker), m_maxBatchSize(maxBatchSize), m_maxLatency(maxLatencyMicroseconds), m_stopping(false)
+{
+    m_serverThread = std::thread([this]() { ServerLoop(); });
+}
+
+template <typename ElemType>
+void BatchingEvaluator<ElemType>::Evaluate(const Values<ElemType>& inputs, Values<ElemType>& outputs)
+{
+    Request request;
+    request.m_inputs = &inputs;
+    request.m_outputs = &outputs;
+    request.m_arrival = Clock::now();
+    auto done = request.m_done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping)
+            LogicError("Evaluate() called after Destroy()");
+        m_queue.push_back(&request);
+    }
+    m_requestArrived.notify_one();
+
+    done.get(); // rethrows the error of this request, if any
+}
+
+template <typename ElemType>
+void BatchingEvaluator<ElemType>::ServerLoop()
+{
+    for (;;)
+    {
+        std::vector<Request*> batch;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_requestArrived.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty())
+                return; // stopping, and all requests are served
+
+            // give further requests until the deadline of the oldest one to fill up the batch
+            auto deadline = m_queue.front()->m_arrival + m_maxLatency;
+            m_requestArrived.wait_until(lock, deadline, [this]() { return m_stopping || m_queue.size() >= m_maxBatchSize; });
+
+            size_t batchSize = std::min(m_queue.size(), m_maxBatchSize);
+            batch.assign(m_queue.begin(), m_queue.begin() + batchSize);
+            m_queue.erase(m_queue.begin(), m_queue.begin() + batchSize);
+        }
+        EvaluateBatch(batch);
+    }
+}
+
+template <typename ElemType>
+void BatchingEvaluator<ElemType>::EvaluateBatch(const std::vector<Request*>& batch)
+{
+    std::vector<const Values<ElemType>*> inputs;
+    std::vector<Values<ElemType>*> outputs;
+    for (auto request : batch)
+    {
+        inputs.push_back(request->m_inputs);
+        outputs.push_back(request->m_outputs);
+    }
+
+    try
+    {
+        m_worker->ForwardPassBatch(inputs, outputs);
+    }
+    catch (...)
+    {
+        if (batch.size() == 1)
+        {
+            batch[0]->m_done.set_exception(std::current_exception());
+            return;
+        }
+
+        // one bad request must not fail the others, so find it by evaluating them one by one
+        for (auto request : batch)
+            EvaluateBatch({ request });
+        return;
+    }
+
+    for (auto request : batch)
+        request->m_done.set_value();
+}
+
+template <typename ElemType>
+void BatchingEvaluator<ElemType>::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_requestArrived.notify_one();
+    m_serverThread.join();
+
+    m_worker->Destroy();
+    delete this;
+}
+
+template class BatchingEvaluator<double>;
+template class BatchingEvaluator<float>;
+
+} } }
@@ -0,0 +1,61 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// BatchingEvaluator.h - batching front end of the extended evaluation interface (see IBatchingEvaluator in Eval.h)
+//
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Eval.h"
+#include "CNTKEval.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Callers of Evaluate() queue their requests and wait; a server thread takes the queued requests, up to maxBatchSize
+// of them, as soon as the batch is full or the oldest request has waited for maxLatency, and evaluates them in one
+// forward pass on a worker that shares the parameters with the evaluator it was created from.
+template <typename ElemType>
+class BatchingEvaluator : public IBatchingEvaluator<ElemType>
+{
+public:
+    // takes ownership of the worker
+    BatchingEvaluator(CNTKEvalExtended<ElemType>* worker, size_t maxBatchSize, size_t maxLatencyMicroseconds);
+
+    virtual void Evaluate(const Values<ElemType>& inputs, Values<ElemType>& outputs) override;
+
+    virtual void Destroy() override;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Request
+    {
+        const Values<ElemType>* m_inputs;
+        Values<ElemType>* m_outputs;
+        Clock::time_point m_arrival;
+        std::promise<void> m_done;
+    };
+
+    void ServerLoop();
+    void EvaluateBatch(const std::vector<Request*>& batch);
+
+    CNTKEvalExtended<ElemType>* m_worker;
+    const size_t m_maxBatchSize;
+    const std::chrono::microseconds m_maxLatency;
+
+    std::mutex m_mutex; // protects m_queue and m_stopping
+    std::condition_variable m_requestArrived;
+    std::deque<Request*> m_queue;
+    bool m_stopping;
+    std::thread m_serverThread;
+};
+
+} } }
@@ -14,6 +14,7 @@
 #include "Eval.h"
 #include "Actions.h"
 #include "CNTKEval.h"
+#include "BatchingEvaluator.h"
 #include "CPUMatrix.h" // for SetNumThreads()
 #include "SimpleOutputWriter.h"
 #include "NDLNetworkBuilder.h"
@@ -61,6 +62,14 @@ void CNTKEvalBase<ElemType>::CreateNetwork(const std::string& networkDescription
     {
         LogicError("Unable to construct network from description");
     }
+
+    if (config(L"quantizeTimes", false))
+    {
+        size_t numConverted = this->m_net->template ConvertTimesToQuantizedTimes<ElemType>(config(L"quantizeBitShiftA", (size_t) 1), config(L"quantizeBitShiftB", (size_t) 1));
+        if (this->m_net->TraceLevel() > 0)
+            fprintf(stderr, "CreateNetwork: Replaced %d Times nodes by QuantizedTimes nodes.\n", (int) numConverted);
+        this->m_net->CompileNetwork();
+    }
 }
 
 
@@ -259,8 +268,22 @@ template<typename ElemType>
 void CNTKEvalExtended<ElemType>::StartForwardEvaluation(const std::vector<wstring>& outputNodeNames)
 {
     m_scopedNetworkOperationMode = make_shared<ScopedNetworkOperationMode>(this->m_net, NetworkOperationMode::inferring);
+    if (this->m_config(L"optimizeForInference", false))
+    {
+        size_t numRemoved = this->m_net->template OptimizeForInference<ElemType>(this->m_net->OutputNodesByName(outputNodeNames));
+        if (this->m_net->TraceLevel() > 0 && !m_isWorker)
+            fprintf(stderr, "StartForwardEvaluation: Removed %d nodes by folding batch normalization, pass-through nodes and constants.\n", (int) numRemoved);
+        this->m_net->CompileNetwork();
+    }
     m_outputNodes  = this->m_net->OutputNodesByName(outputNodeNames);
     m_inputNodes = this->m_net->InputNodesForOutputs(outputNodeNames);
+    if (this->m_config(L"blockedImageLayout", false))
+    {
+        size_t numBlocked = this->m_net->template ConvertToBlockedImageLayout<ElemType>(m_outputNodes);
+        if (this->m_net->TraceLevel() > 0 && !m_isWorker)
+            fprintf(stderr, "StartForwardEvaluation: Keeping the values of %d nodes in the blocked image layout.\n", (int) numBlocked);
+        this->m_net->CompileNetwork();
+    }
     // allocate memory for forward computation
     this->m_net->AllocateAllMatrices({}, m_outputNodes, nullptr);
     this->m_net->StartEvaluateMinibatchLoop(m_outputNodes);
@@ -434,6 +457,165 @@ void CNTKEvalExtended<ElemType>::ForwardPass(const ValueRefs<ElemType>& inputs,
     ForwardPassT(inputs, outputs, resetRNN);
 }
 
+// ForwardPassBatch - evaluate several requests in one minibatch
+// Request r becomes parallel sequence r of the minibatch, starting at time 0; shorter requests are padded with gaps.
+template <typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassBatch(const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs)
+{
+    if (!m_started)
+        RuntimeError("ForwardPassBatch() called before StartForwardEvaluation()");
+
+    const size_t numRequests = inputs.size();
+    if (numRequests == 0 || outputs.size() != numRequests)
+        LogicError("ForwardPassBatch: Expected one output for every input, and at least one of each.");
+
+    for (size_t r = 0; r < numRequests; r++)
+    {
+        if (inputs[r]->size() != m_inputNodes.size())
+            RuntimeError("Expected %d inputs, but got %d.", (int)m_inputNodes.size(), (int)inputs[r]->size());
+        if (outputs[r]->size() != m_outputNodes.size())
+            RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)outputs[r]->size());
+    }
+
+    // inputs may share their MBLayout, in which case they must agree on the sequence lengths
+    std::map<MBLayout*, std::vector<size_t>> sequenceLengths;
+    for (size_t i = 0; i < m_inputNodes.size(); i++)
+    {
+        const auto& inputNode = m_inputNodes[i];
+        auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(inputNode->ValuePtr());
+        if (matrix->GetMatrixType() != MatrixType::DENSE)
+            RuntimeError("Input %ls: Only dense inputs can be evaluated in batches.", inputNode->GetName().c_str());
+        size_t numRows = inputNode->GetSampleLayout().GetNumElements();
+
+        std::vector<size_t> lengths(numRequests);
+        for (size_t r = 0; r < numRequests; r++)
+        {
+            const auto& buffer = (*inputs[r])[i].m_buffer;
+            if (buffer.size() % numRows != 0)
+                RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".",
+                             inputNode->GetName().c_str(), numRows, buffer.size());
+            if (buffer.size() == 0)
+                RuntimeError("Input %ls: Expected at least one element.", inputNode->GetName().c_str());
+            lengths[r] = buffer.size() / numRows;
+        }
+        size_t numTimeSteps = *std::max_element(lengths.begin(), lengths.end());
+
+        auto pMBLayout = inputNode->GetMBLayout();
+        auto known = sequenceLengths.find(pMBLayout.get());
+        if (known == sequenceLengths.end())
+        {
+            pMBLayout->Init(numRequests, numTimeSteps);
+            for (size_t r = 0; r < numRequests; r++)
+            {
+                pMBLayout->AddSequence(r, r, 0, lengths[r]);
+                pMBLayout->AddGap(r, lengths[r], numTimeSteps);
+            }
+            sequenceLengths[pMBLayout.get()] = lengths;
+        }
+        else if (known->second != lengths)
+            RuntimeError("Input %ls: Expected the same number of samples as in the other inputs of the request.", inputNode->GetName().c_str());
+
+        // sample t of request r goes to column t * numRequests + r
+        m_batchBuffer.assign(numRows * numTimeSteps * numRequests, 0);
+        for (size_t r = 0; r < numRequests; r++)
+        {
+            const auto& buffer = (*inputs[r])[i].m_buffer;
+            for (size_t t = 0; t < lengths[r]; t++)
+                std::copy(buffer.begin() + t * numRows, buffer.begin() + (t + 1) * numRows, m_batchBuffer.begin() + (t * numRequests + r) * numRows);
+        }
+        matrix->SetValue(numRows, numTimeSteps * numRequests, matrix->GetDeviceId(), m_batchBuffer.data(), matrixFlagNormal);
+    }
+
+    ComputationNetwork::BumpEvalTimeStamp(m_inputNodes);
+    this->m_net->ForwardProp(m_outputNodes);
+
+    for (size_t o = 0; o < m_outputNodes.size(); o++)
+    {
+        const auto& node = m_outputNodes[o];
+        shared_ptr<Matrix<ElemType>> outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
+        size_t numRows = outputMatrix->GetNumRows();
+        m_batchBuffer.resize(outputMatrix->GetNumElements());
+        ElemType* data = m_batchBuffer.data();
+        size_t size = m_batchBuffer.size();
+        outputMatrix->CopyToArray(data, size);
+
+        auto pMBLayout = node->GetMBLayout();
+        for (size_t r = 0; r < numRequests; r++)
+        {
+            auto& vec = (*outputs[r])[o].m_buffer;
+            if (!pMBLayout)
+            {
+                // not a function of the inputs' time axis, the same for all requests
+                if (vec.capacity() < m_batchBuffer.size())
+                    RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+                vec.assign(m_batchBuffer.begin(), m_batchBuffer.end());
+                continue;
+            }
+
+            const auto& sequences = pMBLayout->GetAllSequences();
+            auto seq = std::find_if(sequences.begin(), sequences.end(), [r](const MBLayout::SequenceInfo& s) { return s.seqId == r; });
+            if (seq == sequences.end())
+                RuntimeError("Output %ls: The sequence of request %d is missing from the output.", node->GetName().c_str(), (int)r);
+
+            size_t numFrames = seq->GetNumTimeSteps();
+            if (vec.capacity() < numRows * numFrames)
+                RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+            vec.resize(numRows * numFrames);
+            for (size_t t = 0; t < numFrames; t++)
+            {
+                size_t col = pMBLayout->GetColumnIndex(*seq, t);
+                std::copy(m_batchBuffer.begin() + col * numRows, m_batchBuffer.begin() + (col + 1) * numRows, vec.begin() + t * numRows);
+            }
+        }
+    }
+}
+
+template <typename ElemType>
+IBatchingEvaluator<ElemType>* CNTKEvalExtended<ElemType>::CreateBatchingEvaluator(size_t maxBatchSize, size_t maxLatencyMicroseconds)
+{
+    if (maxBatchSize == 0)
+        InvalidArgument("CreateBatchingEvaluator: maxBatchSize must be at least 1.");
+
+    auto worker = static_cast<CNTKEvalExtended<ElemType>*>(CreateWorker());
+    try
+    {
+        return new BatchingEvaluator<ElemType>(worker, maxBatchSize, maxLatencyMicroseconds);
+    }
+    catch (...)
+    {
+        worker->Destroy();
+        throw;
+    }
+}
+
+// CreateWorker - create an evaluator for the same outputs on a copy of the network that shares the parameters with
+// this one (see ComputationNetwork::CloneSharingParameters()), so that both can be evaluated on separate threads.
+template <typename ElemType>
+IEvaluateModelExtended<ElemType>* CNTKEvalExtended<ElemType>::CreateWorker()
+{
+    if (!m_started)
+        RuntimeError("CreateWorker() called before StartForwardEvaluation()");
+
+    std::vector<wstring> outputNodeNames;
+    for (const auto& node : m_outputNodes)
+        outputNodeNames.push_back(node->NodeName());
+
+    auto worker = new CNTKEvalExtended<ElemType>();
+    try
+    {
+        worker->m_config = this->m_config;
+        worker->m_isWorker = true;
+        worker->m_net = this->m_net->template CloneSharingParameters<ElemType>();
+        worker->StartForwardEvaluation(outputNodeNames);
+    }
+    catch (...)
+    {
+        worker->Destroy();
+        throw;
+    }
+    return worker;
+}
+
 template <typename ElemType>
 void CNTKEvalExtended<ElemType>::Destroy()
 {
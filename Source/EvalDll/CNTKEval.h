@@ -91,7 +91,7 @@ class CNTKEvalExtended : public CNTKEvalBase<ElemType>, public IEvaluateModelExt
 {
 public:
     CNTKEvalExtended() : CNTKEvalBase<ElemType>(), 
-        m_started(false){}
+        m_started(false), m_isWorker(false){}
 
     virtual VariableSchema GetOutputSchema() const override;
 
@@ -107,6 +107,14 @@ public:
 
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) override;
 
+    virtual IEvaluateModelExtended<ElemType>* CreateWorker() override;
+
+    virtual IBatchingEvaluator<ElemType>* CreateBatchingEvaluator(size_t maxBatchSize, size_t maxLatencyMicroseconds) override;
+
+    // ForwardPassBatch - evaluate several requests in one minibatch, each as a sequence of its own (used by BatchingEvaluator)
+    // inputs[r], outputs[r] - input and output buffers of request r, as for ForwardPass(); only dense inputs are supported
+    void ForwardPassBatch(const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs);
+
     virtual void Destroy() override;
 
     virtual void CreateNetwork(const std::string& networkDescription) override
@@ -126,6 +134,8 @@ private:
     std::vector<ComputationNodeBasePtr> m_inputNodes;
     StreamMinibatchInputs m_inputMatrices;
     bool m_started;
+    bool m_isWorker; // created by CreateWorker(), which does not repeat the messages of the evaluator it was created from
+    std::vector<ElemType> m_batchBuffer; // staging area of ForwardPassBatch()
 
     template<template<typename> class ValueContainer> 
     void ForwardPassT(const std::vector < ValueBuffer<ElemType, ValueContainer> >& inputs,
@@ -6,6 +6,7 @@
 #include "stdafx.h"
 #include "BatchNormalizationEngine.h"
 #include "CuDnnFactories.h"
+#include "BlockedLayout.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -82,10 +83,19 @@ public:
 public:
     CntkBatchNormEngine(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
                         bool spatial, ImageLayoutKind imageLayout)
-                        : Base(deviceId, inOutT, spatial, imageLayout)
+                        : Base(deviceId, inOutT, spatial, imageLayout), m_blockedInput(false), m_blockedOutput(false)
     {
     }
 
+    void SetBlockedLayout(bool blockedInput, bool blockedOutput) override
+    {
+        if ((blockedInput || blockedOutput) && !Base::IsBlockedLayoutSupported(m_deviceId, m_inOutT, m_spatial, m_imageLayout))
+            LogicError("CNTK batch normalization supports the blocked layout only for spatial inference on the CPU with a multiple of %d channels.",
+                       (int)BlockedLayout::ChannelBlockSize);
+        m_blockedInput = blockedInput;
+        m_blockedOutput = blockedOutput;
+    }
+
 protected:
     using Base::m_deviceId;
     using Base::m_imageLayout;
@@ -101,6 +111,15 @@ protected:
     void ForwardCore(const Mat& in, const Mat& scale, const Mat& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Mat& runMean, Mat& runVariance,
                      Mat& out, double epsilon, Mat& savedMean, Mat& savedInvStdDev) override
     {
+        if (m_blockedInput || m_blockedOutput)
+        {
+            if (!inferenceOnly || expAvgFactor != 0 || blendFactor != 1)
+                LogicError("CNTK batch normalization supports the blocked layout only for inference.");
+            ForwardBlocked(in, scale, bias, runMean, runVariance, out, epsilon);
+            savedMean.Resize(0, 0);
+            savedInvStdDev.Resize(0, 0);
+            return;
+        }
         in.BatchNormalizationForward(scale, bias, inferenceOnly, expAvgFactor, blendFactor, runMean, runVariance, out, epsilon, savedMean, savedInvStdDev);
     }
 
@@ -109,6 +128,61 @@ protected:
     {
         srcGrad.BatchNormalizationBackward(in, grad, scale, blendFactor, savedMean, savedInvStdDev, scaleGrad, biasGrad);
     }
+
+private:
+    // Inference in the blocked layout: out = a * in + b per channel, with a = scale / sqrt(var + eps) and b = bias - a * mean.
+    // Plain inputs and outputs are converted, so that the inner loop always runs over the channels of a block.
+    void ForwardBlocked(const Mat& in, const Mat& scale, const Mat& bias, const Mat& runMean, const Mat& runVariance, Mat& out, double epsilon)
+    {
+        const size_t B = BlockedLayout::ChannelBlockSize;
+        const size_t width = m_inOutT[0], height = m_inOutT[1], channels = m_inOutT[2];
+        const size_t planeSize = width * height;
+        const size_t batchSize = in.GetNumCols();
+        const size_t numBlocks = channels / B;
+
+        m_coefficients.resize(2 * channels);
+        for (size_t c = 0; c < channels; c++)
+        {
+            ElemType a = scale.Data()[c] / sqrt(runVariance.Data()[c] + (ElemType)epsilon);
+            m_coefficients[c] = a;
+            m_coefficients[channels + c] = bias.Data()[c] - a * runMean.Data()[c];
+        }
+
+        const ElemType* src = in.Data();
+        if (!m_blockedInput)
+        {
+            m_buffer.resize(in.GetNumElements());
+            BlockedLayout::ToBlocked(in.Data(), m_buffer.data(), width, height, channels, batchSize);
+            src = m_buffer.data();
+        }
+        ElemType* dst = out.Data();
+        if (!m_blockedOutput)
+        {
+            m_buffer.resize(out.GetNumElements());
+            dst = m_buffer.data(); // in place if the input was converted too
+        }
+
+        const ElemType* a = m_coefficients.data();
+        const ElemType* b = m_coefficients.data() + channels;
+#pragma omp parallel for
+        for (int64_t nb = 0; nb < (int64_t)(batchSize * numBlocks); nb++)
+        {
+            const size_t cb = nb % numBlocks;
+            const size_t offset = nb * planeSize * B;
+            for (size_t i = 0; i < planeSize; i++)
+            {
+                for (size_t c = 0; c < B; c++)
+                    dst[offset + i * B + c] = a[cb * B + c] * src[offset + i * B + c] + b[cb * B + c];
+            }
+        }
+
+        if (!m_blockedOutput)
+            BlockedLayout::FromBlocked(m_buffer.data(), out.Data(), width, height, channels, batchSize);
+    }
+
+    bool m_blockedInput, m_blockedOutput;
+    std::vector<ElemType> m_coefficients; // a and b of ForwardBlocked()
+    std::vector<ElemType> m_buffer;       // blocked copy of a plain input and/or output
 };
 
 template class CntkBatchNormEngine<float>;
@@ -144,6 +218,13 @@ std::unique_ptr<BatchNormEngine<ElemType>> BatchNormEngine<ElemType>::Create(DEV
     RuntimeError("Could not find appropriate batch normalization engine.");
 }
 
+template <class ElemType>
+bool BatchNormEngine<ElemType>::IsBlockedLayoutSupported(DEVICEID_TYPE deviceId, const TensorShape& inOutT, bool spatial, ImageLayoutKind imageLayout)
+{
+    return deviceId < 0 && spatial && imageLayout == ImageLayoutKind::CHW &&
+           inOutT.GetRank() == 3 && inOutT[2] % BlockedLayout::ChannelBlockSize == 0;
+}
+
 template class BatchNormEngine<float>;
 template class BatchNormEngine<double>;
 
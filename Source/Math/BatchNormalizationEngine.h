@@ -46,6 +46,18 @@ public:
 
     DISABLE_COPY_AND_MOVE(BatchNormEngine);
 
+    // Selects the blocked layout (see BlockedLayout.h) instead of the plain one for the input and/or the output of
+    // Forward(). Only supported by the CNTK engine, for spatial inference on the CPU with a multiple of
+    // BlockedLayout::ChannelBlockSize channels.
+    virtual void SetBlockedLayout(bool blockedInput, bool blockedOutput)
+    {
+        if (blockedInput || blockedOutput)
+            LogicError("This batch normalization engine does not support the blocked layout.");
+    }
+
+    // Whether the CNTK engine supports the blocked layout for the given configuration.
+    static bool IsBlockedLayoutSupported(DEVICEID_TYPE deviceId, const TensorShape& inOutT, bool spatial, ImageLayoutKind imageLayout);
+
 protected:
     BatchNormEngine(DEVICEID_TYPE deviceId, const TensorShape& inOutT,
                     bool spatial, ImageLayoutKind imageLayout)
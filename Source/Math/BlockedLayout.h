@@ -0,0 +1,89 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// BlockedLayout.h -- channel-interleaved ("NCHWc") layout of image tensors for the CPU inference engines
+//
+// CNTK stores an image sample [W x H x C] column-major, i.e. one plane per channel. The blocked layout groups the
+// channels into blocks of ChannelBlockSize and interleaves the channels of a block, so that the values of all channels
+// of a block at one pixel are contiguous:
+//
+//     blocked[((c / ChannelBlockSize * H + y) * W + x) * ChannelBlockSize + c % ChannelBlockSize] = plain[(c * H + y) * W + x]
+//
+// The inner loops of the blocked convolution, pooling and batch normalization then run over the channels of a block
+// with unit stride. If C is not a multiple of ChannelBlockSize, the last block is padded with zeros. If it is, a blocked
+// sample has the same number of elements as a plain one, so that both can be stored in the same matrix.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+struct BlockedLayout
+{
+    static const size_t ChannelBlockSize = 8;
+
+    static size_t NumBlocks(size_t channels)
+    {
+        return (channels + ChannelBlockSize - 1) / ChannelBlockSize;
+    }
+
+    // number of elements of a blocked sample, including the padding channels
+    static size_t SampleSize(size_t width, size_t height, size_t channels)
+    {
+        return NumBlocks(channels) * ChannelBlockSize * width * height;
+    }
+
+    // Converts numSamples plain samples [W x H x C] to the blocked layout. Samples are SampleSize() elements apart in blocked.
+    template <class ElemType>
+    static void ToBlocked(const ElemType* plain, ElemType* blocked, size_t width, size_t height, size_t channels, size_t numSamples)
+    {
+        const size_t planeSize = width * height;
+        const size_t numBlocks = NumBlocks(channels);
+        const size_t plainSampleSize = planeSize * channels;
+        const size_t blockedSampleSize = SampleSize(width, height, channels);
+#pragma omp parallel for
+        for (int64_t nb = 0; nb < (int64_t)(numSamples * numBlocks); nb++)
+        {
+            const size_t n = nb / numBlocks;
+            const size_t cb = nb % numBlocks;
+            const ElemType* src = plain + n * plainSampleSize + cb * ChannelBlockSize * planeSize;
+            ElemType* dst = blocked + n * blockedSampleSize + cb * ChannelBlockSize * planeSize;
+            const size_t numChannels = channels - cb * ChannelBlockSize;
+            for (size_t i = 0; i < planeSize; i++)
+            {
+                for (size_t ci = 0; ci < ChannelBlockSize; ci++)
+                    dst[i * ChannelBlockSize + ci] = ci < numChannels ? src[ci * planeSize + i] : 0;
+            }
+        }
+    }
+
+    // Inverse of ToBlocked(), the padding channels are dropped.
+    template <class ElemType>
+    static void FromBlocked(const ElemType* blocked, ElemType* plain, size_t width, size_t height, size_t channels, size_t numSamples)
+    {
+        const size_t planeSize = width * height;
+        const size_t numBlocks = NumBlocks(channels);
+        const size_t plainSampleSize = planeSize * channels;
+        const size_t blockedSampleSize = SampleSize(width, height, channels);
+#pragma omp parallel for
+        for (int64_t nb = 0; nb < (int64_t)(numSamples * numBlocks); nb++)
+        {
+            const size_t n = nb / numBlocks;
+            const size_t cb = nb % numBlocks;
+            const ElemType* src = blocked + n * blockedSampleSize + cb * ChannelBlockSize * planeSize;
+            ElemType* dst = plain + n * plainSampleSize + cb * ChannelBlockSize * planeSize;
+            const size_t numChannels = channels - cb * ChannelBlockSize;
+            for (size_t ci = 0; ci < ChannelBlockSize && ci < numChannels; ci++)
+            {
+                for (size_t i = 0; i < planeSize; i++)
+                    dst[ci * planeSize + i] = src[i * ChannelBlockSize + ci];
+            }
+        }
+    }
+};
+
+}}}
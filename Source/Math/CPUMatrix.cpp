@@ -11,6 +11,8 @@
 
 #include "CPUMatrix.h"
 #include "TensorOps.h"
+#include "CPUTensorKernels.h"
+#include "CPURNN.h"
 #include <assert.h>
 #include <stdexcept>
 #include <omp.h>
@@ -4609,6 +4611,13 @@ void CPUMatrix<ElemType>::BatchNormalizationBackward(const CPUMatrix<ElemType>&
     RuntimeError("Batch normalization training on CPU is not yet implemented.");
 }
 
+template <class ElemType>
+void CPUMatrix<ElemType>::RNNForward(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame,
+                                     const RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& workspace)
+{
+    CPURNN<ElemType>(rnnAttributes, xDim, yDim).Forward(paramW, inputX, *this, numSequencesForFrame, workspace);
+}
+
 
 #pragma region Static BLAS Functions
 
@@ -6106,28 +6115,80 @@ void CPUMatrix<ElemType>::SetCompatibleMode()
 // function to compute the value for a given output location (perform reduction if needed)
 // -----------------------------------------------------------------------
 
+// value of TensorOpContext::parallelLoop if no regular loop is run in parallel (-1 is already taken by the scalar level)
+static const int TensorOpNoParallelLoop = -2;
+
+// maximum number of blocks a reduction is split into for parallel execution
+static const size_t TensorOpMaxReductionBlocks = 64;
+
+// per-call information that is passed through the loop templates below
+struct TensorOpContext
+{
+    // op codes of 'opfn' and 'reductionOp', for use by the explicitly vectorized kernels (CPUTensorKernels.h)
+    ElementWiseOperator op;
+    ElementWiseOperator reductionOp;
+    // parallel schedule, see ScheduleTensorOp()
+    int parallelLoop;       // index k of the regular loop that is run in parallel, or TensorOpNoParallelLoop
+    size_t reductionBlocks; // if > 1, the outermost reduction loop is cut into this many blocks that are reduced in parallel
+};
+
 // perform loop over reduction index m
 // This function is declared inside a wrapper struct to allow partial specialization (m = -1).
 template <class ElemType, typename OPFN, typename ReductionOp, size_t N, int m>
 struct TensorOpReduction
 {
     // reduction case (non-reduction case is specialized)
-    static inline ElemType Loop(array<ElemType*, N> pointers, const OPFN& opfn, const ReductionOp& reductionOp,
+    static inline ElemType Loop(array<ElemType*, N> pointers, const OPFN& opfn, const ReductionOp& reductionOp, const TensorOpContext& context,
                                 const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+    {
+        size_t dimSize = reducingOpDims[(size_t) m];
+        if ((size_t) m + 1 < reducingOpDims.size() || context.reductionBlocks <= 1)
+            return LoopRange(pointers, 0, dimSize, opfn, reductionOp, context, reducingOpDims, reducingStrides);
+
+        // outermost reduction loop scheduled for parallel execution: reduce blocks in parallel, then aggregate them in order
+        // The block boundaries only depend on the tensor shape, so the result does not depend on the number of threads.
+        const int numBlocks = (int) context.reductionBlocks;
+        vector<ElemType> partialAggregates(numBlocks);
+#pragma omp parallel for
+        for (int block = 0; block < numBlocks; block++)
+            partialAggregates[block] = LoopRange(pointers, dimSize * block / numBlocks, dimSize * (block + 1) / numBlocks, opfn, reductionOp, context, reducingOpDims, reducingStrides);
+        double aggregate = partialAggregates[0];
+        for (int block = 1; block < numBlocks; block++)
+            aggregate = reductionOp(aggregate, partialAggregates[block]);
+        return static_cast<double>(aggregate);
+    }
+
+    // reduce over index range [begin, end) of loop m
+    static inline ElemType LoopRange(array<ElemType*, N> pointers, size_t begin, size_t end, const OPFN& opfn, const ReductionOp& reductionOp, const TensorOpContext& context,
+                                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
     {
         array<ptrdiff_t, N - 1> strides;   // N-1 because last one is the result pointer, which is unused in reduction
+        bool allStridesOne = true;
         for (size_t i = 0; i < N - 1; i++) // N = a small constant, this will be unrolled
+        {
             strides[i] = reducingStrides[i][(size_t) m];
+            allStridesOne &= strides[i] == 1;
+            pointers[i] += begin * strides[i];
+        }
+
+        // innermost reduction over consecutive elements: use the vectorized kernel if there is one
+        if (m == 0 && allStridesOne && CPUTensorKernels<ElemType>::CanDoReduction(context.op, context.reductionOp, N - 1))
+        {
+            const ElemType* inputs[N - 1];
+            for (size_t i = 0; i < N - 1; i++)
+                inputs[i] = pointers[i];
+            return (ElemType) CPUTensorKernels<ElemType>::Reduce(context.op, context.reductionOp, N - 1, inputs, end - begin);
+        }
 
-        double aggregate = TensorOpReduction<ElemType, OPFN, ReductionOp, N, m - 1>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
-        for (size_t dim = reducingOpDims[(size_t)m] - 1; dim-- > 0;)
+        double aggregate = TensorOpReduction<ElemType, OPFN, ReductionOp, N, m - 1>::Loop(pointers, opfn, reductionOp, context, reducingOpDims, reducingStrides);
+        for (size_t dim = end - begin - 1; dim-- > 0;)
         {
             // advance the pointers
             for (size_t i = 0; i < N - 1; i++)
                 pointers[i] += strides[i]; // note: last pointer (result) is unused and untouched here
 
             // need to descend into one loop deeper
-            aggregate = reductionOp(aggregate, TensorOpReduction<ElemType, OPFN, ReductionOp, N, m - 1>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides));
+            aggregate = reductionOp(aggregate, TensorOpReduction<ElemType, OPFN, ReductionOp, N, m - 1>::Loop(pointers, opfn, reductionOp, context, reducingOpDims, reducingStrides));
         }
         // Actually it would be nicer to return double but we keep ElementType so that test don't return different numbers than previous implementation.
         return static_cast<double>(aggregate);
@@ -6139,7 +6200,7 @@ struct TensorOpReduction
 template <class ElemType, typename OPFN, typename ReductionOp, size_t N>
 struct TensorOpReduction<ElemType, OPFN, ReductionOp, N, -1>
 {
-    static inline ElemType Loop(array<ElemType*, N> pointers, const OPFN& opfn, const ReductionOp& reductionOp,
+    static inline ElemType Loop(array<ElemType*, N> pointers, const OPFN& opfn, const ReductionOp& reductionOp, const TensorOpContext&,
                                 const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, N>&)
     {
         return opfn(pointers); // finally we are doing some work!!!
@@ -6154,7 +6215,7 @@ struct TensorOpReduction<ElemType, OPFN, ReductionOp, N, -1>
 template <class ElemType, typename OPFN, typename ReductionOp, size_t N, bool vectorizable, int m, int k>
 struct TensorOpIteration
 {
-    static inline void Loop(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+    static inline void Loop(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp, const TensorOpContext& context,
                             const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
                             const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
     {
@@ -6162,10 +6223,23 @@ struct TensorOpIteration
         array<ptrdiff_t, N> strides;
         for (size_t i = 0; i < N; i++) // N = a small constant, this will be unrolled
             strides[i] = regularStrides[i][(size_t) k];
+        if (k == context.parallelLoop) // this loop was chosen by ScheduleTensorOp() to be run in parallel
+        {
+            const int K = (int) regularOpDims[(size_t) k];
+#pragma omp parallel for
+            for (int dim = 0; dim < K; dim++)
+            {
+                array<ElemType*, N> dimPointers;
+                for (size_t i = 0; i < N; i++)
+                    dimPointers[i] = pointers[i] + dim * strides[i];
+                TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, k - 1>::Loop(beta, dimPointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+            }
+            return;
+        }
         for (size_t dim = regularOpDims[(size_t) k]; dim-- > 0;)
         {
             // need to descend into one loop deeper
-            TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, k - 1>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+            TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, k - 1>::Loop(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
             // advance the pointers
             for (size_t i = 0; i < N; i++)
                 pointers[i] += strides[i];
@@ -6173,73 +6247,116 @@ struct TensorOpIteration
     }
 };
 
-// Special version for innermost loop with strides all being 1 and no further reduction. Compiler can use SSE.
+// number of elements per parallel work item of the explicitly vectorized innermost loop
+static const size_t VectorizedTensorOpChunkSize = 4096;
+
+// Innermost loop with strides all being 1 and no further reduction, using the explicitly vectorized kernels (CPUTensorKernels.h).
+// If 'parallel', the loop is cut into chunks that are processed in parallel. Returns false if there is no vectorized kernel for 'op'.
+template <class ElemType, size_t N>
+static inline bool TensorOpVectorizedInnermostLoop(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, ElementWiseOperator op, size_t K, bool parallel)
+{
+    if (!CPUTensorKernels<ElemType>::CanDoElementwise(op, N - 1))
+        return false;
+    const int numChunks = (int) ((K + VectorizedTensorOpChunkSize - 1) / VectorizedTensorOpChunkSize);
+#pragma omp parallel for if (parallel && numChunks > 1)
+    for (int chunk = 0; chunk < numChunks; chunk++)
+    {
+        size_t begin = chunk * VectorizedTensorOpChunkSize;
+        size_t n = min(VectorizedTensorOpChunkSize, K - begin);
+        const ElemType* inputs[N - 1];
+        for (size_t i = 0; i < N - 1; i++)
+            inputs[i] = pointers[i] + begin;
+        CPUTensorKernels<ElemType>::Elementwise(op, N - 1, beta, inputs, pointers[N - 1] + begin, alpha, n);
+    }
+    return true;
+}
+
+// Special version for innermost loop with strides all being 1 and no further reduction.
 // This is a very common case, e.g. adding vectors or computing the Sigmoid.
+// Ops that have an explicitly vectorized kernel use that; for all others, the compiler can use SSE.
 template <class ElemType, typename OPFN, typename ReductionOp>
 struct TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, 0 /*innermost loop*/>
 {
-    static inline void Loop(ElemType beta, array<ElemType*, 3> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+    static inline void Loop(ElemType beta, array<ElemType*, 3> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp, const TensorOpContext& context,
                             const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 3>& regularStrides,
                             const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 3>& reducingStrides)
     {
+        if (TensorOpVectorizedInnermostLoop(beta, pointers, alpha, context.op, regularOpDims[0], context.parallelLoop == 0))
+            return;
         ElemType* pa = pointers[0];
         ElemType* pb = pointers[1];
         ElemType* pc = pointers[2];
         size_t K = regularOpDims[0];
         // special-case beta and alpha to allow the compiler to short-circuit it
         if (beta != 0)
-#pragma omp parallel for
+#pragma omp parallel for if (context.parallelLoop == 0)
             for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         else if (alpha != 1)
-#pragma omp parallel for
+#pragma omp parallel for if (context.parallelLoop == 0)
             for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         else
-#pragma omp parallel for
+#pragma omp parallel for if (context.parallelLoop == 0)
             for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, 1, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+                TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, 1, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         // TODO: According to Amit, the VS compiler is not able to vectorize into lambdas. Solution: change the lambda to take an N, or to implement the loop inside (with 1 element by default).
         // TODO: The signedness of k (required for omp) causes an extra sign-extend.
-        // TODO: OMP adds LOTS of overhead. Do we need a guard, a min size when to use it?
+    }
+};
+// and ternary, which is only special-cased for the vectorized kernels
+template <class ElemType, typename OPFN, typename ReductionOp>
+struct TensorOpIteration<ElemType, OPFN, ReductionOp, 4, true /*vectorizable*/, -1 /*no reduction*/, 0 /*innermost loop*/>
+{
+    static inline void Loop(ElemType beta, array<ElemType*, 4> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp, const TensorOpContext& context,
+                            const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 4>& regularStrides,
+                            const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 4>& reducingStrides)
+    {
+        if (TensorOpVectorizedInnermostLoop(beta, pointers, alpha, context.op, regularOpDims[0], context.parallelLoop == 0))
+            return;
+        size_t K = regularOpDims[0];
+        for (size_t k = 0; k < K; k++)
+            TensorOpIteration<ElemType, OPFN, ReductionOp, 4, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 4>{pointers[0] + k, pointers[1] + k, pointers[2] + k, pointers[3] + k}, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     }
 };
 // and unary
 template <class ElemType, typename OPFN, typename ReductionOp>
 struct TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, 0 /*innermost loop*/>
 {
-    static inline void Loop(ElemType beta, array<ElemType*, 2> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+    static inline void Loop(ElemType beta, array<ElemType*, 2> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp, const TensorOpContext& context,
                             const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, 2>& regularStrides,
                             const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, 2>& reducingStrides)
     {
+        if (TensorOpVectorizedInnermostLoop(beta, pointers, alpha, context.op, regularOpDims[0], context.parallelLoop == 0))
+            return;
         ElemType* pa = pointers[0];
         ElemType* pb = pointers[1];
         size_t K = regularOpDims[0];
         // special-case beta and alpha to allow the compiler to short-circuit it
         if (beta != 0)
-#pragma omp parallel for
+#pragma omp parallel for if (context.parallelLoop == 0)
             for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         else if (alpha != 1)
-#pragma omp parallel for
+#pragma omp parallel for if (context.parallelLoop == 0)
             for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         else
-#pragma omp parallel for
+#pragma omp parallel for if (context.parallelLoop == 0)
             for (int k = 0; k < (int) K; k++)
-                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, 1, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+                TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, 1, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     }
 };
 
 template <class ElemType, typename OPFN, typename ReductionOp, size_t N, bool vectorizable, int m>
 struct TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, -1>
 {
-    static inline void Loop(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+    static inline void Loop(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp, const TensorOpContext& context,
                             const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, N>&,
                             const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
     {
         // we are at element level for the result: perform the op (there may still be reduction)
-        ElemType val = TensorOpReduction<ElemType, OPFN, ReductionOp, N, m>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
+        ElemType val = TensorOpReduction<ElemType, OPFN, ReductionOp, N, m>::Loop(pointers, opfn, reductionOp, context, reducingOpDims, reducingStrides);
         // scale
         val *= alpha;
         // combine with previous value in target matrix, then write it out
@@ -6252,13 +6369,88 @@ struct TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, -1>
     }
 };
 
+// -----------------------------------------------------------------------
+// choose between serial and parallel execution
+// -----------------------------------------------------------------------
+
+// minimum number of elements to process (outputs times reduction size) for which a tensor op is run in parallel
+static size_t s_tensorOpParallelThreshold = 16384;
+
+// number of threads to use for a tensor op that processes 'numElements' elements (1 means serial execution)
+static size_t GetNumTensorOpThreads(size_t numElements)
+{
+    if (numElements < s_tensorOpParallelThreshold)
+        return 1;
+#ifdef _OPENMP
+    if (omp_in_parallel()) // already inside a parallel region (nested parallelism would only add overhead)
+        return 1;
+    return (size_t) omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// Decide how to parallelize a tensor op, based on the amount of work.
+// Entering an OpenMP parallel region costs microseconds, which dominates ops on small tensors, e.g. in inference with small
+// minibatches, so those are run serially. Others are parallelized over the outermost regular loop that has at least as many
+// iterations as there are threads, which gives the largest work items. Ops with fewer outputs than threads (e.g. reductions
+// to a scalar) are parallelized over blocks of the outermost reduction loop instead.
+static void ScheduleTensorOp(TensorOpContext& context, const SmallVector<size_t>& regularOpDims, const SmallVector<size_t>& reducingOpDims)
+{
+    context.parallelLoop = TensorOpNoParallelLoop;
+    context.reductionBlocks = 1;
+
+    size_t numOutputs = 1;
+    for (size_t k = 0; k < regularOpDims.size(); k++)
+        numOutputs *= regularOpDims[k];
+    size_t reductionSize = 1;
+    for (size_t m = 0; m < reducingOpDims.size(); m++)
+        reductionSize *= reducingOpDims[m];
+    const size_t numThreads = GetNumTensorOpThreads(numOutputs * reductionSize);
+    if (numThreads <= 1)
+        return;
+
+    if (numOutputs >= numThreads)
+    {
+        int longestLoop = 0;
+        for (int k = (int) regularOpDims.size() - 1; k >= 0; k--)
+        {
+            if (regularOpDims[(size_t) k] >= numThreads)
+            {
+                context.parallelLoop = k;
+                return;
+            }
+            if (regularOpDims[(size_t) k] > regularOpDims[(size_t) longestLoop])
+                longestLoop = k;
+        }
+        context.parallelLoop = longestLoop; // no single loop is long enough; use the longest one
+    }
+    else if (!reducingOpDims.empty())
+        context.reductionBlocks = min(reducingOpDims.back(), TensorOpMaxReductionBlocks);
+}
+
+// note: this function does not depend on the <ElemType> parameter
+template <class ElemType>
+size_t CPUMatrix<ElemType>::SetTensorOpParallelThreshold(size_t numElements)
+{
+    size_t previous = s_tensorOpParallelThreshold;
+    s_tensorOpParallelThreshold = numElements;
+    return previous;
+}
+
+template <class ElemType>
+size_t CPUMatrix<ElemType>::GetTensorOpParallelThreshold()
+{
+    return s_tensorOpParallelThreshold;
+}
+
 // -----------------------------------------------------------------------
 // map runtime parameters N to template parameters
 // -----------------------------------------------------------------------
 
 // tensor operation with k+1 dimensions (-1 means scalar)
 template <class ElemType, typename OPFN, typename ReductionOp, size_t N, int k>
-static void TensorOpWithRegularLoop(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, ReductionOp reductionOp,
+static void TensorOpWithRegularLoop(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, ReductionOp reductionOp, const TensorOpContext& context,
                                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
                                     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
 {
@@ -6266,9 +6458,9 @@ static void TensorOpWithRegularLoop(ElemType beta, const array<ElemType*, N>& po
     switch (dims)
     {
     case 2:
-        return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 1:
-        return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 0, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 0, k>::Loop(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 0:
     {
         // if all leading dimensions are 1, we can let the compiler do some unrolling
@@ -6276,9 +6468,9 @@ static void TensorOpWithRegularLoop(ElemType beta, const array<ElemType*, N>& po
         for (size_t i = 0; i < N; i++)
             leadingAllOne &= k >= 0 && regularStrides[i][0] == 1;
         if (leadingAllOne) // special version that uses a hard-coded increment of 1 for all leading dimensions
-            return TensorOpIteration<ElemType, OPFN, ReductionOp, N, true /*vectorizable*/, -1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+            return TensorOpIteration<ElemType, OPFN, ReductionOp, N, true /*vectorizable*/, -1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         else
-            return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, -1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+            return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, -1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     }
     default:
         LogicError("TensorOp: %d non-flattened reduction dimensions are not supported.", (int) dims);
@@ -6288,26 +6480,27 @@ static void TensorOpWithRegularLoop(ElemType beta, const array<ElemType*, N>& po
 // tensor operation, generalized in number of arguments, operation already provided as a lambda
 // This function now expands into different k.
 template <class ElemType, typename OPFN, typename ReductionOp, size_t N>
-static void TensorOpWithFnAndReduction(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+static void TensorOpWithFnAndReduction(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp, TensorOpContext context,
     const array<size_t, N>& offsets,
     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
 {
     for (size_t i = 0; i < N; i++) // N = a small constant, this will be unrolled
         pointers[i] += offsets[i];
+    ScheduleTensorOp(context, regularOpDims, reducingOpDims);
     size_t dims = regularOpDims.size();
     switch (dims)
     {
     case 4:
-        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, 3>(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, 3>(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 3:
-        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, 2>(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, 2>(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 2:
-        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, 1>(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, 1>(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 1:
-        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, 0>(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, 0>(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 0:
-        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, -1>(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+        return TensorOpWithRegularLoop<ElemType, OPFN, ReductionOp, N, -1>(beta, pointers, alpha, opfn, reductionOp, context, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     default:
         LogicError("TensorOp: %d non-flattened input dimensions are not supported.", (int)dims);
     }
@@ -6316,7 +6509,7 @@ static void TensorOpWithFnAndReduction(ElemType beta, array<ElemType*, N> pointe
 // tensor operation, generalized in number of arguments, operation already provided as a lambda
 // This function now expands into different reductionOps
 template <class ElemType, typename OPFN, size_t N>
-static void TensorOpWithFn(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, ElementWiseOperator reductionOp,
+static void TensorOpWithFn(ElemType beta, array<ElemType*, N> pointers, ElemType alpha, const OPFN& opfn, ElementWiseOperator op, ElementWiseOperator reductionOp,
     const array<size_t, N>& offsets,
     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
     const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
@@ -6333,6 +6526,7 @@ static void TensorOpWithFn(ElemType beta, array<ElemType*, N> pointers, ElemType
                                     {                                                         \
                                     return Op##oper(a, b);                                    \
                                     },                                                        \
+                                    TensorOpContext{op, reductionOp, TensorOpNoParallelLoop, 1},                           \
                                     offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
 
     switch (reductionOp)
@@ -6371,7 +6565,7 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
                               {                                                        \
                                   return Op##oper((*(pp[0])));                         \
                               },                                                       \
-                              reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
+                              ElementWiseOperator::op##oper, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
 
     array<ElemType*, 2> pointers = {a.Data(), Data()};
     switch (op)
@@ -6399,7 +6593,7 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
                               {                                                        \
                                   return Op##oper((*(pp[0])), (*(pp[1])));             \
                               },                                                       \
-                              reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
+                              ElementWiseOperator::op##oper, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
 
     array<ElemType*, 3> pointers = {a.Data(), b.Data(), Data()};
     switch (op)
@@ -6427,7 +6621,7 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
                               {                                                        \
                                   return Op##oper((*(pp[0])), (*(pp[1])), (*(pp[2]))); \
                               },                                                       \
-                              reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
+                              ElementWiseOperator::op##oper, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
 
     array<ElemType*, 4> pointers = {a.Data(), b.Data(), c.Data(), Data()};
     switch (op)
@@ -6438,6 +6632,154 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
     }
 }
 
+// -----------------------------------------------------------------------
+// fused evaluation of a chain of elementwise ops (ElementwiseOpChain.h)
+// -----------------------------------------------------------------------
+
+// number of consecutive elements that are pushed through the chain at once; the intermediate results of a block stay in the L1 cache
+static const size_t FusedTensorOpBlockSize = 256;
+
+// result[j] = op(args[0][j], ...) for j < n, where all arguments are dense
+template <class ElemType>
+static void FusedTensorOpStep(ElementWiseOperator op, size_t arity, const ElemType* const* args, ElemType* result, size_t n)
+{
+    if (CPUTensorKernels<ElemType>::CanDoElementwise(op, arity))
+        return CPUTensorKernels<ElemType>::Elementwise(op, arity, 0, args, result, 1, n);
+
+    const ElemType* a = args[0];
+    const ElemType* b = arity > 1 ? args[1] : nullptr;
+    const ElemType* c = arity > 2 ? args[2] : nullptr;
+#define CaseFusedUnaryOp(oper)          \
+    case ElementWiseOperator::op##oper: \
+        for (size_t j = 0; j < n; j++)  \
+            result[j] = Op##oper(a[j]); \
+        return
+#define CaseFusedBinaryOp(oper)               \
+    case ElementWiseOperator::op##oper:       \
+        for (size_t j = 0; j < n; j++)        \
+            result[j] = Op##oper(a[j], b[j]); \
+        return
+#define CaseFusedTernaryOp(oper)                    \
+    case ElementWiseOperator::op##oper:             \
+        for (size_t j = 0; j < n; j++)              \
+            result[j] = Op##oper(a[j], b[j], c[j]); \
+        return
+    switch (arity)
+    {
+    case 1:
+        switch (op) { ForAllUnaryOps(CaseFusedUnaryOp); default: break; }
+        break;
+    case 2:
+        switch (op) { ForAllBinaryOps(CaseFusedBinaryOp); default: break; }
+        break;
+    case 3:
+        switch (op) { ForAllTernaryOps(CaseFusedTernaryOp); default: break; }
+        break;
+    }
+#undef CaseFusedUnaryOp
+#undef CaseFusedBinaryOp
+#undef CaseFusedTernaryOp
+    LogicError("FusedTensorOp: Unknown op code %d with %d inputs.", (int) op, (int) arity);
+}
+
+// Evaluate all ops of the chain on one block of consecutive elements of the innermost dimension at a time, so that
+// memory traffic is only incurred for reading the inputs and writing the final output. The operand layout is as for
+// TensorOp() without reduction; inputs that are not consecutive in memory (e.g. broadcasting) are gathered first.
+template <class ElemType>
+void CPUMatrix<ElemType>::FusedTensorOp(ElemType beta, const ElementwiseOpChain& chain, const array<const CPUMatrix<ElemType>*, ElementwiseOpChain::MaxNumInputs>& inputs, ElemType alpha,
+                                        const array<size_t, ElementwiseOpChain::MaxNumInputs + 1>& offsets,
+                                        const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, ElementwiseOpChain::MaxNumInputs + 1>& regularStrides)
+{
+    const size_t output = ElementwiseOpChain::MaxNumInputs; // index of the output in 'offsets' and 'regularStrides'
+    const size_t numInputs = chain.GetNumInputs();
+    const auto& steps = chain.GetSteps();
+    if (steps.empty())
+        InvalidArgument("FusedTensorOp: The chain has no ops.");
+
+    array<const ElemType*, ElementwiseOpChain::MaxNumInputs> inputData = {};
+    array<ptrdiff_t, ElementwiseOpChain::MaxNumInputs + 1> innerStrides = {};
+    for (size_t i = 0; i < numInputs; i++)
+        inputData[i] = inputs[i]->Data() + offsets[i];
+    ElemType* outputData = Data() + offsets[output];
+
+    // the innermost dimension is cut into blocks; all others are iterated over
+    const size_t rank = regularOpDims.size();
+    const size_t K = rank > 0 ? regularOpDims[0] : 1;
+    if (rank > 0)
+        for (size_t i = 0; i <= output; i++)
+            innerStrides[i] = regularStrides[i][0];
+    size_t numOuter = 1;
+    for (size_t k = 1; k < rank; k++)
+        numOuter *= regularOpDims[k];
+    const size_t blocksPerRow = (K + FusedTensorOpBlockSize - 1) / FusedTensorOpBlockSize;
+    const int numBlocks = (int) (numOuter * blocksPerRow);
+    const bool parallel = numBlocks > 1 && GetNumTensorOpThreads(numOuter * K) > 1;
+
+#pragma omp parallel if (parallel)
+    {
+        // per-thread buffers for gathered inputs and intermediate results
+        vector<ElemType> buffer(chain.GetNumOperands() * FusedTensorOpBlockSize);
+        vector<const ElemType*> operands(chain.GetNumOperands());
+#pragma omp for
+        for (int block = 0; block < numBlocks; block++)
+        {
+            const size_t begin = (block % blocksPerRow) * FusedTensorOpBlockSize;
+            const size_t n = min(FusedTensorOpBlockSize, K - begin);
+
+            // locate the block in all operands
+            array<ptrdiff_t, ElementwiseOpChain::MaxNumInputs + 1> locations;
+            for (size_t i = 0; i <= output; i++)
+                locations[i] = begin * innerStrides[i];
+            size_t outer = block / blocksPerRow;
+            for (size_t k = 1; k < rank; k++)
+            {
+                const size_t index = outer % regularOpDims[k];
+                outer /= regularOpDims[k];
+                for (size_t i = 0; i <= output; i++)
+                    locations[i] += index * regularStrides[i][k];
+            }
+
+            // inputs
+            for (size_t i = 0; i < numInputs; i++)
+            {
+                const ElemType* p = inputData[i] + locations[i];
+                if (innerStrides[i] == 1)
+                    operands[i] = p;
+                else
+                {
+                    ElemType* gathered = &buffer[i * FusedTensorOpBlockSize];
+                    for (size_t j = 0; j < n; j++)
+                        gathered[j] = p[j * innerStrides[i]];
+                    operands[i] = gathered;
+                }
+            }
+
+            // the chain
+            for (size_t s = 0; s < steps.size(); s++)
+            {
+                const auto& step = steps[s];
+                const ElemType* args[3];
+                for (size_t a = 0; a < step.arity; a++)
+                    args[a] = operands[step.args[a]];
+                ElemType* result = &buffer[(numInputs + s) * FusedTensorOpBlockSize];
+                FusedTensorOpStep(step.op, step.arity, args, result, n);
+                operands[numInputs + s] = result;
+            }
+
+            // output, with the same rounding as TensorOp()
+            const ElemType* result = operands.back();
+            ElemType* pout = outputData + locations[output];
+            const ptrdiff_t outStride = innerStrides[output];
+            if (beta != 0)
+                for (size_t j = 0; j < n; j++)
+                    pout[j * outStride] = alpha * result[j] + beta * pout[j * outStride];
+            else
+                for (size_t j = 0; j < n; j++)
+                    pout[j * outStride] = alpha * result[j];
+        }
+    }
+}
+
 // =======================================================================
 // explicit instantiations
 // =======================================================================
@@ -389,11 +389,17 @@ public:
     void BatchNormalizationBackward(const CPUMatrix<ElemType>& in, CPUMatrix<ElemType>& grad, const CPUMatrix<ElemType>& scale, double blendFactor, const CPUMatrix<ElemType>& saveMean, const CPUMatrix<ElemType>& saveInvStdDev,
                                     CPUMatrix<ElemType>& scaleGrad, CPUMatrix<ElemType>& biasGrad) const;
 
+    void RNNForward(const CPUMatrix<ElemType>& inputX, const CPUMatrix<ElemType>& paramW, size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame, const struct RnnAttributes& rnnAttributes, CPUMatrix<ElemType>& workspace);
+
 public:
     // This functions do not depend on <ElemType>, i.e. you can call them on any <ElemType>
     static int SetNumThreads(int numThreads);
     static int GetMaxNumThreads();
 
+    // tensor ops on fewer elements than this are run single-threaded; returns the previous value
+    static size_t SetTensorOpParallelThreshold(size_t numElements);
+    static size_t GetTensorOpParallelThreshold();
+
     static void SetCompatibleMode();
 
     // static BLAS functions
@@ -438,6 +444,9 @@ public:
                   const std::array<size_t, 4>& offsets,
                   const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
                   const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+    void FusedTensorOp(ElemType beta, const ElementwiseOpChain& chain, const std::array<const CPUMatrix<ElemType>*, ElementwiseOpChain::MaxNumInputs>& inputs, ElemType alpha,
+                       const std::array<size_t, ElementwiseOpChain::MaxNumInputs + 1>& offsets,
+                       const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, ElementwiseOpChain::MaxNumInputs + 1>& regularStrides);
 
     static CPUMatrix<ElemType> Ones(const size_t rows, const size_t cols);
     static CPUMatrix<ElemType> Zeros(const size_t rows, const size_t cols);
@@ -0,0 +1,233 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPURNN.cpp -- CPU implementation of the stacked RNN computed by OptimizedRNNStackNode (see CPURNN.h)
+//
+// For each layer and direction, the input projections of all frames do not depend on the recurrence and are
+// computed with a single GEMM. The recurrence then only multiplies the recurrent weights with the hidden state of
+// the active sequences in each frame, and evaluates all gate nonlinearities and the state update in one pass.
+//
+
+#include "stdafx.h"
+#include "CPURNN.h"
+#include <math.h>
+#include <string.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <class ElemType>
+static inline ElemType Sigmoid(ElemType x)
+{
+    return 1 / (1 + exp(-x));
+}
+
+template <class ElemType>
+CPURNN<ElemType>::CPURNN(const RnnAttributes& rnnAttributes, size_t xDim, size_t yDim)
+    : m_numLayers(rnnAttributes.m_numLayers),
+      m_numDirections(rnnAttributes.m_bidirectional ? 2 : 1),
+      m_hiddenSize(rnnAttributes.m_hiddenSize),
+      m_xDim(xDim)
+{
+    if      (rnnAttributes.m_recurrentOp == L"lstm")    { m_cellType = CellType::LSTM;    m_numGates = 4; }
+    else if (rnnAttributes.m_recurrentOp == L"gru")     { m_cellType = CellType::GRU;     m_numGates = 3; }
+    else if (rnnAttributes.m_recurrentOp == L"rnnReLU") { m_cellType = CellType::RNNReLU; m_numGates = 1; }
+    else if (rnnAttributes.m_recurrentOp == L"rnnTanh") { m_cellType = CellType::RNNTanh; m_numGates = 1; }
+    else InvalidArgument("Unknown cell type '%ls'. Supported values are 'lstm', 'gru', 'rnnReLU', 'rnnTanh'.", rnnAttributes.m_recurrentOp.c_str());
+
+    if (m_numLayers == 0 || m_hiddenSize == 0)
+        InvalidArgument("CPURNN: The number of layers and the hidden size must not be 0.");
+    if (yDim != m_numDirections * m_hiddenSize)
+        InvalidArgument("CPURNN: Output dimension must be %d times the hidden size.", (int)m_numDirections);
+}
+
+template <class ElemType>
+size_t CPURNN<ElemType>::GetNumParameters() const
+{
+    size_t total = 0;
+    for (size_t layer = 0; layer < m_numLayers; layer++)
+        total += m_numDirections * m_numGates * m_hiddenSize * (GetLayerInputDim(layer) + m_hiddenSize + 2);
+    return total;
+}
+
+template <class ElemType>
+void CPURNN<ElemType>::Forward(const CPUMatrix<ElemType>& weightsW, const CPUMatrix<ElemType>& inputX, CPUMatrix<ElemType>& outputY,
+                               const std::vector<size_t>& numSequencesForFrame, CPUMatrix<ElemType>& workspace) const
+{
+    if (weightsW.GetNumElements() != GetNumParameters())
+        InvalidArgument("RNN needs %ld parameters, but %ld were allocated", (long)GetNumParameters(), (long)weightsW.GetNumElements());
+
+    // column offset of every frame in the packed input and output
+    const size_t numFrames = numSequencesForFrame.size();
+    std::vector<size_t> frameOffsets(numFrames);
+    size_t numCols = 0;
+    size_t maxNumSequences = 0;
+    for (size_t t = 0; t < numFrames; t++)
+    {
+        if (t > 0 && numSequencesForFrame[t] > numSequencesForFrame[t - 1])
+            InvalidArgument("CPURNN: Sequences must be packed from longest to shortest.");
+        frameOffsets[t] = numCols;
+        numCols += numSequencesForFrame[t];
+        maxNumSequences = std::max(maxNumSequences, numSequencesForFrame[t]);
+    }
+    if (inputX.GetNumRows() != m_xDim || inputX.GetNumCols() != numCols)
+        InvalidArgument("CPURNN: Input must be a [%d x %d] matrix.", (int)m_xDim, (int)numCols);
+
+    const size_t gateDim = m_numGates * m_hiddenSize;
+    const size_t layerOutputDim = m_numDirections * m_hiddenSize;
+    outputY.RequireSize(layerOutputDim, numCols);
+    if (numCols == 0)
+        return;
+
+    // workspace: the gates of all frames, two layer outputs (for the layers before the last one), and the state
+    const size_t gatesSize = gateDim * numCols;
+    const size_t layerOutputSize = m_numLayers > 1 ? layerOutputDim * numCols : 0;
+    const size_t stateSize = m_hiddenSize * maxNumSequences;
+    workspace.RequireSize(gatesSize + 2 * layerOutputSize + 2 * stateSize + gateDim * maxNumSequences, 1);
+    ElemType* gates = workspace.Data();
+    ElemType* layerOutputs[2] = { gates + gatesSize, gates + gatesSize + layerOutputSize };
+    ElemType* hiddenState = layerOutputs[1] + layerOutputSize;
+    ElemType* cellState = hiddenState + stateSize;
+    ElemType* recurrentGates = cellState + stateSize;
+    CPUMatrix<ElemType> gatesView(gateDim, numCols, gates, matrixFlagDontOwnBuffer);
+
+    const ElemType* weights = weightsW.Data();
+    const ElemType* biases = weights;
+    for (size_t layer = 0; layer < m_numLayers; layer++)
+        biases += m_numDirections * gateDim * (GetLayerInputDim(layer) + m_hiddenSize);
+
+    const ElemType* layerInput = inputX.Data();
+    for (size_t layer = 0; layer < m_numLayers; layer++)
+    {
+        const size_t inputDim = GetLayerInputDim(layer);
+        ElemType* layerOutput = (layer + 1 == m_numLayers) ? outputY.Data() : layerOutputs[layer % 2];
+        CPUMatrix<ElemType> inputView(inputDim, numCols, const_cast<ElemType*>(layerInput), matrixFlagDontOwnBuffer);
+
+        for (size_t direction = 0; direction < m_numDirections; direction++)
+        {
+            const ElemType* inputWeights = weights;
+            const ElemType* recurrentWeights = inputWeights + gateDim * inputDim;
+            const ElemType* biasW = biases;
+            const ElemType* biasR = biasW + gateDim;
+            weights += gateDim * (inputDim + m_hiddenSize);
+            biases += 2 * gateDim;
+
+            // input projections of all frames at once: gates = W' * input
+            // W holds the gates' [hiddenSize x inputDim] row-major matrices, i.e. it is an [inputDim x gateDim] column-major matrix.
+            CPUMatrix<ElemType> weightsView(inputDim, gateDim, const_cast<ElemType*>(inputWeights), matrixFlagDontOwnBuffer);
+            CPUMatrix<ElemType>::MultiplyAndWeightedAdd(1, weightsView, true, inputView, false, 0, gatesView);
+
+            // add both biases, except for the recurrent bias of the GRU's candidate state, which is applied inside the reset gate
+            std::vector<ElemType> bias(gateDim);
+            for (size_t k = 0; k < gateDim; k++)
+                bias[k] = biasW[k] + (m_cellType == CellType::GRU && k >= 2 * m_hiddenSize ? 0 : biasR[k]);
+#pragma omp parallel for
+            for (long j = 0; j < (long)numCols; j++)
+            {
+                ElemType* g = gates + j * gateDim;
+                for (size_t k = 0; k < gateDim; k++)
+                    g[k] += bias[k];
+            }
+
+            ForwardRecurrence(recurrentWeights, biasR, direction == 1, numSequencesForFrame, frameOffsets, gates, layerOutput, direction * m_hiddenSize,
+                              hiddenState, cellState, recurrentGates);
+        }
+
+        layerInput = layerOutput;
+    }
+}
+
+template <class ElemType>
+void CPURNN<ElemType>::ForwardRecurrence(const ElemType* weightsR, const ElemType* biasR, bool backward, const std::vector<size_t>& numSequencesForFrame,
+                                         const std::vector<size_t>& frameOffsets, ElemType* gates, ElemType* output, size_t outputRowOffset,
+                                         ElemType* hiddenState, ElemType* cellState, ElemType* recurrentGates) const
+{
+    const size_t H = m_hiddenSize;
+    const size_t gateDim = m_numGates * H;
+    const size_t outputDim = m_numDirections * H;
+    const size_t numFrames = numSequencesForFrame.size();
+    const size_t maxNumSequences = numSequencesForFrame.empty() ? 0 : numSequencesForFrame[0];
+
+    // Sequences start with a zero state. Going backward, the number of active sequences only grows, and the state
+    // of the ones that become active has not been touched yet.
+    memset(hiddenState, 0, sizeof(ElemType) * H * maxNumSequences);
+    memset(cellState, 0, sizeof(ElemType) * H * maxNumSequences);
+
+    // R holds the gates' [hiddenSize x hiddenSize] row-major matrices, i.e. it is a [hiddenSize x gateDim] column-major matrix.
+    CPUMatrix<ElemType> weightsView(H, gateDim, const_cast<ElemType*>(weightsR), matrixFlagDontOwnBuffer);
+
+    for (size_t step = 0; step < numFrames; step++)
+    {
+        const size_t t = backward ? numFrames - 1 - step : step;
+        const size_t numSequences = numSequencesForFrame[t];
+        const size_t offset = frameOffsets[t];
+        if (numSequences == 0)
+            continue;
+
+        // recurrent projections: R' * h. The GRU needs them separately, the other cells just add them to the gates.
+        CPUMatrix<ElemType> stateView(H, numSequences, hiddenState, matrixFlagDontOwnBuffer);
+        if (m_cellType == CellType::GRU)
+        {
+            CPUMatrix<ElemType> recurrentView(gateDim, numSequences, recurrentGates, matrixFlagDontOwnBuffer);
+            if (step == 0)
+                memset(recurrentGates, 0, sizeof(ElemType) * gateDim * numSequences);
+            else
+                CPUMatrix<ElemType>::MultiplyAndWeightedAdd(1, weightsView, true, stateView, false, 0, recurrentView);
+        }
+        else if (step > 0)
+        {
+            CPUMatrix<ElemType> gatesView(gateDim, numSequences, gates + offset * gateDim, matrixFlagDontOwnBuffer);
+            CPUMatrix<ElemType>::MultiplyAndWeightedAdd(1, weightsView, true, stateView, false, 1, gatesView);
+        }
+
+        // gate nonlinearities and state update
+#pragma omp parallel for
+        for (long j = 0; j < (long)numSequences; j++)
+        {
+            const ElemType* g = gates + (offset + j) * gateDim;
+            ElemType* h = hiddenState + j * H;
+            ElemType* c = cellState + j * H;
+            ElemType* y = output + (offset + j) * outputDim + outputRowOffset;
+            switch (m_cellType)
+            {
+            case CellType::LSTM:
+                for (size_t k = 0; k < H; k++)
+                {
+                    ElemType inputGate = Sigmoid(g[k]);
+                    ElemType forgetGate = Sigmoid(g[H + k]);
+                    ElemType candidate = tanh(g[2 * H + k]);
+                    ElemType outputGate = Sigmoid(g[3 * H + k]);
+                    c[k] = forgetGate * c[k] + inputGate * candidate;
+                    h[k] = outputGate * tanh(c[k]);
+                }
+                break;
+            case CellType::GRU:
+            {
+                const ElemType* r = recurrentGates + j * gateDim;
+                for (size_t k = 0; k < H; k++)
+                {
+                    ElemType resetGate = Sigmoid(g[k] + r[k]);
+                    ElemType updateGate = Sigmoid(g[H + k] + r[H + k]);
+                    ElemType candidate = tanh(g[2 * H + k] + resetGate * (r[2 * H + k] + biasR[2 * H + k]));
+                    h[k] = (1 - updateGate) * candidate + updateGate * h[k];
+                }
+                break;
+            }
+            case CellType::RNNReLU:
+                for (size_t k = 0; k < H; k++)
+                    h[k] = g[k] > 0 ? g[k] : 0;
+                break;
+            case CellType::RNNTanh:
+                for (size_t k = 0; k < H; k++)
+                    h[k] = tanh(g[k]);
+                break;
+            }
+            memcpy(y, h, sizeof(ElemType) * H);
+        }
+    }
+}
+
+template class CPURNN<float>;
+template class CPURNN<double>;
+
+}}}
@@ -0,0 +1,72 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPURNN.h -- CPU implementation of the stacked RNN computed by OptimizedRNNStackNode
+//
+// The GPU implementation is cuDNN's (see CuDnnRNN.h). This one computes the same function on the same parameters,
+// so that models trained on the GPU can be evaluated on the CPU unmodified. Only the forward pass is implemented.
+//
+// Parameter layout (the one of cuDNN 5 with CUDNN_LINEAR_INPUT): the weight matrices of all layers, followed by
+// the biases of all layers. Layers are ordered layer by layer, forward direction before backward direction.
+// Each layer has
+//     W: numGates matrices [hiddenSize x inputDim] (row-major), the input weights of each gate,
+//     R: numGates matrices [hiddenSize x hiddenSize] (row-major), the recurrent weights of each gate,
+// and in the bias section
+//     bW, bR: numGates vectors [hiddenSize] each, the input and recurrent biases of each gate.
+// The gates are i, f, c, o for LSTM, r (reset), z (update), h for GRU, and a single one for plain RNNs.
+//
+// Data layout: the input and output are packed frame by frame, with sequences ordered from longest to shortest
+// (see OptimizedRNNStackNode::PackSequencesForCuDNN()), so that the sequences active in frame t are the first
+// numSequencesForFrame[t] columns of that frame. For bidirectional networks, the output of the forward direction
+// is in the first hiddenSize rows, that of the backward direction in the second hiddenSize rows.
+//
+
+#pragma once
+
+#include "CPUMatrix.h"
+#include "RNNCommon.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <class ElemType>
+class CPURNN
+{
+public:
+    CPURNN(const RnnAttributes& rnnAttributes, size_t xDim, size_t yDim);
+
+    // outputY = RNN(inputX); the workspace is resized as needed
+    void Forward(const CPUMatrix<ElemType>& weightsW, const CPUMatrix<ElemType>& inputX, CPUMatrix<ElemType>& outputY,
+                 const std::vector<size_t>& numSequencesForFrame, CPUMatrix<ElemType>& workspace) const;
+
+    // total number of weights and biases
+    size_t GetNumParameters() const;
+
+private:
+    enum class CellType
+    {
+        LSTM,
+        GRU,
+        RNNReLU,
+        RNNTanh
+    };
+
+    size_t GetLayerInputDim(size_t layer) const { return layer == 0 ? m_xDim : m_numDirections * m_hiddenSize; }
+
+    // the recurrence of one layer in one direction, over all frames
+    // gates: numGates * hiddenSize rows, the input projections plus biases of all frames; overwritten
+    // output: the layer output, whose rows [direction * hiddenSize, (direction + 1) * hiddenSize) this computes
+    void ForwardRecurrence(const ElemType* weightsR, const ElemType* biasR, bool backward, const std::vector<size_t>& numSequencesForFrame,
+                           const std::vector<size_t>& frameOffsets, ElemType* gates, ElemType* output, size_t outputRowOffset,
+                           ElemType* hiddenState, ElemType* cellState, ElemType* recurrentGates) const;
+
+    CellType m_cellType;
+    size_t m_numGates;
+    size_t m_numLayers;
+    size_t m_numDirections;
+    size_t m_hiddenSize;
+    size_t m_xDim;
+};
+
+}}}
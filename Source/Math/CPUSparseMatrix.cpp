@@ -443,6 +443,64 @@ CPUSparseMatrix<ElemType>& CPUSparseMatrix<ElemType>::DoScatterColumnsOf(ElemTyp
     return *this;
 }
 
+// *this[:,idx[j]] = a[:,j] * alpha + *this[:,idx[j]] * beta, for a SparseBlockCol target
+// Only the columns that are written to get a block. This is the gradient of DoGatherColumnsOf() w.r.t. the gathered-from matrix,
+// e.g. of an embedding lookup, which touches a small subset of the columns.
+template <class ElemType>
+CPUSparseMatrix<ElemType>& CPUSparseMatrix<ElemType>::DoScatterColumnsOf(ElemType beta, const CPUMatrix<ElemType>& idx, const CPUMatrix<ElemType>& a, ElemType alpha)
+{
+    VerifyWritable(__func__);
+
+    if (GetFormat() != matrixFormatSparseBlockCol)
+        NOT_IMPLEMENTED;
+
+    if (idx.GetNumRows() != 1) // index is 1-dimensional only
+        InvalidArgument("DoScatterColumnsOf: Map must be a row vector.");
+    if (idx.GetNumCols() != a.GetNumCols())
+        InvalidArgument("DoScatterColumnsOf: Map must have width of input vector.");
+    if (a.GetNumRows() != GetNumRows())
+        InvalidArgument("DoScatterColumnsOf: Output must have same height as input vector.");
+
+    // pre-scale the existing blocks with beta, since more than one source column may be added to the same block
+    if (beta == 0)
+        Reset();
+    else if (beta != 1)
+    {
+        ElemType* values = Buffer();
+        for (size_t p = 0; p < NzCount(); p++)
+            values[p] *= beta;
+    }
+
+    vector<size_t> cols;
+    cols.reserve(a.GetNumCols());
+    for (size_t jIn = 0; jIn < a.GetNumCols(); jIn++)
+    {
+        auto jOutF = idx(0, jIn);           // this is the column we add into
+        if (std::isnan(jOutF) || jOutF < 0) // negative index means gap
+            continue;
+        size_t jOut = (size_t) jOutF;
+        if (jOut >= GetNumCols())
+            InvalidArgument("DoScatterColumnsOf: Map out of bounds.");
+        cols.push_back(jOut);
+    }
+    map<size_t, size_t> col2BlockId = AddBlockCols(GetNumRows(), GetNumCols(), cols);
+
+    const size_t numRows = GetNumRows();
+    const ElemType* aData = a.Data();
+    for (size_t jIn = 0; jIn < a.GetNumCols(); jIn++)
+    {
+        auto jOutF = idx(0, jIn);
+        if (std::isnan(jOutF) || jOutF < 0)
+            continue;
+        ElemType* block = Buffer() + col2BlockId[(size_t) jOutF] * numRows;
+        const ElemType* aCol = aData + jIn * numRows;
+        for (size_t i = 0; i < numRows; i++)
+            block[i] += alpha * aCol[i];
+    }
+
+    return *this;
+}
+
 template <class ElemType>
 void CPUSparseMatrix<ElemType>::Print(const char* matrixName) const
 {
@@ -810,6 +868,55 @@ void CPUSparseMatrix<ElemType>::Reset()
     SetBlockIdShift(0);
 }
 
+// Makes sure that this SparseBlockCol matrix of size numRows x numCols has a block for each of the given columns.
+// Missing blocks are appended and zero-initialized. Returns the index of the block of each column that has one.
+template <class ElemType>
+map<size_t, size_t> CPUSparseMatrix<ElemType>::AddBlockCols(const size_t numRows, const size_t numCols, const vector<size_t>& cols)
+{
+    SetFormat(matrixFormatSparseBlockCol);
+    size_t blockSizePrev = GetBlockSize();
+
+    if (blockSizePrev == 0)
+    {
+        RequireSizeAndAllocate(numRows, numCols, 0, true); // allocate for blockIds
+    }
+
+    map<size_t, size_t> col2BlockId;
+    for (size_t blockId = 0; blockId < blockSizePrev; blockId++)
+    {
+        col2BlockId[GetBlockIds()[blockId]] = blockId;
+    }
+
+    size_t blockSizeCurr = blockSizePrev;
+    for (size_t col : cols)
+    {
+        if (col2BlockId.find(col) == col2BlockId.end())
+        {
+            col2BlockId[col] = blockSizeCurr;
+            GetBlockIds()[blockSizeCurr] = col;
+            blockSizeCurr++;
+        }
+    }
+
+    if (blockSizeCurr > blockSizePrev)
+    {
+        RequireSizeAndAllocate(numRows, numCols, numRows * blockSizeCurr, true, true);
+        SetBlockSize(blockSizeCurr);
+        memset(Data() + numRows * blockSizePrev, 0, sizeof(ElemType) * numRows * (blockSizeCurr - blockSizePrev));
+    }
+
+    return col2BlockId;
+}
+
+// Size of the blocks that a dimension of a dense matrix is cut into for the sparse products below: small enough that every thread
+// gets several blocks (for load balancing) and that the data touched by a block stays in cache, and a multiple of a cache line.
+static size_t ParallelBlockSize(size_t dim)
+{
+    const size_t numBlocks = 4 * (size_t) omp_get_max_threads();
+    const size_t blockSize = (dim + numBlocks - 1) / numBlocks;
+    return min((size_t) 512, max((size_t) 16, (blockSize + 15) / 16 * 16));
+}
+
 // Implements product of one sparse and one dense matrix updating a third dense matrix. Input matrices are optionally transposed.
 // NOTE: The only for using a class template instead of a function template was that I couldn't make the function template compile.
 template <class ElemType, bool denseTimesSparse /* false means SparseTimesDense */, bool transposeA, bool transposeB>
@@ -869,49 +976,92 @@ public:
         // * Initialized the output matrix c
 
         // Now do the actual multiplication.
-        ElemType* valueBuffer = sparse.Buffer() + *sparse.SecondaryIndexLocation(); // Points to the value buffer of the current view (i.e. buffer containing values of non-zero elements).
-        int* rowIndexBuffer = sparse.MajorIndexLocation();                          // Points to the index buffer of the current view (i.e. buffer containing indices of non-zero elements).
-        size_t iNonzero = 0;                                                           // Number of nonzero elements handled so far for curent slice view.
-        int numPreviosNonzero = sparse.SecondaryIndexLocation()[0];                 // Total number of nonzero values handled in previous slices.
-
-        // Loop over columns of the sparse matrix
-        for (size_t colSparse = 0; colSparse < sparse.GetNumCols(); colSparse++)
+        const ElemType* valueBuffer = sparse.Buffer() + *sparse.SecondaryIndexLocation(); // Points to the value buffer of the current view (i.e. buffer containing values of non-zero elements).
+        const CPUSPARSE_INDEX_TYPE* rowIndexBuffer = sparse.MajorIndexLocation();        // Points to the index buffer of the current view (i.e. buffer containing indices of non-zero elements).
+        const CPUSPARSE_INDEX_TYPE* colStarts = sparse.SecondaryIndexLocation();          // Offsets of the columns, including the nonzero values of previous slices.
+        const int numSparseCols = (int) sparse.GetNumCols();
+        const size_t numNonzero = colStarts[numSparseCols] - colStarts[0];
+
+        const ElemType* denseData = dense.Data();
+        const size_t denseLd = dense.GetNumRows();
+        ElemType* cData = c.Data();
+        const size_t cLd = c.GetNumRows();
+
+        // The work is distributed such that each thread owns a disjoint part of c:
+        // * If the outer index of the sparse matrix is its column index, each sparse column only updates its own column (row) of c,
+        //   so the sparse columns are distributed over the threads.
+        // * Otherwise a sparse column scatters into arbitrary columns (rows) of c. Then the outer dimension of the dense matrix is cut
+        //   into blocks, and each thread processes all nonzero elements for its own blocks. This also keeps the parts of the dense
+        //   matrix and of c that are touched by a block in cache.
+        // Below booleans are evaluated at compile time.
+        const bool sparseColumnOwnsOutput = (denseTimesSparse && !transposeB) || (!denseTimesSparse && transposeA);
+        // Whether the outer index of the dense matrix runs along its columns, i.e. through contiguous memory. If so, each nonzero
+        // element is applied to a range of the outer index (an axpy); otherwise the nonzero elements are gathered for each outer index.
+        const bool denseOuterIsContiguous = (denseTimesSparse && !transposeA) || (!denseTimesSparse && transposeB);
+
+        auto accumulate = [&](size_t outerBegin, size_t outerEnd, int colBegin, int colEnd)
         {
-            size_t numNonzeroInSparseCol = sparse.SecondaryIndexLocation()[colSparse + 1] - numPreviosNonzero;
-            // Loop over the nonzero rows of the current column of the sparse matrix
-            for (; iNonzero < numNonzeroInSparseCol; iNonzero++)
+            // If the outer index of the dense matrix is contiguous, a single pass over the nonzero elements handles the whole range
+            // [outerBegin, outerEnd); otherwise there is one pass for each outer index.
+            const size_t numPasses = denseOuterIsContiguous ? 1 : outerEnd - outerBegin;
+            for (size_t pass = 0; pass < numPasses; pass++)
             {
-                size_t rowSparse = rowIndexBuffer[iNonzero]; // RowLocation
-                ElemType sparseVal = valueBuffer[iNonzero];
-
-                // Determine the index of the 'outer' dimension of the sparse matrix and the common inner index.
-                size_t outerIndexSparse;
-                size_t innerIndex;
-                // Below if-statements are evaluated at compile time.
-                if      ( denseTimesSparse && !transposeB) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
-                else if ( denseTimesSparse &&  transposeB) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
-                else if (!denseTimesSparse && !transposeA) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
-                else if (!denseTimesSparse &&  transposeA) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
-
-                // Loop over the outer index of the dense matrix
-                for (size_t outerIndexDense = 0; outerIndexDense < outerDimensionDense; outerIndexDense++)
+                size_t outerIndexDense = outerBegin + pass;
+                // Loop over columns of the sparse matrix
+                for (int colSparse = colBegin; colSparse < colEnd; colSparse++)
                 {
-                    // Determine the row index of the dense input matrix.
-                    // Below if-statements are evaluated at compile time.
-                    ElemType denseVal;
-                    if      ( denseTimesSparse && !transposeA) denseVal = dense(outerIndexDense,      innerIndex);
-                    else if ( denseTimesSparse &&  transposeA) denseVal = dense(     innerIndex, outerIndexDense);
-                    else if (!denseTimesSparse && !transposeB) denseVal = dense(     innerIndex, outerIndexDense);
-                    else if (!denseTimesSparse &&  transposeB) denseVal = dense(outerIndexDense,      innerIndex);
-                    
-
-                    // Update matrix c.
-                    if (denseTimesSparse)
-                        c(outerIndexDense, outerIndexSparse) += alpha * denseVal * sparseVal;
-                    else /*Sparse times dense */
-                        c(outerIndexSparse, outerIndexDense) += alpha * denseVal * sparseVal;
+                    // Loop over the nonzero rows of the current column of the sparse matrix
+                    for (size_t iNonzero = colStarts[colSparse] - colStarts[0]; iNonzero < colStarts[colSparse + 1] - colStarts[0]; iNonzero++)
+                    {
+                        size_t rowSparse = rowIndexBuffer[iNonzero]; // RowLocation
+                        ElemType alphaTimesSparseVal = alpha * valueBuffer[iNonzero];
+
+                        // Determine the index of the 'outer' dimension of the sparse matrix and the common inner index.
+                        size_t outerIndexSparse;
+                        size_t innerIndex;
+                        // Below if-statements are evaluated at compile time.
+                        if      ( denseTimesSparse && !transposeB) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
+                        else if ( denseTimesSparse &&  transposeB) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
+                        else if (!denseTimesSparse && !transposeA) { outerIndexSparse = rowSparse; innerIndex = colSparse; }
+                        else if (!denseTimesSparse &&  transposeA) { outerIndexSparse = colSparse; innerIndex = rowSparse; }
+
+                        // Element (outerIndexDense, innerIndex) of the dense factor, and (outerIndexSparse, outerIndexDense) of c, in the
+                        // order of the product. Both advance by a stride when the outer index of the dense matrix advances.
+                        const ElemType* denseVal;
+                        size_t denseStride;
+                        if      ( denseTimesSparse && !transposeA) { denseVal = denseData + outerIndexDense + innerIndex * denseLd; denseStride = 1; }
+                        else if ( denseTimesSparse &&  transposeA) { denseVal = denseData + innerIndex + outerIndexDense * denseLd; denseStride = denseLd; }
+                        else if (!denseTimesSparse && !transposeB) { denseVal = denseData + innerIndex + outerIndexDense * denseLd; denseStride = denseLd; }
+                        else if (!denseTimesSparse &&  transposeB) { denseVal = denseData + outerIndexDense + innerIndex * denseLd; denseStride = 1; }
+                        ElemType* cVal;
+                        size_t cStride;
+                        if (denseTimesSparse) { cVal = cData + outerIndexDense + outerIndexSparse * cLd; cStride = 1; }
+                        else /*Sparse times dense */ { cVal = cData + outerIndexSparse + outerIndexDense * cLd; cStride = cLd; }
+
+                        // Update matrix c.
+                        size_t count = denseOuterIsContiguous ? outerEnd - outerBegin : 1;
+                        for (size_t i = 0; i < count; i++)
+                            cVal[i * cStride] += alphaTimesSparseVal * denseVal[i * denseStride];
+                    }
                 }
             }
+        };
+
+        // Small products are not worth distributing.
+        const bool parallel = numNonzero * outerDimensionDense >= 16384 && omp_get_max_threads() > 1;
+        if (sparseColumnOwnsOutput)
+        {
+#pragma omp parallel for schedule(dynamic, 16) if (parallel)
+            for (int colSparse = 0; colSparse < numSparseCols; colSparse++)
+                accumulate(0, outerDimensionDense, colSparse, colSparse + 1);
+        }
+        else
+        {
+            const size_t blockSize = ParallelBlockSize(outerDimensionDense);
+            const int numBlocks = (int) ((outerDimensionDense + blockSize - 1) / blockSize);
+#pragma omp parallel for schedule(dynamic) if (parallel)
+            for (int block = 0; block < numBlocks; block++)
+                accumulate(block * blockSize, min((block + 1) * blockSize, outerDimensionDense), 0, numSparseCols);
         }
     }
 };
@@ -986,54 +1136,38 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
             NOT_IMPLEMENTED;
 
         // allocate enough memory
-        c.SetFormat(matrixFormatSparseBlockCol);
-        size_t blockSizePrev = c.GetBlockSize();
-
-        if (blockSizePrev == 0)
+        vector<size_t> resultCols(rhs.MajorIndexLocation(), rhs.MajorIndexLocation() + rhs.NzCount());
+        map<size_t, size_t> col2BlockId = c.AddBlockCols(m, n, resultCols);
+
+        // Each nonzero element of rhs adds a multiple of a column of lhs to the block of its row. Several nonzero elements can go to the
+        // same block, so the threads split the rows of lhs (and of the blocks) instead. The block of each nonzero element is looked up once.
+        const ElemType* rhsValues = rhs.Buffer() + rhs.SecondaryIndexLocation()[0];
+        const CPUSPARSE_INDEX_TYPE* rhsRows = rhs.MajorIndexLocation();
+        const CPUSPARSE_INDEX_TYPE* rhsColStarts = rhs.SecondaryIndexLocation();
+        const size_t rhsNumNonzero = rhsColStarts[rhs.GetNumCols()] - rhsColStarts[0];
+        vector<ElemType*> results(rhsNumNonzero);
+        for (size_t p = 0; p < rhsNumNonzero; p++)
+            results[p] = c.Buffer() + col2BlockId[rhsRows[p]] * m;
+
+        const ElemType* lhsData = lhs.Data();
+        const size_t lhsLd = lhs.GetNumRows();
+        const size_t blockSize = ParallelBlockSize(m);
+        const int numRowBlocks = (int) ((m + blockSize - 1) / blockSize);
+        const bool parallel = rhsNumNonzero * m >= 16384 && omp_get_max_threads() > 1; // small products are not worth distributing
+#pragma omp parallel for schedule(dynamic) if (parallel)
+        for (int rowBlock = 0; rowBlock < numRowBlocks; rowBlock++)
         {
-            c.RequireSizeAndAllocate(m, n, 0, true); // allocate for blockIds
-        }
-
-        map<size_t, size_t> col2BlockId;
-        for (size_t blockId = 0; blockId < blockSizePrev; blockId++)
-        {
-            col2BlockId[c.GetBlockIds()[blockId]] = blockId;
-        }
-
-        size_t blockSizeCurr = blockSizePrev;
-        for (size_t rhsNz = 0; rhsNz < rhs.NzCount(); rhsNz++)
-        {
-            size_t resultCol = rhs.MajorIndexLocation()[rhsNz];
-            if (col2BlockId.find(resultCol) == col2BlockId.end())
-            {
-                col2BlockId[resultCol] = blockSizeCurr;
-                c.GetBlockIds()[blockSizeCurr] = resultCol;
-                blockSizeCurr ++;
-            }
-        }
-
-        if (blockSizeCurr > blockSizePrev)
-        {
-            c.RequireSizeAndAllocate(m, n, m * blockSizeCurr, true, true);
-            c.SetBlockSize(blockSizeCurr);
-            memset(c.Data() + m * blockSizePrev, 0, sizeof(ElemType) * m * (blockSizeCurr - blockSizePrev));
-        }
-
-        for (size_t rhsCol = 0; rhsCol < rhs.GetNumCols(); rhsCol++)
-        {
-            size_t start = rhs.SecondaryIndexLocation()[rhsCol];
-            size_t end = rhs.SecondaryIndexLocation()[rhsCol + 1];
-
-            for (size_t p = start; p < end; p++)
+            const size_t rowBegin = rowBlock * blockSize;
+            const size_t rowEnd = min(rowBegin + blockSize, m);
+            for (size_t rhsCol = 0; rhsCol < rhs.GetNumCols(); rhsCol++)
             {
-                size_t rhsRow = rhs.MajorIndexLocation()[p];
-                ElemType val = rhs.Buffer()[p];
-
-                ElemType* results = c.Buffer() + col2BlockId[rhsRow] * m;
-                #pragma omp parallel for
-                for (int lhsRow = 0; lhsRow < (int)m; lhsRow++)
+                const ElemType* lhsCol = lhsData + rhsCol * lhsLd;
+                for (size_t p = rhsColStarts[rhsCol] - rhsColStarts[0]; p < rhsColStarts[rhsCol + 1] - rhsColStarts[0]; p++)
                 {
-                    results[lhsRow] += alpha * lhs((size_t)lhsRow, rhsCol) * val;
+                    ElemType alphaTimesVal = alpha * rhsValues[p];
+                    ElemType* result = results[p];
+                    for (size_t lhsRow = rowBegin; lhsRow < rowEnd; lhsRow++)
+                        result[lhsRow] += alphaTimesVal * lhsCol[lhsRow];
                 }
             }
         }
@@ -1102,6 +1236,33 @@ void CPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const CPUSpars
     }
 }
 
+// sparse += dense, only for the columns that have a block in the SparseBlockCol matrix c
+// This is what L2 regularization of a row-sparse gradient amounts to: the weight decay is applied to the touched columns only.
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const CPUMatrix<ElemType>& lhs, CPUSparseMatrix<ElemType>& c)
+{
+    if (lhs.IsEmpty() || c.IsEmpty())
+        LogicError("ScaleAndAdd:  one of the input matrix is empty.");
+
+    if (lhs.GetNumRows() != c.GetNumRows() || lhs.GetNumCols() != c.GetNumCols())
+        InvalidArgument("CPUSparseMatrix::ScaleAndAdd: The dimensions of a and b must match.");
+
+    if (c.GetFormat() != matrixFormatSparseBlockCol)
+        NOT_IMPLEMENTED;
+
+    const size_t numRows = c.GetNumRows();
+    const ElemType* lhsData = lhs.Data();
+    ElemType* values = c.Buffer();
+#pragma omp parallel for
+    for (long blockId = 0; blockId < (long) c.GetBlockSize(); blockId++)
+    {
+        const ElemType* lhsCol = lhsData + (c.GetBlockIds()[blockId] - c.GetBlockIdShift()) * numRows;
+        ElemType* block = values + blockId * numRows;
+        for (size_t i = 0; i < numRows; i++)
+            block[i] += alpha * lhsCol[i];
+    }
+}
+
 template <class ElemType>
 /*static*/ bool CPUSparseMatrix<ElemType>::AreEqual(const CPUSparseMatrix<ElemType>& a, const CPUSparseMatrix<ElemType>& b, const ElemType threshold)
 {
@@ -1295,6 +1456,65 @@ ElemType CPUSparseMatrix<ElemType>::Adagrad(CPUMatrix<ElemType>& c, const bool n
         return 1;
 }
 
+// FSAdaGrad update of the model (functionValues) and its smoothed gradients c = [ smoothed squared gradients, momentum accumulator ]
+// This is the update of CPUMatrix::FSAdagrad(), except that the smoothed gradients and the model are only updated in the
+// columns that have a block in this gradient, instead of decaying the accumulators of all columns in each minibatch.
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::FSAdagrad(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample,
+                                          ElemType momentum, ElemType adaWeight, ElemType adaMul, bool unitGainMomentum)
+{
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol)
+        NOT_IMPLEMENTED;
+
+    const auto unitGainFactor = ElemType(unitGainMomentum ? (1.0 - momentum) : 1.0);
+
+    size_t numColsNeeded = 2 * GetNumCols();
+
+    if (c.IsEmpty() || (c.GetNumCols() < numColsNeeded))
+    {
+        c.RequireSize(GetNumRows(), numColsNeeded);
+        c.SetValue(0.0);
+    }
+
+    assert((c.GetNumRows() == GetNumRows()) && (c.GetNumCols() == numColsNeeded));
+
+    const size_t numRows = GetNumRows();
+    const ElemType* grad = Buffer();
+    ElemType* smoothAda = c.Data();
+    ElemType* smoothMom = c.Data() + GetNumElements();
+    ElemType* val = functionValues.Data();
+#pragma omp parallel for
+    for (long blockId = 0; blockId < (long) GetBlockSize(); blockId++)
+    {
+        size_t colOffset = (GetBlockIds()[blockId] - GetBlockIdShift()) * numRows;
+        for (size_t i = 0; i < numRows; i++)
+        {
+            ElemType g = grad[blockId * numRows + i];
+            size_t p = colOffset + i;
+            ElemType adaSqr = adaWeight * smoothAda[p] + (1.0f - adaWeight) * g * g;
+            smoothAda[p] = adaSqr;
+            if (adaSqr != 0.0f)
+            {
+                ElemType ada = sqrt(adaSqr);
+                ElemType w = adaMul * ((ElemType) 1.0 / ada);
+
+                if (w > 10.0f)
+                    w = 10.0f;
+                g *= w;
+            }
+
+            if (momentum > 0.0f)
+            {
+                g = momentum * smoothMom[p] + unitGainFactor * g;
+                smoothMom[p] = g;
+            }
+
+            g *= learnRatePerSample;
+            val[p] -= g;
+        }
+    }
+}
+
 template <class ElemType>
 CPUSparseMatrix<ElemType>& CPUSparseMatrix<ElemType>::InplaceTruncateTop(const ElemType threshold)
 {
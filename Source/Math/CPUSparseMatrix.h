@@ -71,6 +71,7 @@ public:
 private:
     void ZeroInit();
     void CheckInit(const MatrixFormat format);
+    std::map<size_t, size_t> AddBlockCols(const size_t numRows, const size_t numCols, const std::vector<size_t>& cols);
 
 public:
     explicit CPUSparseMatrix(const MatrixFormat format);
@@ -93,6 +94,7 @@ public:
 
     CPUSparseMatrix<ElemType>& DoGatherColumnsOf(ElemType beta, const CPUMatrix<ElemType>& idx, const CPUSparseMatrix<ElemType>& a, ElemType alpha);
     CPUSparseMatrix<ElemType>& DoScatterColumnsOf(ElemType beta, const CPUMatrix<ElemType>& idx, const CPUSparseMatrix<ElemType>& a, ElemType alpha);
+    CPUSparseMatrix<ElemType>& DoScatterColumnsOf(ElemType beta, const CPUMatrix<ElemType>& idx, const CPUMatrix<ElemType>& a, ElemType alpha);
 
     size_t BufferSize() const
     {
@@ -132,6 +134,9 @@ public:
 
     static void ScaleAndAdd(const ElemType alpha, const CPUSparseMatrix<ElemType>& lhs, CPUMatrix<ElemType>& c);
 
+    // Sparse += Dense, restricted to the blocks of a SparseBlockCol matrix
+    static void ScaleAndAdd(const ElemType alpha, const CPUMatrix<ElemType>& lhs, CPUSparseMatrix<ElemType>& c);
+
     static bool AreEqual(const CPUSparseMatrix<ElemType>& a, const CPUSparseMatrix<ElemType>& b, const ElemType threshold = 1e-8);
 
     // sum(vec(a).*vec(b))
@@ -221,6 +226,7 @@ public:
 public:
     void NormalGrad(CPUMatrix<ElemType>& c, const ElemType momentum, bool unitGainMomentum = true);
     ElemType Adagrad(CPUMatrix<ElemType>& c, const bool needAveMultiplier);
+    void FSAdagrad(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul, bool unitGainMomentum);
 
 public:
     CPUSparseMatrix<ElemType>& InplaceTruncateTop(const ElemType threshold);
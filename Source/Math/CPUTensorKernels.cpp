@@ -0,0 +1,151 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorKernels.cpp -- runtime instruction-set detection and dispatch for the vectorized tensor kernels
+//
+
+#include "stdafx.h"
+#include "CPUTensorKernels.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// instruction-set detection
+// -----------------------------------------------------------------------
+
+static void CpuId(int leaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+    __cpuidex((int*) regs, leaf, 0);
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// extended control register 0, which tells which register states the OS saves on context switches
+static unsigned long long GetXCR0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long) edx << 32) | eax;
+#endif
+}
+
+static CPUVectorInstructionSet DetectCPUVectorInstructionSet()
+{
+    unsigned int regs[4]; // eax, ebx, ecx, edx
+    CpuId(0, regs);
+    if (regs[0] < 7)
+        return CPUVectorInstructionSet::None;
+
+    CpuId(1, regs);
+    const bool hasOSXSave = (regs[2] & (1u << 27)) != 0;
+    const bool hasAVX     = (regs[2] & (1u << 28)) != 0;
+    if (!hasOSXSave || !hasAVX)
+        return CPUVectorInstructionSet::None;
+    const unsigned long long xcr0 = GetXCR0();
+    const bool osSavesYmm = (xcr0 & 0x06) == 0x06; // XMM and YMM state
+    const bool osSavesZmm = (xcr0 & 0xe6) == 0xe6; // additionally opmask and ZMM state
+
+    CpuId(7, regs);
+    const bool hasAVX2    = (regs[1] & (1u << 5)) != 0;
+    const bool hasAVX512F = (regs[1] & (1u << 16)) != 0;
+
+    if (hasAVX512F && osSavesZmm && HaveAVX512TensorKernels())
+        return CPUVectorInstructionSet::AVX512;
+    if (hasAVX2 && osSavesYmm)
+        return CPUVectorInstructionSet::AVX2;
+    return CPUVectorInstructionSet::None;
+}
+
+CPUVectorInstructionSet GetSupportedCPUVectorInstructionSet()
+{
+    static const CPUVectorInstructionSet supported = DetectCPUVectorInstructionSet();
+    return supported;
+}
+
+std::string GetCPUModelName()
+{
+    unsigned int regs[4];
+    CpuId(0x80000000, regs);
+    if (regs[0] < 0x80000004)
+        return std::string();
+
+    char brand[3 * sizeof(regs) + 1] = {};
+    for (int i = 0; i < 3; i++)
+    {
+        CpuId(0x80000002 + i, regs);
+        memcpy(brand + i * sizeof(regs), regs, sizeof(regs));
+    }
+    std::string name(brand);
+    name.erase(0, name.find_first_not_of(' '));
+    name.erase(name.find_last_not_of(' ') + 1);
+    return name;
+}
+
+static CPUVectorInstructionSet& CurrentCPUVectorInstructionSet()
+{
+    static CPUVectorInstructionSet current = GetSupportedCPUVectorInstructionSet();
+    return current;
+}
+
+CPUVectorInstructionSet GetCPUVectorInstructionSet()
+{
+    return CurrentCPUVectorInstructionSet();
+}
+
+CPUVectorInstructionSet SetCPUVectorInstructionSet(CPUVectorInstructionSet instructionSet)
+{
+    CPUVectorInstructionSet previous = CurrentCPUVectorInstructionSet();
+    CPUVectorInstructionSet supported = GetSupportedCPUVectorInstructionSet();
+    CurrentCPUVectorInstructionSet() = instructionSet < supported ? instructionSet : supported;
+    return previous;
+}
+
+// -----------------------------------------------------------------------
+// dispatch
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+void CPUTensorKernels<ElemType>::Elementwise(ElementWiseOperator op, size_t arity, ElemType beta, const ElemType* const* inputs, ElemType* output, ElemType alpha, size_t n)
+{
+    bool done = false;
+    switch (GetCPUVectorInstructionSet())
+    {
+    case CPUVectorInstructionSet::AVX512: done = ElementwiseAVX512(op, arity, beta, inputs, output, alpha, n); break;
+    case CPUVectorInstructionSet::AVX2:   done = ElementwiseAVX2(op, arity, beta, inputs, output, alpha, n); break;
+    default: break;
+    }
+    if (!done)
+        LogicError("CPUTensorKernels::Elementwise: Op code %d with %d inputs is not vectorized for this CPU.", (int) op, (int) arity);
+}
+
+template <class ElemType>
+double CPUTensorKernels<ElemType>::Reduce(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const ElemType* const* inputs, size_t n)
+{
+    double result = 0;
+    bool done = false;
+    switch (GetCPUVectorInstructionSet())
+    {
+    case CPUVectorInstructionSet::AVX512: done = ReduceAVX512(op, reductionOp, arity, inputs, n, result); break;
+    case CPUVectorInstructionSet::AVX2:   done = ReduceAVX2(op, reductionOp, arity, inputs, n, result); break;
+    default: break;
+    }
+    if (!done)
+        LogicError("CPUTensorKernels::Reduce: Reduction op code %d over op code %d with %d inputs is not vectorized for this CPU.", (int) reductionOp, (int) op, (int) arity);
+    return result;
+}
+
+template class CPUTensorKernels<float>;
+template class CPUTensorKernels<double>;
+
+}}}
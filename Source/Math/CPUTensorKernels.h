@@ -0,0 +1,170 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorKernels.h -- explicitly vectorized (AVX2/AVX-512) inner loops for CPUMatrix::TensorOp()
+//
+// The generic TensorOp implementation in CPUMatrix.cpp evaluates one lambda per element and relies on the
+// compiler to auto-vectorize, which it mostly does not. For the innermost stride-1 dimension, CPUMatrix
+// instead calls into these kernels, which are compiled in separate translation units with the respective
+// instruction-set flags and selected at runtime based on what the CPU supports.
+//
+// Only operations whose vectorized form gives bit-identical results to the scalar code in TensorOps.h are
+// vectorized (arithmetic, comparisons, min/max, sqrt, floor). Transcendental functions keep going through
+// the generic code path. Reductions still aggregate in double, but in several lanes at once, so sums may
+// differ from the scalar code in the last bits due to the different summation order.
+//
+
+#pragma once
+
+#include "CommonMatrix.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// instruction sets for which vectorized tensor kernels exist
+// -----------------------------------------------------------------------
+
+enum class CPUVectorInstructionSet : int
+{
+    None = 0,   // generic lambda code path in CPUMatrix.cpp
+    AVX2 = 1,
+    AVX512 = 2, // AVX-512F
+};
+
+// the best instruction set supported by the CPU (and OS) we are running on; determined once
+MATH_API CPUVectorInstructionSet GetSupportedCPUVectorInstructionSet();
+
+// the instruction set currently used by CPUMatrix::TensorOp()
+MATH_API CPUVectorInstructionSet GetCPUVectorInstructionSet();
+
+// Select the instruction set to use, e.g. to compare against the generic code path in tests.
+// Requests beyond what the CPU supports are clipped to the supported set. Returns the previous setting.
+MATH_API CPUVectorInstructionSet SetCPUVectorInstructionSet(CPUVectorInstructionSet instructionSet);
+
+// the processor brand string, e.g. to tell apart measurements made on different hardware; empty if unknown
+MATH_API std::string GetCPUModelName();
+
+// -----------------------------------------------------------------------
+// operations that have a vectorized implementation
+// -----------------------------------------------------------------------
+
+#define ForAllVectorizedUnaryOps(Macro) \
+    Macro(Copy);                        \
+    Macro(Negate);                      \
+    Macro(Abs);                         \
+    Macro(Floor);                       \
+    Macro(Reciprocal);                  \
+    Macro(Sqr);                         \
+    Macro(Sqrt);                        \
+    Macro(LinearRectifier);
+
+#define ForAllVectorizedBinaryOps(Macro)                              \
+    Macro(CopyIf);                                                    \
+    Macro(CopyIfNot);                                                 \
+    Macro(Sum);                                                       \
+    Macro(Difference);                                                \
+    Macro(ElementwiseProduct);                                        \
+    Macro(Max);                                                       \
+    Macro(Min);                                                       \
+    Macro(Equal);                                                     \
+    Macro(NotEqual);                                                  \
+    Macro(Greater);                                                   \
+    Macro(Less);                                                      \
+    Macro(GreaterEqual);                                              \
+    Macro(LessEqual);                                                 \
+    Macro(MaskNegative);                                              \
+    Macro(ElementwiseProductWithSigmoidDerivativeFromOutput);         \
+    Macro(ElementwiseProductWithTanhDerivativeFromOutput);            \
+    Macro(ElementwiseProductWithLinearRectifierDerivativeFromOutput); \
+    Macro(ElementwiseProductWithSqrtDerivative);                      \
+    Macro(SqrOfDifference);
+
+#define ForAllVectorizedTernaryOps(Macro) \
+    Macro(Cond);                          \
+    Macro(CopyIfEqual);                   \
+    Macro(Clip);
+
+// 'arity' counts the inputs only (1 for unary, 2 for binary, 3 for ternary ops)
+static inline bool IsVectorizedElementwiseOp(ElementWiseOperator op, size_t arity)
+{
+#define CaseVectorizedOp(oper) \
+    case ElementWiseOperator::op##oper: return true
+    switch (arity)
+    {
+    case 1:
+        switch (op) { ForAllVectorizedUnaryOps(CaseVectorizedOp); default: return false; }
+    case 2:
+        switch (op) { ForAllVectorizedBinaryOps(CaseVectorizedOp); default: return false; }
+    case 3:
+        switch (op) { ForAllVectorizedTernaryOps(CaseVectorizedOp); default: return false; }
+    default:
+        return false;
+    }
+#undef CaseVectorizedOp
+}
+
+// reductions are vectorized for Sum, Max, and Min over any vectorized unary or binary op, and for LogSum over Copy
+static inline bool IsVectorizedReduction(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity)
+{
+    if (arity > 2 || !IsVectorizedElementwiseOp(op, arity))
+        return false;
+    switch (reductionOp)
+    {
+    case ElementWiseOperator::opSum:
+    case ElementWiseOperator::opMax:
+    case ElementWiseOperator::opMin:
+        return true;
+    case ElementWiseOperator::opLogSum:
+        return op == ElementWiseOperator::opCopy;
+    default:
+        return false;
+    }
+}
+
+// -----------------------------------------------------------------------
+// CPUTensorKernels -- entry points used by CPUMatrix::TensorOp()
+// All functions operate on 'n' consecutive elements. 'inputs' points to 'arity' input pointers.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class CPUTensorKernels
+{
+public:
+    // Can the current instruction set compute output = beta * output + alpha * op(inputs)?
+    static bool CanDoElementwise(ElementWiseOperator op, size_t arity)
+    {
+        return GetCPUVectorInstructionSet() != CPUVectorInstructionSet::None && IsVectorizedElementwiseOp(op, arity);
+    }
+
+    // Can the current instruction set aggregate reductionOp over op(inputs)?
+    static bool CanDoReduction(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity)
+    {
+        return GetCPUVectorInstructionSet() != CPUVectorInstructionSet::None && IsVectorizedReduction(op, reductionOp, arity);
+    }
+
+    // output[i] = beta * output[i] + alpha * op(inputs[0][i], ...); requires CanDoElementwise()
+    static void Elementwise(ElementWiseOperator op, size_t arity, ElemType beta, const ElemType* const* inputs, ElemType* output, ElemType alpha, size_t n);
+
+    // aggregate of op(inputs[0][i], ...) over i = 0..n-1, n > 0; requires CanDoReduction()
+    static double Reduce(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const ElemType* const* inputs, size_t n);
+};
+
+// per-instruction-set implementations (CPUTensorKernelsAVX2.cpp, CPUTensorKernelsAVX512.cpp)
+// These return false if the op is not vectorized; CPUTensorKernels turns that into an error.
+bool ElementwiseAVX2(ElementWiseOperator op, size_t arity, float beta, const float* const* inputs, float* output, float alpha, size_t n);
+bool ElementwiseAVX2(ElementWiseOperator op, size_t arity, double beta, const double* const* inputs, double* output, double alpha, size_t n);
+bool ReduceAVX2(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const float* const* inputs, size_t n, double& result);
+bool ReduceAVX2(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const double* const* inputs, size_t n, double& result);
+bool ElementwiseAVX512(ElementWiseOperator op, size_t arity, float beta, const float* const* inputs, float* output, float alpha, size_t n);
+bool ElementwiseAVX512(ElementWiseOperator op, size_t arity, double beta, const double* const* inputs, double* output, double alpha, size_t n);
+bool ReduceAVX512(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const float* const* inputs, size_t n, double& result);
+bool ReduceAVX512(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const double* const* inputs, size_t n, double& result);
+bool HaveAVX512TensorKernels(); // false if the compiler could not build them
+
+// Inner loop of the blocked convolution (see BlockedLayout.h) for 8 adjacent output pixels p and blocks of 8 channels:
+// acc[p * 8 + co] += sum over kx < kernelWidth, ci of x[p * pixelStride + kx * 8 + ci] * w[(kx * 8 + ci) * 8 + co].
+// Requires GetCPUVectorInstructionSet() != None.
+void BlockedConvolutionMultiplyAddAVX2(const float* x, size_t pixelStride, const float* w, size_t kernelWidth, float* acc);
+
+}}}
@@ -0,0 +1,152 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorKernelsAVX2.cpp -- AVX2 instantiation of the vectorized tensor kernels (see CPUTensorKernels.h)
+//
+// This file must be compiled with AVX2 code generation enabled (-mavx2 on GCC), but without FMA contraction,
+// so that results stay identical to the generic code path. It is only called on CPUs that support AVX2.
+//
+
+#include "CPUTensorKernelsImpl.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+namespace {
+
+struct AVX2Float
+{
+    typedef float ElemType;
+    typedef __m256 Vec;
+    typedef __m256 Mask;
+    static const size_t width = 8;
+
+    static inline Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+    static inline void Store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    static inline Vec Set1(float f) { return _mm256_set1_ps(f); }
+    static inline Vec Zero() { return _mm256_setzero_ps(); }
+    static inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static inline Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+    static inline Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    static inline Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    static inline Vec Sqrt(Vec a) { return _mm256_sqrt_ps(a); }
+    static inline Vec Floor(Vec a) { return _mm256_floor_ps(a); }
+    static inline Vec Negate(Vec a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    static inline Vec Abs(Vec a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    template <int predicate>
+    static inline Mask Cmp(Vec a, Vec b) { return _mm256_cmp_ps(a, b, predicate); }
+    static inline Vec Select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, m); }
+    static inline Vec MaskOrZero(Mask m, Vec v) { return _mm256_and_ps(m, v); }
+
+    struct SumAccumulator
+    {
+        __m256d lo, hi;
+        SumAccumulator() : lo(_mm256_setzero_pd()), hi(_mm256_setzero_pd()) {}
+        inline void Add(Vec v)
+        {
+            lo = _mm256_add_pd(lo, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+            hi = _mm256_add_pd(hi, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+        }
+        inline double Total() const
+        {
+            double lanes[4];
+            _mm256_storeu_pd(lanes, _mm256_add_pd(lo, hi));
+            return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+    };
+};
+
+struct AVX2Double
+{
+    typedef double ElemType;
+    typedef __m256d Vec;
+    typedef __m256d Mask;
+    static const size_t width = 4;
+
+    static inline Vec Load(const double* p) { return _mm256_loadu_pd(p); }
+    static inline void Store(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+    static inline Vec Set1(double f) { return _mm256_set1_pd(f); }
+    static inline Vec Zero() { return _mm256_setzero_pd(); }
+    static inline Vec Add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    static inline Vec Div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+    static inline Vec Max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+    static inline Vec Min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+    static inline Vec Sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+    static inline Vec Floor(Vec a) { return _mm256_floor_pd(a); }
+    static inline Vec Negate(Vec a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    static inline Vec Abs(Vec a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    template <int predicate>
+    static inline Mask Cmp(Vec a, Vec b) { return _mm256_cmp_pd(a, b, predicate); }
+    static inline Vec Select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm256_blendv_pd(ifFalse, ifTrue, m); }
+    static inline Vec MaskOrZero(Mask m, Vec v) { return _mm256_and_pd(m, v); }
+
+    struct SumAccumulator
+    {
+        __m256d acc;
+        SumAccumulator() : acc(_mm256_setzero_pd()) {}
+        inline void Add(Vec v) { acc = _mm256_add_pd(acc, v); }
+        inline double Total() const
+        {
+            double lanes[4];
+            _mm256_storeu_pd(lanes, acc);
+            return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+    };
+};
+
+} // anonymous namespace
+
+bool ElementwiseAVX2(ElementWiseOperator op, size_t arity, float beta, const float* const* inputs, float* output, float alpha, size_t n)
+{
+    return VectorizedElementwise<AVX2Float>(op, arity, beta, inputs, output, alpha, n);
+}
+
+bool ElementwiseAVX2(ElementWiseOperator op, size_t arity, double beta, const double* const* inputs, double* output, double alpha, size_t n)
+{
+    return VectorizedElementwise<AVX2Double>(op, arity, beta, inputs, output, alpha, n);
+}
+
+bool ReduceAVX2(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const float* const* inputs, size_t n, double& result)
+{
+    return VectorizedReduce<AVX2Float>(op, reductionOp, arity, inputs, n, result);
+}
+
+bool ReduceAVX2(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const double* const* inputs, size_t n, double& result)
+{
+    return VectorizedReduce<AVX2Double>(op, reductionOp, arity, inputs, n, result);
+}
+
+// The 8 output channels of each pixel are one register; every weight row is loaded once for all 8 pixels.
+void BlockedConvolutionMultiplyAddAVX2(const float* x, size_t pixelStride, const float* w, size_t kernelWidth, float* acc)
+{
+    __m256 a0 = _mm256_loadu_ps(acc),      a1 = _mm256_loadu_ps(acc + 8);
+    __m256 a2 = _mm256_loadu_ps(acc + 16), a3 = _mm256_loadu_ps(acc + 24);
+    __m256 a4 = _mm256_loadu_ps(acc + 32), a5 = _mm256_loadu_ps(acc + 40);
+    __m256 a6 = _mm256_loadu_ps(acc + 48), a7 = _mm256_loadu_ps(acc + 56);
+    const float* x4 = x + 4 * pixelStride;
+    for (size_t kx = 0; kx < kernelWidth; kx++, x += 8, x4 += 8, w += 64)
+    {
+        for (size_t ci = 0; ci < 8; ci++)
+        {
+            const __m256 wv = _mm256_loadu_ps(w + ci * 8);
+            a0 = _mm256_add_ps(a0, _mm256_mul_ps(_mm256_broadcast_ss(x + ci), wv));
+            a1 = _mm256_add_ps(a1, _mm256_mul_ps(_mm256_broadcast_ss(x + pixelStride + ci), wv));
+            a2 = _mm256_add_ps(a2, _mm256_mul_ps(_mm256_broadcast_ss(x + 2 * pixelStride + ci), wv));
+            a3 = _mm256_add_ps(a3, _mm256_mul_ps(_mm256_broadcast_ss(x + 3 * pixelStride + ci), wv));
+            a4 = _mm256_add_ps(a4, _mm256_mul_ps(_mm256_broadcast_ss(x4 + ci), wv));
+            a5 = _mm256_add_ps(a5, _mm256_mul_ps(_mm256_broadcast_ss(x4 + pixelStride + ci), wv));
+            a6 = _mm256_add_ps(a6, _mm256_mul_ps(_mm256_broadcast_ss(x4 + 2 * pixelStride + ci), wv));
+            a7 = _mm256_add_ps(a7, _mm256_mul_ps(_mm256_broadcast_ss(x4 + 3 * pixelStride + ci), wv));
+        }
+    }
+    _mm256_storeu_ps(acc, a0);      _mm256_storeu_ps(acc + 8, a1);
+    _mm256_storeu_ps(acc + 16, a2); _mm256_storeu_ps(acc + 24, a3);
+    _mm256_storeu_ps(acc + 32, a4); _mm256_storeu_ps(acc + 40, a5);
+    _mm256_storeu_ps(acc + 48, a6); _mm256_storeu_ps(acc + 56, a7);
+}
+
+}}}
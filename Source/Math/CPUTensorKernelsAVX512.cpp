@@ -0,0 +1,144 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorKernelsAVX512.cpp -- AVX-512 instantiation of the vectorized tensor kernels (see CPUTensorKernels.h)
+//
+// This file must be compiled with AVX-512F code generation enabled (-mavx512f on GCC), but without FMA contraction,
+// so that results stay identical to the generic code path. It is only called on CPUs that support AVX-512F.
+// Only AVX-512F instructions are used (no DQ/BW/VL), so bitwise float ops go through the integer unit.
+// Compilers without AVX-512 support (GCC < 4.9, VS 2015) build stubs, and AVX-512 is then never selected.
+//
+
+#include "CPUTensorKernelsImpl.h"
+
+#if defined(__AVX512F__) || (defined(_MSC_VER) && _MSC_VER >= 1911)
+#define HAVE_AVX512_TENSOR_KERNELS
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#ifdef HAVE_AVX512_TENSOR_KERNELS
+
+namespace {
+
+struct AVX512Float
+{
+    typedef float ElemType;
+    typedef __m512 Vec;
+    typedef __mmask16 Mask;
+    static const size_t width = 16;
+
+    static inline Vec Load(const float* p) { return _mm512_loadu_ps(p); }
+    static inline void Store(float* p, Vec v) { _mm512_storeu_ps(p, v); }
+    static inline Vec Set1(float f) { return _mm512_set1_ps(f); }
+    static inline Vec Zero() { return _mm512_setzero_ps(); }
+    static inline Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+    static inline Vec Div(Vec a, Vec b) { return _mm512_div_ps(a, b); }
+    static inline Vec Max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+    static inline Vec Min(Vec a, Vec b) { return _mm512_min_ps(a, b); }
+    static inline Vec Sqrt(Vec a) { return _mm512_sqrt_ps(a); }
+    static inline Vec Floor(Vec a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    static inline Vec Negate(Vec a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32(0x80000000))); }
+    static inline Vec Abs(Vec a) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_set1_epi32(0x7fffffff))); }
+    template <int predicate>
+    static inline Mask Cmp(Vec a, Vec b) { return _mm512_cmp_ps_mask(a, b, predicate); }
+    static inline Vec Select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm512_mask_blend_ps(m, ifFalse, ifTrue); }
+    static inline Vec MaskOrZero(Mask m, Vec v) { return _mm512_maskz_mov_ps(m, v); }
+
+    struct SumAccumulator
+    {
+        __m512d lo, hi;
+        SumAccumulator() : lo(_mm512_setzero_pd()), hi(_mm512_setzero_pd()) {}
+        inline void Add(Vec v)
+        {
+            lo = _mm512_add_pd(lo, _mm512_cvtps_pd(_mm512_castps512_ps256(v)));
+            hi = _mm512_add_pd(hi, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1))));
+        }
+        inline double Total() const
+        {
+            double lanes[8];
+            _mm512_storeu_pd(lanes, _mm512_add_pd(lo, hi));
+            return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+        }
+    };
+};
+
+struct AVX512Double
+{
+    typedef double ElemType;
+    typedef __m512d Vec;
+    typedef __mmask8 Mask;
+    static const size_t width = 8;
+
+    static inline Vec Load(const double* p) { return _mm512_loadu_pd(p); }
+    static inline void Store(double* p, Vec v) { _mm512_storeu_pd(p, v); }
+    static inline Vec Set1(double f) { return _mm512_set1_pd(f); }
+    static inline Vec Zero() { return _mm512_setzero_pd(); }
+    static inline Vec Add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+    static inline Vec Sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+    static inline Vec Mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+    static inline Vec Div(Vec a, Vec b) { return _mm512_div_pd(a, b); }
+    static inline Vec Max(Vec a, Vec b) { return _mm512_max_pd(a, b); }
+    static inline Vec Min(Vec a, Vec b) { return _mm512_min_pd(a, b); }
+    static inline Vec Sqrt(Vec a) { return _mm512_sqrt_pd(a); }
+    static inline Vec Floor(Vec a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    static inline Vec Negate(Vec a) { return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(0x8000000000000000ull))); }
+    static inline Vec Abs(Vec a) { return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(0x7fffffffffffffffull))); }
+    template <int predicate>
+    static inline Mask Cmp(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, predicate); }
+    static inline Vec Select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm512_mask_blend_pd(m, ifFalse, ifTrue); }
+    static inline Vec MaskOrZero(Mask m, Vec v) { return _mm512_maskz_mov_pd(m, v); }
+
+    struct SumAccumulator
+    {
+        __m512d acc;
+        SumAccumulator() : acc(_mm512_setzero_pd()) {}
+        inline void Add(Vec v) { acc = _mm512_add_pd(acc, v); }
+        inline double Total() const
+        {
+            double lanes[8];
+            _mm512_storeu_pd(lanes, acc);
+            return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+        }
+    };
+};
+
+} // anonymous namespace
+
+bool ElementwiseAVX512(ElementWiseOperator op, size_t arity, float beta, const float* const* inputs, float* output, float alpha, size_t n)
+{
+    return VectorizedElementwise<AVX512Float>(op, arity, beta, inputs, output, alpha, n);
+}
+
+bool ElementwiseAVX512(ElementWiseOperator op, size_t arity, double beta, const double* const* inputs, double* output, double alpha, size_t n)
+{
+    return VectorizedElementwise<AVX512Double>(op, arity, beta, inputs, output, alpha, n);
+}
+
+bool ReduceAVX512(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const float* const* inputs, size_t n, double& result)
+{
+    return VectorizedReduce<AVX512Float>(op, reductionOp, arity, inputs, n, result);
+}
+
+bool ReduceAVX512(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const double* const* inputs, size_t n, double& result)
+{
+    return VectorizedReduce<AVX512Double>(op, reductionOp, arity, inputs, n, result);
+}
+
+bool HaveAVX512TensorKernels() { return true; }
+
+#else // compiler cannot generate AVX-512 code
+
+bool ElementwiseAVX512(ElementWiseOperator, size_t, float, const float* const*, float*, float, size_t) { return false; }
+bool ElementwiseAVX512(ElementWiseOperator, size_t, double, const double* const*, double*, double, size_t) { return false; }
+bool ReduceAVX512(ElementWiseOperator, ElementWiseOperator, size_t, const float* const*, size_t, double&) { return false; }
+bool ReduceAVX512(ElementWiseOperator, ElementWiseOperator, size_t, const double* const*, size_t, double&) { return false; }
+
+bool HaveAVX512TensorKernels() { return false; }
+
+#endif
+
+}}}
@@ -0,0 +1,314 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUTensorKernelsImpl.h -- instruction-set independent part of the vectorized tensor kernels
+//
+// This is included only by the per-instruction-set translation units (CPUTensorKernelsAVX2.cpp etc.),
+// which define a traits class V for each element type that wraps the intrinsics:
+//
+//  - typedef ElemType, Vec (a register of 'width' elements), Mask (result of a comparison)
+//  - Load(), Store(), Set1(), Zero(), Add(), Sub(), Mul(), Div(), Max(), Min(), Sqrt(), Floor(), Negate(), Abs()
+//  - Cmp<predicate>(a, b) -> Mask, Select(mask, ifTrue, ifFalse), MaskOrZero(mask, v)
+//  - SumAccumulator: accumulates Vecs in double precision
+//
+// Everything is in an anonymous namespace since these translation units are compiled with instruction-set
+// specific code-generation flags, and nothing compiled that way may be shared with the rest of the library.
+// For the same reason, errors are not thrown from here but reported back to CPUTensorKernels.cpp.
+//
+
+#pragma once
+
+#include "CPUTensorKernels.h"
+#include "TensorOps.h"
+#include <immintrin.h>
+#include <math.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+namespace {
+
+// -----------------------------------------------------------------------
+// vectorized versions of the ElementWiseOperators (TensorOps.h)
+// Each op has a vector version and a scalar one (the original from TensorOps.h) for the remainder.
+// The vector versions are chosen such that they give bit-identical results to the scalar ones.
+// -----------------------------------------------------------------------
+
+#pragma push_macro("DefVectorizedUnaryOp")
+#define DefVectorizedUnaryOp(op, expr)                                                  \
+    struct VectorizedOp##op                                                             \
+    {                                                                                   \
+        template <class V>                                                              \
+        static inline typename V::Vec Vector(typename V::Vec a) { return expr; }        \
+        template <class ElemType>                                                       \
+        static inline ElemType Scalar(ElemType a) { return Op##op(a); }                 \
+    }
+
+DefVectorizedUnaryOp(Copy, a);
+DefVectorizedUnaryOp(Negate, V::Negate(a));
+DefVectorizedUnaryOp(Abs, V::Abs(a));
+DefVectorizedUnaryOp(Floor, V::Floor(a));
+DefVectorizedUnaryOp(Reciprocal, V::Select(V::template Cmp<_CMP_EQ_OQ>(a, V::Zero()), V::Zero(), V::Div(V::Set1(1), a)));
+DefVectorizedUnaryOp(Sqr, V::Mul(a, a));
+DefVectorizedUnaryOp(Sqrt, V::Sqrt(V::Max(a, V::Zero())));    // max(a,0) = (a > 0 ? a : 0), also for NaN
+DefVectorizedUnaryOp(LinearRectifier, V::Max(a, V::Zero()));
+#pragma pop_macro("DefVectorizedUnaryOp")
+
+#pragma push_macro("DefVectorizedBinaryOp")
+#define DefVectorizedBinaryOp(op, expr)                                                                     \
+    struct VectorizedOp##op                                                                                 \
+    {                                                                                                       \
+        template <class V>                                                                                  \
+        static inline typename V::Vec Vector(typename V::Vec a, typename V::Vec b) { return expr; }         \
+        template <class ElemType>                                                                           \
+        static inline ElemType Scalar(ElemType a, ElemType b) { return Op##op(a, b); }                      \
+    }
+
+DefVectorizedBinaryOp(CopyIf, V::MaskOrZero(V::template Cmp<_CMP_NEQ_UQ>(a, V::Zero()), b));
+DefVectorizedBinaryOp(CopyIfNot, V::MaskOrZero(V::template Cmp<_CMP_EQ_OQ>(a, V::Zero()), b));
+DefVectorizedBinaryOp(Sum, V::Add(a, b));
+DefVectorizedBinaryOp(Difference, V::Sub(a, b));
+DefVectorizedBinaryOp(ElementwiseProduct, V::Mul(a, b));
+DefVectorizedBinaryOp(Max, V::Max(a, b));                     // max(a,b) = (a > b ? a : b)
+DefVectorizedBinaryOp(Min, V::Min(a, b));                     // min(a,b) = (a < b ? a : b)
+DefVectorizedBinaryOp(Equal, V::MaskOrZero(V::template Cmp<_CMP_EQ_OQ>(a, b), V::Set1(1)));
+DefVectorizedBinaryOp(NotEqual, V::MaskOrZero(V::template Cmp<_CMP_NEQ_UQ>(a, b), V::Set1(1)));
+DefVectorizedBinaryOp(Greater, V::MaskOrZero(V::template Cmp<_CMP_GT_OQ>(a, b), V::Set1(1)));
+DefVectorizedBinaryOp(Less, V::MaskOrZero(V::template Cmp<_CMP_LT_OQ>(a, b), V::Set1(1)));
+DefVectorizedBinaryOp(GreaterEqual, V::MaskOrZero(V::template Cmp<_CMP_GE_OQ>(a, b), V::Set1(1)));
+DefVectorizedBinaryOp(LessEqual, V::MaskOrZero(V::template Cmp<_CMP_LE_OQ>(a, b), V::Set1(1)));
+DefVectorizedBinaryOp(MaskNegative, V::MaskOrZero(V::template Cmp<_CMP_GE_OQ>(b, V::Zero()), a));
+DefVectorizedBinaryOp(ElementwiseProductWithSigmoidDerivativeFromOutput, V::Mul(a, V::Mul(b, V::Sub(V::Set1(1), b))));
+DefVectorizedBinaryOp(ElementwiseProductWithTanhDerivativeFromOutput, V::Mul(a, V::Sub(V::Set1(1), V::Mul(b, b))));
+DefVectorizedBinaryOp(ElementwiseProductWithLinearRectifierDerivativeFromOutput, V::MaskOrZero(V::template Cmp<_CMP_GT_OQ>(b, V::Zero()), a));
+DefVectorizedBinaryOp(ElementwiseProductWithSqrtDerivative, V::Div(a, V::Mul(V::Set1(2), b)));
+DefVectorizedBinaryOp(SqrOfDifference, V::Mul(V::Sub(a, b), V::Sub(a, b)));
+#pragma pop_macro("DefVectorizedBinaryOp")
+
+#pragma push_macro("DefVectorizedTernaryOp")
+#define DefVectorizedTernaryOp(op, expr)                                                                                    \
+    struct VectorizedOp##op                                                                                                 \
+    {                                                                                                                       \
+        template <class V>                                                                                                  \
+        static inline typename V::Vec Vector(typename V::Vec a, typename V::Vec b, typename V::Vec c) { return expr; }      \
+        template <class ElemType>                                                                                           \
+        static inline ElemType Scalar(ElemType a, ElemType b, ElemType c) { return Op##op(a, b, c); }                       \
+    }
+
+DefVectorizedTernaryOp(Cond, V::Select(V::template Cmp<_CMP_NEQ_UQ>(a, V::Zero()), b, c));
+DefVectorizedTernaryOp(CopyIfEqual, V::MaskOrZero(V::template Cmp<_CMP_EQ_OQ>(a, b), c));
+DefVectorizedTernaryOp(Clip, V::Select(V::template Cmp<_CMP_LT_OQ>(c, a), a, V::Min(b, c))); // min(b,c) = (c > b ? b : c)
+#pragma pop_macro("DefVectorizedTernaryOp")
+
+// -----------------------------------------------------------------------
+// apply an op of given arity to element/vector i of the inputs
+// -----------------------------------------------------------------------
+
+template <class V, class OP, size_t arity>
+struct VectorizedOpApplier;
+
+template <class V, class OP>
+struct VectorizedOpApplier<V, OP, 1>
+{
+    typedef typename V::ElemType ElemType;
+    static inline typename V::Vec Vector(const ElemType* const* in, size_t i) { return OP::template Vector<V>(V::Load(in[0] + i)); }
+    static inline ElemType Scalar(const ElemType* const* in, size_t i) { return OP::Scalar(in[0][i]); }
+};
+
+template <class V, class OP>
+struct VectorizedOpApplier<V, OP, 2>
+{
+    typedef typename V::ElemType ElemType;
+    static inline typename V::Vec Vector(const ElemType* const* in, size_t i) { return OP::template Vector<V>(V::Load(in[0] + i), V::Load(in[1] + i)); }
+    static inline ElemType Scalar(const ElemType* const* in, size_t i) { return OP::Scalar(in[0][i], in[1][i]); }
+};
+
+template <class V, class OP>
+struct VectorizedOpApplier<V, OP, 3>
+{
+    typedef typename V::ElemType ElemType;
+    static inline typename V::Vec Vector(const ElemType* const* in, size_t i) { return OP::template Vector<V>(V::Load(in[0] + i), V::Load(in[1] + i), V::Load(in[2] + i)); }
+    static inline ElemType Scalar(const ElemType* const* in, size_t i) { return OP::Scalar(in[0][i], in[1][i], in[2][i]); }
+};
+
+// -----------------------------------------------------------------------
+// elementwise: output = beta * output + alpha * op(inputs)
+// -----------------------------------------------------------------------
+
+// 'hasBeta' and 'hasAlpha' are hoisted out of the loop; without beta, the output is not read (it may be uninitialized)
+template <class V, class OP, size_t arity, bool hasBeta, bool hasAlpha>
+static void ElementwiseLoop(typename V::ElemType beta, const typename V::ElemType* const* inputs, typename V::ElemType* output, typename V::ElemType alpha, size_t n)
+{
+    typedef typename V::ElemType ElemType;
+    typedef VectorizedOpApplier<V, OP, arity> Applier;
+    const ElemType* in[arity];
+    for (size_t j = 0; j < arity; j++)
+        in[j] = inputs[j];
+
+    const typename V::Vec vbeta = V::Set1(beta);
+    const typename V::Vec valpha = V::Set1(alpha);
+    size_t i = 0;
+    for (; i + V::width <= n; i += V::width)
+    {
+        typename V::Vec val = Applier::Vector(in, i);
+        if (hasAlpha)
+            val = V::Mul(val, valpha);
+        if (hasBeta)
+            val = V::Add(val, V::Mul(vbeta, V::Load(output + i)));
+        V::Store(output + i, val);
+    }
+    for (; i < n; i++) // remainder: same as generic code path
+    {
+        ElemType val = Applier::Scalar(in, i);
+        if (hasAlpha)
+            val *= alpha;
+        if (hasBeta)
+            val += beta * output[i];
+        output[i] = val;
+    }
+}
+
+template <class V, class OP, size_t arity>
+static bool ElementwiseWithAlphaBeta(typename V::ElemType beta, const typename V::ElemType* const* inputs, typename V::ElemType* output, typename V::ElemType alpha, size_t n)
+{
+    if (beta != 0)
+        ElementwiseLoop<V, OP, arity, true, true>(beta, inputs, output, alpha, n);
+    else if (alpha != 1)
+        ElementwiseLoop<V, OP, arity, false, true>(beta, inputs, output, alpha, n);
+    else
+        ElementwiseLoop<V, OP, arity, false, false>(beta, inputs, output, alpha, n);
+    return true;
+}
+
+// returns false if the op is not vectorized
+template <class V>
+static bool VectorizedElementwise(ElementWiseOperator op, size_t arity, typename V::ElemType beta, const typename V::ElemType* const* inputs, typename V::ElemType* output, typename V::ElemType alpha, size_t n)
+{
+#define CaseVectorizedUnaryOp(oper)   case ElementWiseOperator::op##oper: return ElementwiseWithAlphaBeta<V, VectorizedOp##oper, 1>(beta, inputs, output, alpha, n)
+#define CaseVectorizedBinaryOp(oper)  case ElementWiseOperator::op##oper: return ElementwiseWithAlphaBeta<V, VectorizedOp##oper, 2>(beta, inputs, output, alpha, n)
+#define CaseVectorizedTernaryOp(oper) case ElementWiseOperator::op##oper: return ElementwiseWithAlphaBeta<V, VectorizedOp##oper, 3>(beta, inputs, output, alpha, n)
+    switch (arity)
+    {
+    case 1:
+        switch (op) { ForAllVectorizedUnaryOps(CaseVectorizedUnaryOp); default: break; }
+        break;
+    case 2:
+        switch (op) { ForAllVectorizedBinaryOps(CaseVectorizedBinaryOp); default: break; }
+        break;
+    case 3:
+        switch (op) { ForAllVectorizedTernaryOps(CaseVectorizedTernaryOp); default: break; }
+        break;
+    }
+    return false;
+#undef CaseVectorizedUnaryOp
+#undef CaseVectorizedBinaryOp
+#undef CaseVectorizedTernaryOp
+}
+
+// -----------------------------------------------------------------------
+// reduction: aggregate reductionOp over op(inputs)
+// Like the generic code, aggregation is done in double.
+// -----------------------------------------------------------------------
+
+template <class V, class OP, size_t arity>
+static double SumLoop(const typename V::ElemType* const* in, size_t n)
+{
+    typedef VectorizedOpApplier<V, OP, arity> Applier;
+    typename V::SumAccumulator acc;
+    size_t i = 0;
+    for (; i + V::width <= n; i += V::width)
+        acc.Add(Applier::Vector(in, i));
+    double aggregate = acc.Total();
+    for (; i < n; i++)
+        aggregate += (double) Applier::Scalar(in, i);
+    return aggregate;
+}
+
+// Max and Min; 'isMax' selects which one
+template <class V, class OP, size_t arity, bool isMax>
+static double MaxMinLoop(const typename V::ElemType* const* in, size_t n)
+{
+    typedef typename V::ElemType ElemType;
+    typedef VectorizedOpApplier<V, OP, arity> Applier;
+    size_t i = 0;
+    double aggregate;
+    if (n >= V::width)
+    {
+        typename V::Vec acc = Applier::Vector(in, 0);
+        for (i = V::width; i + V::width <= n; i += V::width)
+            acc = isMax ? V::Max(acc, Applier::Vector(in, i)) : V::Min(acc, Applier::Vector(in, i));
+        ElemType lanes[V::width];
+        V::Store(lanes, acc);
+        aggregate = lanes[0];
+        for (size_t j = 1; j < V::width; j++)
+            aggregate = isMax ? OpMax(aggregate, (double) lanes[j]) : OpMin(aggregate, (double) lanes[j]);
+    }
+    else
+        aggregate = Applier::Scalar(in, i++);
+    for (; i < n; i++)
+        aggregate = isMax ? OpMax(aggregate, (double) Applier::Scalar(in, i)) : OpMin(aggregate, (double) Applier::Scalar(in, i));
+    return aggregate;
+}
+
+// LogSum: log(sum_i exp(x_i)), computed relative to the maximum, which is found with a vectorized pass.
+// Like LogAdd(), contributions below MINLOGEXP relative to the maximum are ignored.
+template <class V>
+static double LogSumLoop(const typename V::ElemType* const* in, size_t n)
+{
+    typedef typename V::ElemType ElemType;
+    double maxVal = MaxMinLoop<V, VectorizedOpCopy, 1, /*isMax=*/true>(in, n);
+    if (n == 1)
+        return maxVal;
+    const ElemType* pa = in[0];
+    double sum = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        double diff = pa[i] - maxVal;
+        if (diff >= MINLOGEXP)
+            sum += exp(diff);
+    }
+    if (sum <= 1 && maxVal < LSMALL) // nothing but the maximum itself contributed
+        return LZERO;
+    return maxVal + log(sum);
+}
+
+template <class V, class OP, size_t arity>
+static bool ReduceWithOp(ElementWiseOperator reductionOp, const typename V::ElemType* const* inputs, size_t n, double& result)
+{
+    switch (reductionOp)
+    {
+    case ElementWiseOperator::opSum: result = SumLoop<V, OP, arity>(inputs, n); return true;
+    case ElementWiseOperator::opMax: result = MaxMinLoop<V, OP, arity, /*isMax=*/true>(inputs, n); return true;
+    case ElementWiseOperator::opMin: result = MaxMinLoop<V, OP, arity, /*isMax=*/false>(inputs, n); return true;
+    default: return false;
+    }
+}
+
+// returns false if the op/reductionOp combination is not vectorized
+template <class V>
+static bool VectorizedReduce(ElementWiseOperator op, ElementWiseOperator reductionOp, size_t arity, const typename V::ElemType* const* inputs, size_t n, double& result)
+{
+    if (reductionOp == ElementWiseOperator::opLogSum && op == ElementWiseOperator::opCopy && arity == 1)
+    {
+        result = LogSumLoop<V>(inputs, n);
+        return true;
+    }
+#define CaseVectorizedUnaryOp(oper)  case ElementWiseOperator::op##oper: return ReduceWithOp<V, VectorizedOp##oper, 1>(reductionOp, inputs, n, result)
+#define CaseVectorizedBinaryOp(oper) case ElementWiseOperator::op##oper: return ReduceWithOp<V, VectorizedOp##oper, 2>(reductionOp, inputs, n, result)
+    switch (arity)
+    {
+    case 1:
+        switch (op) { ForAllVectorizedUnaryOps(CaseVectorizedUnaryOp); default: break; }
+        break;
+    case 2:
+        switch (op) { ForAllVectorizedBinaryOps(CaseVectorizedBinaryOp); default: break; }
+        break;
+    }
+    return false;
+#undef CaseVectorizedUnaryOp
+#undef CaseVectorizedBinaryOp
+}
+
+} // anonymous namespace
+
+}}}
@@ -6,6 +6,16 @@
 #include "stdafx.h"
 #include "ConvolutionEngine.h"
 #include "CuDnnFactories.h"
+#include "BlockedLayout.h"
+#include "CPUTensorKernels.h"
+#include "CPUMatrix.h"
+#include "fileutil.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <xmmintrin.h>
+#include <map>
+#include <mutex>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -848,6 +858,1186 @@ public:
     }
 };
 
+//------------------------------------------------------------------
+// Winograd convolution engine implementation.
+// CPU engine for the two kernel sizes that dominate image models, for 2D convolutions with full sharing:
+// * 3x3 kernels with stride 1 use Winograd's minimal filtering algorithm F(4x4, 3x3) (Lavin and Gray, 2015).
+//   It computes a 4x4 tile of outputs from a 6x6 input tile with 36 instead of 144 multiplications per pair of input
+//   and output channel. The transforms cost more than they save for small images, so outputs need to be at least 8x8.
+// * 1x1 kernels with stride 1 and no padding are a single matrix product per sample, no unrolling is needed.
+// Create() picks this engine for these geometries only, all other geometries fall back to the GEMM engine.
+//------------------------------------------------------------------
+
+// Transform matrices of F(4x4, 3x3), row-major: B^T is 6x6, G is 6x3 and A^T is 4x6.
+// The output tile is Y = A^T [(G g G^T) .* (B^T d B)] A for a 3x3 kernel g and a 6x6 input tile d.
+static const double c_winogradBT4[6 * 6] =
+{
+    4,  0, -5,  0, 1, 0,
+    0, -4, -4,  1, 1, 0,
+    0,  4, -4, -1, 1, 0,
+    0, -2, -1,  2, 1, 0,
+    0,  2, -1, -2, 1, 0,
+    0,  4,  0, -5, 0, 1
+};
+static const double c_winogradG4[6 * 3] =
+{
+     1.0 / 4,        0,       0,
+    -1.0 / 6, -1.0 / 6, -1.0 / 6,
+    -1.0 / 6,  1.0 / 6, -1.0 / 6,
+     1.0 / 24, 1.0 / 12, 1.0 / 6,
+     1.0 / 24, -1.0 / 12, 1.0 / 6,
+            0,        0,       1
+};
+static const double c_winogradAT4[4 * 6] =
+{
+    1, 1,  1, 1,  1, 0,
+    0, 1, -1, 2, -2, 0,
+    0, 1,  1, 4,  4, 0,
+    0, 1, -1, 8, -8, 1
+};
+
+// out = L in L^T, where L is the given row-major matrix or its transpose. This is the form of all transforms, e.g.
+// B^T d B with L = B^T, or the adjoint B dV B^T with L = (B^T)^T. The transforms of many tiles (e.g. all channels) are
+// done at once: in is a q x q and out a p x p array of vectors of len elements, element (i, j) of in starts at
+// in + (i * q + j) * inStride, element (a, b) of out at out + (a * p + b) * outStride. temp holds p * q * len elements.
+template <class ElemType>
+static void WinogradTransform(const double* L, size_t rowsL, size_t colsL, bool transposeL,
+                              const ElemType* in, size_t inStride, ElemType* out, size_t outStride, size_t len, ElemType* temp)
+{
+    const size_t p = transposeL ? colsL : rowsL; // size of out
+    const size_t q = transposeL ? rowsL : colsL; // size of in
+    auto l = [=](size_t i, size_t j) { return (ElemType)(transposeL ? L[j * colsL + i] : L[i * colsL + j]); };
+    // temp = L in, p x q
+    for (size_t i = 0; i < p; i++)
+    {
+        for (size_t j = 0; j < q; j++)
+        {
+            ElemType* t = temp + (i * q + j) * len;
+            fill(t, t + len, (ElemType)0);
+            for (size_t k = 0; k < q; k++)
+            {
+                const ElemType c = l(i, k);
+                if (c == 0)
+                    continue;
+                const ElemType* s = in + (k * q + j) * inStride;
+                for (size_t n = 0; n < len; n++)
+                    t[n] += c * s[n];
+            }
+        }
+    }
+    // out = temp L^T, p x p
+    for (size_t i = 0; i < p; i++)
+    {
+        for (size_t j = 0; j < p; j++)
+        {
+            ElemType* o = out + (i * p + j) * outStride;
+            fill(o, o + len, (ElemType)0);
+            for (size_t k = 0; k < q; k++)
+            {
+                const ElemType c = l(j, k);
+                if (c == 0)
+                    continue;
+                const ElemType* s = temp + (i * q + k) * len;
+                for (size_t n = 0; n < len; n++)
+                    o[n] += c * s[n];
+            }
+        }
+    }
+}
+
+template <class ElemType>
+class WinogradConvolutionEngine : public ReferenceConvolutionEngine<ElemType>
+{
+public:
+    using Base = ReferenceConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    WinogradConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind)
+    {
+        const auto& inT = geometry->InputShape();
+        const auto& outT = geometry->OutputShape();
+        m_inW = inT[0];
+        m_inH = inT[1];
+        m_inC = inT[2];
+        m_outW = outT[0];
+        m_outH = outT[1];
+        m_mapCount = outT[2];
+        m_padX = geometry->GetLowerPad(0);
+        m_padY = geometry->GetLowerPad(1);
+        m_kernelSize = geometry->KernelShape()[0];
+
+        m_tileSize = 4;
+        m_alpha = m_tileSize + 2;
+        m_tilesX = (m_outW + m_tileSize - 1) / m_tileSize;
+        m_tilesY = (m_outH + m_tileSize - 1) / m_tileSize;
+        m_BT = c_winogradBT4;
+        m_G  = c_winogradG4;
+        m_AT = c_winogradAT4;
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+    using Base::m_maxTempMemSizeInSamples;
+
+    void EnsureCompatible() override
+    {
+        if (m_imageLayout != ImageLayoutKind::CHW)
+            LogicError("Winograd convolution engine supports only CHW/cudnn layout.");
+        if (!IsSupported(m_deviceId, m_geometry))
+            LogicError("Winograd convolution engine does not support this convolution configuration. Geometry: %s", ((string)*m_geometry).c_str());
+    }
+
+    void EnsureConvolutionInitialized() override
+    {
+        // Everything is derived from the geometry in the constructor, the reference maps are not needed.
+    }
+
+    // Notation as in the GEMM engine above: input [WHC x N], kernel [XYC x K], output [W'H'K x N].
+    // The Winograd path works on the P = N * tiles tiles of the (sub-)batch. For each of the alpha^2 = (m + 2)^2
+    // positions xi within a tile, it keeps the transformed kernels U_xi [C x K], inputs V_xi [C x P] and outputs
+    // M_xi [K x P], so that the products over the channels become alpha^2 GEMMs: M_xi = U_xi^T V_xi.
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        size_t batchSize = in.GetNumCols();
+        auto kern = kernel.ColumnSlice(0, kernel.GetNumCols());
+        if (m_kernelSize == 1)
+        {
+            // [WH x C] * [C x K] -> [WH x K] for each sample.
+            kern.Reshape(m_inC, m_mapCount);
+            for (size_t i = 0; i < batchSize; i++)
+            {
+                auto inSlice = in.ColumnSlice(i, 1);
+                inSlice.Reshape(m_inW * m_inH, m_inC);
+                auto outSlice = out.ColumnSlice(i, 1);
+                outSlice.Reshape(m_outW * m_outH, m_mapCount);
+                Mat::Multiply(inSlice, false, kern, false, outSlice);
+            }
+            return;
+        }
+
+        size_t subBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
+        size_t alpha2 = m_alpha * m_alpha;
+        size_t maxTiles = subBatchSize * m_tilesX * m_tilesY;
+        // Reserve space for U, V and M.
+        size_t offsetV = alpha2 * m_inC * m_mapCount;
+        size_t offsetM = offsetV + alpha2 * m_inC * maxTiles;
+        workspace.Resize(1, offsetM + alpha2 * m_mapCount * maxTiles);
+
+        TransformKernel(kern.Data(), workspace.Data());
+        for (size_t start = 0; start < batchSize; start += subBatchSize)
+        {
+            size_t curBatchSize = min(subBatchSize, batchSize - start);
+            size_t numTiles = curBatchSize * m_tilesX * m_tilesY;
+            TransformInput(in.ColumnSlice(start, curBatchSize).Data(), curBatchSize, workspace.Data() + offsetV);
+            for (size_t xi = 0; xi < alpha2; xi++)
+            {
+                auto u = workspace.ColumnSlice(xi * m_inC * m_mapCount, m_inC * m_mapCount);
+                u.Reshape(m_inC, m_mapCount);
+                auto v = workspace.ColumnSlice(offsetV + xi * m_inC * numTiles, m_inC * numTiles);
+                v.Reshape(m_inC, numTiles);
+                auto m = workspace.ColumnSlice(offsetM + xi * m_mapCount * numTiles, m_mapCount * numTiles);
+                m.Reshape(m_mapCount, numTiles);
+                Mat::Multiply(u, true, v, false, m);
+            }
+            auto outSlice = out.ColumnSlice(start, curBatchSize);
+            TransformOutput(workspace.Data() + offsetM, curBatchSize, outSlice.Data());
+        }
+    }
+
+    // The backward methods apply the adjoints of the forward transforms: the output gradients are transformed with
+    // A dY A^T into dM_xi [K x P], then
+    // * backward data: dV_xi = U_xi dM_xi, and the input gradients of each tile are B dV B^T,
+    // * backward kernel: dU_xi = V_xi dM_xi^T, summed over all tiles, and the kernel gradients are G^T dU G.
+    void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool /*accumulateGradient*/, Mat& workspace) override
+    {
+        size_t batchSize = srcGrad.GetNumCols();
+        auto kern = kernel.ColumnSlice(0, kernel.GetNumCols());
+        if (m_kernelSize == 1)
+        {
+            // [WH x K] * [C x K]^T -> [WH x C] for each sample.
+            kern.Reshape(m_inC, m_mapCount);
+            for (size_t i = 0; i < batchSize; i++)
+            {
+                auto srcGradSlice = srcGrad.ColumnSlice(i, 1);
+                srcGradSlice.Reshape(m_outW * m_outH, m_mapCount);
+                auto gradSlice = grad.ColumnSlice(i, 1);
+                gradSlice.Reshape(m_inW * m_inH, m_inC);
+                Mat::MultiplyAndAdd(srcGradSlice, false, kern, true, gradSlice);
+            }
+            return;
+        }
+
+        size_t subBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
+        size_t alpha2 = m_alpha * m_alpha;
+        size_t maxTiles = subBatchSize * m_tilesX * m_tilesY;
+        // Reserve space for U, dM and dV.
+        size_t offsetM = alpha2 * m_inC * m_mapCount;
+        size_t offsetV = offsetM + alpha2 * m_mapCount * maxTiles;
+        workspace.Resize(1, offsetV + alpha2 * m_inC * maxTiles);
+
+        TransformKernel(kern.Data(), workspace.Data());
+        for (size_t start = 0; start < batchSize; start += subBatchSize)
+        {
+            size_t curBatchSize = min(subBatchSize, batchSize - start);
+            size_t numTiles = curBatchSize * m_tilesX * m_tilesY;
+            TransformOutputGradient(srcGrad.ColumnSlice(start, curBatchSize).Data(), curBatchSize, workspace.Data() + offsetM);
+            for (size_t xi = 0; xi < alpha2; xi++)
+            {
+                auto u = workspace.ColumnSlice(xi * m_inC * m_mapCount, m_inC * m_mapCount);
+                u.Reshape(m_inC, m_mapCount);
+                auto m = workspace.ColumnSlice(offsetM + xi * m_mapCount * numTiles, m_mapCount * numTiles);
+                m.Reshape(m_mapCount, numTiles);
+                auto v = workspace.ColumnSlice(offsetV + xi * m_inC * numTiles, m_inC * numTiles);
+                v.Reshape(m_inC, numTiles);
+                Mat::Multiply(u, false, m, false, v);
+            }
+            auto gradSlice = grad.ColumnSlice(start, curBatchSize);
+            AddInputGradient(workspace.Data() + offsetV, curBatchSize, gradSlice.Data());
+        }
+    }
+
+    void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool /*accumulateGradient*/, bool /*allowReuse*/, Mat& workspace) override
+    {
+        size_t batchSize = srcGrad.GetNumCols();
+        auto kernGrad = kernelGrad.ColumnSlice(0, kernelGrad.GetNumCols());
+        if (m_kernelSize == 1)
+        {
+            // [WH x C]^T * [WH x K] -> [C x K], summed over the samples.
+            kernGrad.Reshape(m_inC, m_mapCount);
+            for (size_t i = 0; i < batchSize; i++)
+            {
+                auto inSlice = in.ColumnSlice(i, 1);
+                inSlice.Reshape(m_inW * m_inH, m_inC);
+                auto srcGradSlice = srcGrad.ColumnSlice(i, 1);
+                srcGradSlice.Reshape(m_outW * m_outH, m_mapCount);
+                Mat::MultiplyAndAdd(inSlice, true, srcGradSlice, false, kernGrad);
+            }
+            return;
+        }
+
+        size_t subBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
+        size_t alpha2 = m_alpha * m_alpha;
+        size_t maxTiles = subBatchSize * m_tilesX * m_tilesY;
+        // Reserve space for dU, V and dM.
+        size_t offsetV = alpha2 * m_inC * m_mapCount;
+        size_t offsetM = offsetV + alpha2 * m_inC * maxTiles;
+        workspace.Resize(1, offsetM + alpha2 * m_mapCount * maxTiles);
+
+        auto dU = workspace.ColumnSlice(0, offsetV);
+        dU.SetValue(0);
+        for (size_t start = 0; start < batchSize; start += subBatchSize)
+        {
+            size_t curBatchSize = min(subBatchSize, batchSize - start);
+            size_t numTiles = curBatchSize * m_tilesX * m_tilesY;
+            TransformInput(in.ColumnSlice(start, curBatchSize).Data(), curBatchSize, workspace.Data() + offsetV);
+            TransformOutputGradient(srcGrad.ColumnSlice(start, curBatchSize).Data(), curBatchSize, workspace.Data() + offsetM);
+            for (size_t xi = 0; xi < alpha2; xi++)
+            {
+                auto u = workspace.ColumnSlice(xi * m_inC * m_mapCount, m_inC * m_mapCount);
+                u.Reshape(m_inC, m_mapCount);
+                auto v = workspace.ColumnSlice(offsetV + xi * m_inC * numTiles, m_inC * numTiles);
+                v.Reshape(m_inC, numTiles);
+                auto m = workspace.ColumnSlice(offsetM + xi * m_mapCount * numTiles, m_mapCount * numTiles);
+                m.Reshape(m_mapCount, numTiles);
+                Mat::MultiplyAndAdd(v, false, m, true, u);
+            }
+        }
+        AddKernelGradient(workspace.Data(), kernGrad.Data());
+    }
+
+private:
+    // U_xi[c, k] = (G g G^T)[xi] for the 3x3 kernel g of input channel c and output channel k.
+    void TransformKernel(const ElemType* kernel, ElemType* u) const
+    {
+        const size_t numPairs = m_inC * m_mapCount;
+#pragma omp parallel for
+        for (int64_t pair = 0; pair < (int64_t)numPairs; pair++)
+        {
+            ElemType temp[6 * 3];
+            WinogradTransform(m_G, m_alpha, 3, false, kernel + 9 * pair, 1, u + pair, numPairs, 1, temp);
+        }
+    }
+
+    // dg = G^T dU G, added to the kernel gradient.
+    void AddKernelGradient(const ElemType* du, ElemType* kernelGrad) const
+    {
+        const size_t numPairs = m_inC * m_mapCount;
+#pragma omp parallel for
+        for (int64_t pair = 0; pair < (int64_t)numPairs; pair++)
+        {
+            ElemType temp[3 * 6];
+            ElemType dg[3 * 3];
+            WinogradTransform(m_G, m_alpha, 3, true, du + pair, numPairs, dg, 1, 1, temp);
+            for (size_t i = 0; i < 9; i++)
+                kernelGrad[9 * pair + i] += dg[i];
+        }
+    }
+
+    // V_xi[c, p] = (B^T d B)[xi] for the input tile d of channel c and tile p, zero outside of the input (padding).
+    // Each thread transforms whole tiles, for all channels at once.
+    void TransformInput(const ElemType* in, size_t batchSize, ElemType* v) const
+    {
+        const size_t alpha2 = m_alpha * m_alpha;
+        const size_t tilesPerSample = m_tilesX * m_tilesY;
+        const size_t numTiles = batchSize * tilesPerSample;
+#pragma omp parallel
+        {
+            vector<ElemType> d(alpha2 * m_inC);
+            vector<ElemType> temp(alpha2 * m_inC);
+#pragma omp for
+            for (int64_t p = 0; p < (int64_t)numTiles; p++)
+            {
+                const size_t sample = p / tilesPerSample;
+                const size_t t = p % tilesPerSample;
+                const int x0 = (int)((t % m_tilesX) * m_tileSize) - m_padX;
+                const int y0 = (int)((t / m_tilesX) * m_tileSize) - m_padY;
+                for (size_t c = 0; c < m_inC; c++)
+                {
+                    const ElemType* image = in + (sample * m_inC + c) * m_inW * m_inH;
+                    for (int i = 0; i < (int)m_alpha; i++)
+                    {
+                        for (int j = 0; j < (int)m_alpha; j++)
+                        {
+                            const int x = x0 + j, y = y0 + i;
+                            d[(i * m_alpha + j) * m_inC + c] = x >= 0 && x < (int)m_inW && y >= 0 && y < (int)m_inH ? image[y * m_inW + x] : 0;
+                        }
+                    }
+                }
+                WinogradTransform(m_BT, m_alpha, m_alpha, false, d.data(), m_inC, v + p * m_inC, numTiles * m_inC, m_inC, temp.data());
+            }
+        }
+    }
+
+    // dd = B dV B^T, added to the input gradient. Neighboring tiles overlap, so the threads own rows of tiles, first
+    // the even and then the odd ones; rows two apart do not overlap.
+    void AddInputGradient(const ElemType* dv, size_t batchSize, ElemType* grad) const
+    {
+        const size_t alpha2 = m_alpha * m_alpha;
+        const size_t tilesPerSample = m_tilesX * m_tilesY;
+        const size_t numTiles = batchSize * tilesPerSample;
+#pragma omp parallel
+        {
+            vector<ElemType> dd(alpha2 * m_inC);
+            vector<ElemType> temp(alpha2 * m_inC);
+            for (size_t phase = 0; phase < 2; phase++)
+            {
+                const size_t rowsPerSample = (m_tilesY + 1 - phase) / 2;
+#pragma omp for
+                for (int64_t sr = 0; sr < (int64_t)(batchSize * rowsPerSample); sr++)
+                {
+                    const size_t sample = sr / rowsPerSample;
+                    const size_t row = 2 * (sr % rowsPerSample) + phase;
+                    for (size_t col = 0; col < m_tilesX; col++)
+                    {
+                        const size_t p = sample * tilesPerSample + row * m_tilesX + col;
+                        WinogradTransform(m_BT, m_alpha, m_alpha, true, dv + p * m_inC, numTiles * m_inC, dd.data(), m_inC, m_inC, temp.data());
+                        const int x0 = (int)(col * m_tileSize) - m_padX;
+                        const int y0 = (int)(row * m_tileSize) - m_padY;
+                        for (size_t c = 0; c < m_inC; c++)
+                        {
+                            ElemType* image = grad + (sample * m_inC + c) * m_inW * m_inH;
+                            for (int i = 0; i < (int)m_alpha; i++)
+                            {
+                                for (int j = 0; j < (int)m_alpha; j++)
+                                {
+                                    const int x = x0 + j, y = y0 + i;
+                                    if (x >= 0 && x < (int)m_inW && y >= 0 && y < (int)m_inH)
+                                        image[y * m_inW + x] += dd[(i * m_alpha + j) * m_inC + c];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Output tile Y = A^T M A of output channel k and tile p, cropped to the output.
+    void TransformOutput(const ElemType* m, size_t batchSize, ElemType* out) const
+    {
+        const size_t tilesPerSample = m_tilesX * m_tilesY;
+        const size_t numTiles = batchSize * tilesPerSample;
+#pragma omp parallel
+        {
+            vector<ElemType> y(m_tileSize * m_tileSize * m_mapCount);
+            vector<ElemType> temp(m_tileSize * m_alpha * m_mapCount);
+#pragma omp for
+            for (int64_t p = 0; p < (int64_t)numTiles; p++)
+            {
+                const size_t sample = p / tilesPerSample;
+                const size_t t = p % tilesPerSample;
+                WinogradTransform(m_AT, m_tileSize, m_alpha, false, m + p * m_mapCount, numTiles * m_mapCount, y.data(), m_mapCount, m_mapCount, temp.data());
+                const size_t x0 = (t % m_tilesX) * m_tileSize;
+                const size_t y0 = (t / m_tilesX) * m_tileSize;
+                for (size_t k = 0; k < m_mapCount; k++)
+                {
+                    ElemType* image = out + (sample * m_mapCount + k) * m_outW * m_outH;
+                    for (size_t i = 0; i < m_tileSize && y0 + i < m_outH; i++)
+                        for (size_t j = 0; j < m_tileSize && x0 + j < m_outW; j++)
+                            image[(y0 + i) * m_outW + x0 + j] = y[(i * m_tileSize + j) * m_mapCount + k];
+                }
+            }
+        }
+    }
+
+    // dM_xi[k, p] = (A dY A^T)[xi] for the output gradient tile dY of output channel k and tile p, zero outside of the output.
+    void TransformOutputGradient(const ElemType* srcGrad, size_t batchSize, ElemType* m) const
+    {
+        const size_t tilesPerSample = m_tilesX * m_tilesY;
+        const size_t numTiles = batchSize * tilesPerSample;
+#pragma omp parallel
+        {
+            vector<ElemType> dy(m_tileSize * m_tileSize * m_mapCount);
+            vector<ElemType> temp(m_alpha * m_tileSize * m_mapCount);
+#pragma omp for
+            for (int64_t p = 0; p < (int64_t)numTiles; p++)
+            {
+                const size_t sample = p / tilesPerSample;
+                const size_t t = p % tilesPerSample;
+                const size_t x0 = (t % m_tilesX) * m_tileSize;
+                const size_t y0 = (t / m_tilesX) * m_tileSize;
+                for (size_t k = 0; k < m_mapCount; k++)
+                {
+                    const ElemType* image = srcGrad + (sample * m_mapCount + k) * m_outW * m_outH;
+                    for (size_t i = 0; i < m_tileSize; i++)
+                        for (size_t j = 0; j < m_tileSize; j++)
+                            dy[(i * m_tileSize + j) * m_mapCount + k] = y0 + i < m_outH && x0 + j < m_outW ? image[(y0 + i) * m_outW + x0 + j] : 0;
+                }
+                WinogradTransform(m_AT, m_tileSize, m_alpha, true, dy.data(), m_mapCount, m + p * m_mapCount, numTiles * m_mapCount, m_mapCount, temp.data());
+            }
+        }
+    }
+
+public:
+    static bool IsSupported(DEVICEID_TYPE deviceId, ConvolveGeometryPtr geometry)
+    {
+        const auto& inT = geometry->InputShape();
+        const auto& kernT = geometry->KernelShape();
+        const auto& outT = geometry->OutputShape();
+        if (deviceId >= 0 || inT.GetRank() != 3 ||
+            find(begin(geometry->Sharing()), end(geometry->Sharing()), false) != end(geometry->Sharing()) ||
+            kernT[2] != inT[2] || geometry->GetMapCount(0) != 1 || geometry->GetMapCount(1) != 1 || outT[2] != geometry->GetMapCount(2) ||
+            geometry->GetStride(0) != 1 || geometry->GetStride(1) != 1)
+        {
+            return false;
+        }
+        if (kernT[0] == 3 && kernT[1] == 3)
+            return outT[0] >= 8 && outT[1] >= 8;
+        return kernT[0] == 1 && kernT[1] == 1 && outT[0] == inT[0] && outT[1] == inT[1] &&
+               geometry->GetLowerPad(0) == 0 && geometry->GetLowerPad(1) == 0;
+    }
+
+private:
+    size_t m_inW, m_inH, m_inC;
+    size_t m_outW, m_outH, m_mapCount;
+    int m_padX, m_padY;
+    size_t m_kernelSize; // 1 or 3
+
+    // F(m x m, 3 x 3) with m = m_tileSize = 4 and alpha = m + 2
+    size_t m_tileSize;
+    size_t m_alpha;
+    size_t m_tilesX, m_tilesY;
+    const double* m_BT;
+    const double* m_G;
+    const double* m_AT;
+};
+
+//------------------------------------------------------------------
+// Blocked convolution engine implementation.
+// Inference-only CPU engine for 2D convolutions with full sharing and 2D pooling that works on the channel-interleaved
+// layout of BlockedLayout.h, so that its inner loops run over the ChannelBlockSize channels of a block with unit stride.
+// The network keeps the values between such operations blocked (see ComputationNetwork::ConvertToBlockedImageLayout()),
+// so that the layout is converted only where a blocked region of the network begins or ends. Inputs or outputs that
+// are plain are converted by the engine itself.
+//------------------------------------------------------------------
+// Inner loop of the blocked convolution for a row of the kernel window and a block of input channels:
+// for numPixels output pixels p, acc[p * B + co] += sum over kx, ci of x[p * pixelStride + kx * B + ci] * w[(kx * B + ci) * B + co].
+template <class ElemType, size_t numPixels>
+struct BlockedMultiplyAdd
+{
+    static void Run(const ElemType* x, size_t pixelStride, const ElemType* w, size_t kernelWidth, ElemType* acc)
+    {
+        const size_t B = BlockedLayout::ChannelBlockSize;
+        for (size_t kx = 0; kx < kernelWidth; kx++, x += B, w += B * B)
+        {
+            for (size_t ci = 0; ci < B; ci++)
+            {
+                for (size_t p = 0; p < numPixels; p++)
+                {
+                    const ElemType v = x[p * pixelStride + ci];
+                    for (size_t co = 0; co < B; co++)
+                        acc[p * B + co] += v * w[ci * B + co];
+                }
+            }
+        }
+    }
+};
+
+// For float, the 8 output channels of 4 pixels are kept in 8 SSE registers.
+template <>
+struct BlockedMultiplyAdd<float, 4>
+{
+    static void Run(const float* x, size_t pixelStride, const float* w, size_t kernelWidth, float* acc)
+    {
+        static_assert(BlockedLayout::ChannelBlockSize == 8, "BlockedMultiplyAdd<float, 4> assumes blocks of 8 channels.");
+        __m128 a0 = _mm_loadu_ps(acc),      b0 = _mm_loadu_ps(acc + 4);
+        __m128 a1 = _mm_loadu_ps(acc + 8),  b1 = _mm_loadu_ps(acc + 12);
+        __m128 a2 = _mm_loadu_ps(acc + 16), b2 = _mm_loadu_ps(acc + 20);
+        __m128 a3 = _mm_loadu_ps(acc + 24), b3 = _mm_loadu_ps(acc + 28);
+        for (size_t kx = 0; kx < kernelWidth; kx++, x += 8, w += 64)
+        {
+            for (size_t ci = 0; ci < 8; ci++)
+            {
+                const __m128 wa = _mm_loadu_ps(w + ci * 8);
+                const __m128 wb = _mm_loadu_ps(w + ci * 8 + 4);
+                __m128 v = _mm_set1_ps(x[ci]);
+                a0 = _mm_add_ps(a0, _mm_mul_ps(v, wa));
+                b0 = _mm_add_ps(b0, _mm_mul_ps(v, wb));
+                v = _mm_set1_ps(x[pixelStride + ci]);
+                a1 = _mm_add_ps(a1, _mm_mul_ps(v, wa));
+                b1 = _mm_add_ps(b1, _mm_mul_ps(v, wb));
+                v = _mm_set1_ps(x[2 * pixelStride + ci]);
+                a2 = _mm_add_ps(a2, _mm_mul_ps(v, wa));
+                b2 = _mm_add_ps(b2, _mm_mul_ps(v, wb));
+                v = _mm_set1_ps(x[3 * pixelStride + ci]);
+                a3 = _mm_add_ps(a3, _mm_mul_ps(v, wa));
+                b3 = _mm_add_ps(b3, _mm_mul_ps(v, wb));
+            }
+        }
+        _mm_storeu_ps(acc, a0);      _mm_storeu_ps(acc + 4, b0);
+        _mm_storeu_ps(acc + 8, a1);  _mm_storeu_ps(acc + 12, b1);
+        _mm_storeu_ps(acc + 16, a2); _mm_storeu_ps(acc + 20, b2);
+        _mm_storeu_ps(acc + 24, a3); _mm_storeu_ps(acc + 28, b3);
+    }
+};
+
+// 8 pixels use the AVX2 kernel if the CPU has it (CPUTensorKernelsAVX2.cpp), otherwise twice the SSE kernel.
+template <>
+struct BlockedMultiplyAdd<float, 8>
+{
+    static void Run(const float* x, size_t pixelStride, const float* w, size_t kernelWidth, float* acc)
+    {
+        if (GetCPUVectorInstructionSet() != CPUVectorInstructionSet::None)
+            BlockedConvolutionMultiplyAddAVX2(x, pixelStride, w, kernelWidth, acc);
+        else
+        {
+            BlockedMultiplyAdd<float, 4>::Run(x, pixelStride, w, kernelWidth, acc);
+            BlockedMultiplyAdd<float, 4>::Run(x + 4 * pixelStride, pixelStride, w, kernelWidth, acc + 4 * BlockedLayout::ChannelBlockSize);
+        }
+    }
+};
+
+template <class ElemType>
+class BlockedConvolutionEngine : public ConvolutionEngine<ElemType>
+{
+public:
+    using Base = ConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    BlockedConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind), m_blockedInput(false), m_blockedOutput(false)
+    {
+        const auto& inT = geometry->InputShape();
+        const auto& outT = geometry->OutputShape();
+        const auto& kernT = geometry->KernelShape();
+        m_inW = inT[0];
+        m_inH = inT[1];
+        m_inC = inT[2];
+        m_outW = outT[0];
+        m_outH = outT[1];
+        m_outC = outT[2];
+        m_kernelW = kernT[0];
+        m_kernelH = kernT[1];
+        m_strideX = geometry->GetStride(0);
+        m_strideY = geometry->GetStride(1);
+        m_padX = geometry->GetLowerPad(0);
+        m_padY = geometry->GetLowerPad(1);
+    }
+
+    void SetBlockedLayout(bool blockedInput, bool blockedOutput) override
+    {
+        if ((blockedInput && m_inC % BlockedLayout::ChannelBlockSize != 0) || (blockedOutput && m_outC % BlockedLayout::ChannelBlockSize != 0))
+            LogicError("Blocked convolution engine: the blocked layout requires a multiple of %d channels. Geometry: %s",
+                       (int)BlockedLayout::ChannelBlockSize, ((string)*m_geometry).c_str());
+        m_blockedInput = blockedInput;
+        m_blockedOutput = blockedOutput;
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+    using Base::m_poolKind;
+
+    void EnsureCompatible() override
+    {
+        if (m_imageLayout != ImageLayoutKind::CHW)
+            LogicError("Blocked convolution engine supports only CHW/cudnn layout.");
+        if (!Base::IsBlockedLayoutSupported(m_geometry, m_deviceId, m_poolKind))
+            LogicError("Blocked convolution engine does not support this configuration. Geometry: %s", ((string)*m_geometry).c_str());
+    }
+
+    void EnsureConvolutionInitialized() override
+    {
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& /*workspace*/) override
+    {
+        const size_t batchSize = in.GetNumCols();
+        const size_t B = BlockedLayout::ChannelBlockSize;
+        const size_t inBlocks = BlockedLayout::NumBlocks(m_inC);
+        const size_t outBlocks = BlockedLayout::NumBlocks(m_outC);
+
+        ReorderKernelIfChanged(kernel);
+
+        const ElemType* src = BlockedInput(in);
+        ElemType* dst = BlockedOutput(out);
+        const size_t inSampleSize = BlockedLayout::SampleSize(m_inW, m_inH, m_inC);
+        const size_t outSampleSize = BlockedLayout::SampleSize(m_outW, m_outH, m_outC);
+        const ElemType* weights = m_kernel.data();
+
+        // Output pixels whose kernel window lies within the input in x are computed PixelBlockSize at a time, which
+        // loads each weight once for all of them. The others (at the border) are computed one at a time.
+        const size_t oxBegin = std::min(m_outW, (size_t)std::max(0, (m_padX + (int)m_strideX - 1) / (int)m_strideX));
+        const size_t oxEnd = m_inW + m_padX < m_kernelW ? oxBegin : std::max(oxBegin, std::min(m_outW, (m_inW + m_padX - m_kernelW) / m_strideX + 1));
+
+#pragma omp parallel for
+        for (int64_t row = 0; row < (int64_t)(batchSize * outBlocks * m_outH); row++)
+        {
+            const size_t n = row / (outBlocks * m_outH);
+            const size_t kb = row / m_outH % outBlocks;
+            const size_t oy = row % m_outH;
+            const ElemType* image = src + n * inSampleSize;
+            const ElemType* blockWeights = weights + kb * inBlocks * m_kernelH * m_kernelW * B * B;
+            ElemType* target = dst + n * outSampleSize + (kb * m_outH + oy) * m_outW * B;
+            size_t ox = 0;
+            while (ox < m_outW)
+            {
+                if (ox >= oxBegin && ox + PixelBlockSize <= oxEnd)
+                {
+                    ConvolvePixels<PixelBlockSize>(image, blockWeights, inBlocks, ox, oy, target);
+                    ox += PixelBlockSize;
+                }
+                else
+                {
+                    ConvolvePixels<1>(image, blockWeights, inBlocks, ox, oy, target);
+                    ox++;
+                }
+            }
+        }
+
+        FinishOutput(out);
+    }
+
+    void BackwardDataCore(const Mat& /*srcGrad*/, const Mat& /*kernel*/, Mat& /*grad*/, bool /*accumulateGradient*/, Mat& /*workspace*/) override
+    {
+        LogicError("Blocked convolution engine supports only inference.");
+    }
+
+    void BackwardKernelCore(const Mat& /*srcGrad*/, const Mat& /*in*/, Mat& /*kernelGrad*/, bool /*accumulateGradient*/, bool /*allowReuse*/, Mat& /*workspace*/) override
+    {
+        LogicError("Blocked convolution engine supports only inference.");
+    }
+
+    void EnsurePoolingInitialized() override
+    {
+    }
+
+    void ForwardPoolingCore(const Mat& in, Mat& out) override
+    {
+        const size_t batchSize = in.GetNumCols();
+        const size_t B = BlockedLayout::ChannelBlockSize;
+        const size_t numBlocks = BlockedLayout::NumBlocks(m_inC);
+        const size_t inSampleSize = BlockedLayout::SampleSize(m_inW, m_inH, m_inC);
+        const size_t outSampleSize = BlockedLayout::SampleSize(m_outW, m_outH, m_outC);
+        const ElemType* src = BlockedInput(in);
+        ElemType* dst = BlockedOutput(out);
+        const bool isMax = m_poolKind == PoolKind::Max;
+
+#pragma omp parallel for
+        for (int64_t row = 0; row < (int64_t)(batchSize * numBlocks * m_outH); row++)
+        {
+            const size_t n = row / (numBlocks * m_outH);
+            const size_t cb = row / m_outH % numBlocks;
+            const size_t oy = row % m_outH;
+            const ElemType* image = src + n * inSampleSize + cb * m_inH * m_inW * B;
+            ElemType* target = dst + n * outSampleSize + (cb * m_outH + oy) * m_outW * B;
+            size_t kyBegin, kyEnd;
+            KernelRange(oy, m_strideY, m_padY, m_kernelH, m_inH, kyBegin, kyEnd);
+            for (size_t ox = 0; ox < m_outW; ox++)
+            {
+                size_t kxBegin, kxEnd;
+                KernelRange(ox, m_strideX, m_padX, m_kernelW, m_inW, kxBegin, kxEnd);
+                ElemType acc[B];
+                for (size_t c = 0; c < B; c++)
+                    acc[c] = isMax ? std::numeric_limits<ElemType>::lowest() : 0;
+                for (size_t ky = kyBegin; ky < kyEnd; ky++)
+                {
+                    const size_t iy = oy * m_strideY + ky - m_padY;
+                    const ElemType* x = image + (iy * m_inW + ox * m_strideX + kxBegin - m_padX) * B;
+                    for (size_t kx = kxBegin; kx < kxEnd; kx++, x += B)
+                    {
+                        if (isMax)
+                        {
+                            for (size_t c = 0; c < B; c++)
+                                acc[c] = std::max(acc[c], x[c]);
+                        }
+                        else
+                        {
+                            for (size_t c = 0; c < B; c++)
+                                acc[c] += x[c];
+                        }
+                    }
+                }
+                // Average pooling averages over the cells inside the input only, as the other engines do.
+                const ElemType scale = isMax ? 1 : (ElemType)1 / (ElemType)std::max<size_t>(1, (kyEnd - kyBegin) * (kxEnd - kxBegin));
+                for (size_t c = 0; c < B; c++)
+                    target[ox * B + c] = acc[c] * scale;
+            }
+        }
+
+        FinishOutput(out);
+    }
+
+    void BackwardPoolingCore(const Mat& /*out*/, const Mat& /*srcGrad*/, const Mat& /*in*/, Mat& /*grad*/) override
+    {
+        LogicError("Blocked convolution engine supports only inference.");
+    }
+
+    void MaxUnpoolingCore(const Mat& /*out*/, const Mat& /*poolIn*/, Mat& /*in*/) override
+    {
+        LogicError("Blocked convolution engine does not support max unpooling.");
+    }
+
+private:
+    static const size_t PixelBlockSize = 8;
+
+    // Computes numPixels adjacent output pixels (ox, oy), ... of all channels of a block. For numPixels > 1, the kernel
+    // window of all of them must be inside the input in x.
+    template <size_t numPixels>
+    void ConvolvePixels(const ElemType* image, const ElemType* blockWeights, size_t inBlocks, size_t ox, size_t oy, ElemType* target) const
+    {
+        const size_t B = BlockedLayout::ChannelBlockSize;
+        size_t kyBegin, kyEnd, kxBegin, kxEnd;
+        KernelRange(oy, m_strideY, m_padY, m_kernelH, m_inH, kyBegin, kyEnd);
+        KernelRange(ox, m_strideX, m_padX, m_kernelW, m_inW, kxBegin, kxEnd);
+        const size_t pixelStride = m_strideX * B;
+        ElemType acc[numPixels][BlockedLayout::ChannelBlockSize] = {};
+        for (size_t cb = 0; cb < inBlocks; cb++)
+        {
+            for (size_t ky = kyBegin; ky < kyEnd; ky++)
+            {
+                const size_t iy = oy * m_strideY + ky - m_padY;
+                const ElemType* w = blockWeights + ((cb * m_kernelH + ky) * m_kernelW + kxBegin) * B * B;
+                const ElemType* x = image + ((cb * m_inH + iy) * m_inW + ox * m_strideX + kxBegin - m_padX) * B;
+                BlockedMultiplyAdd<ElemType, numPixels>::Run(x, pixelStride, w, kxEnd - kxBegin, acc[0]);
+            }
+        }
+        for (size_t p = 0; p < numPixels; p++)
+        {
+            for (size_t co = 0; co < B; co++)
+                target[(ox + p) * B + co] = acc[p][co];
+        }
+    }
+
+    // Range [begin, end) of kernel offsets for output position o whose input position o * stride + k - pad is inside the input.
+    static void KernelRange(size_t o, size_t stride, int pad, size_t kernelSize, size_t inSize, size_t& begin, size_t& end)
+    {
+        const int first = (int)(o * stride) - pad;
+        begin = first < 0 ? (size_t)(-first) : 0;
+        end = std::min(kernelSize, (size_t)std::max(0, (int)inSize - first));
+        if (end < begin)
+            end = begin;
+    }
+
+    const ElemType* BlockedInput(const Mat& in)
+    {
+        if (m_blockedInput)
+            return in.Data();
+        m_input.resize(BlockedLayout::SampleSize(m_inW, m_inH, m_inC) * in.GetNumCols());
+        BlockedLayout::ToBlocked(in.Data(), m_input.data(), m_inW, m_inH, m_inC, in.GetNumCols());
+        return m_input.data();
+    }
+
+    ElemType* BlockedOutput(Mat& out)
+    {
+        if (m_blockedOutput)
+            return out.Data();
+        m_output.resize(BlockedLayout::SampleSize(m_outW, m_outH, m_outC) * out.GetNumCols());
+        return m_output.data();
+    }
+
+    // Reorders the kernel [XYC x K] -> [K/B][C/B][Y][X][B of C][B of K], zero for the padding channels.
+    // The result is cached and the kernel is only reordered again when its weights differ from the cached ones,
+    // which (unlike the reordering) is a sequential read.
+    void ReorderKernelIfChanged(const Mat& kernel)
+    {
+        const size_t B = BlockedLayout::ChannelBlockSize;
+        const size_t inBlocks = BlockedLayout::NumBlocks(m_inC);
+        const size_t outBlocks = BlockedLayout::NumBlocks(m_outC);
+        const size_t kernelSize = m_kernelW * m_kernelH * m_inC;
+        const ElemType* k = kernel.Data();
+        if (m_kernelWeights.size() == kernelSize * m_outC && std::equal(m_kernelWeights.begin(), m_kernelWeights.end(), k))
+            return;
+
+        m_kernelWeights.assign(k, k + kernelSize * m_outC);
+        m_kernel.assign(outBlocks * inBlocks * m_kernelH * m_kernelW * B * B, 0);
+        for (size_t co = 0; co < m_outC; co++)
+        {
+            for (size_t ci = 0; ci < m_inC; ci++)
+            {
+                for (size_t ky = 0; ky < m_kernelH; ky++)
+                {
+                    for (size_t kx = 0; kx < m_kernelW; kx++)
+                    {
+                        size_t target = ((((co / B) * inBlocks + ci / B) * m_kernelH + ky) * m_kernelW + kx) * B * B + (ci % B) * B + co % B;
+                        m_kernel[target] = k[co * kernelSize + (ci * m_kernelH + ky) * m_kernelW + kx];
+                    }
+                }
+            }
+        }
+    }
+
+    void FinishOutput(Mat& out)
+    {
+        if (!m_blockedOutput)
+            BlockedLayout::FromBlocked(m_output.data(), out.Data(), m_outW, m_outH, m_outC, out.GetNumCols());
+    }
+
+    size_t m_inW, m_inH, m_inC;
+    size_t m_outW, m_outH, m_outC;
+    size_t m_kernelW, m_kernelH;
+    size_t m_strideX, m_strideY;
+    int m_padX, m_padY;
+    bool m_blockedInput, m_blockedOutput;
+
+    std::vector<ElemType> m_kernel;        // reordered kernel
+    std::vector<ElemType> m_kernelWeights; // the weights m_kernel was reordered from
+    std::vector<ElemType> m_input;  // blocked copy of a plain input
+    std::vector<ElemType> m_output; // blocked result for a plain output
+};
+
+template <class ElemType>
+bool ConvolutionEngine<ElemType>::IsBlockedLayoutSupported(std::shared_ptr<const ConvolveGeometry> geometry, DEVICEID_TYPE deviceId, PoolKind poolKind)
+{
+    const auto& inT = geometry->InputShape();
+    const auto& kernT = geometry->KernelShape();
+    const auto& outT = geometry->OutputShape();
+    if (deviceId >= 0 || inT.GetRank() != 3 || kernT.GetRank() != 3 || outT.GetRank() != 3)
+        return false;
+    if (poolKind != PoolKind::None)
+        return kernT[2] == 1 && geometry->GetStride(2) == 1 && outT[2] == inT[2] && geometry->GetLowerPad(2) == 0;
+    return find(begin(geometry->Sharing()), end(geometry->Sharing()), false) == end(geometry->Sharing()) &&
+           kernT[2] == inT[2] && geometry->GetMapCount(0) == 1 && geometry->GetMapCount(1) == 1 && outT[2] == geometry->GetMapCount(2);
+}
+
+//------------------------------------------------------------------
+// Autotuning convolution engine implementation.
+// Wraps the CPU engines that support the geometry. The first call of an operation with a new batch size runs each
+// engine twice on a copy of the result, the first run includes the one-time initialization of the engine, and picks
+// the engine with the fastest second run. The choices are kept in a process-wide cache, keyed by the operation,
+// element type, batch size, temp memory limit, CPU model, number of threads and geometry, and optionally in a file
+// (see ConvolutionEngineAutotuner).
+//------------------------------------------------------------------
+
+enum class ConvolutionOperation
+{
+    Forward,
+    BackwardData,
+    BackwardKernel
+};
+
+static const char* ConvolutionOperationName(ConvolutionOperation op)
+{
+    switch (op)
+    {
+    case ConvolutionOperation::Forward:        return "forward";
+    case ConvolutionOperation::BackwardData:   return "backwardData";
+    case ConvolutionOperation::BackwardKernel: return "backwardKernel";
+    default:                                   LogicError("Unknown convolution operation.");
+    }
+}
+
+static const char* ConvolutionEngineKindName(ConvolutionEngineKind kind)
+{
+    switch (kind)
+    {
+    case ConvolutionEngineKind::Reference: return "reference";
+    case ConvolutionEngineKind::CuDnn:     return "cudnn";
+    case ConvolutionEngineKind::Legacy:    return "legacy";
+    case ConvolutionEngineKind::Gemm:      return "gemm";
+    case ConvolutionEngineKind::Winograd:  return "winograd";
+    default:                               return "none";
+    }
+}
+
+// Process-wide state of the ConvolutionEngineAutotuner.
+struct ConvolutionAutotunerState
+{
+    std::mutex mutex;
+    bool enabled = false;
+    std::wstring path;
+    std::map<std::string, ConvolutionEngineKind> choices;
+};
+
+static ConvolutionAutotunerState& GetAutotunerState()
+{
+    static ConvolutionAutotunerState state;
+    return state;
+}
+
+/*static*/ void ConvolutionEngineAutotuner::SetEnabled(bool enable)
+{
+    auto& state = GetAutotunerState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.enabled = enable;
+}
+
+/*static*/ bool ConvolutionEngineAutotuner::IsEnabled()
+{
+    auto& state = GetAutotunerState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.enabled;
+}
+
+// The file has one choice per line: the engine name and the key of the choice, separated by a tab.
+// Returns the number of choices read, or -1 if the file cannot be opened.
+static int ReadAutotunedEngines(const std::wstring& path, std::map<std::string, ConvolutionEngineKind>& choices)
+{
+    FILE* f = _wfopen(path.c_str(), L"r");
+    if (f == nullptr)
+        return -1;
+    std::vector<char> buffer(4096);
+    int numChoices = 0;
+    while (fgets(buffer.data(), (int)buffer.size(), f))
+    {
+        std::string line(buffer.data());
+        line.erase(line.find_last_not_of("\r\n") + 1);
+        auto tab = line.find('\t');
+        if (tab == std::string::npos)
+            continue;
+        auto name = line.substr(0, tab);
+        for (auto kind : { ConvolutionEngineKind::Reference, ConvolutionEngineKind::Gemm, ConvolutionEngineKind::Winograd })
+        {
+            if (name == ConvolutionEngineKindName(kind))
+            {
+                choices[line.substr(tab + 1)] = kind; // later lines win
+                numChoices++;
+            }
+        }
+    }
+    fclose(f);
+    return numChoices;
+}
+
+/*static*/ void ConvolutionEngineAutotuner::SetCacheFile(const std::wstring& path)
+{
+    auto& state = GetAutotunerState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.path = path;
+    state.choices.clear();
+    if (path.empty() || !fexists(path))
+        return;
+
+    int numChoices = ReadAutotunedEngines(path, state.choices);
+    if (numChoices < 0)
+        fprintf(stderr, "WARNING: Cannot read the convolution engine choices from '%ls', the engines will be timed again.\n", path.c_str());
+    else
+        fprintf(stderr, "Loaded %d convolution engine choices from '%ls'.\n", numChoices, path.c_str());
+}
+
+static bool FindAutotunedEngine(const std::string& key, ConvolutionEngineKind& kind)
+{
+    auto& state = GetAutotunerState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto iter = state.choices.find(key);
+    if (iter == state.choices.end())
+        return false;
+    kind = iter->second;
+    return true;
+}
+
+// Other processes may use the same file, so the choices they have saved in the meantime are kept, and the file is
+// replaced in one step by one written under a name of this process. Failing to save the choices only means that
+// later runs time the engines again, so it is not an error.
+static void SaveAutotunedEngines(ConvolutionAutotunerState& state)
+{
+    std::map<std::string, ConvolutionEngineKind> choices;
+    ReadAutotunedEngines(state.path, choices);
+    for (const auto& choice : state.choices)
+        choices[choice.first] = choice.second;
+
+    const std::wstring tempPath = state.path + L"." + std::to_wstring(GetCurrentProcessId()) + L".tmp";
+    FILE* f = _wfopen(tempPath.c_str(), L"w");
+    bool saved = f != nullptr;
+    if (f != nullptr)
+    {
+        for (const auto& choice : choices)
+            fprintf(f, "%s\t%s\n", ConvolutionEngineKindName(choice.second), choice.first.c_str());
+        saved = !ferror(f);
+        saved = fclose(f) == 0 && saved;
+        saved = saved && renameReplacing(tempPath, state.path);
+        if (!saved)
+            _wunlink(tempPath.c_str());
+    }
+    if (!saved)
+        fprintf(stderr, "WARNING: Cannot save the convolution engine choices to '%ls', later runs will time the engines again.\n", state.path.c_str());
+}
+
+static void AddAutotunedEngine(const std::string& key, ConvolutionEngineKind kind)
+{
+    auto& state = GetAutotunerState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.choices[key] = kind;
+    if (!state.path.empty())
+        SaveAutotunedEngines(state);
+}
+
+template <class ElemType>
+class AutotuningConvolutionEngine : public ConvolutionEngine<ElemType>
+{
+public:
+    using Base = ConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+    typedef std::vector<std::pair<ConvolutionEngineKind, std::unique_ptr<Base>>> Engines;
+
+public:
+    AutotuningConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
+                                Engines&& engines, const std::wstring& logPrefix)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind), m_engines(std::move(engines)), m_logPrefix(logPrefix)
+    {
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_imageLayout;
+    using Base::m_maxTempMemSizeInSamples;
+
+    void EnsureCompatible() override
+    {
+        if (m_imageLayout != ImageLayoutKind::CHW)
+            LogicError("Autotuning convolution engine supports only CHW/cudnn layout.");
+    }
+
+    void EnsureConvolutionInitialized() override
+    {
+        // The wrapped engines initialize themselves.
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        auto& engine = Choose(ConvolutionOperation::Forward, in.GetNumCols(), out, [&](Base& candidate, Mat& trialOut)
+        {
+            candidate.Forward(in, kernel, trialOut, workspace);
+        });
+        engine.Forward(in, kernel, out, workspace);
+    }
+
+    void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, bool accumulateGradient, Mat& workspace) override
+    {
+        auto& engine = Choose(ConvolutionOperation::BackwardData, srcGrad.GetNumCols(), grad, [&](Base& candidate, Mat& trialGrad)
+        {
+            candidate.BackwardData(srcGrad, kernel, trialGrad, accumulateGradient, workspace);
+        });
+        engine.BackwardData(srcGrad, kernel, grad, accumulateGradient, workspace);
+    }
+
+    void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool accumulateGradient, bool allowReuse, Mat& workspace) override
+    {
+        auto& engine = Choose(ConvolutionOperation::BackwardKernel, srcGrad.GetNumCols(), kernelGrad, [&](Base& candidate, Mat& trialKernelGrad)
+        {
+            candidate.BackwardKernel(srcGrad, in, trialKernelGrad, accumulateGradient, allowReuse, workspace);
+        });
+        engine.BackwardKernel(srcGrad, in, kernelGrad, accumulateGradient, allowReuse, workspace);
+    }
+
+    void EnsurePoolingInitialized() override
+    {
+        LogicError("Autotuning convolution engine does not support pooling.");
+    }
+
+    void ForwardPoolingCore(const Mat& /*in*/, Mat& /*out*/) override
+    {
+    }
+
+    void BackwardPoolingCore(const Mat& /*out*/, const Mat& /*srcGrad*/, const Mat& /*in*/, Mat& /*grad*/) override
+    {
+    }
+
+    void MaxUnpoolingCore(const Mat& /*out*/, const Mat& /*poolIn*/, Mat& /*in*/) override
+    {
+    }
+
+private:
+    // Returns the engine for the operation. run(engine, result) must run the operation with the given engine and write
+    // its result to the given matrix, the engines are timed on a copy of the actual result.
+    template <class Run>
+    Base& Choose(ConvolutionOperation op, size_t batchSize, const Mat& result, const Run& run)
+    {
+        const int numThreads = CPUMatrix<ElemType>::GetMaxNumThreads();
+        auto localKey = std::make_tuple(op, batchSize, m_maxTempMemSizeInSamples, numThreads);
+        auto iter = m_choices.find(localKey);
+        if (iter != m_choices.end())
+            return *iter->second;
+
+        for (auto& engine : m_engines)
+            engine.second->SetmMaxTempMemSizeInSamples(m_maxTempMemSizeInSamples);
+        auto engStr = (std::string)(*m_geometry);
+        // The fastest engine depends on the hardware and the number of threads, which may differ between the runs sharing a file.
+        static const std::string cpuModel = GetCPUModelName();
+        auto key = msra::strfun::strprintf("%s\t%d\t%d\t%d\t%s\t%d\t%s", ConvolutionOperationName(op), (int)sizeof(ElemType), (int)batchSize,
+                                           (int)m_maxTempMemSizeInSamples, cpuModel.c_str(), numThreads, engStr.c_str());
+
+        Base* chosen = nullptr;
+        ConvolutionEngineKind kind;
+        if (FindAutotunedEngine(key, kind))
+        {
+            for (auto& engine : m_engines)
+                if (engine.first == kind)
+                    chosen = engine.second.get();
+            if (chosen != nullptr && GetMathLibTraceLevel() > 0)
+                fprintf(stderr, "%lsusing cached choice of %s engine for %s convolution with batch size %d for geometry: %s.\n",
+                        m_logPrefix.c_str(), ConvolutionEngineKindName(kind), ConvolutionOperationName(op), (int)batchSize, engStr.c_str());
+        }
+        // A cached engine that is not enabled for this layer is timed again.
+        if (chosen == nullptr)
+        {
+            Mat trialResult = result.DeepClone();
+            std::string timings;
+            double bestTime = std::numeric_limits<double>::max();
+            for (auto& engine : m_engines)
+            {
+                run(*engine.second, trialResult);
+                auto start = std::chrono::steady_clock::now();
+                run(*engine.second, trialResult);
+                double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                timings += msra::strfun::strprintf("%s%s %.3f ms", timings.empty() ? "" : ", ", ConvolutionEngineKindName(engine.first), time * 1000);
+                if (time < bestTime)
+                {
+                    bestTime = time;
+                    chosen = engine.second.get();
+                    kind = engine.first;
+                }
+            }
+            AddAutotunedEngine(key, kind);
+            fprintf(stderr, "%lsautotuned %s convolution with batch size %d: using %s engine (%s) for geometry: %s.\n",
+                    m_logPrefix.c_str(), ConvolutionOperationName(op), (int)batchSize, ConvolutionEngineKindName(kind), timings.c_str(), engStr.c_str());
+        }
+        m_choices[localKey] = chosen;
+        return *chosen;
+    }
+
+private:
+    Engines m_engines;
+    std::wstring m_logPrefix;
+    std::map<std::tuple<ConvolutionOperation, size_t, size_t, int>, Base*> m_choices;
+};
+
 template <class ElemType>
 std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId,
                                                                                  ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
@@ -883,6 +2073,42 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
         return CuDnnConvolutionEngineFactory<ElemType>::Create(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, forceDeterministicAlgorithms);
     }
 
+    // The blocked engine is used only if it is asked for explicitly, since its inputs and outputs may be blocked.
+    if (isEnabled(ConvolutionEngineKind::Blocked) && IsBlockedLayoutSupported(geometry, deviceId, poolKind))
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing blocked convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<BlockedConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind);
+    }
+
+    // On CPU, time the engines that support the convolution and use the fastest one, if there is a choice.
+    if (deviceId < 0 && poolKind == PoolKind::None && ConvolutionEngineAutotuner::IsEnabled())
+    {
+        typename AutotuningConvolutionEngine<ElemType>::Engines engines;
+        if (isEnabled(ConvolutionEngineKind::Winograd) && WinogradConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
+            engines.push_back(std::make_pair(ConvolutionEngineKind::Winograd, std::make_unique<WinogradConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind)));
+        if (isEnabled(ConvolutionEngineKind::Gemm) && GemmConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
+            engines.push_back(std::make_pair(ConvolutionEngineKind::Gemm, std::make_unique<GemmConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind)));
+        if (isEnabled(ConvolutionEngineKind::Reference))
+            engines.push_back(std::make_pair(ConvolutionEngineKind::Reference, std::make_unique<ReferenceConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind)));
+        if (engines.size() > 1)
+        {
+            if (GetMathLibTraceLevel() > 0)
+                fprintf(stderr, "%lsusing autotuning convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+            return std::make_unique<AutotuningConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, std::move(engines), logPrefix);
+        }
+    }
+
+    if (isEnabled(ConvolutionEngineKind::Winograd) && WinogradConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing Winograd convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<WinogradConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind);
+    }
+
     if (isEnabled(ConvolutionEngineKind::Gemm) && GemmConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
     {
         if (GetMathLibTraceLevel() > 0)
@@ -22,8 +22,10 @@ enum class ConvolutionEngineKind
     CuDnn     = 1 << 1, // cuDNN, works only for 2D/3D convos with full sharing.
     Legacy    = 1 << 2, // Legacy, for backwards compatibility. REVIEW alexeyk: implement sparse version and remove Legacy altogether.
     Gemm      = 1 << 3, // Uses convolution unrolling+GEMM technique. Works only for convos with full sharing.
+    Winograd  = 1 << 4, // CPU only: Winograd for 3x3 (outputs of at least 8x8) and GEMM without unrolling for 1x1 2D convos with stride 1 and full sharing.
+    Blocked   = 1 << 5, // CPU only, inference only: 2D convos with full sharing and 2D pooling in the blocked layout (see BlockedLayout.h). Must be requested explicitly.
 
-    All       = Reference | CuDnn | Legacy | Gemm
+    All       = Reference | CuDnn | Legacy | Gemm | Winograd
 };
 
 enum class PoolKind
@@ -74,6 +76,18 @@ public:
 
     virtual bool ImplementsGradientOverwriteOptimization() const { return false; }
 
+    // Selects the blocked layout (see BlockedLayout.h) instead of the plain one for the input and/or the output of
+    // Forward() and ForwardPooling(). Only the Blocked engine supports it, and only if the blocked tensor has a multiple
+    // of BlockedLayout::ChannelBlockSize channels, so that it has the same size as the plain one.
+    virtual void SetBlockedLayout(bool blockedInput, bool blockedOutput)
+    {
+        if (blockedInput || blockedOutput)
+            LogicError("This convolution engine does not support the blocked layout.");
+    }
+
+    // Whether the Blocked engine supports the geometry.
+    static bool IsBlockedLayoutSupported(std::shared_ptr<const ConvolveGeometry> geometry, DEVICEID_TYPE deviceId, PoolKind poolKind);
+
 protected:
     ConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind)
         : m_geometry(geometry), m_deviceId(deviceId), m_imageLayout(imageLayout), m_maxTempMemSizeInSamples(maxTempMemSizeInSamples), m_poolKind(poolKind)
@@ -109,6 +123,24 @@ protected:
 
 #pragma warning(pop)
 
+//-------------------------------------------------------------
+// Autotuning of the CPU convolution engines.
+// When enabled, Create() returns an engine for CPU convolutions that, on the first call of each operation (forward,
+// backward data, backward kernel) with a new batch size, times all enabled engines that support the geometry and
+// uses the fastest one from then on. The choices are shared by all layers with the same geometry and can be kept in
+// a file, e.g. next to the model, so that later runs do not need to time the engines again.
+//-------------------------------------------------------------
+class MATH_API ConvolutionEngineAutotuner
+{
+public:
+    static void SetEnabled(bool enable);
+    static bool IsEnabled();
+
+    // Replaces the cached choices by the ones stored in the file, if it exists, and saves all new choices to it.
+    // An empty path only clears the cache.
+    static void SetCacheFile(const std::wstring& path);
+};
+
 static inline PoolKind PoolKindFrom(const wstring& s)
 {
     if (s.empty() || AreEqualIgnoreCase(s, L"none"))
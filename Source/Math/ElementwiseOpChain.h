@@ -0,0 +1,103 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ElementwiseOpChain.h -- description of a chain of elementwise tensor operations that is evaluated in a single pass
+//
+// A sequence of TensorView::Do*OpOf() calls streams every intermediate result through memory. E.g. an LSTM cell
+// evaluates a dozen ops on full minibatch matrices, which on CPU is memory-bandwidth bound. An ElementwiseOpChain
+// instead describes the whole expression, and TensorView::DoChainOf() evaluates it block by block, such that the
+// intermediate results stay in the cache.
+//
+// Example: out = sigmoid(a + b) .* c
+//     ElementwiseOpChain chain(3); // inputs a, b, c are referred to as operands 0, 1, 2
+//     chain.Binary(opElementwiseProduct, chain.Unary(opSigmoid, chain.Binary(opSum, 0, 1)), 2);
+//     out.AssignChainOf(chain, { a, b, c });
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "CommonMatrix.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// number of inputs of an elementwise op that has a TensorView implementation, or 0 if it has none
+static inline size_t GetElementwiseOpArity(ElementWiseOperator op)
+{
+#define CaseElementwiseOpArity(oper, arity) \
+    case ElementWiseOperator::op##oper: return arity
+#define CaseUnaryOpArity(oper) CaseElementwiseOpArity(oper, 1)
+#define CaseBinaryOpArity(oper) CaseElementwiseOpArity(oper, 2)
+#define CaseTernaryOpArity(oper) CaseElementwiseOpArity(oper, 3)
+    switch (op)
+    {
+        ForAllUnaryOps(CaseUnaryOpArity);
+        ForAllBinaryOps(CaseBinaryOpArity);
+        ForAllTernaryOps(CaseTernaryOpArity);
+    default:
+        return 0;
+    }
+#undef CaseTernaryOpArity
+#undef CaseBinaryOpArity
+#undef CaseUnaryOpArity
+#undef CaseElementwiseOpArity
+}
+
+// -----------------------------------------------------------------------
+// ElementwiseOpChain -- a directed acyclic graph of elementwise ops over a fixed number of inputs
+// Operands are referred to by index: 0..numInputs-1 are the inputs, and each op appends one operand for its result.
+// The result of the last op is the result of the chain. Ops may only refer to operands that already exist,
+// so the ops are stored in a valid evaluation order.
+// -----------------------------------------------------------------------
+
+class ElementwiseOpChain
+{
+public:
+    static const size_t MaxNumInputs = 7;
+    static const size_t MaxNumOps = 32;
+
+    struct Step
+    {
+        ElementWiseOperator op;
+        size_t arity;
+        size_t args[3]; // operand indices; only the first 'arity' are used
+    };
+
+    explicit ElementwiseOpChain(size_t numInputs)
+        : m_numInputs(numInputs)
+    {
+        if (numInputs == 0 || numInputs > MaxNumInputs)
+            InvalidArgument("ElementwiseOpChain: Number of inputs must be between 1 and %d.", (int) MaxNumInputs);
+    }
+
+    // add an op; returns the operand index of its result
+    size_t Unary(ElementWiseOperator op, size_t a) { return AddStep(op, 1, a, 0, 0); }
+    size_t Binary(ElementWiseOperator op, size_t a, size_t b) { return AddStep(op, 2, a, b, 0); }
+    size_t Ternary(ElementWiseOperator op, size_t a, size_t b, size_t c) { return AddStep(op, 3, a, b, c); }
+
+    size_t GetNumInputs() const { return m_numInputs; }
+    size_t GetNumOperands() const { return m_numInputs + m_steps.size(); }
+    const std::vector<Step>& GetSteps() const { return m_steps; }
+
+private:
+    size_t AddStep(ElementWiseOperator op, size_t arity, size_t a, size_t b, size_t c)
+    {
+        if (GetElementwiseOpArity(op) != arity)
+            InvalidArgument("ElementwiseOpChain: Op %d is not an elementwise op with %d inputs.", (int) op, (int) arity);
+        if (m_steps.size() >= MaxNumOps)
+            InvalidArgument("ElementwiseOpChain: Chains are limited to %d ops.", (int) MaxNumOps);
+        Step step = { op, arity, { a, b, c } };
+        for (size_t i = 0; i < arity; i++)
+            if (step.args[i] >= GetNumOperands())
+                InvalidArgument("ElementwiseOpChain: Operand %d of op %d refers to an operand that does not exist yet.", (int) i, (int) op);
+        m_steps.push_back(step);
+        return GetNumOperands() - 1;
+    }
+
+    size_t m_numInputs;
+    std::vector<Step> m_steps;
+};
+
+}}}
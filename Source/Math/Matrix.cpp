@@ -660,6 +660,27 @@ void Matrix<ElemType>::Read(File& stream)
         LogicError("Read: Input file corrupt (invalid matrix type field 0x%02d, should be 'f' or 'd').", type);
 }
 
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::SkipRead(File& stream, size_t& numRows, size_t& numCols)
+{
+    char type;
+    stream >> type;
+    if (type != 'd')
+        LogicError("SkipRead: Only dense matrices can be skipped (matrix type field 0x%02d).", type);
+
+    // same layout as written by CPUMatrix and GPUMatrix
+    stream.GetMarker(fileMarkerBeginSection, std::wstring(L"BMAT"));
+    size_t elsize;
+    stream >> elsize;
+    if (sizeof(ElemType) != elsize)
+        RuntimeError("Template argument size doesn't match those in file");
+    std::wstring matrixName;
+    int format;
+    stream >> matrixName >> format >> numRows >> numCols;
+    stream.SetPosition(stream.GetPosition() + numRows * numCols * elsize);
+    stream.GetMarker(fileMarkerEndSection, std::wstring(L"EMAT"));
+}
+
 template <class ElemType>
 void Matrix<ElemType>::Write(File& stream) const
 {
@@ -1121,6 +1142,17 @@ Matrix<ElemType>& Matrix<ElemType>::DoScatterColumnsOf(ElemType beta, const Matr
 {
     DecideAndMoveToRightDevice(*this, idx, a); // TODO: only move target if beta != 0
 
+    // scattering dense columns into a sparse matrix yields a block-sparse matrix that only holds the columns written to
+    if (GetMatrixType() == SPARSE && a.GetMatrixType() == DENSE)
+    {
+        DISPATCH_MATRIX_ON_FLAG(this, this,
+            { NOT_IMPLEMENTED; },
+            { NOT_IMPLEMENTED; },
+            { m_CPUSparseMatrix->DoScatterColumnsOf(beta, *idx.m_CPUMatrix, *a.m_CPUMatrix, alpha); },
+            { NOT_IMPLEMENTED; });
+        return *this;
+    }
+
     DISPATCH_MATRIX_ON_FLAG(&a, this,
         { m_CPUMatrix->DoScatterColumnsOf(beta, *idx.m_CPUMatrix, *a.m_CPUMatrix, alpha); },
         { m_GPUMatrix->DoScatterColumnsOf(beta, *idx.m_GPUMatrix, *a.m_GPUMatrix, alpha); },
@@ -1666,7 +1698,12 @@ void Matrix<ElemType>::FSAdagradUpdate(size_t mbSize,
                                    targetAdagradAvDenom_x_sqrtAdagradSqrFrames, unitGainMomentum); 
             SetDataLocation(GPU); 
         },
-        { NOT_IMPLEMENTED; },
+        { 
+            gradients.m_CPUSparseMatrix->FSAdagrad(*m_CPUMatrix, *functionValues.m_CPUMatrix, 
+                                                   (ElemType)learnRatePerSample, (ElemType)meanMomentum, (ElemType)varMomentum, 
+                                                   targetAdagradAvDenom_x_sqrtAdagradSqrFrames, unitGainMomentum); 
+            SetDataLocation(CPU); 
+        },
         { gradients.m_GPUSparseMatrix->FSAdagrad(*m_GPUMatrix, *functionValues.m_GPUMatrix, (ElemType)learnRatePerSample, (ElemType)meanMomentum, (ElemType)varMomentum, targetAdagradAvDenom_x_sqrtAdagradSqrFrames, unitGainMomentum); SetDataLocation(GPU); });
 
     // Note: Since both 'this' and gradients are changed, we must call SetDataLocation() on 'this' as well.
@@ -4514,7 +4551,7 @@ void Matrix<ElemType>::RNNForward(const Matrix<ElemType> &inputX, const Matrix<E
 
     DISPATCH_MATRIX_ON_FLAG(this,
                             this,
-                            NOT_IMPLEMENTED,
+                            m_CPUMatrix->RNNForward(*(inputX.m_CPUMatrix), *(paramW.m_CPUMatrix), xDim, yDim, numSequencesForFrame, rnnAttributes, *(workspace.m_CPUMatrix)),
                             m_GPUMatrix->RNNForward(*(inputX.m_GPUMatrix), *(paramW.m_GPUMatrix), xDim, yDim, numSequencesForFrame, rnnAttributes, *(reserve.m_GPUMatrix), *(workspace.m_GPUMatrix)),
                             NOT_IMPLEMENTED,
                             NOT_IMPLEMENTED);
@@ -4529,7 +4566,7 @@ void Matrix<ElemType>::RNNBackwardData(const Matrix<ElemType>& outputDY, const M
     workspace._transferToDevice(GetDeviceId());
     DISPATCH_MATRIX_ON_FLAG(this,
                             this,
-                            NOT_IMPLEMENTED,
+                            RuntimeError("OptimizedRNNStack training on CPU is not yet implemented."),
                             m_GPUMatrix->RNNBackwardData(*(outputDY.m_GPUMatrix), *(paramW.m_GPUMatrix), *(outputDX.m_GPUMatrix), rnnAttributes, *(reserve.m_GPUMatrix), *(workspace.m_GPUMatrix)),
                             NOT_IMPLEMENTED,
                             NOT_IMPLEMENTED);
@@ -4544,7 +4581,7 @@ void Matrix<ElemType>::RNNBackwardWeights(const Matrix<ElemType>& inputX, const
     workspace._transferToDevice(GetDeviceId());
     DISPATCH_MATRIX_ON_FLAG(this,
                             this,
-                            NOT_IMPLEMENTED,
+                            RuntimeError("OptimizedRNNStack training on CPU is not yet implemented."),
                             m_GPUMatrix->RNNBackwardWeights(*(inputX.m_GPUMatrix), *(outputY.m_GPUMatrix), *(dw.m_GPUMatrix), rnnAttributes, *(reserve.m_GPUMatrix), *(workspace.m_GPUMatrix)),
                             NOT_IMPLEMENTED,
                             NOT_IMPLEMENTED);
@@ -4845,7 +4882,10 @@ template <class ElemType>
                     GPUSparseMatrix<ElemType>::ScaleAndAdd(alpha, *a.m_GPUSparseMatrix, *c.m_GPUMatrix);
                 c.SetDataLocation(GPU);
             },
-            { NOT_IMPLEMENTED; },
+            {
+                CPUSparseMatrix<ElemType>::ScaleAndAdd(alpha, *a.m_CPUMatrix, *c.m_CPUSparseMatrix);
+                c.SetDataLocation(CPU);
+            },
             {
                 c.m_GPUMatrix = make_shared<GPUMatrix<ElemType>>(c.m_GPUSparseMatrix->CopyToDenseMatrix());
                 GPUSparseMatrix<ElemType>::ScaleAndAdd(alpha, *a.m_GPUMatrix, 1, *c.m_GPUSparseMatrix, *c.m_GPUMatrix);
@@ -5683,6 +5723,28 @@ void Matrix<ElemType>::TensorOp(ElemType beta, const Matrix<ElemType>& a, const
                             NOT_IMPLEMENTED);
 }
 
+template <class ElemType>
+void Matrix<ElemType>::FusedTensorOp(ElemType beta, const ElementwiseOpChain& chain, const array<const Matrix<ElemType>*, ElementwiseOpChain::MaxNumInputs>& inputs, ElemType alpha,
+                                     const array<size_t, ElementwiseOpChain::MaxNumInputs + 1>& offsets,
+                                     const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, ElementwiseOpChain::MaxNumInputs + 1>& regularStrides)
+{
+    VerifyIsDense(*this);
+
+    // there is no GPU implementation; TensorView::DoChainOf() evaluates chains on the GPU op by op
+    if (GetCurrentMatrixLocation() != CPU)
+        LogicError("FusedTensorOp: Only implemented for matrices on the CPU.");
+    array<const CPUMatrix<ElemType>*, ElementwiseOpChain::MaxNumInputs> cpuInputs = {};
+    for (size_t i = 0; i < chain.GetNumInputs(); i++)
+    {
+        VerifyIsDense(*inputs[i]);
+        if (inputs[i]->GetCurrentMatrixLocation() != CPU)
+            LogicError("FusedTensorOp: Only implemented for matrices on the CPU.");
+        cpuInputs[i] = inputs[i]->m_CPUMatrix.get();
+    }
+
+    m_CPUMatrix->FusedTensorOp(beta, chain, cpuInputs, alpha, offsets, regularOpDims, regularStrides);
+}
+
 //template class Matrix<short>;
 template class Matrix<float>;
 template class Matrix<double>;
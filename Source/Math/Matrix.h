@@ -12,6 +12,7 @@
 #include "Basics.h"
 #include "File.h"
 #include "CommonMatrix.h"
+#include "ElementwiseOpChain.h"
 #include "TensorShape.h" // only for SmallVector; I was hoping to keep this out
 #include "RNGHandle.h"
 #include "DataTransferer.h"
@@ -594,10 +595,16 @@ public:
                   const std::array<size_t, 4>& offsets,
                   const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& regularStrides,
                   const SmallVector<size_t>& reducingOpDims, const std::array<SmallVector<ptrdiff_t>, 4>& reducingStrides);
+    // single-pass evaluation of an ElementwiseOpChain (CPU only); operand arrays are indexed by input, with the output last
+    void FusedTensorOp(ElemType beta, const ElementwiseOpChain& chain, const std::array<const Matrix<ElemType>*, ElementwiseOpChain::MaxNumInputs>& inputs, ElemType alpha,
+                       const std::array<size_t, ElementwiseOpChain::MaxNumInputs + 1>& offsets,
+                       const SmallVector<size_t>& regularOpDims, const std::array<SmallVector<ptrdiff_t>, ElementwiseOpChain::MaxNumInputs + 1>& regularStrides);
 
 public:
     void Read(File& stream);
     void Write(File& stream) const;
+    // skip over a dense matrix written by Write(), only reading its dimensions
+    static void SkipRead(File& stream, size_t& numRows, size_t& numCols);
 
     Matrix<ElemType>& Shift(const Matrix<ElemType>& a, int shift);
 
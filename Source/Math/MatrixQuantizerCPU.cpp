@@ -30,7 +30,9 @@ void MatrixQuantizerCPU<ElemType>::QuantizeAsync(const Matrix<ElemType>& inMatri
 #ifdef QUANTUSEPPL
     Concurrency::parallel_for((size_t) 0, us.cols(), [&](size_t j)
 #else
-    for (size_t j = 0; j < nCol; j++)
+    // the columns are quantized independently
+#pragma omp parallel for
+    for (long j = 0; j < (long) nCol; j++)
 #endif
     {
         auto& qcol = *(outQMatrix.GetQuantizedColumn(j));
@@ -87,7 +89,9 @@ void MatrixQuantizerCPU<ElemType>::UnquantizeAsync(QuantizedMatrix<ElemType>& in
 #ifdef QUANTUSEPPL
     Concurrency::parallel_for((size_t) 0, us.cols(), [&](size_t j)
 #else
-    for (size_t j = 0; j < nCol; j++)
+    // the columns are unquantized independently
+#pragma omp parallel for
+    for (long j = 0; j < (long) nCol; j++)
 #endif
     {
         const auto& qcol = *(inQMatrix.GetQuantizedColumn(j));
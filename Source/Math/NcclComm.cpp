@@ -74,7 +74,7 @@ NcclComm::~NcclComm()
         ncclCommDestroy(m_ncclComm);
 }
 
-bool NcclComm::IsSupported()
+bool NcclComm::IsSupported() const
 {
     return m_ncclComm != nullptr;
 }
@@ -110,7 +110,7 @@ NcclComm::NcclComm(int /*deviceId*/, const MPIWrapperPtr& /*mpi*/) { }
 
 NcclComm::~NcclComm() { }
 
-bool NcclComm::IsSupported()
+bool NcclComm::IsSupported() const
 {
     return false;
 }
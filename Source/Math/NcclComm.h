@@ -30,7 +30,7 @@ private:
 public:
     NcclComm(int deviceId, const MPIWrapperPtr& mpiComm);
     ~NcclComm();
-    bool IsSupported();
+    bool IsSupported() const;
     void Sync(); // waits for outstanding reductions to complete
 
     template <typename ElemType>
@@ -0,0 +1,143 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// QuantizedOperations.cpp -- integer product of QuantizedMultiplier
+//
+
+#include "stdafx.h"
+#include "QuantizedOperations.h"
+#include <omp.h>
+// The block multiplier is implemented with SSE/AVX2 intrinsics, which do not exist on ARM64 (see BlockHandlerSSE.cpp).
+#if !defined(__aarch64__)
+#include "BlockMultiplier.h"
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Product of a quantized A[m,k], rewritten ahead of time, with quantized matrices B[k,n] (all column-major).
+// Column-major C[m,n] is the row-major matrix C'[n,m] = B'[n,k] * A'[k,m], where B' and A' are the row-major views
+// of the column-major B and A. So A takes the place of the right-hand side of the block multiplier, which is the
+// one it rewrites into block order once (PrepareB()), and B is passed as is.
+class QuantizedBlockProduct
+{
+#if !defined(__aarch64__)
+#ifdef SUPPORT_AVX2
+    typedef BlockMultiplier<BlockHandlerAVX> MultiplierT;
+#else
+    typedef BlockMultiplier<BlockHandlerSSE> MultiplierT;
+#endif
+    MultiplierT m_multiplier;
+    short* m_preparedA;
+#else
+    vector<short> m_preparedA;
+#endif
+    int m_m;
+    int m_k;
+
+public:
+    QuantizedBlockProduct(int numThreads)
+#if !defined(__aarch64__)
+        : m_multiplier(numThreads), m_preparedA(nullptr), m_m(0), m_k(0)
+#else
+        : m_m(0), m_k(0)
+#endif
+    {
+        UNUSED(numThreads);
+    }
+
+    ~QuantizedBlockProduct()
+    {
+#if !defined(__aarch64__)
+        if (m_preparedA)
+            MultiplierT::FreeMatrix(m_preparedA);
+#endif
+    }
+
+    bool IsPrepared(int m, int k) const { return m_m == m && m_k == k; }
+
+    void PrepareA(short* A, int m, int k)
+    {
+#if !defined(__aarch64__)
+        if (m_preparedA)
+            MultiplierT::FreeMatrix(m_preparedA);
+        m_preparedA = m_multiplier.PrepareB(A, k, m);
+#else
+        m_preparedA.assign(A, A + m * k);
+#endif
+        m_m = m;
+        m_k = k;
+    }
+
+    // C = A * B; C must be zeroed
+    void Multiply(short* B, int n, int* C)
+    {
+#if !defined(__aarch64__)
+        m_multiplier.MultiplyMatrices(B, n, m_k, m_preparedA, m_m, C);
+#else
+        for (int j = 0; j < n; j++)
+            for (int l = 0; l < m_k; l++)
+                for (int i = 0; i < m_m; i++)
+                    C[i + j * m_m] += m_preparedA[i + l * m_m] * B[l + j * m_k];
+#endif
+    }
+};
+
+template <class ElemType>
+QuantizedMultiplier<ElemType>::QuantizedMultiplier(shared_ptr<QuantizerBase<ElemType, short>> pQuantizerA, bool isAConstant, shared_ptr<QuantizerBase<ElemType, short>> pQuantizerB, bool isBConstant) :
+    m_pQuantizerA(pQuantizerA), m_pQuantizerB(pQuantizerB), m_isAConstant(isAConstant), m_isBConstant(isBConstant), m_firstPass(true)
+{
+    if (isAConstant && isBConstant)
+        LogicError("Quantized multiplication is applied to two constant matrices -- it is highly inefficient. Better approach is to replace the operation with the resulting matrix.");
+}
+
+template <class ElemType>
+QuantizedMultiplier<ElemType>::~QuantizedMultiplier()
+{
+}
+
+template <class ElemType>
+void QuantizedMultiplier<ElemType>::Multiply(int m, int n, int k, ElemType* A, ElemType* B, ElemType* C)
+{
+    // created on first use, to pick up the number of threads set by CPUMatrix::SetNumThreads()
+    if (!m_blockProduct)
+        m_blockProduct.reset(new QuantizedBlockProduct(omp_get_max_threads()));
+
+    // Quantize
+    if (!m_isAConstant || m_firstPass || !m_blockProduct->IsPrepared(m, k))
+    {
+        m_pMatA.resize(m*k);
+        ArrayRef<short> refMatA(m_pMatA.data(), m_pMatA.size());
+        m_pQuantizerA->Quantize(ArrayRef<ElemType>(A, m_pMatA.size()), refMatA);
+        m_blockProduct->PrepareA(m_pMatA.data(), m, k);
+
+        // a constant A is only needed in block order from now on
+        if (m_isAConstant)
+            vector<short>().swap(m_pMatA);
+    }
+
+    if (!m_isBConstant || m_firstPass)
+    {
+        m_pMatB.resize(n*k);
+        ArrayRef<short> refMatB(m_pMatB.data(), m_pMatB.size());
+        m_pQuantizerB->Quantize(ArrayRef<ElemType>(B, m_pMatB.size()), refMatB);
+    }
+
+    m_firstPass = false;
+
+    // Do multiply
+    m_product.assign(m*n, 0);
+    m_blockProduct->Multiply(m_pMatB.data(), n, m_product.data());
+
+    // De-quantize
+    int mn = m*n;
+    for (int i = 0; i < mn; i++)
+        C[i] = (ElemType)m_product[i];
+    m_pQuantizerB->Dequantize(C, C, mn);
+    m_pQuantizerA->Dequantize(C, C, mn);
+}
+
+template class MATH_API QuantizedMultiplier<float>;
+template class MATH_API QuantizedMultiplier<double>;
+
+}}}
@@ -22,6 +22,7 @@
 #include "stdafx.h"
 #include "Basics.h"
 #include "TensorView.h"
+#include <algorithm>
 #include <array>
 
 #ifndef let
@@ -285,6 +286,119 @@ void TensorView<ElemType>::DoTernaryOpOf(ElemType beta, const TensorView& a, con
     GetSOB().TensorOp(beta, a.GetSOB(), b.GetSOB(), c.GetSOB(), alpha, op, reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
 }
 
+// -------------------------------------------------------------------
+// fused chain of elementwise operations
+// -------------------------------------------------------------------
+
+template <class ElemType>
+void TensorView<ElemType>::DoChainOf(ElemType beta, const ElementwiseOpChain& chain, const vector<TensorView>& inputs, ElemType alpha, shared_ptr<Matrix<ElemType>> workspace)
+{
+    const size_t numInputs = chain.GetNumInputs();
+    if (inputs.size() != numInputs)
+        InvalidArgument("DoChainOf: The chain expects %d inputs, but %d were given.", (int) numInputs, (int) inputs.size());
+
+    // only the CPU has a fused implementation
+    bool allOnCPU = GetSOB().GetDeviceId() == CPUDEVICE;
+    for (const auto& input : inputs)
+        allOnCPU &= input.GetSOB().GetDeviceId() == CPUDEVICE;
+    if (!allOnCPU)
+        return DoChainOpByOpOf(beta, chain, inputs, alpha, workspace);
+
+    // The operand layout is determined as for the other elementwise ops, with the output last.
+    // Unused input slots are filled with the output shape, which does not change the result.
+    const size_t N = ElementwiseOpChain::MaxNumInputs + 1;
+    array<TensorShape, N> shapes;
+    array<const Matrix<ElemType>*, ElementwiseOpChain::MaxNumInputs> sobs = {};
+    for (size_t i = 0; i < N - 1; i++)
+        shapes[i] = i < numInputs ? inputs[i].GetShape() : GetShape();
+    shapes[N - 1] = GetShape();
+    for (size_t i = 0; i < numInputs; i++)
+        sobs[i] = &inputs[i].GetSOB();
+
+    array<size_t, N> offsets;
+    array<SmallVector<ptrdiff_t>, N> regularStrides, reducingStrides;
+    SmallVector<size_t> regularOpDims, reducingOpDims;
+    PrepareTensorOperands<ElemType, N>(shapes, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    if (reducingOpDims.size() > 0)
+        InvalidArgument("DoChainOf: The output [%s] cannot be inverse-broadcasting.", string(GetShape()).c_str());
+
+    GetSOB().FusedTensorOp(beta, chain, sobs, alpha, offsets, regularOpDims, regularStrides);
+}
+
+// evaluate a chain as a sequence of individual tensor ops
+// Intermediate results have the output shape and are stored in the columns of 'workspace'. A column is reused
+// as soon as the result it holds has been read for the last time, so the workspace holds at most as many
+// columns as there are intermediate results alive at the same time.
+template <class ElemType>
+void TensorView<ElemType>::DoChainOpByOpOf(ElemType beta, const ElementwiseOpChain& chain, const vector<TensorView>& inputs, ElemType alpha, shared_ptr<Matrix<ElemType>> workspace)
+{
+    const auto& steps = chain.GetSteps();
+    if (steps.empty())
+        InvalidArgument("DoChainOf: The chain has no ops.");
+    const size_t numInputs = chain.GetNumInputs();
+
+    // last step that reads each intermediate result (its own step if it is never read)
+    vector<size_t> lastUse(steps.size());
+    for (size_t s = 0; s < steps.size(); s++)
+        lastUse[s] = s;
+    for (size_t s = 0; s < steps.size(); s++)
+        for (size_t i = 0; i < steps[s].arity; i++)
+            if (steps[s].args[i] >= numInputs)
+                lastUse[steps[s].args[i] - numInputs] = s;
+
+    // assign a workspace column to each intermediate result; the last one goes straight into the output
+    // Intermediate results have the output shape, so an op can write into the column of an input it reads for the last time.
+    vector<size_t> slots(steps.size(), SIZE_MAX);
+    vector<size_t> freeSlots;
+    size_t numSlots = 0;
+    for (size_t s = 0; s + 1 < steps.size(); s++)
+    {
+        for (size_t i = 0; i < steps[s].arity; i++)
+        {
+            const size_t arg = steps[s].args[i];
+            if (arg >= numInputs && lastUse[arg - numInputs] == s && find(freeSlots.begin(), freeSlots.end(), slots[arg - numInputs]) == freeSlots.end())
+                freeSlots.push_back(slots[arg - numInputs]);
+        }
+        if (freeSlots.empty())
+            freeSlots.push_back(numSlots++);
+        slots[s] = freeSlots.back();
+        if (lastUse[s] != s) // a result that is never read leaves its column free
+            freeSlots.pop_back();
+    }
+
+    const DEVICEID_TYPE deviceId = GetSOB().GetDeviceId();
+    const size_t numElements = GetShape().GetNumElements();
+    vector<TensorView> columns;
+    if (numSlots > 0)
+    {
+        if (!workspace)
+            workspace = make_shared<Matrix<ElemType>>(deviceId);
+        else if (workspace->GetDeviceId() != deviceId)
+            InvalidArgument("DoChainOf: The workspace is on device %d, but the output is on device %d.", (int) workspace->GetDeviceId(), (int) deviceId);
+        workspace->Resize(numElements, numSlots);
+        for (size_t k = 0; k < numSlots; k++)
+            columns.push_back(TensorView(make_shared<Matrix<ElemType>>(workspace->ColumnSlice(k, 1)), TensorShape(GetShape().GetDims())));
+    }
+
+    vector<TensorView> operands(inputs);
+    for (size_t s = 0; s < steps.size(); s++)
+    {
+        const auto& step = steps[s];
+        const bool isLast = s + 1 == steps.size();
+        TensorView result = isLast ? *this : columns[slots[s]];
+        const ElemType stepBeta  = isLast ? beta  : 0;
+        const ElemType stepAlpha = isLast ? alpha : 1;
+        switch (step.arity)
+        {
+        case 1: result.DoUnaryOpOf(stepBeta, operands[step.args[0]], stepAlpha, step.op, ElementWiseOperator::opSum); break;
+        case 2: result.DoBinaryOpOf(stepBeta, operands[step.args[0]], operands[step.args[1]], stepAlpha, step.op, ElementWiseOperator::opSum); break;
+        case 3: result.DoTernaryOpOf(stepBeta, operands[step.args[0]], operands[step.args[1]], operands[step.args[2]], stepAlpha, step.op, ElementWiseOperator::opSum); break;
+        default: LogicError("DoChainOf: Invalid op arity %d.", (int) step.arity);
+        }
+        operands.push_back(result);
+    }
+}
+
 // -------------------------------------------------------------------
 // matrix product -- GEMM for flattened tensors
 // -------------------------------------------------------------------
@@ -134,6 +134,19 @@ public:
     void DoBinaryOpOf (ElemType beta, const TensorView& a, const TensorView& b,                      ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp);
     void DoTernaryOpOf(ElemType beta, const TensorView& a, const TensorView& b, const TensorView& c, ElemType alpha, ElementWiseOperator op, ElementWiseOperator reductionOp);
 
+    // -------------------------------------------------------------------
+    // fused chain of elementwise operations (see ElementwiseOpChain.h)
+    // c.DoChainOf(beta, chain, { a, b, ... }, alpha) means c := beta * c + alpha * chain(a, b, ...).
+    // On the CPU, the chain is evaluated in a single pass over memory. On the GPU, it is evaluated op by op.
+    // Inputs broadcast as for the other elementwise operations, but the output cannot be inverse-broadcasting.
+    // The op-by-op evaluation keeps its intermediate results in 'workspace', which is resized as needed and can
+    // be kept across calls, e.g. a node's temp matrix from the matrix pool. If none is given, one is allocated per call.
+    // -------------------------------------------------------------------
+
+    void DoChainOf(ElemType beta, const ElementwiseOpChain& chain, const std::vector<TensorView>& inputs, ElemType alpha, shared_ptr<Matrix<ElemType>> workspace = nullptr);
+    void AssignChainOf(const ElementwiseOpChain& chain, const std::vector<TensorView>& inputs, ElemType alpha = 1.0f, shared_ptr<Matrix<ElemType>> workspace = nullptr) { DoChainOf(0, chain, inputs, alpha, workspace); }
+    void AddChainOf   (const ElementwiseOpChain& chain, const std::vector<TensorView>& inputs, ElemType alpha = 1.0f, shared_ptr<Matrix<ElemType>> workspace = nullptr) { DoChainOf(1.0f, chain, inputs, alpha, workspace); }
+
     // -------------------------------------------------------------------
     // matrix product -- GEMM for flattened tensors
     // Result goes into 'this', and can optionally be added to the existing value.
@@ -160,6 +173,8 @@ public:
     friend Test::TensorTest<ElemType>;
 
 private:
+    void DoChainOpByOpOf(ElemType beta, const ElementwiseOpChain& chain, const std::vector<TensorView>& inputs, ElemType alpha, shared_ptr<Matrix<ElemType>> workspace);
+
     // -------------------------------------------------------------------
     // sob members
     // -------------------------------------------------------------------
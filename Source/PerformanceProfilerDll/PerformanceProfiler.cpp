@@ -17,8 +17,12 @@
 #include "fileutil.h"
 #include "TimerUtility.h"
 #include <algorithm>
+#include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <stdio.h>
 #ifndef CPUONLY
 #include <cuda_runtime_api.h>
@@ -28,6 +32,7 @@
 #include <Windows.h>
 #else
 #include <sys/syscall.h>
+#include <unistd.h>
 #endif 
 
 
@@ -92,6 +97,53 @@ struct CustomEventRecord
 };
 
 
+//
+// Trace spans are recorded into fixed-size blocks. Each thread fills its own block and only takes the
+// global lock when it needs a new one. A thread that exits hands its partially filled block back, so
+// that short-lived threads (e.g. from std::async) do not use up a block each.
+//
+struct TraceEventRecord
+{
+    long long       beginClock;
+    long long       endClock;
+    unsigned int    threadId;
+    int             nameId;
+    int             category;
+};
+
+struct TraceEventBlock
+{
+    static const size_t     c_capacity = 1024;
+    TraceEventRecord        events[c_capacity];
+    std::atomic<size_t>     numEvents;   // written by the owning thread only, after the event is complete
+
+    TraceEventBlock() : numEvents(0) {}
+};
+
+//
+// The trace blocks of one ProfilerInit()/ProfilerClose() session. Threads that record into a block hold a
+// reference to the buffer, so that a concurrent ProfilerClose() or ProfilerInit() cannot free the block
+// while it is written.
+//
+struct TraceBuffer
+{
+    std::atomic<bool>                       full;        // Have all trace blocks been allocated?
+    size_t                                  maxBlocks;   // Number of trace blocks that fit into the trace buffer budget
+    std::vector<unique_ptr<TraceEventBlock>> blocks;     // All trace blocks allocated so far
+    std::vector<TraceEventBlock*>           freeBlocks;  // Partially filled blocks of threads that exited
+
+    TraceBuffer(size_t maxBlocks) : full(false), maxBlocks(maxBlocks) {}
+};
+
+static const char* const c_traceCategoryNames[profilerTraceMax] = {
+    "forward",                                                      // profilerTraceForward
+    "backward",                                                     // profilerTraceBackward
+    "reader",                                                       // profilerTraceReader
+    "aggregation",                                                  // profilerTraceAggregation
+    "custom",                                                       // profilerTraceCustom
+};
+
+
 //
 // Global state of the profiler
 //
@@ -107,6 +159,9 @@ struct ProfilerState
     unsigned long long      customEventBufferBytes;      // Number of bytes allocated for the custom event buffer
     unsigned long long      customEventOffset;           // Offset to current place in buffer
     unique_ptr<char[]>      customEventBuffer;           // Pointer to custom event buffer
+    bool                    traceEnabled;                // Record trace spans
+    std::shared_ptr<TraceBuffer> traceBuffer;            // Trace blocks, also referenced by the recording threads
+    std::map<unsigned int, std::string> traceThreadNames; // Thread names for the Chrome trace
 };
 
 
@@ -116,6 +171,35 @@ static unique_ptr<ProfilerState> g_profilerState;
 // Mutex controlling access to g_profilerState
 static std::mutex g_mutex;
 
+// Incremented by every ProfilerInit() and ProfilerClose(), to invalidate the trace blocks held by threads
+static std::atomic<unsigned int> g_profilerGeneration(0);
+
+// Whether trace spans are recorded. Checked without the lock, so recording threads do not touch g_profilerState.
+static std::atomic<bool> g_traceActive(false);
+
+// Trace span names, registered once per process. Ids stay valid across ProfilerInit() calls.
+static std::mutex g_traceNameMutex;
+static std::vector<std::string> g_traceNames;
+static std::unordered_map<std::string, int> g_traceNameIds;
+
+//
+// Per-thread trace state: the block the thread currently records into, and its cache of name ids.
+//
+struct ThreadTraceState
+{
+    std::shared_ptr<TraceBuffer>            buffer;      // Keeps the block alive
+    TraceEventBlock*                        block;
+    unsigned int                            generation;
+    unsigned int                            threadId;
+    std::unordered_map<const char*, int>    nameIds;
+    std::unordered_map<std::wstring, int>   wideNameIds;
+
+    ThreadTraceState() : block(nullptr), generation(0), threadId(0) {}
+    ~ThreadTraceState();
+};
+
+static thread_local ThreadTraceState t_traceState;
+
 // Forward declarations
 unsigned int GetThreadId();
 
@@ -124,6 +208,7 @@ void FormatTimeStr(char* str, size_t strLen, double value);
 void FormatThroughputStr(char* str, size_t strLen, double value);
 void FormatBytesStr(char* str, size_t strLen, long long bytes);
 void ProfilerGenerateDetailFile(const std::wstring& fileName);
+void ProfilerGenerateTraceFile(const std::wstring& fileName);
 
 
 double TicksToSeconds(long long ticks)
@@ -145,31 +230,41 @@ double TicksSqToSecondsSq(double ticksSq)
 // customEventBufferBytes: Size of the custom event buffer.
 // logSuffix: Suffix string to append to log file names.
 // syncGpu: Wait for GPU to complete processing for each profiling event with syncGpu flag set.
+// traceEnabled: Record trace spans and export them as a Chrome trace.
+// traceBufferBytes: Maximum number of bytes to allocate for trace spans, over all threads.
 //
 void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes,
-    const std::wstring& logSuffix, const bool syncGpu)
+    const std::wstring& logSuffix, const bool syncGpu, const bool traceEnabled, const unsigned long long traceBufferBytes)
 {
-    if (g_profilerState != nullptr)
-    {
-        RuntimeError("Error: ProfilerInit: Profiler already initialized.\n");
-    }
-    g_profilerState.reset(new ProfilerState());
+    // Set up the new state before publishing it, so that threads acquiring trace blocks never see it half initialized
+    unique_ptr<ProfilerState> profilerState(new ProfilerState());
 
-    g_profilerState->profilerDir = profilerDir;
-    g_profilerState->logSuffix = logSuffix;
+    profilerState->profilerDir = profilerDir;
+    profilerState->logSuffix = logSuffix;
 
-    g_profilerState->customEventBufferFull = false;
-    g_profilerState->customEventBufferBytes = customEventBufferBytes;
-    g_profilerState->customEventOffset = 0ull;
-    g_profilerState->customEventBuffer.reset(new char[customEventBufferBytes]);
+    profilerState->customEventBufferFull = false;
+    profilerState->customEventBufferBytes = customEventBufferBytes;
+    profilerState->customEventOffset = 0ull;
+    profilerState->customEventBuffer.reset(new char[customEventBufferBytes]);
 
-    g_profilerState->syncGpu = syncGpu;
-    g_profilerState->enabled = false;
+    profilerState->traceEnabled = traceEnabled;
+    profilerState->traceBuffer = std::make_shared<TraceBuffer>((size_t)(traceBufferBytes / sizeof(TraceEventBlock)));
+
+    profilerState->syncGpu = syncGpu;
+    profilerState->enabled = false;
+
+    if (_wmkdir(profilerState->profilerDir.c_str()) == -1 && errno != EEXIST)
+    {
+        RuntimeError("Error: ProfilerInit: Cannot create directory <%ls>.\n", profilerState->profilerDir.c_str());
+    }
 
-    if (_wmkdir(g_profilerState->profilerDir.c_str()) == -1 && errno != EEXIST)
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_profilerState != nullptr)
     {
-        RuntimeError("Error: ProfilerInit: Cannot create directory <%ls>.\n", g_profilerState->profilerDir.c_str());
+        RuntimeError("Error: ProfilerInit: Profiler already initialized.\n");
     }
+    g_profilerState = std::move(profilerState);
+    g_profilerGeneration++;
 }
 
 //
@@ -184,6 +279,7 @@ void PERF_PROFILER_API ProfilerEnable(bool enable)
         return;
 
     g_profilerState->enabled = enable;
+    g_traceActive = enable && g_profilerState->traceEnabled;
 }
 
 
@@ -242,6 +338,105 @@ void ProfilerTimeRecordToBuffer(const char* eventDescription, const long long be
 }
 
 
+//
+// Internal helper functions to record trace spans.
+//
+int ProfilerTraceRegisterName(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(g_traceNameMutex);
+
+    auto iter = g_traceNameIds.find(name);
+    if (iter != g_traceNameIds.end())
+        return iter->second;
+
+    int nameId = (int)g_traceNames.size();
+    g_traceNames.push_back(name);
+    g_traceNameIds[name] = nameId;
+    return nameId;
+}
+
+unsigned int ProfilerTraceThreadId(ThreadTraceState& traceState)
+{
+    if (traceState.threadId == 0)
+        traceState.threadId = GetThreadId();
+    return traceState.threadId;
+}
+
+// Get a block with free space for the calling thread, or nullptr if the trace buffer budget is used up.
+// Also makes the thread reference the trace buffer of the current session.
+TraceEventBlock* ProfilerTraceAcquireBlock(ThreadTraceState& traceState)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    traceState.generation = g_profilerGeneration;
+    traceState.buffer = g_profilerState != nullptr ? g_profilerState->traceBuffer : nullptr;
+    if (traceState.buffer == nullptr)
+        return nullptr;
+
+    TraceBuffer& buffer = *traceState.buffer;
+    while (!buffer.freeBlocks.empty())
+    {
+        TraceEventBlock* block = buffer.freeBlocks.back();
+        buffer.freeBlocks.pop_back();
+        if (block->numEvents < TraceEventBlock::c_capacity)
+            return block;
+    }
+
+    if (buffer.blocks.size() >= buffer.maxBlocks)
+    {
+        if (!buffer.full)
+        {
+            fprintf(stderr, "Warning: Performance Profiler: Trace buffer is full, no more trace spans will be recorded.\n");
+            buffer.full = true;
+        }
+        return nullptr;
+    }
+
+    buffer.blocks.emplace_back(new TraceEventBlock());
+    return buffer.blocks.back().get();
+}
+
+void ProfilerTraceRecord(ThreadTraceState& traceState, const long long beginClock, const long long endClock, const int nameId, const ProfilerTraceCategory category)
+{
+    // After a ProfilerInit() or ProfilerClose() the thread switches to the current buffer. Until then it
+    // writes into its old block, which its reference keeps alive, and the span is simply not exported.
+    if (traceState.generation != g_profilerGeneration)
+    {
+        traceState.block = nullptr;
+        traceState.buffer.reset();
+    }
+
+    if (traceState.block == nullptr || traceState.block->numEvents.load(std::memory_order_relaxed) == TraceEventBlock::c_capacity)
+    {
+        traceState.block = (traceState.buffer != nullptr && traceState.buffer->full) ? nullptr : ProfilerTraceAcquireBlock(traceState);
+        if (traceState.block == nullptr)
+            return;
+    }
+
+    size_t index = traceState.block->numEvents.load(std::memory_order_relaxed);
+    TraceEventRecord& eventRecord = traceState.block->events[index];
+    eventRecord.beginClock = beginClock;
+    eventRecord.endClock = endClock;
+    eventRecord.threadId = ProfilerTraceThreadId(traceState);
+    eventRecord.nameId = nameId;
+    eventRecord.category = (int)category;
+
+    // Publish the record to ProfilerGenerateTraceFile()
+    traceState.block->numEvents.store(index + 1, std::memory_order_release);
+}
+
+ThreadTraceState::~ThreadTraceState()
+{
+    if (block == nullptr)
+        return;
+
+    // Hand the block back for use by other threads
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_profilerState != nullptr && g_profilerState->traceBuffer == buffer)
+        buffer->freeBlocks.push_back(block);
+}
+
+
 //
 // Measure either a fixed or custom event time.
 // ProfilerTimeBegin() returns a stateId that is passed to ProfilerTimeEnd().
@@ -342,6 +537,65 @@ void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int
 }
 
 
+//
+// Record a trace span.
+// ProfilerTraceBegin() returns a stateId that is passed to ProfilerTraceEnd(), or 0 if tracing is off.
+//
+bool PERF_PROFILER_API ProfilerTraceEnabled()
+{
+    return g_traceActive;
+}
+
+
+long long PERF_PROFILER_API ProfilerTraceBegin()
+{
+    return ProfilerTraceEnabled() ? Clock::GetTimeStamp() : 0;
+}
+
+
+void PERF_PROFILER_API ProfilerTraceEnd(const long long stateId, const char* name, const ProfilerTraceCategory category)
+{
+    if (stateId == 0 || !ProfilerTraceEnabled())
+        return;
+
+    long long endClock = Clock::GetTimeStamp();
+    ThreadTraceState& traceState = t_traceState;
+    auto nameId = traceState.nameIds.find(name);
+    if (nameId == traceState.nameIds.end())
+        nameId = traceState.nameIds.insert(std::make_pair(name, ProfilerTraceRegisterName(name))).first;
+    ProfilerTraceRecord(traceState, stateId, endClock, nameId->second, category);
+}
+
+
+void PERF_PROFILER_API ProfilerTraceEnd(const long long stateId, const std::wstring& name, const ProfilerTraceCategory category)
+{
+    if (stateId == 0 || !ProfilerTraceEnabled())
+        return;
+
+    long long endClock = Clock::GetTimeStamp();
+    ThreadTraceState& traceState = t_traceState;
+    auto nameId = traceState.wideNameIds.find(name);
+    if (nameId == traceState.wideNameIds.end())
+        nameId = traceState.wideNameIds.insert(std::make_pair(name, ProfilerTraceRegisterName(msra::strfun::utf8(name)))).first;
+    ProfilerTraceRecord(traceState, stateId, endClock, nameId->second, category);
+}
+
+
+//
+// Name the calling thread in the Chrome trace.
+//
+void PERF_PROFILER_API ProfilerTraceSetThreadName(const char* name)
+{
+    if (!ProfilerTraceEnabled())
+        return;
+
+    unsigned int threadId = ProfilerTraceThreadId(t_traceState);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_profilerState != nullptr)
+        g_profilerState->traceThreadNames[threadId] = name;
+}
+
+
 //
 // Generate reports and release all resources.
 //
@@ -351,6 +605,8 @@ void PERF_PROFILER_API ProfilerClose()
     if (g_profilerState == nullptr)
         return;
 
+    g_traceActive = false;
+
     // Get current time as yyyy-mm-dd_hh-mm-ss
     time_t currentTime;
     time(&currentTime);
@@ -366,6 +622,15 @@ void PERF_PROFILER_API ProfilerClose()
     fileName = g_profilerState->profilerDir + L"/" + std::wstring(timeStr) + L"_detail_" + g_profilerState->logSuffix + L".csv";
     ProfilerGenerateDetailFile(fileName);
 
+    // Generate Chrome trace file
+    if (g_profilerState->traceEnabled)
+    {
+        fileName = g_profilerState->profilerDir + L"/" + std::wstring(timeStr) + L"_trace_" + g_profilerState->logSuffix + L".json";
+        ProfilerGenerateTraceFile(fileName);
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_profilerGeneration++;
     g_profilerState.reset();
 }
 
@@ -555,13 +820,126 @@ void ProfilerGenerateDetailFile(const std::wstring& fileName)
 }
 
 
+//
+// Escape a string for use in a JSON string literal.
+//
+std::string JsonEscape(const char* str)
+{
+    std::string escaped;
+    for (const char* p = str; *p; p++)
+    {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += (char)c;
+        }
+        else if (c < 0x20)
+        {
+            char code[8];
+            sprintf_s(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else
+            escaped += (char)c;
+    }
+    return escaped;
+}
+
+void WriteTraceEvent(FILE* f, const char*& separator, const char* name, const char* category, unsigned int processId, unsigned int threadId,
+    long long beginClock, long long endClock)
+{
+    // Chrome trace time stamps are in microseconds
+    fprintfOrDie(f, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+        separator, JsonEscape(name).c_str(), category, processId, threadId,
+        1000000.0 * TicksToSeconds(beginClock), 1000000.0 * TicksToSeconds(endClock - beginClock));
+    separator = ",\n";
+}
+
+//
+// Generate Chrome trace file (see the Trace Event Format specification), with the events of the
+// detail file and all trace spans.
+//
+void ProfilerGenerateTraceFile(const std::wstring& fileName)
+{
+    FILE* f = _wfopen(fileName.c_str(), L"wt");
+    if (f == NULL)
+    {
+        RuntimeError("Error: ProfilerGenerateTraceFile: Cannot create file <%ls>.\n", fileName.c_str());
+    }
+
+#ifdef _WIN32
+    unsigned int processId = (unsigned int)GetCurrentProcessId();
+#else
+    unsigned int processId = (unsigned int)getpid();
+#endif
+
+    fprintfOrDie(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    const char* separator = "";
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        for (const auto& threadName : g_profilerState->traceThreadNames)
+        {
+            fprintfOrDie(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                separator, processId, threadName.first, JsonEscape(threadName.second.c_str()).c_str());
+            separator = ",\n";
+        }
+    }
+
+    // Events of the detail file; leading underscores only indent the summary report
+    char* eventPtr = g_profilerState->customEventBuffer.get();
+    while (eventPtr < (g_profilerState->customEventBuffer.get() + g_profilerState->customEventOffset))
+    {
+        char* descriptionStr = eventPtr;
+        eventPtr += strlen(descriptionStr) + 1;
+
+        CustomEventRecord* eventRecord = (CustomEventRecord*)eventPtr;
+        eventPtr += sizeof(CustomEventRecord);
+
+        while (*descriptionStr == '_')
+            descriptionStr++;
+        WriteTraceEvent(f, separator, descriptionStr, "profiler", processId, eventRecord->threadId, eventRecord->beginClock, eventRecord->endClock);
+    }
+
+    // Trace spans. Threads may still be recording; only complete records are counted in numEvents.
+    std::vector<std::string> traceNames;
+    {
+        std::lock_guard<std::mutex> lock(g_traceNameMutex);
+        traceNames = g_traceNames;
+    }
+    std::vector<TraceEventBlock*> traceBlocks;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        for (const auto& block : g_profilerState->traceBuffer->blocks)
+            traceBlocks.push_back(block.get());
+    }
+    for (const auto block : traceBlocks)
+    {
+        size_t numEvents = block->numEvents.load(std::memory_order_acquire);
+        for (size_t i = 0; i < numEvents; i++)
+        {
+            const TraceEventRecord& eventRecord = block->events[i];
+            if (eventRecord.nameId >= (int)traceNames.size())
+                continue; // registered after we took the snapshot
+            WriteTraceEvent(f, separator, traceNames[eventRecord.nameId].c_str(), c_traceCategoryNames[eventRecord.category],
+                processId, eventRecord.threadId, eventRecord.beginClock, eventRecord.endClock);
+        }
+    }
+
+    fprintfOrDie(f, "\n]}\n");
+    fclose(f);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Scoped helpers.
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void ProfilerContext::Init(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes, const std::wstring& logSuffix, const bool syncGpu)
+void ProfilerContext::Init(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes, const std::wstring& logSuffix, const bool syncGpu,
+                           const bool traceEnabled, const unsigned long long traceBufferBytes)
 {
-    ProfilerInit(profilerDir, customEventBufferBytes, logSuffix, syncGpu);
+    ProfilerInit(profilerDir, customEventBufferBytes, logSuffix, syncGpu, traceEnabled, traceBufferBytes);
 }
 
 ProfilerContext::~ProfilerContext()
@@ -596,6 +974,35 @@ ScopeProfile::~ScopeProfile()
 }
 
 
+ScopeTrace::ScopeTrace(const char* name, ProfilerTraceCategory category)
+{
+    m_name = name;
+    m_wideName = nullptr;
+    m_category = category;
+    m_stateId = ProfilerTraceBegin();
+}
+
+ScopeTrace::ScopeTrace(const std::wstring& name, ProfilerTraceCategory category)
+{
+    m_name = nullptr;
+    m_wideName = &name;
+    m_category = category;
+    m_stateId = ProfilerTraceBegin();
+}
+
+ScopeTrace::~ScopeTrace()
+{
+    if (m_name)
+    {
+        ProfilerTraceEnd(m_stateId, m_name, m_category);
+    }
+    else
+    {
+        ProfilerTraceEnd(m_stateId, *m_wideName, m_category);
+    }
+}
+
+
 ScopeThroughput::ScopeThroughput(int eventId, long long bytes)
 {
     m_bytes = bytes;
@@ -26,6 +26,15 @@
 // and ProfilerThroughputBegin() calls should be used. The throughput APIs can only be used
 // with fixed events.
 //
+// Hierarchical tracing
+//
+// When tracing is enabled in ProfilerInit(), spans recorded with ProfilerTraceBegin()/ProfilerTraceEnd()
+// or the scoped object ScopeTrace are appended to per-thread event blocks without taking a lock (a lock is
+// only taken when a thread needs a new block). Spans on the same thread nest, so the forward and backward
+// pass of every node shows up inside the minibatch, and reader and gradient aggregation spans show up on
+// their own threads. In ProfilerClose(), the spans and all events of the detail log are exported as a
+// Chrome trace JSON file (load it in chrome://tracing).
+//
 // CNTK specifics
 //
 // The profiler is turned off during the very first epoch to avoid polluting profile data with
@@ -78,15 +87,32 @@ enum ProfilerEvents
 };
 
 
+//
+// Categories of trace spans. These appear as the "cat" field in the Chrome trace.
+//
+enum ProfilerTraceCategory
+{
+    profilerTraceForward = 0,               // ForwardProp() of a node
+    profilerTraceBackward,                  // Backprop() of a node
+    profilerTraceReader,                    // Data reader
+    profilerTraceAggregation,               // Gradient aggregation
+    profilerTraceCustom,                    // Anything else
+
+    profilerTraceMax
+};
+
+
 //
 // Initialize all resources to enable profiling.
 // profilerDir: Directory where the profiler logs will be saved.
 // customEventBufferBytes: Bytes to allocate for the custom event buffer.
 // logSuffix: Suffix string to append to log files.
 // syncGpu: Wait for GPU to complete processing for each profiling event.
+// traceEnabled: Record trace spans and export them as a Chrome trace.
+// traceBufferBytes: Maximum number of bytes to allocate for trace spans, over all threads.
 //
 void PERF_PROFILER_API ProfilerInit(const std::wstring& profilerDir, const unsigned long long customEventBufferBytes,
-    const std::wstring& logSuffix, const bool syncGpu);
+    const std::wstring& logSuffix, const bool syncGpu, const bool traceEnabled, const unsigned long long traceBufferBytes);
 
 
 //
@@ -122,6 +148,24 @@ long long PERF_PROFILER_API ProfilerThroughputBegin();
 void PERF_PROFILER_API ProfilerThroughputEnd(const long long stateId, const int eventId, const long long bytes);
 
 
+//
+// Record a trace span.
+// ProfilerTraceBegin() returns a stateId that is passed to ProfilerTraceEnd(), or 0 if tracing is off.
+// Spans are identified by their name; names are registered once per thread, so that recording a span
+// only copies two time stamps and a few ids into a per-thread buffer. Narrow names are looked up by
+// address, so they must be string literals (or otherwise never change).
+//
+bool PERF_PROFILER_API ProfilerTraceEnabled();
+long long PERF_PROFILER_API ProfilerTraceBegin();
+void PERF_PROFILER_API ProfilerTraceEnd(const long long stateId, const char* name, const ProfilerTraceCategory category);
+void PERF_PROFILER_API ProfilerTraceEnd(const long long stateId, const std::wstring& name, const ProfilerTraceCategory category);
+
+//
+// Name the calling thread in the Chrome trace. Has no effect if tracing is off.
+//
+void PERF_PROFILER_API ProfilerTraceSetThreadName(const char* name);
+
+
 //
 // Generate reports and release all resources.
 //
@@ -133,7 +177,8 @@ void PERF_PROFILER_API ProfilerClose();
 //
 struct PERF_PROFILER_API ProfilerContext
 {
-    void Init(const std::wstring& profilerDir = L"", const unsigned long long customEventBufferBytes = (32 * 1024 * 1024), const std::wstring& logSuffix = L"", const bool syncGpu = false);
+    void Init(const std::wstring& profilerDir = L"", const unsigned long long customEventBufferBytes = (32 * 1024 * 1024), const std::wstring& logSuffix = L"", const bool syncGpu = false,
+              const bool traceEnabled = false, const unsigned long long traceBufferBytes = (256 * 1024 * 1024));
     ~ProfilerContext();
 };
 
@@ -174,4 +219,26 @@ private:
 
 #define THROUGHPUT_SCOPE(eventId, bytes)    ScopeThroughput __st##eventId(eventId, bytes);
 
+
+//
+// Scoped trace span. The name must stay valid for the lifetime of the object.
+//
+struct PERF_PROFILER_API ScopeTrace
+{
+    ScopeTrace(const char* name, ProfilerTraceCategory category);
+    ScopeTrace(const std::wstring& name, ProfilerTraceCategory category);
+    ~ScopeTrace();
+
+private:
+    long long               m_stateId;
+    const char*             m_name;
+    const std::wstring*     m_wideName;
+    ProfilerTraceCategory   m_category;
+};
+
+// The variable is named after the line, so that several spans can be opened in one block.
+#define TRACE_SCOPE_NAME2(line)             __ts##line
+#define TRACE_SCOPE_NAME(line)              TRACE_SCOPE_NAME2(line)
+#define TRACE_SCOPE(name, category)         ScopeTrace TRACE_SCOPE_NAME(__LINE__)(name, category);
+
 }}}
@@ -55,6 +55,7 @@ BinaryChunkDeserializer::BinaryChunkDeserializer(const BinaryConfigHelper& helpe
     BinaryChunkDeserializer(helper.GetFilePath())
 {
     SetTraceLevel(helper.GetTraceLevel());
+    m_useMemoryMapping = helper.ShouldUseMemoryMapping();
 
     Initialize(helper.GetRename());
 }
@@ -63,6 +64,7 @@ BinaryChunkDeserializer::BinaryChunkDeserializer(const BinaryConfigHelper& helpe
 BinaryChunkDeserializer::BinaryChunkDeserializer(const std::wstring& filename) : 
     m_filename(filename),
     m_file(nullptr),
+    m_useMemoryMapping(false),
     m_offsetStart(0),
     m_dataStart(0),
     m_traceLevel(0)
@@ -150,6 +152,13 @@ void BinaryChunkDeserializer::Initialize(const std::map<std::wstring, std::wstri
     // Note it's possible in distributed reading mode to only want to read
     // a subset of the offsets table.
     ReadOffsetsTable(m_file);
+
+    if (m_useMemoryMapping)
+    {
+        m_mappedFile = make_shared<MemoryMappedFile>(m_filename);
+        if (m_mappedFile->Size() < (size_t)(m_dataStart + m_offsetsTable->GetOffset(m_numChunks)))
+            RuntimeError("The file '%ls' is shorter than its offsets table says.", m_filename.c_str());
+    }
 }
 
 ChunkDescriptions BinaryChunkDeserializer::GetChunkDescriptions()
@@ -210,8 +219,16 @@ void BinaryChunkDeserializer::GetSequencesForChunk(ChunkIdType chunkId, std::vec
     }
 }
 
-unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
+shared_ptr<const byte> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
 {
+    if (m_mappedFile)
+    {
+        // A view into the mapping, which the returned pointer keeps alive.
+        size_t offset = m_dataStart + m_offsetsTable->GetOffset(chunkId);
+        m_mappedFile->WillNeed(offset, m_offsetsTable->GetChunkSize(chunkId));
+        return shared_ptr<const byte>(m_mappedFile, (const byte*)m_mappedFile->Data() + offset);
+    }
+
     // Seek to the start of the chunk
     CNTKBinaryFileHelper::seekOrDie(m_file, m_dataStart + m_offsetsTable->GetOffset(chunkId), SEEK_SET);
 
@@ -219,7 +236,7 @@ unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
     size_t chunkSize = m_offsetsTable->GetChunkSize(chunkId);
     
     // Create buffer
-    unique_ptr<byte[]> buffer(new byte[chunkSize]);
+    shared_ptr<byte> buffer(new byte[chunkSize], std::default_delete<byte[]>());
 
     // Read the chunk from disk
     CNTKBinaryFileHelper::readOrDie(buffer.get(), sizeof(byte), chunkSize, m_file);
@@ -231,9 +248,9 @@ unique_ptr<byte[]> BinaryChunkDeserializer::ReadChunk(ChunkIdType chunkId)
 ChunkPtr BinaryChunkDeserializer::GetChunk(ChunkIdType chunkId)
 {
     // Read the chunk into memory
-    unique_ptr<byte[]> chunkBuffer = ReadChunk(chunkId);
+    shared_ptr<const byte> chunkBuffer = ReadChunk(chunkId);
 
-    return make_shared<BinaryDataChunk>(chunkId, m_offsetsTable->GetStartIndex(chunkId), m_offsetsTable->GetNumSequences(chunkId), std::move(chunkBuffer), m_deserializers);
+    return make_shared<BinaryDataChunk>(chunkId, m_offsetsTable->GetStartIndex(chunkId), m_offsetsTable->GetNumSequences(chunkId), chunkBuffer, m_offsetsTable->GetChunkSize(chunkId), m_deserializers);
 }
 
 void BinaryChunkDeserializer::SetTraceLevel(unsigned int traceLevel)
@@ -10,6 +10,7 @@
 #include "CorpusDescriptor.h"
 #include "BinaryDataChunk.h"
 #include "BinaryDataDeserializer.h"
+#include "MemoryMappedFile.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -68,15 +69,15 @@ public:
     // Retrieves a chunk of data.
     ChunkPtr GetChunk(ChunkIdType chunkId) override;
 
+    // Chunks of a memory-mapped file are views into the mapping and do not touch the file handle.
+    bool IsGetChunkThreadSafe() const override { return m_mappedFile != nullptr; }
+
     // Get information about chunks.
     ChunkDescriptions GetChunkDescriptions() override;
 
     // Get information about particular chunk.
     void GetSequencesForChunk(ChunkIdType chunkId, vector<SequenceDescription>& result) override;
 
-    // Parses buffer into a BinaryChunkPtr
-    void ParseChunk(ChunkIdType chunkId, unique_ptr<byte[]> const& buffer, std::vector<std::vector<SequenceDataPtr>>& data);
-
 private:
     // Builds an index of the input data.
     void Initialize(const std::map<std::wstring, std::wstring>& rename);
@@ -85,8 +86,8 @@ private:
     void ReadOffsetsTable(FILE* infile, size_t startOffset, size_t numChunks);
     void ReadOffsetsTable(FILE* infile);
 
-    // Reads a chunk from disk into buffer
-    unique_ptr<byte[]> ReadChunk(ChunkIdType chunkId);
+    // Reads a chunk from disk into buffer, or returns a view of it in the mapped file.
+    shared_ptr<const byte> ReadChunk(ChunkIdType chunkId);
 
     BinaryChunkDeserializer(const wstring& filename);
 
@@ -96,6 +97,11 @@ private:
     const wstring m_filename;
     FILE* m_file;
 
+    // If set, chunks are not read but point into this mapping of the whole file (no copy,
+    // and the pages are shared through the OS page cache with other processes reading the file).
+    bool m_useMemoryMapping;
+    shared_ptr<MemoryMappedFile> m_mappedFile;
+
     int64_t m_offsetStart;
     int64_t m_dataStart;
 
@@ -48,6 +48,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
         m_filepath = msra::strfun::utf16(config(L"file"));
         m_keepDataInMemory = config(L"keepDataInMemory", false);
+        m_cacheSizeBytes = config(L"cacheSizeInBytes", 0); // only with keepDataInMemory; 0 means no limit
+        m_useMemoryMapping = config(L"useMemoryMapping", false);
 
         // EvalActions inserts randomize = "none" into the reader config in DoWriteOutoput. We would like this to be true/false,
         // but we can't for this reason. So we will assume false unless we specifically get "true"
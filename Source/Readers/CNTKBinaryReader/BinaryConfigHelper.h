@@ -34,6 +34,10 @@ public:
 
     bool ShouldKeepDataInMemory() const { return m_keepDataInMemory; }
 
+    bool ShouldUseMemoryMapping() const { return m_useMemoryMapping; }
+
+    size_t GetCacheSize() const { return m_cacheSizeBytes; }
+
     DISABLE_COPY_AND_MOVE(BinaryConfigHelper);
 
 private:
@@ -43,6 +47,8 @@ private:
     bool m_randomize;
     unsigned int m_traceLevel;
     bool m_keepDataInMemory; // if true the whole dataset is kept in memory
+    size_t m_cacheSizeBytes; // limit for the data kept in memory, in bytes (0 = no limit)
+    bool m_useMemoryMapping; // if true chunks are used in place in a memory mapping of the file instead of being read
 };
 
 } } }
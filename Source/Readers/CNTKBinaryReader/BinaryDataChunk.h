@@ -15,8 +15,9 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 class BinaryDataChunk : public Chunk, public std::enable_shared_from_this<Chunk>
 {
 public:
-    explicit BinaryDataChunk(ChunkIdType chunkId, size_t startSequence, size_t numSequences, unique_ptr<byte[]> buffer, std::vector<BinaryDataDeserializerPtr> deserializer)
-        : m_chunkId(chunkId), m_startSequence(startSequence), m_numSequences(numSequences), m_buffer(std::move(buffer)), m_deserializers(deserializer)
+    // 'buffer' either owns a copy of the chunk, or points into a memory-mapped file and keeps the mapping alive.
+    explicit BinaryDataChunk(ChunkIdType chunkId, size_t startSequence, size_t numSequences, shared_ptr<const byte> buffer, size_t bufferSize, std::vector<BinaryDataDeserializerPtr> deserializer)
+        : m_chunkId(chunkId), m_startSequence(startSequence), m_numSequences(numSequences), m_buffer(buffer), m_bufferSize(bufferSize), m_deserializers(deserializer)
     {
     }
 
@@ -34,6 +35,9 @@ public:
             result[c] = m_data[c].at(sequenceId - m_startSequence);
     }
 
+    // The parsed sequences mostly point into the buffer, so its size is a good approximation.
+    size_t SizeInBytes() const override { return m_bufferSize; }
+
     uint32_t GetNumSamples(size_t sequenceId)
     {
         uint32_t numSamples = 0;
@@ -51,7 +55,7 @@ protected:
         size_t bytesProcessed = 0;
         // Now call all of the deserializers on the chunk, in order
         for (size_t c = 0; c < m_deserializers.size(); c++)
-            bytesProcessed += m_deserializers[c]->GetSequenceDataForChunk(m_numSequences, 0, (byte*)m_buffer.get() + bytesProcessed, m_data[c]);
+            bytesProcessed += m_deserializers[c]->GetSequenceDataForChunk(m_numSequences, 0, m_buffer.get() + bytesProcessed, m_data[c]);
     }
 
     // chunk id (copied from the descriptor)
@@ -63,8 +67,10 @@ protected:
     // so we must tell the chunk where it starts.
     size_t m_numSequences;
 
-    // This is the actual chunk read from disk. We will call back to the deserializer for it to be deserialized
-    unique_ptr<byte[]> m_buffer;
+    // This is the actual chunk read from disk (or mapped). We will call back to the deserializer for it to be deserialized.
+    // The data is never modified, the parsed sequences point into it.
+    shared_ptr<const byte> m_buffer;
+    size_t m_bufferSize;
 
     // This is the deserializer who knows how to interpret the m_data chunk that we read in
     std::vector<BinaryDataDeserializerPtr> m_deserializers;
@@ -16,7 +16,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 class BinaryDataDeserialzer {
 public:
-    virtual size_t GetSequenceDataForChunk(size_t numSequences, size_t startIndex, void* data, std::vector<SequenceDataPtr>& result) = 0;
+    // Parses the data of one stream in a chunk; the sequences point into 'data', which must stay unchanged.
+    virtual size_t GetSequenceDataForChunk(size_t numSequences, size_t startIndex, const void* data, std::vector<SequenceDataPtr>& result) = 0;
 
     StorageType GetStorageType() { return m_storageType; }
     ElementType GetElementType() { return m_elemType; }
@@ -42,7 +43,7 @@ protected:
             return m_data;
         }
 
-        void* m_data;
+        const void* m_data;
     };
 
     // In case of sparse input, we also need a vector of
@@ -61,7 +62,7 @@ protected:
         }
         
         std::vector<IndexType> m_indicesBuffer;
-        void* m_data;
+        const void* m_data;
     };
 
     
@@ -98,14 +99,14 @@ public:
         m_numCols = numCols;
     }
 
-    size_t GetSequenceDataForChunk(size_t numSequences, size_t startIndex, void* data, std::vector<SequenceDataPtr>& result)
+    size_t GetSequenceDataForChunk(size_t numSequences, size_t startIndex, const void* data, std::vector<SequenceDataPtr>& result)
     {
         size_t elemSize = GetElemSizeBytes();
         result.resize(numSequences);
         for (size_t c = 0; c < numSequences; c++)
         {
             shared_ptr<DenseInputStreamBuffer> sequence = make_shared<DenseInputStreamBuffer>();
-            sequence->m_data            = (char*)data + c*m_numCols*elemSize;
+            sequence->m_data            = (const char*)data + c*m_numCols*elemSize;
             sequence->m_id              = startIndex + c;
             sequence->m_numberOfSamples = 1;
             sequence->m_sampleLayout    = std::make_shared<TensorShape>(m_numCols);
@@ -164,24 +165,24 @@ public:
     // ElemType[nnz]: the values for the sparse sequences
     // int32_t[nnz]: the row offsets for the sparse sequences
     // int32_t[numSequences]: the column offsets for the sparse sequences
-    size_t GetSequenceDataForChunk(size_t numSequences, size_t startIndex, void* data, std::vector<SequenceDataPtr>& result)
+    size_t GetSequenceDataForChunk(size_t numSequences, size_t startIndex, const void* data, std::vector<SequenceDataPtr>& result)
     {
         size_t elemSize = GetElemSizeBytes();
         result.resize(numSequences);
 
         // For sparse, the first int32_t is the number of nnz values in the entire set of sequences
-        int32_t totalNNz = *(int32_t*)data;
+        int32_t totalNNz = *(const int32_t*)data;
 
         // the rest of this chunk
         // Since we're not templating on ElemType, we use void for the values. Note that this is the only place
         // this deserializer uses ElemType, the rest are int32_t for this deserializer.
-        void* values = (char*)data + sizeof(int32_t);
+        const void* values = (const char*)data + sizeof(int32_t);
 
         // Now the row offsets
-        int32_t* rowOffsets = (int32_t*)((char*)values + elemSize * totalNNz);
+        const int32_t* rowOffsets = (const int32_t*)((const char*)values + elemSize * totalNNz);
 
         // Now the col offsets
-        int32_t* colOffsets = rowOffsets + totalNNz;
+        const int32_t* colOffsets = rowOffsets + totalNNz;
 
         // Now we setup some helper members to process the chunk
         for (size_t colIndex = 0; colIndex < numSequences; colIndex++)
@@ -196,9 +197,10 @@ public:
             // The values array is already properly packed, so just use it.
             sequence->m_data = values;
             
-            // The indices are correct (note they MUST BE IN INCREASING ORDER), but we will have to fix them up a 
-            // little bit, for now just use them
-            sequence->m_indices = rowOffsets;
+            // The indices are correct (note they MUST BE IN INCREASING ORDER), but they index into the whole sequence,
+            // so we have to fix them up a little bit. The chunk data may be a read-only mapping of the file, so the
+            // fixed-up indices go into a buffer of their own.
+            sequence->m_indicesBuffer.resize(sequence->m_totalNnzCount);
             for (int32_t curRow = 0; curRow < sequence->m_totalNnzCount; curRow++)
             {
                 // Get the sample for the current index
@@ -209,11 +211,12 @@ public:
                 // Now that we have enough samples, increment the nnz for the sample
                 sequence->m_nnzCounts[sampleNum] += 1;
                 // Now that we've found it's sample, fix up the index.
-                rowOffsets[curRow] %= m_numCols;
+                sequence->m_indicesBuffer[curRow] = (IndexType)(rowOffsets[curRow] % m_numCols);
             }
+            sequence->m_indices = sequence->m_indicesBuffer.data();
             sequence->m_numberOfSamples = (uint32_t)sequence->m_nnzCounts.size();
             // update values, rowOffsets pointers
-            values = (char*)values + sequence->m_totalNnzCount * elemSize;
+            values = (const char*)values + sequence->m_totalNnzCount * elemSize;
             rowOffsets += sequence->m_totalNnzCount;
 
             result[colIndex] = sequence;
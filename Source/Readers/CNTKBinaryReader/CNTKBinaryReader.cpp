@@ -28,11 +28,15 @@ CNTKBinaryReader::CNTKBinaryReader(const ConfigParameters& config)
     try
     {
         m_deserializer = shared_ptr<IDataDeserializer>(new BinaryChunkDeserializer(configHelper));
+        if (configHelper.ShouldUseMemoryMapping())
+            log += " | memory-mapped";
 
         if (configHelper.ShouldKeepDataInMemory())
         {
-            m_deserializer = shared_ptr<IDataDeserializer>(new ChunkCache(m_deserializer));
+            m_deserializer = shared_ptr<IDataDeserializer>(new ChunkCache(m_deserializer, configHelper.GetCacheSize(), config(L"verbosity", 0)));
             log += " | keeping data in memory";
+            if (configHelper.GetCacheSize() > 0)
+                log += " (up to " + std::to_string(configHelper.GetCacheSize()) + " bytes)";
         }
 
         if (configHelper.GetRandomize())
@@ -34,7 +34,7 @@ CNTKTextFormatReader::CNTKTextFormatReader(const ConfigParameters& config)
             m_deserializer = make_shared<TextParser<double>>(corpus, configHelper, true);
 
         if (configHelper.ShouldKeepDataInMemory())
-            m_deserializer = make_shared<ChunkCache>(m_deserializer);
+            m_deserializer = make_shared<ChunkCache>(m_deserializer, configHelper.GetCacheSize(), config(L"verbosity", 0));
 
         size_t window = configHelper.GetRandomizationWindow();
         if (window > 0)
@@ -0,0 +1,278 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// NumberParser.h -- fast paths for tokenizing and converting numbers in the CNTK text format
+//
+// The TextParser state machines consume one character at a time and check for the end of the buffer after
+// each of them. For the common case of a well-formed number that ends inside the current buffer, these helpers
+// first find the end of the token with SSE2 (16 characters per step), and then convert the whole token at once:
+// tokens of up to 16 characters with SSSE3 (digits are combined pairwise with multiply-adds, without
+// data-dependent branches), longer ones in a scalar loop. Anything they do not handle exactly makes them return
+// false, and the parser falls back to the general code path, so error handling and warnings stay the same.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "TextReaderConstants.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// index of the lowest set bit of a non-zero mask
+inline unsigned int LowestSetBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Returns the first character in [begin, end) that terminates a number: a value delimiter, a name prefix,
+// an index delimiter or a non-printable character (which includes the row delimiter). Returns 'end' if none.
+inline const char* FindEndOfNumber(const char* begin, const char* end)
+{
+    // Signed comparison, so that bytes >= 0x80 count as non-printable, like in isNonPrintable().
+    const __m128i firstNonDelimiter = _mm_set1_epi8(SPACE_CHAR + 1);
+    const __m128i namePrefix = _mm_set1_epi8(NAME_PREFIX);
+    const __m128i indexDelimiter = _mm_set1_epi8(INDEX_DELIMITER);
+
+    const char* p = begin;
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i stop = _mm_or_si128(_mm_cmplt_epi8(v, firstNonDelimiter),
+                                    _mm_or_si128(_mm_cmpeq_epi8(v, namePrefix), _mm_cmpeq_epi8(v, indexDelimiter)));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(stop);
+        if (mask)
+            return p + LowestSetBit(mask);
+    }
+
+    for (; p != end; ++p)
+    {
+        char c = *p;
+        if (isValueDelimiter(c) || isNonPrintable(c) || c == NAME_PREFIX || c == INDEX_DELIMITER)
+            return p;
+    }
+    return end;
+}
+
+// Returns the first occurrence of 'a' or 'b' in [begin, end), or 'end' if there is none.
+inline const char* FindFirstOf(const char* begin, const char* end, char a, char b)
+{
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+
+    const char* p = begin;
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (mask)
+            return p + LowestSetBit(mask);
+    }
+
+    for (; p != end; ++p)
+    {
+        if (*p == a || *p == b)
+            return p;
+    }
+    return end;
+}
+
+// Converts [begin, end) if it consists of 1 to 19 decimal digits. Longer numbers may overflow,
+// those are left to the general parser, which warns about it.
+inline bool TryParseUint64Fast(const char* begin, const char* end, size_t& value)
+{
+    if (begin == end || end - begin > 19)
+        return false;
+
+    uint64_t result = 0;
+    for (const char* p = begin; p != end; ++p)
+    {
+        unsigned int digit = (unsigned char)*p - '0';
+        if (digit > 9)
+            return false;
+        result = result * 10 + digit;
+    }
+    value = (size_t)result;
+    return true;
+}
+
+// Computes mantissa * 10^exponent if that is exact in double precision: a mantissa of at most 2^53, scaled by
+// at most 10^22 (Clinger's fast path; both factors are exact doubles, so the single multiplication or division
+// is correctly rounded). Returns false otherwise.
+inline bool TryScaleExactly(uint64_t mantissa, int exponent, bool negative, double& value)
+{
+    static const double powersOf10[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const int maxExactPowerOf10 = 22;
+    const uint64_t maxExactMantissa = 1ull << 53;
+
+    if (mantissa == 0)
+    {
+        value = negative ? -0.0 : 0.0;
+        return true;
+    }
+
+    if (mantissa > maxExactMantissa || exponent < -maxExactPowerOf10 || exponent > maxExactPowerOf10)
+        return false;
+
+    double result = (double)mantissa;
+    result = (exponent < 0) ? result / powersOf10[-exponent] : result * powersOf10[exponent];
+    value = negative ? -result : result;
+    return true;
+}
+
+// Parses the exponent digits in [begin, end) following the letter E, with an optional sign.
+// At most 3 digits, anything longer is out of range for TryScaleExactly() anyway.
+inline bool TryParseExponent(const char* begin, const char* end, int& exponent)
+{
+    const char* p = begin;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+    if (p == end || end - p > 3)
+        return false;
+
+    int result = 0;
+    for (; p != end; ++p)
+    {
+        unsigned int digit = (unsigned char)*p - '0';
+        if (digit > 9)
+            return false;
+        result = result * 10 + digit;
+    }
+    exponent = negative ? -result : result;
+    return true;
+}
+
+// Scalar version of TryParseRealNumberFast() for tokens of any length.
+inline bool TryParseRealNumberScalar(const char* begin, const char* end, double& value)
+{
+    const char* p = begin;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int numSignificantDigits = 0;
+    int exponent = 0;
+
+    const char* integralPart = p;
+    for (; p != end && (unsigned int)((unsigned char)*p - '0') <= 9; ++p)
+    {
+        if (numSignificantDigits == 19)
+            return false;
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa != 0)
+            ++numSignificantDigits;
+    }
+    if (p == integralPart)
+        return false;
+
+    if (p != end && *p == '.')
+    {
+        const char* fractionalPart = ++p;
+        for (; p != end && (unsigned int)((unsigned char)*p - '0') <= 9; ++p)
+        {
+            if (numSignificantDigits == 19)
+                return false;
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0)
+                ++numSignificantDigits;
+            --exponent;
+        }
+        if (p == fractionalPart)
+            return false;
+    }
+
+    if (p != end && (*p == 'e' || *p == 'E'))
+    {
+        int explicitExponent;
+        if (!TryParseExponent(p + 1, end, explicitExponent))
+            return false;
+        exponent += explicitExponent;
+    }
+    else if (p != end)
+    {
+        return false;
+    }
+
+    return TryScaleExactly(mantissa, exponent, negative, value);
+}
+
+// Converts [begin, end) if it is a number of the form [+-]digits[.digits][(e|E)[+-]digits] whose value
+// can be computed exactly in double precision (see TryScaleExactly()). Returns false for anything else.
+// 'bufferEnd' is the end of the readable memory, at or after 'end'.
+inline bool TryParseRealNumberFast(const char* begin, const char* end, const char* bufferEnd, double& value)
+{
+    const int length = (int)(end - begin);
+    if (length == 0 || length > 16 || bufferEnd - begin < 16)
+        return TryParseRealNumberScalar(begin, end, value);
+
+    // classify the characters of the token (lanes beyond it are ignored)
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    const __m128i digits = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    const __m128i isDigit = _mm_cmplt_epi8(_mm_xor_si128(digits, _mm_set1_epi8((char)0x80)), _mm_set1_epi8((char)(0x80 + 10))); // unsigned digit < 10
+    const unsigned int digitMask = (unsigned int)_mm_movemask_epi8(isDigit);
+    const unsigned int dotMask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    const unsigned int eMask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('e'))) & ((1u << length) - 1);
+
+    // the mantissa is [start, ePos): digits with at most one dot, which has a digit on either side
+    const bool negative = (begin[0] == '-');
+    const int start = (negative || begin[0] == '+') ? 1 : 0;
+    const int ePos = eMask ? (int)LowestSetBit(eMask) : length;
+    const unsigned int mantissaRange = ((1u << ePos) - 1) & ~((1u << start) - 1);
+    const unsigned int dot = dotMask & mantissaRange;
+    if (((digitMask | dot) & mantissaRange) != mantissaRange || (dot & (dot - 1)) != 0)
+        return false;
+    const int dotPos = dot ? (int)LowestSetBit(dot) : ePos;
+    const int numDigits = ePos - start - (dot ? 1 : 0);
+    if (numDigits == 0 || dotPos == start || (dot && dotPos == ePos - 1))
+        return false;
+
+    // Remove the dot, then move the digits to the end of the register, with zeros before them.
+    const __m128i lane = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i packed = _mm_shuffle_epi8(digits, _mm_sub_epi8(lane, _mm_cmpgt_epi8(lane, _mm_set1_epi8((char)(dotPos - 1)))));
+    packed = _mm_shuffle_epi8(packed, _mm_add_epi8(lane, _mm_set1_epi8((char)(start + numDigits - 16))));
+    packed = _mm_and_si128(packed, _mm_cmpgt_epi8(lane, _mm_set1_epi8((char)(15 - numDigits))));
+
+    // combine 2, 4, then 8 digits; the two 8-digit halves end up in the first two 32-bit lanes
+    const __m128i pairs = _mm_maddubs_epi16(packed, _mm_set1_epi16(0x010A));                            // 10, 1
+    const __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010064));                             // 100, 1
+    const __m128i octets = _mm_madd_epi16(_mm_packs_epi32(quads, quads), _mm_set1_epi32(0x00012710)); // 10000, 1
+    const uint64_t high = (uint32_t)_mm_cvtsi128_si32(octets);
+    const uint64_t low = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(octets, 4));
+    const uint64_t mantissa = high * 100000000ull + low;
+
+    int exponent = dot ? -(ePos - dotPos - 1) : 0;
+    if (ePos != length)
+    {
+        int explicitExponent;
+        if (!TryParseExponent(begin + ePos + 1, end, explicitExponent))
+            return false;
+        exponent += explicitExponent;
+    }
+
+    return TryScaleExactly(mantissa, exponent, negative, value);
+}
+
+}}}
@@ -147,7 +147,10 @@ TextConfigHelper::TextConfigHelper(const ConfigParameters& config)
     m_maxErrors = config(L"maxErrors", 0);
     m_traceLevel = config(L"traceLevel", 1);
     m_chunkSizeBytes = config(L"chunkSizeInBytes", 32 * 1024 * 1024); // 32 MB by default
+    m_numIndexingThreads = config(L"numIndexingThreads", 0);
+    m_cacheIndex = config(L"cacheIndex", false);
     m_keepDataInMemory = config(L"keepDataInMemory", false);
+    m_cacheSizeBytes = config(L"cacheSizeInBytes", 0); // only with keepDataInMemory; 0 means no limit
     m_frameMode = config(L"frameMode", false);
 }
 
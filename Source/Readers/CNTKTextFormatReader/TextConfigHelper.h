@@ -35,8 +35,14 @@ public:
 
     size_t GetChunkSize() const { return m_chunkSizeBytes; }
 
+    size_t GetNumIndexingThreads() const { return m_numIndexingThreads; }
+
+    bool ShouldCacheIndex() const { return m_cacheIndex; }
+
     bool ShouldKeepDataInMemory() const { return m_keepDataInMemory; }
 
+    size_t GetCacheSize() const { return m_cacheSizeBytes; }
+
     bool IsInFrameMode() const { return m_frameMode; }
 
     ElementType GetElementType() const { return m_elementType; }
@@ -52,7 +58,10 @@ private:
     unsigned int m_maxErrors;
     unsigned int m_traceLevel;
     size_t m_chunkSizeBytes; // chunks size in bytes
+    size_t m_numIndexingThreads; // number of threads building the index (0 = one per hardware thread)
+    bool m_cacheIndex; // if true the index is stored next to the input file and reused while the file is unchanged
     bool m_keepDataInMemory; // if true the whole dataset is kept in memory
+    size_t m_cacheSizeBytes; // limit for the data kept in memory, in bytes (0 = no limit)
     bool m_frameMode; // if true, the maximum expected sequence length in the dataset is one sample.
 };
 
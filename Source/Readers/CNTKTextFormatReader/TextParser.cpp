@@ -10,6 +10,7 @@
 #include "Indexer.h"
 #include "TextParser.h"
 #include "TextReaderConstants.h"
+#include "NumberParser.h"
 
 #define isSign(c) ((c == '-' || c == '+'))
 #define isE(c) ((c == 'e' || c == 'E'))
@@ -42,9 +43,14 @@ public:
     // Gets sequences by id.
     void GetSequence(size_t sequenceId, std::vector<SequenceDataPtr>& result) override;
 
+    size_t SizeInBytes() const override { return m_sizeInBytes; }
+
     // A map from sequence ids to the sequence data.
     std::vector<SequenceBuffer> m_sequenceMap;
 
+    // size of the parsed sequence data (computed by LoadChunk)
+    size_t m_sizeInBytes;
+
     // chunk id (copied from the descriptor)
     ChunkIdType m_id;
 
@@ -68,6 +74,8 @@ TextParser(corpus, helper.GetFilePath(), helper.GetStreams(), isPrimary)
     SetMaxAllowedErrors(helper.GetMaxAllowedErrors());
     SetChunkSize(helper.GetChunkSize());
     SetSkipSequenceIds(helper.ShouldSkipSequenceIds());
+    SetNumIndexingThreads(helper.GetNumIndexingThreads());
+    SetUseIndexCache(helper.ShouldCacheIndex());
 
     Initialize();
 }
@@ -90,6 +98,9 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
     m_hadWarnings(false),
     m_numAllowedErrors(0),
     m_skipSequenceIds(false),
+    m_numIndexingThreads(0),
+    m_useIndexCache(false),
+    m_useSimdParsing(true),
     m_numRetries(5),
     m_corpus(corpus),
     m_isPrimary(isPrimary)
@@ -169,6 +180,9 @@ void TextParser<ElemType>::Initialize()
         }
 
         m_indexer = make_unique<Indexer>(m_file, m_isPrimary, m_skipSequenceIds, NAME_PREFIX, m_chunkSizeBytes);
+        m_indexer->SetFilePath(m_filename);
+        m_indexer->SetNumThreads(m_numIndexingThreads);
+        m_indexer->SetUseIndexCache(m_useIndexCache);
 
         m_indexer->Build(m_corpus);
     });
@@ -228,7 +242,8 @@ void TextParser<ElemType>::GetSequencesForChunk(ChunkIdType chunkId, std::vector
 
 template <class ElemType>
 TextParser<ElemType>::TextDataChunk::TextDataChunk(const ChunkDescriptor& descriptor, TextParser* parser) :
-    m_parser(parser)
+    m_parser(parser),
+    m_sizeInBytes(0)
 {
     m_id = descriptor.m_id;
 }
@@ -266,9 +281,25 @@ template <class ElemType>
 void TextParser<ElemType>::LoadChunk(TextChunkPtr& chunk, const ChunkDescriptor& descriptor)
 {
     chunk->m_sequenceMap.resize(descriptor.m_sequences.size());
+    chunk->m_sizeInBytes = 0;
     for (const auto& sequenceDescriptor : descriptor.m_sequences)
     {
-        chunk->m_sequenceMap[sequenceDescriptor.m_id] = LoadSequence(sequenceDescriptor);
+        SequenceBuffer& sequence = chunk->m_sequenceMap[sequenceDescriptor.m_id];
+        sequence = LoadSequence(sequenceDescriptor);
+
+        for (size_t i = 0; i < sequence.size(); ++i)
+        {
+            if (m_streamInfos[i].m_type == StorageType::dense)
+            {
+                const auto& data = static_cast<const DenseInputStreamBuffer&>(*sequence[i]);
+                chunk->m_sizeInBytes += data.m_buffer.capacity() * sizeof(ElemType);
+            }
+            else
+            {
+                const auto& data = static_cast<const SparseInputStreamBuffer&>(*sequence[i]);
+                chunk->m_sizeInBytes += data.m_buffer.capacity() * sizeof(ElemType) + data.m_indicesBuffer.capacity() * sizeof(IndexType);
+            }
+        }
     }
 }
 
@@ -899,20 +930,50 @@ void TextParser<ElemType>::SkipToNextInput(size_t& bytesToRead)
 {
     while (bytesToRead && CanRead())
     {
-        char c = *m_pos;
         // skip everything until we hit either an input marker or the end of row.
-        if (c == NAME_PREFIX || c == ROW_DELIMITER)
+        if (!m_useSimdParsing)
+        {
+            char c = *m_pos;
+            if (c == NAME_PREFIX || c == ROW_DELIMITER)
+            {
+                return;
+            }
+            ++m_pos;
+            --bytesToRead;
+            continue;
+        }
+
+        const char* end = m_pos + min<size_t>(m_bufferEnd - m_pos, bytesToRead);
+        const char* found = FindFirstOf(m_pos, end, NAME_PREFIX, ROW_DELIMITER);
+        bytesToRead -= found - m_pos;
+        m_pos = found;
+        if (found != end)
         {
             return;
         }
-        ++m_pos;
-        --bytesToRead;
     }
 }
 
+template <class ElemType>
+const char* TextParser<ElemType>::FindEndOfNumberInBuffer(size_t bytesToRead) const
+{
+    const char* end = m_pos + min<size_t>(m_bufferEnd - m_pos, bytesToRead);
+    const char* numberEnd = FindEndOfNumber(m_pos, end);
+    return numberEnd != end ? numberEnd : nullptr;
+}
+
 template <class ElemType>
 bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
 {
+    // fast path: the number ends within the buffer
+    const char* numberEnd = m_useSimdParsing ? FindEndOfNumberInBuffer(bytesToRead) : nullptr;
+    if (numberEnd && TryParseUint64Fast(m_pos, numberEnd, value))
+    {
+        bytesToRead -= numberEnd - m_pos;
+        m_pos = numberEnd;
+        return true;
+    }
+
     value = 0;
     bool found = false;
     while (bytesToRead && CanRead())
@@ -965,6 +1026,17 @@ bool TextParser<ElemType>::TryReadUint64(size_t& value, size_t& bytesToRead)
 template <class ElemType>
 bool TextParser<ElemType>::TryReadRealNumber(ElemType& value, size_t& bytesToRead)
 {
+    // fast path: the number ends within the buffer and can be converted exactly
+    const char* numberEnd = m_useSimdParsing ? FindEndOfNumberInBuffer(bytesToRead) : nullptr;
+    double fastValue;
+    if (numberEnd && TryParseRealNumberFast(m_pos, numberEnd, m_bufferEnd, fastValue))
+    {
+        value = static_cast<ElemType>(fastValue);
+        bytesToRead -= numberEnd - m_pos;
+        m_pos = numberEnd;
+        return true;
+    }
+
     State state = State::Init;
     double coefficient = .0, number = .0, divider = .0;
     bool negative = false;
@@ -1183,12 +1255,30 @@ void TextParser<ElemType>::SetChunkSize(size_t size)
     m_chunkSizeBytes = size;
 }
 
+template <class ElemType>
+void TextParser<ElemType>::SetNumIndexingThreads(size_t numThreads)
+{
+    m_numIndexingThreads = numThreads;
+}
+
+template <class ElemType>
+void TextParser<ElemType>::SetUseIndexCache(bool useIndexCache)
+{
+    m_useIndexCache = useIndexCache;
+}
+
 template <class ElemType>
 void TextParser<ElemType>::SetNumRetries(unsigned int numRetries)
 {
     m_numRetries = numRetries;
 }
 
+template <class ElemType>
+void TextParser<ElemType>::SetUseSimdParsing(bool useSimdParsing)
+{
+    m_useSimdParsing = useSimdParsing;
+}
+
 template <class ElemType>
 std::wstring TextParser<ElemType>::GetFileInfo()
 {
@@ -120,6 +120,9 @@ private:
     bool m_hadWarnings;
     unsigned int m_numAllowedErrors;
     bool m_skipSequenceIds;
+    size_t m_numIndexingThreads; // 0 = one per hardware thread
+    bool m_useIndexCache; // if true, the index is cached on disk next to the input file
+    bool m_useSimdParsing; // if false, only the scalar code paths are used (to compare against)
     unsigned int m_numRetries; // specifies the number of times an unsuccessful
     // file operation should be repeated (default value is 5).
 
@@ -142,6 +145,10 @@ private:
     void SkipToNextValue(size_t& bytesToRead);
     void SkipToNextInput(size_t& bytesToRead);
 
+    // Returns the end of the number token at m_pos if it ends within both the buffer and
+    // the bytes left to read (so it can be parsed in one go), nullptr otherwise.
+    const char* FindEndOfNumberInBuffer(size_t bytesToRead) const;
+
     bool TryRefillBuffer();
 
     int64_t GetFileOffset() const { return m_fileOffsetStart + (m_pos - m_bufferStart); }
@@ -193,8 +200,14 @@ private:
 
     void SetChunkSize(size_t size);
 
+    void SetNumIndexingThreads(size_t numThreads);
+
+    void SetUseIndexCache(bool useIndexCache);
+
     void SetNumRetries(unsigned int numRetries);
 
+    void SetUseSimdParsing(bool useSimdParsing);
+
     friend class CNTKTextFormatReaderTestRunner<ElemType>;
 
     DISABLE_COPY_AND_MOVE(TextParser);
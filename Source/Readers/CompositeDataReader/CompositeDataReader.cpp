@@ -118,7 +118,14 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
         randomizationWindow = config(L"randomizationWindow", randomizationWindow);
 
         bool shouldPrefetch = true;
-        m_sequenceEnumerator = std::make_shared<BlockRandomizer>(verbosity, randomizationWindow, deserializer, shouldPrefetch, multiThreadedDeserialization, maxErrors);
+
+        // By default a single chunk is prefetched ahead of the randomization window. Prefetching several chunks with
+        // several threads helps with slow deserializers. Deserializers that cannot load chunks in parallel use a single thread.
+        size_t prefetchDepth = config(L"prefetchDepth", 1);
+        size_t prefetchThreads = config(L"prefetchThreads", 1);
+        size_t maxPrefetchBytes = config(L"maxPrefetchSizeInBytes", 0);
+        m_sequenceEnumerator = std::make_shared<BlockRandomizer>(verbosity, randomizationWindow, deserializer, shouldPrefetch, multiThreadedDeserialization, maxErrors,
+                                                                 prefetchDepth, prefetchThreads, maxPrefetchBytes);
     }
     else
     {
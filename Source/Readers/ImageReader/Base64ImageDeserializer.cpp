@@ -144,6 +144,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                 m_dataFile.reset(fopenOrDie(m_fileName, L"rbS"), [](FILE* f) { if (f) fclose(f); });
 
             m_indexer = make_unique<Indexer>(m_dataFile.get(), isPrimary, !hasSequenceKeys);
+            m_indexer->SetFilePath(m_fileName);
+            m_indexer->SetNumThreads(0);
             m_indexer->Build(corpus);
         });
     }
@@ -22,7 +22,10 @@ BlockRandomizer::BlockRandomizer(
     IDataDeserializerPtr deserializer,
     bool shouldPrefetch,
     bool multithreadedGetNextSequence,
-    size_t maxNumberOfInvalidSequences)
+    size_t maxNumberOfInvalidSequences,
+    size_t prefetchDepth,
+    size_t prefetchThreads,
+    size_t maxPrefetchBytes)
     : m_verbosity(verbosity),
       m_deserializer(deserializer),
       m_sweep(SIZE_MAX),
@@ -32,14 +35,26 @@ BlockRandomizer::BlockRandomizer(
       m_sweepSizeInSamples(0),
       m_chunkRandomizer(std::make_shared<ChunkRandomizer>(deserializer, randomizationRangeInSamples)),
       m_multithreadedGetNextSequences(multithreadedGetNextSequence),
-      m_prefetchedChunk(CHUNKID_MAX),
+      m_prefetchDepth(std::max<size_t>(prefetchDepth, 1)),
+      m_prefetchThreads(std::max<size_t>(prefetchThreads, 1)),
+      m_maxPrefetchBytes(maxPrefetchBytes),
       m_cleaner(maxNumberOfInvalidSequences)
 {
     assert(deserializer != nullptr);
 
     m_launchType = shouldPrefetch ? launch::async : launch::deferred;
 
+    m_deserializerIsThreadSafe = m_deserializer->IsGetChunkThreadSafe();
+    if (!m_deserializerIsThreadSafe && m_prefetchThreads > 1)
+    {
+        if (m_verbosity >= Notification)
+            fprintf(stderr, "BlockRandomizer: the deserializer cannot load chunks in parallel, using a single prefetch thread instead of %" PRIu64 ".\n",
+                    m_prefetchThreads);
+        m_prefetchThreads = 1;
+    }
+
     m_streams = m_deserializer->GetStreamDescriptions();
+    m_estimatedSampleSizeInBytes = GetEstimatedSampleSizeInBytes(m_streams);
     m_sequenceRandomizer = std::make_shared<SequenceRandomizer>(verbosity, m_deserializer, m_chunkRandomizer);
 
     // Calculate total number of samples.
@@ -220,9 +235,8 @@ std::pair<size_t, size_t> BlockRandomizer::LoadSequenceData(size_t globalSampleC
             process(i);
     }
 
-    // Now it is safe to start the new chunk prefetch.
-    ChunkIdType chunkToPrefetchNext = GetChunkToPrefetch(windowRange);
-    Prefetch(chunkToPrefetchNext);
+    // Now it is safe to start new chunk prefetches.
+    Prefetch(windowRange);
 
     return { numGlobalSamples, numLocalSamples };
 }
@@ -346,10 +360,13 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
         }
 
         auto const& chunk = m_chunkRandomizer->GetRandomizedChunks()[i];
-        if (chunk.m_original->m_id == m_prefetchedChunk && m_prefetch.valid())
+        auto prefetched = std::find_if(m_prefetches.begin(), m_prefetches.end(),
+            [&chunk](const PrefetchedChunk& p) { return p.m_originalChunkId == chunk.m_original->m_id; });
+        if (prefetched != m_prefetches.end())
         {
             // Taking prefetched chunk.
-            m_chunks[chunk.m_original->m_id] = m_prefetch.get();
+            m_chunks[chunk.m_original->m_id] = prefetched->m_chunk.get();
+            m_prefetches.erase(prefetched);
             if (m_verbosity >= Information)
                 fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in prefetched chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
                 chunk.m_chunkId,
@@ -358,13 +375,7 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
         }
         else
         {
-            // Make sure we have no outstanding prefetches.
-            if (m_prefetch.valid())
-            {
-                m_prefetch.wait();
-            }
-
-            m_chunks[chunk.m_original->m_id] = m_deserializer->GetChunk(chunk.m_original->m_id);
+            m_chunks[chunk.m_original->m_id] = LoadChunk(chunk.m_original->m_id);
             if (m_verbosity >= Information)
                 fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in randomized chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
                 chunk.m_chunkId,
@@ -380,45 +391,103 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
                 m_chunkRandomizer->GetRandomizedChunks()[windowRange.m_end - 1].m_chunkId);
 }
 
-// Identifies chunk id that should be prefetched.
-ChunkIdType BlockRandomizer::GetChunkToPrefetch(const ClosedOpenChunkInterval& windowRange)
+// Identifies the chunks that should be prefetched next, in the order in which they will be needed.
+std::vector<const ChunkDescription*> BlockRandomizer::GetChunksToPrefetch(const ClosedOpenChunkInterval& windowRange)
 {
-    ChunkIdType toBePrefetched = CHUNKID_MAX;
+    std::vector<const ChunkDescription*> toBePrefetched;
     auto current = windowRange.m_end;
-    while (current < m_chunkRandomizer->GetRandomizedChunks().size())
+    while (current < m_chunkRandomizer->GetRandomizedChunks().size() && toBePrefetched.size() < m_prefetchDepth)
     {
         const auto& chunk = m_chunkRandomizer->GetRandomizedChunks()[current];
         if (chunk.m_chunkId % m_config.m_numberOfWorkers == m_config.m_workerRank &&
             m_chunks.find(chunk.m_original->m_id) == m_chunks.end())
         {
-            toBePrefetched = chunk.m_original->m_id;
-            break;
+            toBePrefetched.push_back(chunk.m_original);
         }
         ++current;
     }
     return toBePrefetched;
 }
 
-// Performs io prefetch of the specified chunk if needed.
-void BlockRandomizer::Prefetch(ChunkIdType chunkId)
+// Performs io prefetch of the chunks following the window if needed.
+void BlockRandomizer::Prefetch(const ClosedOpenChunkInterval& windowRange)
 {
-    // Start new prefetch if necessary.
-    if (m_prefetchedChunk != chunkId && chunkId != CHUNKID_MAX)
+    std::vector<const ChunkDescription*> toBePrefetched = GetChunksToPrefetch(windowRange);
+
+    // Drop prefetches that are not ahead of the window anymore, e.g. after a new sweep or a reset of the position.
+    // Destroying the future of a running std::async waits for the load to finish, so the running ones are
+    // put aside until they are done.
+    auto dropped = std::partition(m_prefetches.begin(), m_prefetches.end(), [&toBePrefetched](const PrefetchedChunk& p)
     {
-        // Wait to make sure there is no outstanding prefetches.
-        if (m_prefetch.valid())
-        {
-            m_prefetch.wait();
-        }
+        return std::any_of(toBePrefetched.begin(), toBePrefetched.end(),
+                           [&p](const ChunkDescription* c) { return c->m_id == p.m_originalChunkId; });
+    });
+    for (auto p = dropped; p != m_prefetches.end(); ++p)
+    {
+        if (p->m_chunk.wait_for(std::chrono::seconds(0)) == future_status::timeout)
+            m_droppedPrefetches.push_back(std::move(p->m_chunk));
+    }
+    m_prefetches.erase(dropped, m_prefetches.end());
+
+    m_droppedPrefetches.erase(std::remove_if(m_droppedPrefetches.begin(), m_droppedPrefetches.end(), [](const std::future<ChunkPtr>& f)
+    {
+        return f.wait_for(std::chrono::seconds(0)) != future_status::timeout;
+    }), m_droppedPrefetches.end());
+
+    // Dropped prefetches that are still loading occupy their threads.
+    size_t numLoading = m_droppedPrefetches.size();
+    size_t prefetchedBytes = 0;
+    for (const auto& p : m_prefetches)
+    {
+        if (p.m_chunk.wait_for(std::chrono::seconds(0)) == future_status::timeout)
+            numLoading++;
+        prefetchedBytes += p.m_estimatedSizeInBytes;
+    }
+
+    // Start new prefetches in the order the chunks are needed, within the limits.
+    for (const ChunkDescription* chunk : toBePrefetched)
+    {
+        ChunkIdType chunkId = chunk->m_id;
+        if (std::any_of(m_prefetches.begin(), m_prefetches.end(), [chunkId](const PrefetchedChunk& p) { return p.m_originalChunkId == chunkId; }))
+            continue;
 
-        m_prefetchedChunk = chunkId;
-        m_prefetch = std::async(m_launchType, [this, chunkId]() { return m_deserializer->GetChunk(chunkId); });
+        size_t estimatedSizeInBytes = chunk->m_numberOfSamples * m_estimatedSampleSizeInBytes;
+        if (numLoading >= m_prefetchThreads ||
+            (m_maxPrefetchBytes > 0 && !m_prefetches.empty() && prefetchedBytes + estimatedSizeInBytes > m_maxPrefetchBytes))
+            break;
+
+        PrefetchedChunk prefetch;
+        prefetch.m_originalChunkId = chunkId;
+        prefetch.m_estimatedSizeInBytes = estimatedSizeInBytes;
+        prefetch.m_chunk = std::async(m_launchType, [this, chunkId]() { return LoadChunk(chunkId); });
+        m_prefetches.push_back(std::move(prefetch));
+        numLoading++;
+        prefetchedBytes += estimatedSizeInBytes;
 
         if (m_verbosity >= Debug)
             fprintf(stderr, "BlockRandomizer::Prefetch: prefetching original chunk: %u\n", chunkId);
     }
 }
 
+void BlockRandomizer::WaitForPrefetches()
+{
+    // Deferred prefetches (no io prefetch) are not running, so they are left alone.
+    for (auto& p : m_prefetches)
+    {
+        if (p.m_chunk.valid() && p.m_chunk.wait_for(std::chrono::seconds(0)) != future_status::deferred)
+            p.m_chunk.wait();
+    }
+}
+
+ChunkPtr BlockRandomizer::LoadChunk(ChunkIdType chunkId)
+{
+    if (m_deserializerIsThreadSafe)
+        return m_deserializer->GetChunk(chunkId);
+
+    std::lock_guard<std::mutex> lock(m_loadLock);
+    return m_deserializer->GetChunk(chunkId);
+}
+
 void BlockRandomizer::SetCurrentSamplePosition(size_t currentSamplePosition)
 {
     PrepareNewSweepIfNeeded(currentSamplePosition);
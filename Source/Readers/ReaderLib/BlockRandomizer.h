@@ -13,6 +13,7 @@
 #include "SequenceRandomizer.h"
 #include "ReaderUtil.h"
 #include <future>
+#include <mutex>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -32,6 +33,12 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 //
 // This class is responsible for decimation and loading the data chunks in to memory.
 // Actual randomization happens in ChunkRandomizer and SequenceRandomizer.
+//
+// Chunks that will be needed after the current window are prefetched in the background, following the known
+// order of randomized chunks. Up to prefetchDepth chunks are kept prefetched ahead, with at most prefetchThreads
+// of them being loaded at the same time, and (if maxPrefetchBytes > 0) with their estimated size bounded.
+// Loading more than one chunk at a time requires a deserializer whose GetChunk() is thread-safe, otherwise
+// all loads of the deserializer are serialized and a single prefetch thread is used.
 // TODO: The behavior can be simplified by only randomizing sequences forward.
 class BlockRandomizer : public SequenceEnumerator
 {
@@ -42,7 +49,10 @@ public:
         IDataDeserializerPtr deserializer,
         bool shouldPrefetch,
         bool multithreadedGetNextSequences = false,
-        size_t maxNumberOfInvalidSequences = 0); // per worker
+        size_t maxNumberOfInvalidSequences = 0, // per worker
+        size_t prefetchDepth = 1,
+        size_t prefetchThreads = 1,
+        size_t maxPrefetchBytes = 0); // 0 means no limit
 
     // Starts a new epoch.
     virtual void StartEpoch(const EpochConfiguration& config) override;
@@ -63,10 +73,10 @@ public:
 
     ~BlockRandomizer()
     {
-        if (m_prefetch.valid())
-        {
-            m_prefetch.wait();
-        }
+        // Running loads use the members of the randomizer, so they have to finish first.
+        WaitForPrefetches();
+        for (auto& dropped : m_droppedPrefetches)
+            dropped.wait();
     }
 
     void SetCurrentSamplePosition(size_t currentSamplePosition) override;
@@ -96,11 +106,17 @@ private:
     // Prepares a new sweep if needed.
     void PrepareNewSweepIfNeeded(size_t samplePosition);
 
-    // Performs io prefetch of the specified chunk if needed.
-    void Prefetch(ChunkIdType chunkId);
+    // Performs io prefetch of the chunks following the given window if needed.
+    void Prefetch(const ClosedOpenChunkInterval& windowRange);
+
+    // Returns the next candidates for the prefetch after the given window, in the order they will be needed.
+    std::vector<const ChunkDescription*> GetChunksToPrefetch(const ClosedOpenChunkInterval& windowRange);
+
+    // Waits until no prefetch is loading anymore (without discarding the prefetched chunks).
+    void WaitForPrefetches();
 
-    // Returns next candidate for the prefetch in the given range.
-    ChunkIdType GetChunkToPrefetch(const ClosedOpenChunkInterval& windowRange);
+    // Loads a chunk from the deserializer, serializing the loads if the deserializer is not thread-safe.
+    ChunkPtr LoadChunk(ChunkIdType chunkId);
 
     // Global sample position on the timeline.
     size_t m_globalSamplePosition;
@@ -149,12 +165,33 @@ private:
 
     int m_verbosity;
 
-    // Prefetch future.
-    std::future<ChunkPtr> m_prefetch;
+    // A chunk that is being prefetched or has been prefetched.
+    struct PrefetchedChunk
+    {
+        ChunkIdType m_originalChunkId;
+        size_t m_estimatedSizeInBytes;
+        std::future<ChunkPtr> m_chunk;
+    };
+
+    // Prefetched chunks, in the order they will be needed.
+    std::vector<PrefetchedChunk> m_prefetches;
+    // Prefetches that are not needed anymore but may still be loading. They are kept until they finish,
+    // because destroying the future of a running std::async would block.
+    std::vector<std::future<ChunkPtr>> m_droppedPrefetches;
+    // Whether the deserializer allows concurrent GetChunk() calls.
+    bool m_deserializerIsThreadSafe;
+    // Serializes the loads of a deserializer that is not thread-safe.
+    std::mutex m_loadLock;
     // Whether to have async or deferred prefetch.
     launch m_launchType;
-    // Prefetched original chunk id.
-    ChunkIdType m_prefetchedChunk;
+    // Number of chunks to keep prefetched ahead of the current window.
+    size_t m_prefetchDepth;
+    // Maximum number of chunks being loaded at the same time.
+    size_t m_prefetchThreads;
+    // Maximum estimated size of the prefetched chunks (0 = no limit).
+    size_t m_maxPrefetchBytes;
+    // Estimated size of a sample, for the above limit.
+    size_t m_estimatedSampleSizeInBytes;
 
     // Current loaded chunks.
     ClosedOpenChunkInterval m_currentWindowRange;
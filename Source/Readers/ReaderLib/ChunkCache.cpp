@@ -6,21 +6,148 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include "ChunkCache.h"
+#include "ReaderUtil.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+ChunkCache::ChunkCache(IDataDeserializerPtr deserializer, size_t maxSizeInBytes, int verbosity)
+    : m_deserializer(deserializer), m_maxSizeInBytes(maxSizeInBytes), m_verbosity(verbosity)
+{
+    m_deserializerIsThreadSafe = m_deserializer->IsGetChunkThreadSafe();
+    m_statistics = Statistics{ 0, 0, 0, 0 };
+}
+
+ChunkCache::~ChunkCache()
+{
+    if (m_verbosity > 0)
+    {
+        fprintf(stderr, "ChunkCache: %d hits, %d misses, %d evictions, %.1f MB cached at the end.\n",
+                (int)m_statistics.m_hits, (int)m_statistics.m_misses, (int)m_statistics.m_evictions,
+                m_statistics.m_sizeInBytes / (1024.0 * 1024.0));
+    }
+}
+
 ChunkPtr ChunkCache::GetChunk(ChunkIdType chunkId)
 {
-    auto it = m_chunkMap.find(chunkId);
-    if (it != m_chunkMap.end())
+    std::promise<ChunkPtr> loaded;
+    std::shared_future<ChunkPtr> loadedByOtherThread;
     {
-        return it->second;
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = m_chunkMap.find(chunkId);
+        if (it != m_chunkMap.end())
+        {
+            m_statistics.m_hits++;
+            m_lruList.splice(m_lruList.begin(), m_lruList, it->second.m_lruPosition);
+            return it->second.m_chunk;
+        }
+
+        auto loading = m_loadingChunks.find(chunkId);
+        if (loading != m_loadingChunks.end())
+        {
+            m_statistics.m_hits++;
+            loadedByOtherThread = loading->second;
+        }
+        else
+        {
+            m_statistics.m_misses++;
+            m_loadingChunks[chunkId] = loaded.get_future().share();
+        }
+    }
+
+    // Another thread is loading the chunk, waiting for it outside of the lock.
+    if (loadedByOtherThread.valid())
+        return loadedByOtherThread.get();
+
+    // Loading without holding the lock, so that hits and loads of other chunks can go on.
+    ChunkPtr chunk;
+    try
+    {
+        chunk = LoadChunk(chunkId);
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_loadingChunks.erase(chunkId);
+        }
+        loaded.set_exception(std::current_exception());
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_loadingChunks.erase(chunkId);
+
+        CacheEntry& entry = m_chunkMap[chunkId];
+        entry.m_chunk = chunk;
+        entry.m_sizeInBytes = GetChunkSizeInBytes(chunkId, chunk);
+        entry.m_lruPosition = m_lruList.insert(m_lruList.begin(), chunkId);
+        m_statistics.m_sizeInBytes += entry.m_sizeInBytes;
+
+        if (m_maxSizeInBytes > 0 && m_statistics.m_sizeInBytes > m_maxSizeInBytes)
+            EvictChunks();
     }
- 
-    ChunkPtr chunk = m_deserializer->GetChunk(chunkId);
-    m_chunkMap[chunkId] = chunk;
- 
+
+    loaded.set_value(chunk);
     return chunk;
 }
 
+ChunkPtr ChunkCache::LoadChunk(ChunkIdType chunkId)
+{
+    if (m_deserializerIsThreadSafe)
+        return m_deserializer->GetChunk(chunkId);
+
+    std::lock_guard<std::mutex> lock(m_loadLock);
+    return m_deserializer->GetChunk(chunkId);
+}
+
+ChunkCache::Statistics ChunkCache::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_statistics;
+}
+
+size_t ChunkCache::GetChunkSizeInBytes(ChunkIdType chunkId, const ChunkPtr& chunk)
+{
+    size_t size = chunk->SizeInBytes();
+    if (size > 0)
+        return size;
+
+    // The chunk does not know its size, estimate it from its number of samples.
+    if (m_chunkNumSamples.empty())
+    {
+        for (const auto& description : m_deserializer->GetChunkDescriptions())
+        {
+            if (m_chunkNumSamples.size() <= description->m_id)
+                m_chunkNumSamples.resize(description->m_id + 1, 0);
+            m_chunkNumSamples[description->m_id] = description->m_numberOfSamples;
+        }
+    }
+
+    size_t bytesPerSample = GetEstimatedSampleSizeInBytes(m_deserializer->GetStreamDescriptions());
+    size_t numSamples = chunkId < m_chunkNumSamples.size() ? m_chunkNumSamples[chunkId] : 0;
+    return std::max<size_t>(numSamples * bytesPerSample, 1);
+}
+
+void ChunkCache::EvictChunks()
+{
+    // Walk from the least recently used end; chunks referenced by someone else (i.e. the randomizer's
+    // current window) stay, because dropping our reference would not free their memory.
+    auto position = m_lruList.end();
+    while (m_statistics.m_sizeInBytes > m_maxSizeInBytes && position != m_lruList.begin())
+    {
+        --position;
+        auto it = m_chunkMap.find(*position);
+        assert(it != m_chunkMap.end());
+        if (it->second.m_chunk.use_count() > 1)
+            continue;
+
+        m_statistics.m_sizeInBytes -= it->second.m_sizeInBytes;
+        m_statistics.m_evictions++;
+        m_chunkMap.erase(it);
+        position = m_lruList.erase(position);
+    }
+}
+
 } } }
@@ -6,21 +6,41 @@
 #pragma once
 
 #include <map>
+#include <list>
+#include <mutex>
+#include <future>
 #include "DataDeserializer.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
-// A cache to store the complete dataset (all chunks) in memory. The caching can
-// be switched on/off by a boolean flag in the reader config section, independent 
-// of the randomization and chunking parameters. The caching should only be enabled 
-// when the whole dataset fits in memory.
-// Implemented as a wrapping proxy around a deserializer that stores pointers to
-// all chunks it sees in an internal map.
+// A cache to store loaded chunks in memory, so that they do not have to be read and parsed again
+// in the following epochs. The caching can be switched on/off by a boolean flag in the reader config
+// section, independent of the randomization and chunking parameters.
+// Implemented as a wrapping proxy around a deserializer that stores pointers to the chunks it sees.
+//
+// Without a size limit, the cache keeps all chunks, which is only advisable when the whole dataset fits
+// in memory. With a limit (in bytes), the least recently used chunks are evicted once the cached chunks
+// exceed it. Chunks that are still referenced outside of the cache, i.e. that are in the current
+// randomization window of the randomizer, are never evicted, since evicting them would not free any
+// memory; the cache may exceed its limit if the randomization window alone does.
+//
+// Chunks are loaded without holding the lock of the cache, so that a prefetch does not block hits or loads of
+// other chunks. Concurrent requests for a chunk that is being loaded wait for that load.
 class ChunkCache : public IDataDeserializer
 {
 public:
+    struct Statistics
+    {
+        size_t m_hits;
+        size_t m_misses;
+        size_t m_evictions;
+        size_t m_sizeInBytes; // size of the currently cached chunks
+    };
+
+    // maxSizeInBytes == 0 means no limit.
+    ChunkCache(IDataDeserializerPtr deserializer, size_t maxSizeInBytes = 0, int verbosity = 0);
 
-    ChunkCache(IDataDeserializerPtr deserializer) : m_deserializer(deserializer) { }
+    ~ChunkCache();
 
     virtual std::vector<StreamDescriptionPtr> GetStreamDescriptions() const override
     {
@@ -45,10 +65,48 @@ public:
     // Gets chunk data given its id.
     virtual ChunkPtr GetChunk(ChunkIdType chunkId);
 
+    // Loads of a deserializer that is not thread-safe are serialized by the cache.
+    virtual bool IsGetChunkThreadSafe() const override
+    {
+        return true;
+    }
+
+    Statistics GetStatistics() const;
+
 private:
+    struct CacheEntry
+    {
+        ChunkPtr m_chunk;
+        size_t m_sizeInBytes;
+        std::list<ChunkIdType>::iterator m_lruPosition;
+    };
+
+    // Loads a chunk from the deserializer, serializing the loads if the deserializer is not thread-safe.
+    ChunkPtr LoadChunk(ChunkIdType chunkId);
+
+    // Size of a chunk as reported by the chunk, or estimated from the stream descriptions if it does not know.
+    size_t GetChunkSizeInBytes(ChunkIdType chunkId, const ChunkPtr& chunk);
+
+    // Evicts least recently used, unreferenced chunks until the cache fits into its limit.
+    void EvictChunks();
+
     // A map of currently loaded chunks
-    std::map<size_t, ChunkPtr> m_chunkMap;
+    std::map<ChunkIdType, CacheEntry> m_chunkMap;
+    // Chunks that are being loaded, so that concurrent requests for them wait for the same load.
+    std::map<ChunkIdType, std::shared_future<ChunkPtr>> m_loadingChunks;
+    // Chunk ids in the order of their last use, most recent first.
+    std::list<ChunkIdType> m_lruList;
     IDataDeserializerPtr m_deserializer;
+    size_t m_maxSizeInBytes;
+    int m_verbosity;
+    Statistics m_statistics;
+    // Number of samples per chunk, for size estimates; filled on first use.
+    std::vector<size_t> m_chunkNumSamples;
+    // Protects the cache; not held while loading a chunk.
+    mutable std::mutex m_lock;
+    bool m_deserializerIsThreadSafe;
+    // Serializes the loads of a deserializer that is not thread-safe.
+    std::mutex m_loadLock;
 
     DISABLE_COPY_AND_MOVE(ChunkCache);
 };
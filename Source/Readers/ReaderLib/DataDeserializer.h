@@ -120,6 +120,10 @@ public:
     // deallocated till all its sequences are released.
     virtual void GetSequence(size_t sequenceId, std::vector<SequenceDataPtr>& result) = 0;
 
+    // Approximate memory footprint of the chunk, used to bound the size of the chunk cache.
+    // 0 means unknown, in which case the cache estimates it from the stream descriptions.
+    virtual size_t SizeInBytes() const { return 0; }
+
     virtual ~Chunk() {};
 
 protected:
@@ -172,6 +176,10 @@ public:
     // Gets chunk data given its id.
     virtual ChunkPtr GetChunk(ChunkIdType chunkId) = 0;
 
+    // Whether GetChunk() can be called from several threads at the same time.
+    // Most deserializers read through a single file handle, so the default is no.
+    virtual bool IsGetChunkThreadSafe() const { return false; }
+
     virtual ~IDataDeserializer() {};
 };
 
@@ -6,7 +6,12 @@
 #define __STDC_FORMAT_MACROS
 #define _CRT_SECURE_NO_WARNINGS
 #include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <future>
+#include <thread>
 #include "Indexer.h"
+#include "MemoryMappedFile.h"
 
 using std::string;
 
@@ -14,10 +19,65 @@ const static char ROW_DELIMITER = '\n';
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Parses the digits at the beginning of the line at 'pos' into a sequence id, like Indexer::TryGetSequenceId().
+static bool TryParseSequenceId(const char* data, size_t size, size_t pos, size_t& id)
+{
+    bool found = false;
+    id = 0;
+    for (; pos < size; ++pos)
+    {
+        char c = data[pos];
+        if (!isdigit(c))
+            return found;
+        found = true;
+        id = id * 10 + (c - '0');
+    }
+    return false; // reached EOF without hitting the pipe character
+}
+
+// Returns the offset of the line that follows the one containing 'pos', or 'size' for the last line.
+static size_t NextLineStart(const char* data, size_t size, size_t pos)
+{
+    const char* delimiter = (const char*)memchr(data + pos, ROW_DELIMITER, size - pos);
+    return delimiter ? (delimiter - data) + 1 : size;
+}
+
+// Returns the offset of the line that precedes the line starting at 'lineStart' > 'dataStart'.
+static size_t PreviousLineStart(const char* data, size_t dataStart, size_t lineStart)
+{
+    size_t pos = lineStart - 1; // the delimiter ending the previous line
+    while (pos > dataStart && data[pos - 1] != ROW_DELIMITER)
+        --pos;
+    return pos;
+}
+
+// Modification time of the open file, -1 if it cannot be determined.
+static int64_t GetModificationTime(FILE* file)
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_fstat64(_fileno(file), &st) != 0)
+        return -1;
+    return (int64_t)st.st_mtime;
+#else
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0)
+        return -1;
+    return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+static const char s_indexCacheMagic[8] = { 'C', 'N', 'T', 'K', 'I', 'D', 'X', '\0' };
+static const uint32_t s_indexCacheVersion = 1;
+
 Indexer::Indexer(FILE* file, bool isPrimary, bool skipSequenceIds, char streamPrefix, size_t chunkSize, size_t bufferSize) :
     m_streamPrefix(streamPrefix),
     m_bufferSize(bufferSize),
     m_file(file),
+    m_numThreads(1),
+    m_minBytesPerThread(s_minBytesPerIndexingThread),
+    m_useIndexCache(false),
+    m_collectSequences(false),
     m_fileOffsetStart(0),
     m_fileOffsetEnd(0),
     m_buffer(new char[bufferSize + 1]),
@@ -101,8 +161,39 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
         return;
     }
 
-    m_index.Reserve(filesize(m_file));
+    size_t fileSize = filesize(m_file);
+    m_index.Reserve(fileSize);
+
+    const bool skipSequenceIds = !m_hasSequenceIds;
+    const bool useIndexCache = m_useIndexCache && !m_filePath.empty();
+    std::vector<IndexedSequence> sequences;
+    if (useIndexCache && TryReadIndexCache(skipSequenceIds, sequences))
+    {
+        AddSequences(corpus, sequences);
+        return;
+    }
+
+    size_t numThreads = m_numThreads > 0 ? m_numThreads : std::thread::hardware_concurrency();
+    numThreads = std::min(numThreads, fileSize / m_minBytesPerThread);
+    if (numThreads > 1 && !m_filePath.empty())
+    {
+        BuildInParallel(numThreads, sequences);
+        AddSequences(corpus, sequences);
+    }
+    else
+    {
+        m_collectSequences = useIndexCache;
+        BuildSequentially(corpus);
+        m_collectSequences = false;
+        sequences.swap(m_sequences);
+    }
+
+    if (useIndexCache)
+        WriteIndexCache(skipSequenceIds, sequences);
+}
 
+void Indexer::BuildSequentially(CorpusDescriptorPtr corpus)
+{
     RefillBuffer(); // read the first block of data
     if (m_done)
     {
@@ -161,8 +252,217 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
     AddSequenceIfIncluded(corpus, currentKey, sd);
 }
 
+void Indexer::BuildInParallel(size_t numThreads, std::vector<IndexedSequence>& sequences)
+{
+    MemoryMappedFile file(m_filePath);
+    const char* data = (const char*)file.Data();
+    const size_t size = file.Size();
+
+    size_t dataStart = 0;
+    if (size > 3 && data[0] == '\xEF' && data[1] == '\xBB' && data[2] == '\xBF')
+    {
+        // input file contains UTF-8 BOM value, skip it.
+        dataStart = 3;
+    }
+
+    // same decision as in BuildSequentially()
+    const bool fromLines = !m_hasSequenceIds || data[dataStart] == m_streamPrefix;
+    if (fromLines)
+    {
+        m_hasSequenceIds = false;
+    }
+    else
+    {
+        size_t id;
+        if (!TryParseSequenceId(data, size, dataStart, id))
+            RuntimeError("Expected a sequence id at the offset %" PRIi64 ", none was found.", (int64_t)dataStart);
+    }
+
+    // Each range reports the sequences starting in it, and scans past its end up to the start
+    // of the next sequence, so the ranges can be concatenated without fixing up sizes.
+    std::vector<std::future<std::vector<IndexedSequence>>> ranges;
+    const size_t rangeSize = (size - dataStart) / numThreads;
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        size_t begin = dataStart + i * rangeSize;
+        size_t end = (i + 1 == numThreads) ? size : begin + rangeSize;
+        ranges.push_back(std::async(std::launch::async, [=]()
+        {
+            return ScanRange(data, dataStart, size, begin, end, fromLines);
+        }));
+    }
+
+    for (auto& range : ranges)
+    {
+        std::vector<IndexedSequence> rangeSequences = range.get();
+        if (fromLines)
+        {
+            // ranges number their lines from 0
+            for (auto& s : rangeSequences)
+                s.m_key += sequences.size();
+        }
+        sequences.insert(sequences.end(), rangeSequences.begin(), rangeSequences.end());
+    }
+}
+
+std::vector<Indexer::IndexedSequence> Indexer::ScanRange(const char* data, size_t dataStart, size_t size, size_t begin, size_t end, bool fromLines)
+{
+    std::vector<IndexedSequence> result;
+
+    // resync at the first line that starts at or after 'begin'
+    size_t pos = begin;
+    if (pos > dataStart && data[pos - 1] != ROW_DELIMITER)
+        pos = NextLineStart(data, size, pos);
+
+    if (fromLines)
+    {
+        while (pos < end)
+        {
+            size_t next = NextLineStart(data, size, pos);
+            result.push_back({ (int64_t)pos, next - pos, 1, result.size() });
+            pos = next;
+        }
+        return result;
+    }
+
+    // Lines without an id continue the current sequence, and so do lines with the id of the
+    // current sequence. The current sequence at 'pos' is that of the closest preceding line with an id.
+    size_t currentKey = 0;
+    bool hasCurrentKey = false;
+    for (size_t lineStart = pos; pos < size && lineStart > dataStart && !hasCurrentKey;)
+    {
+        lineStart = PreviousLineStart(data, dataStart, lineStart);
+        hasCurrentKey = TryParseSequenceId(data, size, lineStart, currentKey);
+    }
+
+    while (pos < size)
+    {
+        size_t id;
+        if (TryParseSequenceId(data, size, pos, id) && (!hasCurrentKey || id != currentKey))
+        {
+            if (pos >= end)
+                break; // this sequence starts in the next range
+
+            if (!result.empty())
+                result.back().m_byteSize = pos - result.back().m_fileOffsetBytes;
+            result.push_back({ (int64_t)pos, 0, 0, id });
+            currentKey = id;
+            hasCurrentKey = true;
+        }
+
+        pos = NextLineStart(data, size, pos);
+        if (!result.empty())
+            result.back().m_numberOfSamples++; // lines before the first sequence belong to the previous range
+    }
+
+    if (!result.empty())
+        result.back().m_byteSize = pos - result.back().m_fileOffsetBytes;
+    return result;
+}
+
+void Indexer::AddSequences(CorpusDescriptorPtr corpus, const std::vector<IndexedSequence>& sequences)
+{
+    for (const auto& s : sequences)
+    {
+        SequenceDescriptor sd = {};
+        sd.m_fileOffsetBytes = s.m_fileOffsetBytes;
+        sd.m_byteSize = s.m_byteSize;
+        sd.m_numberOfSamples = (uint32_t)s.m_numberOfSamples;
+        AddSequenceIfIncluded(corpus, s.m_key, sd);
+    }
+}
+
+bool Indexer::TryReadIndexCache(bool skipSequenceIds, std::vector<IndexedSequence>& sequences)
+{
+    const int64_t modificationTime = GetModificationTime(m_file);
+    if (modificationTime == -1)
+        return false;
+
+    FILE* f = _wfopen(GetIndexCachePath().c_str(), L"rb");
+    if (!f)
+        return false;
+
+    auto read = [f](void* data, size_t size) { return fread(data, 1, size, f) == size; };
+
+    char magic[sizeof(s_indexCacheMagic)];
+    uint32_t version;
+    uint64_t fileSize, numSequences;
+    int64_t fileTime;
+    char cachedSkipSequenceIds, cachedStreamPrefix, hasSequenceIds;
+    bool valid = read(magic, sizeof(magic)) && memcmp(magic, s_indexCacheMagic, sizeof(magic)) == 0 &&
+                 read(&version, sizeof(version)) && version == s_indexCacheVersion &&
+                 read(&fileSize, sizeof(fileSize)) && fileSize == filesize(m_file) &&
+                 read(&fileTime, sizeof(fileTime)) && fileTime == modificationTime &&
+                 read(&cachedSkipSequenceIds, 1) && (cachedSkipSequenceIds != 0) == skipSequenceIds &&
+                 read(&cachedStreamPrefix, 1) && cachedStreamPrefix == m_streamPrefix &&
+                 read(&hasSequenceIds, 1) &&
+                 read(&numSequences, sizeof(numSequences)) && numSequences <= fileSize;
+    if (valid)
+    {
+        sequences.resize(numSequences);
+        valid = numSequences == 0 || read(sequences.data(), numSequences * sizeof(IndexedSequence));
+    }
+    fclose(f);
+
+    if (!valid)
+    {
+        sequences.clear();
+        return false;
+    }
+
+    m_hasSequenceIds = hasSequenceIds != 0;
+    return true;
+}
+
+void Indexer::WriteIndexCache(bool skipSequenceIds, const std::vector<IndexedSequence>& sequences)
+{
+    const int64_t modificationTime = GetModificationTime(m_file);
+    if (modificationTime == -1)
+        return;
+
+    // Write to a temporary file first, so that concurrent readers (e.g. other workers of a
+    // distributed job) never see a partially written cache.
+    std::wstring cachePath = GetIndexCachePath();
+    std::wstring tempPath = cachePath + L".tmp" + std::to_wstring(GetCurrentProcessId());
+    FILE* f = _wfopen(tempPath.c_str(), L"wb");
+    if (!f)
+    {
+        fprintf(stderr, "WARNING: Cannot write the index cache '%ls'.\n", cachePath.c_str());
+        return;
+    }
+
+    try
+    {
+        uint64_t fileSize = filesize(m_file);
+        uint64_t numSequences = sequences.size();
+        char flags[3] = { (char)skipSequenceIds, m_streamPrefix, (char)m_hasSequenceIds };
+        fwriteOrDie(s_indexCacheMagic, sizeof(s_indexCacheMagic), 1, f);
+        fwriteOrDie(&s_indexCacheVersion, sizeof(s_indexCacheVersion), 1, f);
+        fwriteOrDie(&fileSize, sizeof(fileSize), 1, f);
+        fwriteOrDie(&modificationTime, sizeof(modificationTime), 1, f);
+        fwriteOrDie(flags, 1, sizeof(flags), f);
+        fwriteOrDie(&numSequences, sizeof(numSequences), 1, f);
+        if (!sequences.empty())
+            fwriteOrDie(sequences.data(), sizeof(IndexedSequence), sequences.size(), f);
+        fflushOrDie(f);
+        fclose(f);
+        f = nullptr;
+        renameOrDie(tempPath, cachePath);
+    }
+    catch (const std::exception& e)
+    {
+        if (f)
+            fclose(f);
+        _wunlink(tempPath.c_str());
+        fprintf(stderr, "WARNING: Cannot write the index cache '%ls': %s\n", cachePath.c_str(), e.what());
+    }
+}
+
 void Indexer::AddSequenceIfIncluded(CorpusDescriptorPtr corpus, size_t sequenceId, SequenceDescriptor& sd)
 {
+    if (m_collectSequences)
+        m_sequences.push_back({ sd.m_fileOffsetBytes, sd.m_byteSize, sd.m_numberOfSamples, sequenceId });
+
     auto key = std::to_string(sequenceId);
     if (corpus->IsIncluded(key))
     {
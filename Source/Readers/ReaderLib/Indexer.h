@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <string>
 #include <vector>
 #include "DataDeserializer.h"
 #include "CorpusDescriptor.h"
@@ -119,11 +120,29 @@ struct Index
 // others specify size and file offset of the respective structure).
 // As opposed to the data deserializer, indexer performs almost no parsing 
 // and therefore is several magnitudes faster.
+// Large files can be indexed by several threads, each scanning a byte range of a memory mapping
+// of the file, and the result of the scan can be cached on disk next to the input file.
 class Indexer
 {
 public:
     Indexer(FILE* file, bool isPrimary, bool skipSequenceIds = false, char streamPrefix = '|', size_t chunkSize = 32 * 1024 * 1024, size_t bufferSize = 2 * 1024 * 1024);
 
+    // Sets the path of the input file. Both parallel indexing and the index cache need it,
+    // without it the file is indexed sequentially through the FILE handle.
+    void SetFilePath(const std::wstring& path) { m_filePath = path; }
+
+    // Sets the number of threads used to index the file (0 = one per hardware thread).
+    // Files smaller than 'minBytesPerThread' per thread use fewer threads.
+    void SetNumThreads(size_t numThreads, size_t minBytesPerThread = s_minBytesPerIndexingThread)
+    {
+        m_numThreads = numThreads;
+        m_minBytesPerThread = std::max<size_t>(minBytesPerThread, 1);
+    }
+
+    // If set, the sequences found in the input file are stored in <file>.cntkindex and reused by
+    // later runs, as long as the size and modification time of the input file did not change.
+    void SetUseIndexCache(bool useIndexCache) { m_useIndexCache = useIndexCache; }
+
     // Reads the input file, building and index of chunks and corresponding
     // sequences.
     void Build(CorpusDescriptorPtr corpus);
@@ -136,8 +155,29 @@ public:
     // (by passing skipSequenceIds = true to the constructor).
     bool HasSequenceIds() const { return m_hasSequenceIds; }
 
+    // The smallest byte range of the input file worth indexing on a separate thread.
+    static const size_t s_minBytesPerIndexingThread = 16 * 1024 * 1024;
+
 private:
+    // A sequence as found in the input file, before it is filtered by the corpus and
+    // assigned to a chunk. This is what the parallel scan produces and what the index cache stores.
+    struct IndexedSequence
+    {
+        int64_t m_fileOffsetBytes;
+        uint64_t m_byteSize;
+        uint64_t m_numberOfSamples;
+        uint64_t m_key; // sequence id, or line number if the input has no sequence ids
+    };
+
     FILE* m_file;
+    std::wstring m_filePath;
+    size_t m_numThreads;
+    size_t m_minBytesPerThread;
+    bool m_useIndexCache;
+
+    // sequences found by the sequential scan, collected only if the index cache is written afterwards
+    bool m_collectSequences;
+    std::vector<IndexedSequence> m_sequences;
 
     int64_t m_fileOffsetStart;
     int64_t m_fileOffsetEnd;
@@ -180,6 +220,29 @@ private:
     // the corresponding sequence id.
     void BuildFromLines(CorpusDescriptorPtr corpus);
 
+    // Single pass over the file through the FILE handle.
+    void BuildSequentially(CorpusDescriptorPtr corpus);
+
+    // Splits the memory-mapped file into byte ranges that are scanned concurrently, and
+    // returns the sequences found in file order. Yields the same index as BuildSequentially().
+    void BuildInParallel(size_t numThreads, std::vector<IndexedSequence>& sequences);
+
+    // Finds the sequences that start in the byte range [begin, end) of the mapped file data[0, size).
+    static std::vector<IndexedSequence> ScanRange(const char* data, size_t dataStart, size_t size, size_t begin, size_t end, bool fromLines);
+
+    // Adds the sequences found by BuildInParallel() or read from the cache to the index.
+    void AddSequences(CorpusDescriptorPtr corpus, const std::vector<IndexedSequence>& sequences);
+
+    // The index cache file for the input file.
+    std::wstring GetIndexCachePath() const { return m_filePath + L".cntkindex"; }
+
+    // Reads the cached sequences, returns false if there is no cache or it does not match the input file.
+    // 'skipSequenceIds' is part of the cache key, since it changes what the sequences are.
+    bool TryReadIndexCache(bool skipSequenceIds, std::vector<IndexedSequence>& sequences);
+
+    // Writes the sequences to the index cache. Failures only produce a warning.
+    void WriteIndexCache(bool skipSequenceIds, const std::vector<IndexedSequence>& sequences);
+
     // Returns current offset in the input file (in bytes). 
     int64_t GetFileOffset() const { return m_fileOffsetStart + (m_pos - m_bufferStart); }
 
@@ -350,12 +350,18 @@ template <class ElemType>
 typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMinibatch(size_t currentDataTransferIndex)
 {
     PROFILE_SCOPE(profilerEvtPrefetchMinibatch);
+    if (m_launchType == launch::async)
+        ProfilerTraceSetThreadName("Reader");
 
     // Resetting layouts.
     for (auto& mx : m_prefetchBuffers)
         mx.second.m_mbLayout = std::make_shared<MBLayout>();
 
-    Minibatch minibatch = m_reader->ReadMinibatch();
+    Minibatch minibatch;
+    {
+        TRACE_SCOPE("Read Minibatch", profilerTraceReader);
+        minibatch = m_reader->ReadMinibatch();
+    }
 
     // If there is no data we can simply return.
     if (minibatch.m_data.empty())
@@ -368,6 +374,7 @@ typename ReaderShim<ElemType>::PrefetchResult ReaderShim<ElemType>::PrefetchMini
     if (m_dataTransferers[currentDataTransferIndex])
         m_dataTransferers[currentDataTransferIndex]->WaitForSyncPointOnAssignStreamAsync();
 
+    TRACE_SCOPE("Fill Minibatch Matrices", profilerTraceReader);
     for (auto& mx : m_prefetchBuffers)
     {
         size_t streamId = m_nameToStreamId[mx.first];
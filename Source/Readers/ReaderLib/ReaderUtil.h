@@ -24,6 +24,22 @@ inline size_t GetSizeByType(ElementType type)
     }
 }
 
+// Estimated in-memory size of one sample over all streams, for chunks that do not know their size:
+// dense samples at their full size, sparse samples as having a single non-zero value (e.g. one-hot labels).
+inline size_t GetEstimatedSampleSizeInBytes(const std::vector<StreamDescriptionPtr>& streams)
+{
+    size_t bytesPerSample = 0;
+    for (const auto& stream : streams)
+    {
+        size_t elementSize = GetSizeByType(stream->m_elementType);
+        if (stream->m_storageType == StorageType::dense && stream->m_sampleLayout)
+            bytesPerSample += stream->m_sampleLayout->GetNumElements() * elementSize;
+        else
+            bytesPerSample += elementSize + sizeof(IndexType);
+    }
+    return bytesPerSample;
+}
+
 static std::vector<unsigned char> FillIndexTable()
 {
     std::vector<unsigned char> indexTable;
@@ -19,6 +19,17 @@ public:
     // Returns a boolean indicating if any samples were processed
     virtual bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) = 0;
 
+    // Whether the aggregator can start aggregating a gradient while the rest of the network is still being backpropagated.
+    // If so, the caller passes each gradient to GradientReady() as soon as it is final, before AggregateGradients() is
+    // called for the same minibatch with all gradients.
+    virtual bool CanAggregateEarly() const
+    {
+        return false;
+    }
+
+    virtual void GradientReady(const Matrix<ElemType>* /*gradient*/)
+    {}
+
     size_t NumProc()
     {
         return m_mpi->NumNodesInUse();
@@ -0,0 +1,342 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// QuantizedDistGradAggregator.h -- data-parallel aggregation of CPU gradients quantized to a few bits per value
+//
+// Each gradient is quantized column by column to numGradientBits bits per value (see ColumnQuantizer.h). The
+// quantization error is kept as a residual and added to the gradient of the next minibatch (error feedback), so that
+// no part of the gradient is lost, only delayed. The columns are split into one stripe per rank, and the aggregation is
+// a reduce-scatter followed by an allgather of quantized stripes:
+//  - every rank sends stripe r of its quantized gradient to rank r,
+//  - rank r unquantizes and sums the stripes it receives, and quantizes the sum again, with a residual of its own,
+//  - every rank sends its quantized sum to all others, which unquantize it into their gradient.
+// Every rank sends and receives 2(N-1)/N times the quantized gradient, which is 32/numGradientBits times smaller than
+// the gradient itself in single precision (minus two values per column for the quantization range).
+// Gradients that are too small to be worth quantizing are summed with one MPI_Iallreduce in full precision.
+//
+
+#pragma once
+
+#include "IDistGradAggregator.h"
+#include "MatrixQuantizerImpl.h"
+#include "TimerUtility.h"
+#include "PerformanceProfiler.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <class ElemType>
+class QuantizedDistGradAggregator : public IDistGradAggregator<ElemType>
+{
+    UsingIDistGradAggregatorMembers;
+
+    // Columns of a quantized gradient have at least this many values, so that the quantization range stored with each
+    // column adds little to its size. Gradients with shorter columns are viewed as matrices with fewer, longer columns.
+    static const size_t MinColumnHeight = 64;
+
+public:
+    QuantizedDistGradAggregator(const MPIWrapperPtr& mpi, int numGradientBits, bool zeroThresholdFor1Bit, int syncStatsTrace)
+        : IDistGradAggregator<ElemType>(mpi), m_numGradientBits(numGradientBits), m_zeroThresholdFor1Bit(zeroThresholdFor1Bit), m_syncStatsTrace(syncStatsTrace),
+          m_iterationCount(0), m_initialized(false), m_quantizer(MatrixQuantizerImpl<ElemType>::Create(CPUDEVICE, false /*useAsync*/))
+    {
+        if (numGradientBits < 1 || numGradientBits >= (int) (8 * sizeof(ElemType)) || 64 % numGradientBits != 0)
+            InvalidArgument("QuantizedDistGradAggregator: The number of gradient bits (%d) must be 1, 2, 4, 8%s.", numGradientBits, sizeof(ElemType) > 4 ? ", 16 or 32" : " or 16");
+    }
+
+    // Aggregate the gradient matrices across all nodes
+    bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) override
+    {
+        TRACE_SCOPE("Aggregate Gradients", profilerTraceAggregation);
+        ResetState(gradients, resetState);
+        bool showSyncPerfStats = (m_syncStatsTrace > 0) && ((m_iterationCount % m_syncStatsTrace) == 0);
+        m_iterationCount++;
+        Timer aggregationTimer;
+        if (showSyncPerfStats)
+            aggregationTimer.Start();
+
+        // If the current node did not process any samples, the gradients should be zero'd. The residuals are still sent.
+        if (headerCPU->numSamples == 0)
+        {
+            for (auto gradient : gradients)
+                gradient->SetValue(0);
+        }
+
+        // The full precision gradients are packed into one buffer and reduced while the quantized ones are exchanged.
+        MPI_Request allReduceRequest = MPI_REQUEST_NULL;
+        if (!m_fullPrecisionBuffer.empty())
+        {
+            ElemType* p = m_fullPrecisionBuffer.data();
+            for (const auto& stripes : m_stripes)
+            {
+                if (!stripes.quantized)
+                {
+                    memcpy(p, stripes.gradient->Data(), stripes.gradient->GetNumElements() * sizeof(ElemType));
+                    p += stripes.gradient->GetNumElements();
+                }
+            }
+            MPI_Iallreduce(MPI_IN_PLACE, m_fullPrecisionBuffer.data(), (int) m_fullPrecisionBuffer.size(), MPIWrapper::GetDataType(m_fullPrecisionBuffer.data()),
+                           MPI_SUM, m_mpi->Communicator(), &allReduceRequest) || MpiFail("MPI_Iallreduce");
+        }
+
+        // reduce-scatter: quantize, send stripe r to rank r, and receive this rank's stripe from all others
+        std::vector<MPI_Request> requests;
+        std::vector<MPI_Request> recvRequests;
+        for (size_t i = 0; i < m_stripes.size(); i++)
+        {
+            auto& stripes = m_stripes[i];
+            if (!stripes.quantized)
+                continue;
+            m_quantizer->QuantizeAsync(stripes.view, stripes.residual, *stripes.quantizedGradient, stripes.residual, m_zeroThresholdFor1Bit);
+            m_quantizer->WaitQuantizeAsyncDone();
+            for (size_t r = 0; r < NumProc(); r++)
+            {
+                if (r == MyRank())
+                    continue;
+                if (stripes.NumCols(r) != 0)
+                {
+                    auto stripe = stripes.quantizedGradient->ColumnSlice(stripes.Begin(r), stripes.NumCols(r));
+                    requests.push_back(MPI_REQUEST_NULL);
+                    MPI_Isend(stripe.Buffer(), (int) stripe.GetSize(), MPI_CHAR, (int) r, (int) (2 * i), m_mpi->Communicator(), &requests.back()) || MpiFail("MPI_Isend");
+                }
+                if (stripes.NumCols(MyRank()) != 0)
+                {
+                    auto& received = *stripes.receivedStripes[r];
+                    recvRequests.push_back(MPI_REQUEST_NULL);
+                    MPI_Irecv(received.Buffer(), (int) received.GetSize(), MPI_CHAR, (int) r, (int) (2 * i), m_mpi->Communicator(), &recvRequests.back()) || MpiFail("MPI_Irecv");
+                }
+            }
+        }
+        MPI_Waitall((int) recvRequests.size(), recvRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        // the quantized gradients receive the aggregated stripes below
+        MPI_Waitall((int) requests.size(), requests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        requests.clear();
+        recvRequests.clear();
+
+        // Sum this rank's stripe, quantize it again, and exchange the sums with all other ranks. This rank's quantized
+        // stripe is used for the sum as well, since its quantization error is already in the residual.
+        for (size_t i = 0; i < m_stripes.size(); i++)
+        {
+            auto& stripes = m_stripes[i];
+            if (!stripes.quantized || stripes.NumCols(MyRank()) == 0)
+                continue;
+            auto ownStripe = stripes.quantizedGradient->ColumnSlice(stripes.Begin(MyRank()), stripes.NumCols(MyRank()));
+            m_quantizer->UnquantizeAsync(ownStripe, stripes.aggregatedStripe, false);
+            for (size_t r = 0; r < NumProc(); r++)
+            {
+                if (r != MyRank())
+                    m_quantizer->UnquantizeAsync(*stripes.receivedStripes[r], stripes.aggregatedStripe, true);
+            }
+            m_quantizer->WaitUnquantizeAsyncDone();
+            m_quantizer->QuantizeAsync(stripes.aggregatedStripe, stripes.aggregatedResidual, ownStripe, stripes.aggregatedResidual, m_zeroThresholdFor1Bit);
+            m_quantizer->WaitQuantizeAsyncDone();
+        }
+
+        // allgather: send the quantized sum of this rank's stripe to all others, and receive theirs
+        for (size_t i = 0; i < m_stripes.size(); i++)
+        {
+            auto& stripes = m_stripes[i];
+            if (!stripes.quantized)
+                continue;
+            for (size_t r = 0; r < NumProc(); r++)
+            {
+                if (r == MyRank())
+                    continue;
+                if (stripes.NumCols(MyRank()) != 0)
+                {
+                    auto ownStripe = stripes.quantizedGradient->ColumnSlice(stripes.Begin(MyRank()), stripes.NumCols(MyRank()));
+                    requests.push_back(MPI_REQUEST_NULL);
+                    MPI_Isend(ownStripe.Buffer(), (int) ownStripe.GetSize(), MPI_CHAR, (int) r, (int) (2 * i + 1), m_mpi->Communicator(), &requests.back()) || MpiFail("MPI_Isend");
+                }
+                if (stripes.NumCols(r) != 0)
+                {
+                    auto stripe = stripes.quantizedGradient->ColumnSlice(stripes.Begin(r), stripes.NumCols(r));
+                    recvRequests.push_back(MPI_REQUEST_NULL);
+                    MPI_Irecv(stripe.Buffer(), (int) stripe.GetSize(), MPI_CHAR, (int) r, (int) (2 * i + 1), m_mpi->Communicator(), &recvRequests.back()) || MpiFail("MPI_Irecv");
+                }
+            }
+        }
+
+        // Meanwhile, aggregate the headers on the main node and send the result back.
+        AggregateHeaders(headerCPU);
+
+        MPI_Waitall((int) recvRequests.size(), recvRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        MPI_Waitall((int) requests.size(), requests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        for (auto& stripes : m_stripes)
+        {
+            if (!stripes.quantized)
+                continue;
+            m_quantizer->UnquantizeAsync(*stripes.quantizedGradient, stripes.view, false);
+            m_quantizer->WaitUnquantizeAsyncDone();
+        }
+
+        MPI_Wait(&allReduceRequest, MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+        if (!m_fullPrecisionBuffer.empty())
+        {
+            const ElemType* p = m_fullPrecisionBuffer.data();
+            for (const auto& stripes : m_stripes)
+            {
+                if (!stripes.quantized)
+                {
+                    memcpy(stripes.gradient->Data(), p, stripes.gradient->GetNumElements() * sizeof(ElemType));
+                    p += stripes.gradient->GetNumElements();
+                }
+            }
+        }
+
+        if (showSyncPerfStats)
+        {
+            aggregationTimer.Stop();
+            double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
+            size_t numBytes = 0, numQuantizedBytes = 0;
+            for (const auto& stripes : m_stripes)
+            {
+                numBytes += stripes.gradient->GetNumElements() * sizeof(ElemType);
+                numQuantizedBytes += stripes.quantized ? stripes.quantizedGradient->GetSize() : stripes.gradient->GetNumElements() * sizeof(ElemType);
+            }
+            fprintf(stderr, "Actual gradient aggregation time: %.6g\n", gradientAggregationTime);
+            fprintf(stderr, "Gradient aggregation: %d gradients, %.6g MB, %.6g MB after %d-bit quantization\n",
+                    (int) gradients.size(), numBytes / 1e6, numQuantizedBytes / 1e6, m_numGradientBits);
+        }
+
+        return (headerCPU->numSamples != 0);
+    }
+
+private:
+    // a gradient, and if it is quantized, the buffers for its stripes
+    struct Stripes
+    {
+        Matrix<ElemType>* gradient;
+        bool quantized;
+        Matrix<ElemType> view;     // the gradient as a matrix with columns of at least MinColumnHeight values
+        Matrix<ElemType> residual; // of the quantization of the gradient
+        std::unique_ptr<QuantizedMatrix<ElemType>> quantizedGradient;
+        std::vector<std::unique_ptr<QuantizedMatrix<ElemType>>> receivedStripes; // [r] this rank's stripe from rank r
+        Matrix<ElemType> aggregatedStripe;                                        // sum of this rank's stripe
+        Matrix<ElemType> aggregatedResidual;                                      // of the quantization of the sum
+        size_t numProc;
+
+        Stripes(Matrix<ElemType>* gradient, size_t columnHeight, size_t numProc, size_t myRank, size_t numBits)
+            : gradient(gradient), quantized(columnHeight != 0),
+              view(gradient->ColumnSlice(0, gradient->GetNumCols())), residual(CPUDEVICE), aggregatedStripe(CPUDEVICE), aggregatedResidual(CPUDEVICE), numProc(numProc)
+        {
+            if (!quantized)
+                return;
+            const size_t numCols = gradient->GetNumElements() / columnHeight;
+            view.Reshape(columnHeight, numCols);
+            residual.Resize(columnHeight, numCols);
+            residual.SetValue(0);
+            quantizedGradient.reset(new QuantizedMatrix<ElemType>(columnHeight, numCols, numBits, CPUDEVICE));
+            receivedStripes.resize(numProc);
+            for (size_t r = 0; r < numProc; r++)
+            {
+                if (r != myRank && NumCols(myRank) != 0)
+                    receivedStripes[r].reset(new QuantizedMatrix<ElemType>(columnHeight, NumCols(myRank), numBits, CPUDEVICE));
+            }
+            aggregatedStripe.Resize(columnHeight, NumCols(myRank));
+            aggregatedResidual.Resize(columnHeight, NumCols(myRank));
+            aggregatedResidual.SetValue(0);
+        }
+
+        // stripe r are the columns [Begin(r), Begin(r + 1))
+        size_t Begin(size_t r) const
+        {
+            return view.GetNumCols() * r / numProc;
+        }
+
+        size_t NumCols(size_t r) const
+        {
+            return Begin(r + 1) - Begin(r);
+        }
+    };
+
+    // The height of the columns of the gradient when quantized: its number of rows times the smallest number of its
+    // columns that gives at least MinColumnHeight values, or 0 to not quantize it.
+    static size_t ColumnHeight(const Matrix<ElemType>& gradient)
+    {
+        const size_t numRows = gradient.GetNumRows();
+        const size_t numCols = gradient.GetNumCols();
+        for (size_t k = 1; k <= numCols; k++)
+        {
+            if (numCols % k == 0 && numRows * k >= MinColumnHeight)
+                return numCols / k >= 2 ? numRows * k : 0; // a single column is not worth quantizing
+        }
+        return 0;
+    }
+
+    void ResetState(const std::vector<Matrix<ElemType>*>& gradients, bool resetState)
+    {
+        if (!m_initialized)
+        {
+            m_initialized = true;
+            size_t numFullPrecisionElements = 0;
+            m_stripes.reserve(gradients.size());
+            for (auto gradient : gradients)
+            {
+                if (gradient->GetDeviceId() != CPUDEVICE)
+                    LogicError("QuantizedDistGradAggregator: Only gradients on the CPU can be aggregated.");
+                if (gradient->GetMatrixType() != DENSE)
+                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+
+                m_stripes.emplace_back(gradient, ColumnHeight(*gradient), NumProc(), MyRank(), m_numGradientBits);
+                if (!m_stripes.back().quantized)
+                    numFullPrecisionElements += gradient->GetNumElements();
+            }
+            m_fullPrecisionBuffer.resize(numFullPrecisionElements);
+        }
+        else if (resetState)
+        {
+            // the residuals belong to the previous model
+            for (auto& stripes : m_stripes)
+            {
+                if (stripes.quantized)
+                {
+                    stripes.residual.SetValue(0);
+                    stripes.aggregatedResidual.SetValue(0);
+                }
+            }
+        }
+
+        if (gradients.size() != m_stripes.size())
+            LogicError("QuantizedDistGradAggregator: The gradients must be the same in every call.");
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            if (gradients[i] != m_stripes[i].gradient)
+                LogicError("QuantizedDistGradAggregator: The gradients must be the same in every call.");
+        }
+    }
+
+    // sum of the headers of all ranks, on all ranks
+    void AggregateHeaders(DistGradHeader* headerCPU)
+    {
+        const size_t headerSize = headerCPU->Size();
+        if (m_mpi->IsMainNode())
+            m_headerBuffer.resize(headerSize * NumProc());
+        MPI_Gather(headerCPU, (int) headerSize, MPI_CHAR, m_headerBuffer.data(), (int) headerSize, MPI_CHAR, (int) m_mpi->MainNodeRank(), m_mpi->Communicator()) || MpiFail("MPI_Gather");
+        if (m_mpi->IsMainNode())
+        {
+            for (size_t r = 0; r < NumProc(); r++)
+            {
+                if (r != MyRank())
+                    headerCPU->Aggregate((DistGradHeader*) &m_headerBuffer[r * headerSize], true);
+            }
+        }
+        MPI_Bcast(headerCPU, (int) headerSize, MPI_CHAR, (int) m_mpi->MainNodeRank(), m_mpi->Communicator()) || MpiFail("MPI_Bcast");
+    }
+
+private:
+    int m_numGradientBits;
+    bool m_zeroThresholdFor1Bit;
+
+    int m_syncStatsTrace;
+
+    // Only used for controlling frequency of measuring/showing gradient aggregation perf stats
+    size_t m_iterationCount;
+
+    bool m_initialized;
+
+    std::unique_ptr<MatrixQuantizerImpl<ElemType>> m_quantizer;
+    std::vector<Stripes> m_stripes;                // [i] for gradient i
+    std::vector<ElemType> m_fullPrecisionBuffer;  // the gradients that are not quantized, packed
+    std::vector<char> m_headerBuffer;             // the headers of all ranks, on the main node
+};
+} } }
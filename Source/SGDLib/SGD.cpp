@@ -32,6 +32,7 @@
 
 #include "SimpleDistGradAggregator.h"
 #include "V2SimpleDistGradAggregator.h"
+#include "QuantizedDistGradAggregator.h"
 #include "ProgressTracing.h"
 #include "PerformanceProfiler.h"
 
@@ -432,6 +433,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         if (i > startEpoch)
         {
             ProfilerEnable(true);
+            ProfilerTraceSetThreadName("Main");
         }
 
         // Synchronize all ranks before proceeding to ensure that
@@ -592,6 +594,8 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         for (size_t j = 0; j < epochEvalErrors.size(); j++)
             epochEvalErrors[j].LogCriterion(evaluationNodes[j]->NodeName());
         fprintf(stderr, "totalSamplesSeen = %d; learningRatePerSample = %.8g; epochTime=%.6gs\n", (int)totalTrainingSamplesSeen, learnRatePerSample, epochTime);
+        if (i == startEpoch && m_traceLevel > 0) // matrices now have their actual sizes
+            net->PrintMemoryPlan();
 #if 0
         // TODO: This was only printed if >1 eval criterion. Why? Needed?
         LOGPRINTF(stderr, "Finished Epoch[%2d of %d]:     Criterion Node [%ls] Per Sample = %.8g\n",
@@ -1094,6 +1098,17 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             // We optionally break the minibatch into sub-minibatches.
             // This, when enabled, is used when a full minibatch does not fit into GPU RAM.
             size_t actualNumSubminibatches = numSubminibatchesNeeded <= 1 ? 1 : smbDispatcher.GetMinibatchIntoCache(*trainSetDataReader, *net, *inputMatrices, numSubminibatchesNeeded);
+
+            // Let the aggregator start on the gradients that backprop has finalized while it computes the others.
+            // With sub-minibatches, the gradients are only final after the last one.
+            ComputationNetwork::GradientReadyCallback onGradientReady;
+            if (useGradientAggregation && m_aggregateGradientsDuringBackprop && actualNumSubminibatches == 1 && m_distGradAgg->CanAggregateEarly())
+            {
+                onGradientReady = [this](const ComputationNodeBasePtr& node)
+                {
+                    m_distGradAgg->GradientReady(&dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Gradient());
+                };
+            }
             for (size_t ismb = 0; ismb < actualNumSubminibatches; ismb++)
             {
                 if (actualNumSubminibatches > 1)
@@ -1116,7 +1131,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                 // ===========================================================
 
                 if (learnRatePerSample > 0.01 * m_minLearnRate) // only compute gradient when learning rate is large enough
-                    net->Backprop(criterionNodes[0]);
+                    net->Backprop(criterionNodes[0], onGradientReady);
 
                 // house-keeping for sub-minibatching
                 if (actualNumSubminibatches > 1)
@@ -2090,7 +2105,11 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int d
         else
             m_distGradAgg = std::make_shared<AllReduceDistGradAggregator<ElemType>>(m_mpi, numGradientBits, m_zeroThresholdFor1Bit, true /*useQuantizationForSelfStripe*/, m_bufferedAsyncGradientAggregation, traceLevel, m_syncStatsTrace);
 #else
-        RuntimeError("Gradient quantization is unsupported in CNTK binaries built without quantized gradient aggregation support!");
+        if (deviceId != CPUDEVICE)
+            RuntimeError("Gradient quantization on the GPU is unsupported in CNTK binaries built without quantized gradient aggregation support!");
+        if (m_bufferedAsyncGradientAggregation && traceLevel > 0)
+            fprintf(stderr, "Quantized gradient aggregation on the CPU is synchronous, useBufferedAsyncGradientAggregation is ignored.\n");
+        m_distGradAgg = std::make_shared<QuantizedDistGradAggregator<ElemType>>(m_mpi, numGradientBits, m_zeroThresholdFor1Bit, m_syncStatsTrace);
 #endif // !CNTK_PARALLEL_TRAINING_SUPPORT
     }
     else
@@ -2100,7 +2119,7 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int d
         if (Globals::UseV2Aggregator()) // Currently used to check V2 against baselines.
             m_distGradAgg = std::make_shared<V2SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, m_syncStatsTrace, ::CNTK::MPICommunicator());
         else
-            m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace);
+            m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, deviceId, m_syncStatsTrace, m_gradientBucketSizeInBytes, m_allReduceAlgorithm);
     }
 
     m_gradHeader.reset(DistGradHeader::Create(numEvalNodes), [](DistGradHeader* ptr) { DistGradHeader::Destroy(ptr); });
@@ -2629,6 +2648,14 @@ static ParallelizationMethod ParseParallelizationMethod(const wstring& s)
     else InvalidArgument("ParseParallelizationMethod: Invalid Parallelization Method. Valid values are (none | DataParallelSGD | ModelAveragingSGD | BlockMomentumSGD | dataParallelASGD)");
 }
 
+static AllReduceAlgorithm ParseAllReduceAlgorithm(const wstring& s)
+{
+    if      (EqualCI(s, L"mpi"))              return AllReduceAlgorithm::mpi;
+    else if (EqualCI(s, L"ring"))             return AllReduceAlgorithm::ring;
+    else if (EqualCI(s, L"hierarchicalRing")) return AllReduceAlgorithm::hierarchicalRing;
+    else InvalidArgument("ParseAllReduceAlgorithm: Invalid allreduce algorithm. Valid values are (mpi | ring | hierarchicalRing)");
+}
+
 static LearningRateSearchAlgorithm ParseLearningRateSearchType(const wstring& s)
 {
     if      (EqualCI(s, L"false") || EqualCI(s, L"none")) return LearningRateSearchAlgorithm::None;
@@ -2893,6 +2920,9 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numGradientBits = vector<int>{8 * (int)sizeofElemType}; // means no quantization
     m_zeroThresholdFor1Bit = true;
     m_bufferedAsyncGradientAggregation = false;
+    m_gradientBucketSizeInBytes = DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES;
+    m_allReduceAlgorithm = AllReduceAlgorithm::mpi;
+    m_aggregateGradientsDuringBackprop = true;
     m_enableDistributedMBReading = false;
     m_parallelizationStartEpochNum = 0;
     m_modelAggregationBlockSize = 0; 
@@ -2926,6 +2956,9 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_numGradientBits = configDataParallelSGD(L"gradientBits", ConfigRecordType::Array(intargvector(vector<int>{defaultGradientBits})));
             m_zeroThresholdFor1Bit = configDataParallelSGD(L"useZeroThresholdFor1BitQuantization", true);
             m_bufferedAsyncGradientAggregation = configDataParallelSGD(L"useBufferedAsyncGradientAggregation", false);
+            m_gradientBucketSizeInBytes = configDataParallelSGD(L"gradientBucketSizeInKB", (size_t) (DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES / 1024)) * 1024;
+            m_allReduceAlgorithm = ParseAllReduceAlgorithm(configDataParallelSGD(L"allReduceAlgorithm", L"mpi"));
+            m_aggregateGradientsDuringBackprop = configDataParallelSGD(L"aggregateGradientsDuringBackprop", true);
             for (size_t i = 0; i < m_numGradientBits.size(); i++)
             {
                 if (m_numGradientBits[i] < 1 || m_numGradientBits[i] > defaultGradientBits)
@@ -20,6 +20,7 @@
 #include "Profiler.h"
 #include "MASGD.h"
 #include "ASGDHelper.h"
+#include "RingAllReduce.h"
 using namespace std; // ugh! TODO: get rid of this from .h files!!!
 
 #define CNTK_CHECKPOINT_VERSION_1 1     // 1 -> no version number 
@@ -273,6 +274,9 @@ protected:
     intargvector m_numGradientBits;
     bool m_bufferedAsyncGradientAggregation;
     bool m_zeroThresholdFor1Bit;
+    size_t m_gradientBucketSizeInBytes;        // gradients smaller than this are fused for aggregation
+    AllReduceAlgorithm m_allReduceAlgorithm;
+    bool m_aggregateGradientsDuringBackprop;   // start aggregating each gradient as soon as backprop has finalized it
 
     // Parallel training related with MA / BM
     size_t m_modelAggregationBlockSize;
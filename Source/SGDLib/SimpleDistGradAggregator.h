@@ -13,21 +13,35 @@
 #include "GPUDataTransferer.h"
 #include "TimerUtility.h"
 #include "MatrixQuantizerImpl.h"
+#include "PerformanceProfiler.h"
+#include "RingAllReduce.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// gradients smaller than this are fused into buckets of up to this size, and each bucket is reduced with one allreduce
+#define DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES (1024 * 1024)
+
 template <class ElemType>
 class SimpleDistGradAggregator : public IDistGradAggregator<ElemType>
 {
     UsingIDistGradAggregatorMembers;
 
 public:
-    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int deviceId, int syncStatsTrace)
-        : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_initialized(false), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0), m_nccl(deviceId, mpi)
-    {}
+    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int deviceId, int syncStatsTrace,
+                             size_t bucketSizeInBytes = DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES, AllReduceAlgorithm allReduceAlgorithm = AllReduceAlgorithm::mpi)
+        : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_initialized(false), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0), m_nccl(deviceId, mpi),
+          m_bucketSizeInBytes(bucketSizeInBytes), m_numBucketsStarted(0), m_allReduceAlgorithm(allReduceAlgorithm)
+    {
+        if (m_allReduceAlgorithm != AllReduceAlgorithm::mpi)
+            m_ringAllReduce.reset(new RingAllReduce<ElemType>(mpi->Communicator(), m_allReduceAlgorithm == AllReduceAlgorithm::hierarchicalRing));
+    }
 
     ~SimpleDistGradAggregator()
     {
+        // the pending aggregation uses the buffers below
+        if (m_pendingAsyncAggregation.valid())
+            m_pendingAsyncAggregation.wait();
+
         for (size_t i = 0; i < m_recvHeaders.size(); ++i)
             DistGradHeader::Destroy(m_recvHeaders[i]);
 
@@ -102,6 +116,7 @@ public:
                     // We are starting on a new thread. Make sure the new thread is
                     // setup to use the right device
                     Matrix<ElemType>::SetDevice(deviceId);
+                    ProfilerTraceSetThreadName("Gradient Aggregation");
 
                     // Synchronize the Quantization compute stream with the completion of
                     // compute of the gradient matrices on the main compute stream
@@ -123,7 +138,70 @@ public:
         }
     }
 
+    // With async aggregation, the gradients are aggregated one minibatch later anyway, and NCCL reduces all at once.
+    bool CanAggregateEarly() const override
+    {
+        return !m_useAsyncAggregation && !m_nccl.IsSupported();
+    }
+
+    // Starts the transfer of a final gradient from the GPU. On the CPU, starts the MPI_Iallreduce of its bucket once all
+    // gradients of the bucket are final. The ring is blocking and thus not started before AggregateGradients().
+    // The first minibatch only records the order in which the gradients become final, see InitBuckets().
+    void GradientReady(const Matrix<ElemType>* gradient) override
+    {
+        if (!CanAggregateEarly())
+            return;
+        if (!m_initialized)
+        {
+            m_observedReadyOrder.push_back(gradient);
+            return;
+        }
+        auto iter = m_gradientIndices.find(gradient);
+        if (iter == m_gradientIndices.end())
+            LogicError("GradientReady: Gradient is not aggregated by this aggregator.");
+        const size_t i = iter->second;
+        if (m_gradientsReady[i])
+            return;
+        m_gradientsReady[i] = true;
+
+        int deviceId = gradient->GetDeviceId();
+        if (deviceId >= 0)
+            m_gpuDataTransferers[i]->CopyGPUToCPUAsync(gradient->Data(), gradient->GetNumElements(), m_intermediateCPUBuffers[i].get());
+        else if (m_allReduceAlgorithm == AllReduceAlgorithm::mpi)
+        {
+            m_numGradientsReady[m_gradientBuckets[i]]++;
+            while (m_numBucketsStarted < m_buckets.size())
+            {
+                const Bucket& bucket = m_buckets[m_numBucketsStarted];
+                if (m_numGradientsReady[m_numBucketsStarted] < bucket.end - bucket.begin)
+                    break;
+                StartAllReduce(m_numBucketsStarted, m_gradients, deviceId);
+            }
+        }
+    }
+
+    // the indices of the gradients in the order in which their buckets are started, once set up by the first
+    // AggregateGradients()
+    const std::vector<size_t>& GradientOrder() const
+    {
+        return m_gradientOrder;
+    }
+
+    size_t NumBucketsStarted() const
+    {
+        return m_numBucketsStarted;
+    }
+
 private:
+    // the gradients in positions [begin, end) of m_gradientOrder are reduced together, in buffer if they are packed (see InitBuckets())
+    struct Bucket
+    {
+        size_t begin;
+        size_t end;
+        size_t numElements;
+        std::shared_ptr<ElemType> buffer;
+    };
+
     std::shared_ptr<ElemType> AllocateIntermediateBuffer(int deviceID, size_t numElements)
     {
         assert(deviceID >= 0);
@@ -147,6 +225,17 @@ private:
             if (!m_nccl.IsSupported() && deviceId != CPUDEVICE)
                 m_allocator.reset(new CUDAPageLockedMemAllocator(deviceId));
 
+            m_gradients = gradients;
+            for (size_t i = 0; i < gradients.size(); i++)
+                m_gradientIndices[gradients[i]] = i;
+
+            if (!m_nccl.IsSupported())
+                InitBuckets(gradients, deviceId);
+
+            m_gradientsReady.assign(gradients.size(), false);
+            m_numGradientsReady.assign(m_buckets.size(), 0);
+            m_allReduceRequests.assign(m_buckets.size(), MPI_REQUEST_NULL);
+
             for (size_t i = 0; i < gradients.size(); i++)
             {
                 // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
@@ -154,10 +243,7 @@ private:
                     RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
 
                 if (!m_nccl.IsSupported() && deviceId != CPUDEVICE)
-                {
                     m_gpuDataTransferers.push_back(std::make_unique<GPUDataTransferer>(deviceId, m_useAsyncAggregation));
-                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId, gradients[i]->GetNumElements()));
-                }
 
                 if (m_useAsyncAggregation)
                     m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
@@ -192,8 +278,147 @@ private:
         }
     }
 
+    // Splits the gradients, in the order in which they become final (see InitGradientOrder()), into buckets that are
+    // reduced with one allreduce each, first to last. Consecutive gradients that are smaller than the bucket size are
+    // fused into one bucket of up to that size, larger gradients get their own.
+    // The gradients of a bucket are packed into one CPU buffer: on the GPU, the buffer receives the copies of the
+    // gradients anyway, so the intermediate buffer of each gradient is a slice of its bucket's buffer. On the CPU,
+    // the gradients of buckets with more than one gradient are copied into and out of the buffer; single gradients
+    // are reduced in place.
+    void InitBuckets(const std::vector<Matrix<ElemType>*>& gradients, int deviceId)
+    {
+        InitGradientOrder(gradients.size());
+        const size_t bucketSize = m_bucketSizeInBytes / sizeof(ElemType);
+        m_gradientBuckets.resize(gradients.size());
+        for (size_t k = 0; k < m_gradientOrder.size(); k++)
+        {
+            const size_t numElements = gradients[m_gradientOrder[k]]->GetNumElements();
+            if (m_buckets.empty() || m_buckets.back().numElements + numElements > bucketSize)
+                m_buckets.push_back(Bucket{ k, k, 0, nullptr });
+            m_buckets.back().end = k + 1;
+            m_buckets.back().numElements += numElements;
+            m_gradientBuckets[m_gradientOrder[k]] = m_buckets.size() - 1;
+        }
+
+        if (deviceId != CPUDEVICE)
+            m_intermediateCPUBuffers.resize(gradients.size());
+        for (auto& bucket : m_buckets)
+        {
+            if (deviceId != CPUDEVICE)
+            {
+                bucket.buffer = AllocateIntermediateBuffer(deviceId, bucket.numElements);
+                size_t offset = 0;
+                for (size_t k = bucket.begin; k < bucket.end; k++)
+                {
+                    // aliases the bucket buffer, and keeps it alive
+                    const size_t i = m_gradientOrder[k];
+                    m_intermediateCPUBuffers[i] = std::shared_ptr<ElemType>(bucket.buffer, bucket.buffer.get() + offset);
+                    offset += gradients[i]->GetNumElements();
+                }
+            }
+            else if (bucket.end - bucket.begin > 1)
+                bucket.buffer = std::shared_ptr<ElemType>(new ElemType[bucket.numElements], [](ElemType* p) { delete[] p; });
+        }
+    }
+
+    // Every rank records the order in which the first backprop finalizes the gradients (see GradientReady()), which is
+    // roughly the reverse of the forward order, and not the order of the gradients, which are sorted by name. The buckets
+    // are formed and started in that order, and all ranks must start them in the same order, so the order of the main
+    // node is used on all ranks. Gradients that were not reported follow, last to first.
+    void InitGradientOrder(size_t numGradients)
+    {
+        std::vector<int> order;
+        std::vector<bool> ordered(numGradients, false);
+        for (auto gradient : m_observedReadyOrder)
+        {
+            auto iter = m_gradientIndices.find(gradient);
+            if (iter != m_gradientIndices.end() && !ordered[iter->second])
+            {
+                ordered[iter->second] = true;
+                order.push_back((int) iter->second);
+            }
+        }
+        for (size_t i = numGradients; i-- > 0;)
+        {
+            if (!ordered[i])
+                order.push_back((int) i);
+        }
+        m_observedReadyOrder.clear();
+
+        MPI_Bcast(order.data(), (int) order.size(), MPI_INT, (int) m_mpi->MainNodeRank(), m_mpi->Communicator()) || MpiFail("MPI_Bcast");
+        m_gradientOrder.assign(order.begin(), order.end());
+    }
+
+    // the CPU buffer that holds the gradients of a bucket, once their transfer from the GPU is done
+    ElemType* GetReductionBuffer(const Bucket& bucket, const std::vector<Matrix<ElemType>*>& gradients, int deviceId)
+    {
+        if (deviceId >= 0)
+        {
+            for (size_t k = bucket.begin; k < bucket.end; k++)
+                m_gpuDataTransferers[m_gradientOrder[k]]->WaitForCopyGPUToCPUAsync();
+            return bucket.buffer.get();
+        }
+        if (!bucket.buffer)
+            return gradients[m_gradientOrder[bucket.begin]]->Data();
+
+        ElemType* p = bucket.buffer.get();
+        for (size_t k = bucket.begin; k < bucket.end; k++)
+        {
+            const Matrix<ElemType>* gradient = gradients[m_gradientOrder[k]];
+            memcpy(p, gradient->Data(), gradient->GetNumElements() * sizeof(ElemType));
+            p += gradient->GetNumElements();
+        }
+        return bucket.buffer.get();
+    }
+
+    // copy the reduced gradients of a bucket back (on the GPU, asynchronously)
+    void ScatterReductionBuffer(const Bucket& bucket, const std::vector<Matrix<ElemType>*>& gradients, int deviceId)
+    {
+        if (deviceId >= 0)
+        {
+            for (size_t k = bucket.begin; k < bucket.end; k++)
+            {
+                const size_t i = m_gradientOrder[k];
+                m_gpuDataTransferers[i]->CopyCPUToGPUAsync(m_intermediateCPUBuffers[i].get(), gradients[i]->GetNumElements(), gradients[i]->Data());
+            }
+            return;
+        }
+        if (!bucket.buffer)
+            return;
+
+        const ElemType* p = bucket.buffer.get();
+        for (size_t k = bucket.begin; k < bucket.end; k++)
+        {
+            Matrix<ElemType>* gradient = gradients[m_gradientOrder[k]];
+            memcpy(gradient->Data(), p, gradient->GetNumElements() * sizeof(ElemType));
+            p += gradient->GetNumElements();
+        }
+    }
+
+    // Starts the allreduce of a bucket. All ranks must start the buckets in the same order, whether early or not: from
+    // the first to the last, which is the order in which backprop finalizes their gradients.
+    void StartAllReduce(size_t b, const std::vector<Matrix<ElemType>*>& gradients, int deviceId)
+    {
+        assert(b == m_numBucketsStarted);
+        ElemType* reductionBuffer = GetReductionBuffer(m_buckets[b], gradients, deviceId);
+        if (m_allReduceAlgorithm == AllReduceAlgorithm::mpi)
+        {
+            // On Windows this async MPI_Iallreduce call requires MS MPI v7 or higher to be installed
+            MPI_Iallreduce(MPI_IN_PLACE, reductionBuffer, m_buckets[b].numElements,
+                           MPIWrapper::GetDataType(reductionBuffer), MPI_SUM,
+                           m_mpi->Communicator(), &m_allReduceRequests[b]) || MpiFail("MPI_Iallreduce");
+        }
+        else
+        {
+            m_ringAllReduce->AllReduce(reductionBuffer, m_buckets[b].numElements);
+            ScatterReductionBuffer(m_buckets[b], gradients, deviceId);
+        }
+        m_numBucketsStarted++;
+    }
+
     void AggregateGradientsImpl(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
     {
+        TRACE_SCOPE("Aggregate Gradients", profilerTraceAggregation);
         Timer aggregationTimer;
         int deviceId = gradients[0]->GetDeviceId();
         if (showSyncPerfStats)
@@ -207,6 +432,7 @@ private:
 
         if (headerCPU->numSamples == 0)
         {
+            assert(m_numBucketsStarted == 0); // no backprop, no early aggregation
             assert(headerCPU->criterion == 0.0);
             assert(headerCPU->numSamplesWithLabel == 0);
             for (int i = 0; i < headerCPU->numEvalNode; ++i)
@@ -226,8 +452,11 @@ private:
         // Initiate transfer of the gradient matrices to the CPU if needed
         if (!m_nccl.IsSupported() && deviceId >= 0)
         {
-            for (size_t i = 0; i < numGradMatrices; ++i)
-                m_gpuDataTransferers[i]->CopyGPUToCPUAsync(gradients[i]->Data(), gradients[i]->GetNumElements(), m_intermediateCPUBuffers[i].get());
+            for (size_t i : m_gradientOrder)
+            {
+                if (!m_gradientsReady[i]) // else started by GradientReady()
+                    m_gpuDataTransferers[i]->CopyGPUToCPUAsync(gradients[i]->Data(), gradients[i]->GetNumElements(), m_intermediateCPUBuffers[i].get());
+            }
         }
 
         // Initiate receive of the header on the main node
@@ -247,24 +476,13 @@ private:
         if (!m_mpi->IsMainNode())
             MPI_Isend(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices, m_mpi->Communicator(), &sendHeaderRequest) || MpiFail("MPI_Isend");
 
-        // Perform async allreduce on the gradient data
-        std::vector<MPI_Request> allReduceRequests(numGradMatrices);
+        // Perform allreduce on the gradient data, one bucket at a time, starting with those not started by GradientReady().
+        // With MPI_Iallreduce, the reduction of a bucket overlaps with the transfer of the next ones from the GPU; the ring
+        // reduces each bucket right away.
         if (!m_nccl.IsSupported())
         {
-            for (size_t i = 0; i < numGradMatrices; ++i)
-            {
-                ElemType* reductionBuffer = gradients[i]->Data();
-                if (deviceId >= 0)
-                {
-                    m_gpuDataTransferers[i]->WaitForCopyGPUToCPUAsync();
-                    reductionBuffer = m_intermediateCPUBuffers[i].get();
-                }
-
-                // On Windows this async MPI_Iallreduce call requires MS MPI v7 or higher to be installed
-                MPI_Iallreduce(MPI_IN_PLACE, reductionBuffer, gradients[i]->GetNumElements(),
-                               MPIWrapper::GetDataType(reductionBuffer), MPI_SUM,
-                               m_mpi->Communicator(), &allReduceRequests[i]) || MpiFail("MPI_Iallreduce");
-            }
+            while (m_numBucketsStarted < m_buckets.size())
+                StartAllReduce(m_numBucketsStarted, gradients, deviceId);
         }
         else
             m_nccl.AllReduce(gradients);
@@ -310,12 +528,20 @@ private:
         // Wait for the allreduce operations to finish and initiate transfer back to the GPU if needed
         if (!m_nccl.IsSupported())
         {
-            for (size_t i = 0; i < numGradMatrices; ++i)
+            TRACE_SCOPE("Wait for Allreduce", profilerTraceAggregation);
+            if (m_allReduceAlgorithm == AllReduceAlgorithm::mpi)
             {
-                MPI_Wait(&allReduceRequests[i], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
-                if (deviceId >= 0)
-                    m_gpuDataTransferers[i]->CopyCPUToGPUAsync(m_intermediateCPUBuffers[i].get(), gradients[i]->GetNumElements(), gradients[i]->Data());
+                for (size_t b = 0; b < m_buckets.size(); b++)
+                {
+                    MPI_Wait(&m_allReduceRequests[b], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+                    ScatterReductionBuffer(m_buckets[b], gradients, deviceId);
+                }
             }
+
+            // reset the early aggregation state for the next minibatch
+            m_numBucketsStarted = 0;
+            m_gradientsReady.assign(m_gradientsReady.size(), false);
+            m_numGradientsReady.assign(m_numGradientsReady.size(), 0);
         }
 
         // Wait to receive aggregate header
@@ -342,6 +568,16 @@ private:
             aggregationTimer.Stop();
             double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
             fprintf(stderr, "Actual gradient aggregation time: %.6g\n", gradientAggregationTime);
+            if (!m_nccl.IsSupported() && gradientAggregationTime > 0)
+            {
+                size_t numBytes = 0;
+                for (const auto& bucket : m_buckets)
+                    numBytes += bucket.numElements * sizeof(ElemType);
+                double algorithmBandwidth = numBytes / gradientAggregationTime / 1e9;
+                fprintf(stderr, "Gradient aggregation: %d gradients in %d buckets, %.6g MB, algorithm bandwidth %.4g GB/s, bus bandwidth %.4g GB/s\n",
+                        (int) numGradMatrices, (int) m_buckets.size(), numBytes / 1e6, algorithmBandwidth,
+                        algorithmBandwidth * RingAllReduce<ElemType>::BusBandwidthFactor(NumProc()));
+            }
         }
     }
 
@@ -371,5 +607,22 @@ private:
     bool m_initialized;
 
     NcclComm m_nccl;
+
+    std::vector<Bucket> m_buckets;
+    std::vector<size_t> m_gradientOrder;   // gradient indices in the order they become final, see InitGradientOrder()
+    std::vector<size_t> m_gradientBuckets; // [i] bucket of gradient i
+    size_t m_bucketSizeInBytes;
+    std::vector<const Matrix<ElemType>*> m_observedReadyOrder; // by the GradientReady() calls of the first minibatch
+
+    // early aggregation of the current minibatch, see GradientReady()
+    std::vector<Matrix<ElemType>*> m_gradients;
+    std::unordered_map<const Matrix<ElemType>*, size_t> m_gradientIndices;
+    std::vector<bool> m_gradientsReady;
+    std::vector<size_t> m_numGradientsReady; // per bucket
+    size_t m_numBucketsStarted;              // buckets are started from first to last
+    std::vector<MPI_Request> m_allReduceRequests;
+
+    AllReduceAlgorithm m_allReduceAlgorithm;
+    std::unique_ptr<RingAllReduce<ElemType>> m_ringAllReduce;
 };
 } } }
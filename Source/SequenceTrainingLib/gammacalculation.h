@@ -7,9 +7,11 @@
 #include "ssematrix.h"
 #include "Matrix.h"
 #include "CUDAPageLockedMemAllocator.h"
+#include "ExceptionCapture.h"
 
 #include <memory>
 #include <vector>
+#include <omp.h>
 
 #pragma warning(disable : 4127) // conditional expression is constant
 
@@ -100,7 +102,6 @@ public:
     {
         // check total frame number to be added ?
         // int deviceid = loglikelihood.GetDeviceId();
-        size_t boundaryframenum;
         std::vector<size_t> validframes; // [s] cursor pointing to next utterance begin within a single parallel sequence [s]
         validframes.assign(samplesInRecurrentStep, 0);
         ElemType objectValue = 0.0;
@@ -126,15 +127,30 @@ public:
             assert(T == pMBLayout->GetNumTimeSteps());
         }
 
-        size_t mapi = 0; // parallel-sequence index for utterance [i]
-        // cal gamma for each utterance
+        // per-utterance state that is carried from one phase to the next
+        struct utterance
+        {
+            size_t ts;         // first column of the utterance in pred, dengammas, and uids
+            size_t numframes;
+            size_t mapi;       // parallel-sequence index for utterance [i]
+            size_t mapcursor;  // first time step of the utterance within its parallel sequence
+            double numavlogp;
+            double denavlogp;
+        };
+        std::vector<utterance> utterances(lattices.size());
+
+        // phase 1: get the logLLs of utterance [i] into pred (and onto the GPU)
         size_t ts = 0;
-        for (size_t i = 0; i < lattices.size(); i++)
+        auto prepareutterance = [&](size_t i)
         {
-            const size_t numframes = lattices[i]->getnumframes();
+            utterance& utt = utterances[i];
+            utt.ts = ts;
+            utt.numframes = lattices[i]->getnumframes();
+            utt.mapi = 0;
+            utt.mapcursor = 0;
+            const size_t numframes = utt.numframes;
 
-            msra::dbn::matrixstripe predstripe(pred, ts, numframes);           // logLLs for this utterance
-            msra::dbn::matrixstripe dengammasstripe(dengammas, ts, numframes); // denominator gammas
+            msra::dbn::matrixstripe predstripe(pred, ts, numframes); // logLLs for this utterance
 
             if (samplesInRecurrentStep == 1) // no sequence parallelism
             {
@@ -150,7 +166,9 @@ public:
             else // multiple parallel sequences
             {
                 // get number of frames for the utterance
-                mapi = extrauttmap[i]; // parallel-sequence index; in case of >1 utterance within this parallel sequence, this is in order of concatenation
+                const size_t mapi = extrauttmap[i]; // parallel-sequence index; in case of >1 utterance within this parallel sequence, this is in order of concatenation
+                utt.mapi = mapi;
+                utt.mapcursor = validframes[mapi];
 
                 // scan MBLayout for end of utterance
                 size_t mapframenum = SIZE_MAX; // duration of utterance [i] as determined from MBLayout
@@ -184,17 +202,19 @@ public:
                 {
                     parallellattice.setloglls(tempmatrix);
                 }
+                validframes[mapi] += numframes; // advance the cursor within the parallel sequence
             }
+            ts += numframes;
+        };
 
-            array_ref<size_t> uidsstripe(&uids[ts], numframes);
-
-            if (doreferencealign)
-            {
-                boundaryframenum = numframes;
-            }
-            else
-                boundaryframenum = 0;
-            array_ref<size_t> boundariesstripe(&boundaries[ts], boundaryframenum);
+        // phase 2: lattice forward-backward of utterance [i]; only touches the columns of the utterance
+        auto forwardbackwardutterance = [&](size_t i)
+        {
+            utterance& utt = utterances[i];
+            msra::dbn::matrixstripe predstripe(pred, utt.ts, utt.numframes);           // logLLs for this utterance
+            msra::dbn::matrixstripe dengammasstripe(dengammas, utt.ts, utt.numframes); // denominator gammas
+            array_ref<size_t> uidsstripe(&uids[utt.ts], utt.numframes);
+            array_ref<size_t> boundariesstripe(&boundaries[utt.ts], doreferencealign ? utt.numframes : 0);
 
             double numavlogp = 0;
             foreach_column (t, dengammasstripe) // we do not allocate memory for numgamma now, should be the same as numgammasstripe
@@ -202,24 +222,32 @@ public:
                 const size_t s = uidsstripe[t];
                 numavlogp += predstripe(s, t) / amf;
             }
-            numavlogp /= numframes;
+            utt.numavlogp = numavlogp / utt.numframes;
 
             // auto_timer dengammatimer;
-            double denavlogp = lattices[i]->second.forwardbackward(parallellattice,
-                                                                   (const msra::math::ssematrixbase&) predstripe, (const msra::asr::simplesenonehmm&) m_hset,
-                                                                   (msra::math::ssematrixbase&) dengammasstripe, (msra::math::ssematrixbase&) gammasbuffer /*empty, not used*/,
-                                                                   lmf, wp, amf, boostmmifactor, seqsMBRmode, uidsstripe, boundariesstripe);
-            objectValue += (ElemType)((numavlogp - denavlogp) * numframes);
+            utt.denavlogp = lattices[i]->second.forwardbackward(parallellattice,
+                                                                (const msra::math::ssematrixbase&) predstripe, (const msra::asr::simplesenonehmm&) m_hset,
+                                                                (msra::math::ssematrixbase&) dengammasstripe, (msra::math::ssematrixbase&) gammasbuffer /*empty, not used*/,
+                                                                lmf, wp, amf, boostmmifactor, seqsMBRmode, uidsstripe, boundariesstripe);
+        };
+
+        // phase 3: get the gammas of utterance [i] back into gammafromlattice
+        auto finishutterance = [&](size_t i)
+        {
+            const utterance& utt = utterances[i];
+            const size_t numframes = utt.numframes;
+            msra::dbn::matrixstripe dengammasstripe(dengammas, utt.ts, numframes);
+            objectValue += (ElemType)((utt.numavlogp - utt.denavlogp) * numframes);
 
             if (samplesInRecurrentStep == 1)
             {
-                tempmatrix = gammafromlattice.ColumnSlice(ts, numframes);
+                tempmatrix = gammafromlattice.ColumnSlice(utt.ts, numframes);
             }
 
             // copy gamma to tempmatrix
             if (m_deviceid == CPUDEVICE)
             {
-                CopyFromSSEMatrixToCNTKMatrix(dengammas, numrows, numframes, tempmatrix, gammafromlattice.GetDeviceId());
+                CopyFromSSEMatrixToCNTKMatrix(dengammasstripe, numrows, numframes, tempmatrix, gammafromlattice.GetDeviceId());
             }
             else
                 parallellattice.getgamma(tempmatrix);
@@ -227,7 +255,7 @@ public:
             // set gamma for multi channel
             if (samplesInRecurrentStep > 1)
             {
-                Microsoft::MSR::CNTK::Matrix<ElemType> gammaFromLatticeForCurrentParallelUtterance = gammafromlattice.ColumnSlice(mapi + (validframes[mapi] * samplesInRecurrentStep), ((numframes - 1) * samplesInRecurrentStep) + 1);
+                Microsoft::MSR::CNTK::Matrix<ElemType> gammaFromLatticeForCurrentParallelUtterance = gammafromlattice.ColumnSlice(utt.mapi + (utt.mapcursor * samplesInRecurrentStep), ((numframes - 1) * samplesInRecurrentStep) + 1);
                 gammaFromLatticeForCurrentParallelUtterance.CopyColumnsStrided(tempmatrix, numframes, 1, samplesInRecurrentStep);
             }
 
@@ -235,17 +263,40 @@ public:
             {
                 for (size_t nframe = 0; nframe < numframes; nframe++)
                 {
-                    size_t uid = uidsstripe[nframe];
+                    size_t uid = uids[utt.ts + nframe];
                     if (samplesInRecurrentStep > 1)
-                        labels(uid, (nframe + validframes[mapi]) * samplesInRecurrentStep + mapi) = 1.0;
+                        labels(uid, (nframe + utt.mapcursor) * samplesInRecurrentStep + utt.mapi) = 1.0;
                     else
-                        labels(uid, ts + nframe) = 1.0;
+                        labels(uid, utt.ts + nframe) = 1.0;
                 }
             }
-            if (samplesInRecurrentStep > 1)
-                validframes[mapi] += numframes; // advance the cursor within the parallel sequence
-            fprintf(stderr, "dengamma value %f\n", denavlogp);
-            ts += numframes;
+            fprintf(stderr, "dengamma value %f\n", utt.denavlogp);
+        };
+
+        // cal gamma for each utterance
+        // The GPU holds the state of one lattice at a time, so there the phases run utterance by utterance.
+        // On the CPU, the lattices are independent and are processed concurrently if there are enough of them to
+        // keep all threads busy; otherwise they are processed one by one, each parallelizing over its edges.
+        if (!parallellattice.enabled() && lattices.size() > 1 && lattices.size() >= (size_t) omp_get_max_threads())
+        {
+            for (size_t i = 0; i < lattices.size(); i++)
+                prepareutterance(i);
+            Microsoft::MSR::CNTK::ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic)
+            for (int i = 0; i < (int) lattices.size(); i++)
+                capture.SafeRun(forwardbackwardutterance, (size_t) i);
+            capture.RethrowIfHappened();
+            for (size_t i = 0; i < lattices.size(); i++)
+                finishutterance(i);
+        }
+        else
+        {
+            for (size_t i = 0; i < lattices.size(); i++)
+            {
+                prepareutterance(i);
+                forwardbackwardutterance(i);
+                finishutterance(i);
+            }
         }
         functionValues.SetValue(objectValue);
     }
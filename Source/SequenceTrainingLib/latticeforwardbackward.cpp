@@ -12,6 +12,7 @@
 #include "simplesenonehmm.h" // the model
 #include "ssematrix.h"       // the matrices
 #include "latticestorage.h"
+#include "ExceptionCapture.h"
 #include <unordered_map>
 #include <list>
 #include <stdexcept>
@@ -952,7 +953,10 @@ void lattice::forwardbackwardalign(parallelstate &parallelstate,
             parallelstate.getedgeacscores(edgeacscoresgpu);
             parallelstate.copyalignments(thisedgealignmentsgpu);
         }
-        foreach_index (j, edges)
+        // Edges are independent: each one only writes its own score, abcs matrix and alignment, so the edges of
+        // large lattices are processed in parallel. The alignment buffer is allocated lazily, hence allocate it up front.
+        thisedgealignments.getalignmentsbuffer();
+        auto processedge = [&](int j)
         {
             const edgeinfowithscores &e = edges[j];
             const size_t ts = nodes[e.S].t;
@@ -970,8 +974,21 @@ void lattice::forwardbackwardalign(parallelstate &parallelstate,
                 else
                     edgeacscores[j] = alignedge(aligntokens, hset, edgeLLs, *abcs[j], j, returnsenoneids, thisedgealignments[j]);
             }
-            if (cpuverification)
+        };
+        const size_t minparalleledges = 64; // below that, the per-edge work does not pay for waking up the threads
+        Microsoft::MSR::CNTK::ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic) if (edges.size() >= minparalleledges)
+        for (int j = 0; j < (int) edges.size(); j++)
+            capture.SafeRun(processedge, j);
+        capture.RethrowIfHappened();
+
+        if (cpuverification)
+        {
+            foreach_index (j, edges)
             {
+                const edgeinfowithscores &e = edges[j];
+                const size_t ts = nodes[e.S].t;
+                const size_t te = nodes[e.E].t;
                 const auto &aligntokens = getaligninfo(j); // get alignment tokens
                 bool edgehassil = false;
                 foreach_index (i, aligntokens)
@@ -7,6 +7,13 @@
 #include "ComputationNode.h"
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -227,6 +234,295 @@ BOOST_AUTO_TEST_CASE(EvalDenseTimesTest)
     eval->Destroy();
 }
 
+BOOST_AUTO_TEST_CASE(EvalConcurrentWorkersTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(4) \n"
+        "o1 = Plus(Times(Constant(2, rows=2, cols=4), i1), Constant(1), tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    // the evaluator itself takes part, too
+    const size_t numWorkers = 4;
+    std::vector<IEvaluateModelExtended<float>*> workers{ eval };
+    for (size_t i = 1; i < numWorkers; i++)
+        workers.push_back(eval->CreateWorker());
+
+    // worker w evaluates the input (w, ..., w) repeatedly, with a different number of samples each time
+    std::vector<char> correct(numWorkers, true); // not vector<bool>, whose elements share bytes
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < numWorkers; w++)
+    {
+        threads.push_back(std::thread([&, w]()
+        {
+            for (size_t pass = 0; pass < 50; pass++)
+            {
+                size_t numSamples = 1 + (w + pass) % 3;
+                Values<float> inputBuffer(1);
+                inputBuffer[0].m_buffer.assign(4 * numSamples, (float)w);
+                Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ numSamples });
+                workers[w]->ForwardPass(inputBuffer, outputBuffer);
+
+                std::vector<float> expected(2 * numSamples, 8 * w + 1);
+                const auto& buf = outputBuffer[0].m_buffer;
+                if (buf != expected)
+                    correct[w] = false;
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    for (size_t w = 0; w < numWorkers; w++)
+        BOOST_CHECK_MESSAGE(correct[w], "Worker " << w << " computed wrong outputs.");
+
+    // workers can outlive the evaluator they were created from
+    eval->Destroy();
+    Values<float> inputBuffer(1);
+    inputBuffer[0].m_buffer = { 1, 2, 3, 4 };
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 });
+    workers[1]->ForwardPass(inputBuffer, outputBuffer);
+    std::vector<float> expected{ 21, 21 };
+    auto buf = outputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+
+    for (size_t i = 1; i < numWorkers; i++)
+        workers[i]->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalBatchingTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(2) \n"
+        "W = Parameter(3, 0, init = \"uniform\", initValueScale = 1) \n"
+        "R = Parameter(3, 0, init = \"uniform\", initValueScale = 1) \n"
+        "dh = PastValue(3, h, timeStep = 1) \n"
+        "h = Tanh(Plus(Times(W, i1), Times(R, dh)), tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    // requests of 1 to 4 samples, evaluated one at a time for reference
+    const size_t numThreads = 6;
+    const size_t numRequestsPerThread = 20;
+    std::vector<Values<float>> inputs;
+    std::vector<std::vector<float>> expected;
+    for (size_t i = 0; i < numThreads * numRequestsPerThread; i++)
+    {
+        size_t numSamples = 1 + i % 4;
+        Values<float> inputBuffer(1);
+        for (size_t j = 0; j < 2 * numSamples; j++)
+            inputBuffer[0].m_buffer.push_back((float)((i * 7 + j * 3) % 11) / 11 - 0.5f);
+        Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ numSamples });
+        eval->ForwardPass(inputBuffer, outputBuffer);
+        inputs.push_back(inputBuffer);
+        expected.push_back(outputBuffer[0].m_buffer);
+    }
+
+    IBatchingEvaluator<float>* batcher = eval->CreateBatchingEvaluator(8, 2000);
+
+    std::vector<float> maxError(numThreads, 0);
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < numThreads; thread++)
+    {
+        threads.push_back(std::thread([&, thread]()
+        {
+            for (size_t i = thread; i < inputs.size(); i += numThreads)
+            {
+                Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 4 });
+                batcher->Evaluate(inputs[i], outputBuffer);
+                const auto& buf = outputBuffer[0].m_buffer;
+                if (buf.size() != expected[i].size())
+                    maxError[thread] = std::numeric_limits<float>::infinity();
+                for (size_t j = 0; j < buf.size() && j < expected[i].size(); j++)
+                    maxError[thread] = std::max(maxError[thread], std::abs(buf[j] - expected[i][j]));
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    for (size_t thread = 0; thread < numThreads; thread++)
+        BOOST_CHECK_SMALL(maxError[thread], 1e-5f);
+
+    // a malformed request fails on its own
+    Values<float> badInput(1);
+    badInput[0].m_buffer = { 1, 2, 3 };
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 4 });
+    BOOST_REQUIRE_THROW(batcher->Evaluate(badInput, outputBuffer), std::exception);
+    batcher->Evaluate(inputs[0], outputBuffer);
+    BOOST_CHECK_EQUAL(outputBuffer[0].m_buffer.size(), expected[0].size());
+
+    batcher->Destroy();
+    eval->Destroy();
+}
+
+// Many client threads issue requests of one sample each to a feedforward network, so that the batching
+// evaluator combines them into full batches. Each client must get the output of its own input.
+BOOST_AUTO_TEST_CASE(EvalBatchingManyClientsTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 0 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(64) \n"
+        "W1 = Parameter(128, 0, init = \"uniform\", initValueScale = 1) \n"
+        "W2 = Parameter(16, 0, init = \"uniform\", initValueScale = 1) \n"
+        "h1 = Sigmoid(Times(W1, i1)) \n"
+        "o1 = Times(W2, h1, tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    // each client has its own input; the outputs of one forward pass per input are the reference
+    const size_t numClients = 16;
+    const size_t numRequestsPerClient = 20;
+    std::vector<Values<float>> inputs;
+    std::vector<std::vector<float>> expected;
+    for (size_t client = 0; client < numClients; client++)
+    {
+        Values<float> inputBuffer(1);
+        for (size_t j = 0; j < 64; j++)
+            inputBuffer[0].m_buffer.push_back((float)((client * 5 + j) % 13) / 13 - 0.5f);
+        Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 });
+        eval->ForwardPass(inputBuffer, outputBuffer);
+        inputs.push_back(inputBuffer);
+        expected.push_back(outputBuffer[0].m_buffer);
+    }
+
+    IBatchingEvaluator<float>* batcher = eval->CreateBatchingEvaluator(numClients, 1000);
+
+    std::vector<float> maxError(numClients, 0);
+    std::vector<std::thread> clients;
+    for (size_t client = 0; client < numClients; client++)
+    {
+        clients.push_back(std::thread([&, client]()
+        {
+            Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 });
+            for (size_t i = 0; i < numRequestsPerClient; i++)
+            {
+                batcher->Evaluate(inputs[client], outputBuffer);
+                const auto& buf = outputBuffer[0].m_buffer;
+                if (buf.size() != expected[client].size())
+                    maxError[client] = std::numeric_limits<float>::infinity();
+                for (size_t j = 0; j < buf.size() && j < expected[client].size(); j++)
+                    maxError[client] = std::max(maxError[client], std::abs(buf[j] - expected[client][j]));
+            }
+        }));
+    }
+    for (auto& client : clients)
+        client.join();
+
+    for (size_t client = 0; client < numClients; client++)
+        BOOST_CHECK_SMALL(maxError[client], 1e-5f);
+
+    batcher->Destroy();
+    eval->Destroy();
+}
+
+// Compares one forward pass per request with batched evaluation, for requests of one sample each that are issued
+// by several client threads, and prints throughput and latencies. This is a benchmark without pass/fail criterion,
+// so it does not run by default; run it with --run_test=EvalTestSuite/EvalBatchingBenchmark.
+BOOST_AUTO_TEST_CASE(EvalBatchingBenchmark, *boost::unit_test::disabled())
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 0 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(512) \n"
+        "W1 = Parameter(1024, 0, init = \"uniform\", initValueScale = 1) \n"
+        "W2 = Parameter(1024, 0, init = \"uniform\", initValueScale = 1) \n"
+        "W3 = Parameter(64, 0, init = \"uniform\", initValueScale = 1) \n"
+        "h1 = Sigmoid(Times(W1, i1)) \n"
+        "h2 = Sigmoid(Times(W2, h1)) \n"
+        "o1 = Times(W3, h2, tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    const size_t numClients = 16;
+    const size_t numRequestsPerClient = 200;
+    typedef std::chrono::steady_clock Clock;
+
+    // runs all clients, each issuing its requests back to back, and reports throughput and latencies
+    auto run = [&](const char* name, std::function<void(const Values<float>&, Values<float>&)> evaluate)
+    {
+        std::vector<double> latencies(numClients * numRequestsPerClient);
+        auto start = Clock::now();
+        std::vector<std::thread> clients;
+        for (size_t client = 0; client < numClients; client++)
+        {
+            clients.push_back(std::thread([&, client]()
+            {
+                Values<float> inputBuffer(1);
+                inputBuffer[0].m_buffer.assign(512, 0.01f * client);
+                Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 });
+                for (size_t i = 0; i < numRequestsPerClient; i++)
+                {
+                    auto requestStart = Clock::now();
+                    evaluate(inputBuffer, outputBuffer);
+                    latencies[client * numRequestsPerClient + i] = std::chrono::duration<double, std::milli>(Clock::now() - requestStart).count();
+                }
+            }));
+        }
+        for (auto& client : clients)
+            client.join();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::sort(latencies.begin(), latencies.end());
+        fprintf(stderr, "%s: %.0f requests/s, latency p50 %.3f ms, p99 %.3f ms\n", name,
+                latencies.size() / seconds, latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100]);
+    };
+
+    // the evaluator is not thread-safe, so the clients take turns
+    std::mutex evalMutex;
+    run("One forward pass per request", [&](const Values<float>& inputs, Values<float>& outputs)
+    {
+        std::lock_guard<std::mutex> lock(evalMutex);
+        eval->ForwardPass(inputs, outputs);
+    });
+
+    IBatchingEvaluator<float>* batcher = eval->CreateBatchingEvaluator(numClients, 1000);
+    run("Batched evaluation", [&](const Values<float>& inputs, Values<float>& outputs)
+    {
+        batcher->Evaluate(inputs, outputs);
+    });
+
+    batcher->Destroy();
+    eval->Destroy();
+}
+
 BOOST_AUTO_TEST_CASE(EvalSparseTimesTest)
 {
     std::string modelDefinition =
@@ -9,12 +9,14 @@
 //#include "Windows.h"
 #include "Matrix.h"
 #include "CPUMatrix.h"
+#include "CPUSparseMatrix.h"
 #include "TensorView.h"
 #include "Sequences.h"
 #include <chrono>
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <functional>
 
 using namespace Microsoft::MSR::CNTK;
 using namespace std;
@@ -279,6 +281,137 @@ struct TensorTest
     }
 };
 
+// Times tensor ops of increasing size with the ops forced to run serially, forced to run in parallel, and with the
+// default CPUMatrix<ElemType>::SetTensorOpParallelThreshold(), to show where parallel execution starts to pay off.
+template <class ElemType>
+void TensorOpParallelThresholdTest(int count)
+{
+    const size_t defaultThreshold = CPUMatrix<ElemType>::GetTensorOpParallelThreshold();
+    cout << "Testing TensorOp serial vs. parallel execution with " << CPUMatrix<ElemType>::GetMaxNumThreads()
+         << " threads, default threshold is " << defaultThreshold << " elements" << endl;
+
+    // average time of one call to fn() in microseconds, with tensor ops of at least 'threshold' elements run in parallel
+    auto timeOp = [count](size_t threshold, const function<void()>& fn) -> double
+    {
+        CPUMatrix<ElemType>::SetTensorOpParallelThreshold(threshold);
+        fn(); // warm up, e.g. start the OpenMP thread pool
+        auto t_start = chrono::high_resolution_clock::now();
+        for (int i = 0; i < count; ++i)
+            fn();
+        auto t_end = chrono::high_resolution_clock::now();
+        return chrono::duration<double, micro>(t_end - t_start).count() / count;
+    };
+
+    cout << "elements\top\tserial[us]\tparallel[us]\tdefault[us]" << endl;
+    for (size_t n = 256; n <= 4 * 1024 * 1024; n *= 4)
+    {
+        auto createTensor = [](size_t numElements) -> TensorView<ElemType>
+        {
+            let sob = make_shared<Matrix<ElemType>>(numElements, 1, CPUDEVICE);
+            randomInitializeMatrix<ElemType>(*sob, -1, 2);
+            return TensorView<ElemType>(sob, TensorShape(numElements));
+        };
+        let a = createTensor(n);
+        let b = createTensor(n);
+        auto c = createTensor(n);
+        auto columns = createTensor(64);
+        auto scalar = createTensor(1);
+        let matrixView = a.Reshaped(TensorShape(64, n / 64));
+
+        const pair<const char*, function<void()>> ops[] =
+        {
+            { "sum",        [&] { c.AssignSumOf(a, b); } },
+            { "sigmoid",    [&] { c.AssignSigmoidOf(a); } },
+            { "reduceAll",  [&] { scalar.DoCopyOf(0, a, 1); } },
+            { "reduceCols", [&] { columns.DoCopyOf(0, matrixView, 1); } },
+        };
+        for (const auto& op : ops)
+        {
+            double serial   = timeOp(SIZE_MAX, op.second);
+            double parallel = timeOp(0, op.second);
+            double chosen   = timeOp(defaultThreshold, op.second);
+            cout << n << "\t" << op.first << "\t" << serial << "\t" << parallel << "\t" << chosen << endl;
+        }
+    }
+    CPUMatrix<ElemType>::SetTensorOpParallelThreshold(defaultThreshold);
+}
+
+// Times the products of sparse (CSC) and dense matrices in the shapes of an embedding layer over a large vocabulary,
+// on one thread and on all threads.
+template <class ElemType>
+void SparseDenseMultiplyTest(int count)
+{
+    const size_t vocabularySize = 50000;
+    const size_t embeddingDim = 512;
+    const size_t batchSize = 256;
+    const size_t nonzerosPerColumn = 32;
+
+    // input: batchSize columns over the vocabulary, with a few random nonzero elements each
+    vector<CPUSPARSE_INDEX_TYPE> colStarts, rows;
+    vector<ElemType> values;
+    for (size_t col = 0; col < batchSize; col++)
+    {
+        colStarts.push_back((CPUSPARSE_INDEX_TYPE) rows.size());
+        vector<CPUSPARSE_INDEX_TYPE> colRows;
+        for (size_t i = 0; i < nonzerosPerColumn; i++)
+            colRows.push_back((CPUSPARSE_INDEX_TYPE) (rand() % vocabularySize));
+        sort(colRows.begin(), colRows.end());
+        colRows.erase(unique(colRows.begin(), colRows.end()), colRows.end());
+        for (auto row : colRows)
+        {
+            rows.push_back(row);
+            values.push_back((ElemType) rand() / RAND_MAX);
+        }
+    }
+    colStarts.push_back((CPUSPARSE_INDEX_TYPE) rows.size());
+    CPUSparseMatrix<ElemType> input(matrixFormatSparseCSC, vocabularySize, batchSize, rows.size());
+    input.SetMatrixFromCSCFormat(colStarts.data(), rows.data(), values.data(), rows.size(), vocabularySize, batchSize);
+
+    CPUMatrix<ElemType> weights(embeddingDim, vocabularySize);
+    randomInitializeCPUMatrix<ElemType>(weights, -1, 2);
+    CPUMatrix<ElemType> weightsTransposed(vocabularySize, embeddingDim);
+    randomInitializeCPUMatrix<ElemType>(weightsTransposed, -1, 2);
+    CPUMatrix<ElemType> embedding(embeddingDim, batchSize);
+    randomInitializeCPUMatrix<ElemType>(embedding, -1, 2);
+    CPUMatrix<ElemType> embeddingTransposed(batchSize, embeddingDim);
+    randomInitializeCPUMatrix<ElemType>(embeddingTransposed, -1, 2);
+    CPUMatrix<ElemType> denseGradient(embeddingDim, vocabularySize);
+    CPUSparseMatrix<ElemType> blockGradient(matrixFormatSparseBlockCol, embeddingDim, vocabularySize, 0);
+    CPUMatrix<ElemType> output(embeddingDim, batchSize);
+    CPUMatrix<ElemType> outputTransposed(batchSize, embeddingDim);
+
+    const pair<const char*, function<void()>> ops[] =
+    {
+        { "dense * sparse",                   [&] { CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, weights, false, input, false, 0, output); } },
+        { "dense^T * sparse",                 [&] { CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, weightsTransposed, true, input, false, 0, output); } },
+        { "sparse^T * dense",                 [&] { CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, input, true, weightsTransposed, false, 0, outputTransposed); } },
+        { "dense * sparse^T (dense grad)",    [&] { CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, embedding, false, input, true, 1, denseGradient); } },
+        { "sparse * dense^T (dense grad)",    [&] { CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, input, false, embedding, true, 1, weightsTransposed); } },
+        { "dense * sparse^T (blockCol grad)", [&] { CPUSparseMatrix<ElemType>::MultiplyAndAdd(1, embedding, false, input, true, blockGradient); } },
+    };
+
+    const int maxNumThreads = CPUMatrix<ElemType>::GetMaxNumThreads();
+    cout << "Testing sparse x dense products, vocabulary " << vocabularySize << ", embedding " << embeddingDim << ", batch " << batchSize
+         << ", " << rows.size() << " nonzero elements" << endl;
+    cout << "op\t1 thread[us]\t" << maxNumThreads << " threads[us]" << endl;
+    for (const auto& op : ops)
+    {
+        double times[2];
+        for (int i = 0; i < 2; i++)
+        {
+            CPUMatrix<ElemType>::SetNumThreads(i == 0 ? 1 : maxNumThreads);
+            op.second(); // warm up
+            auto t_start = chrono::high_resolution_clock::now();
+            for (int j = 0; j < count; ++j)
+                op.second();
+            auto t_end = chrono::high_resolution_clock::now();
+            times[i] = chrono::duration<double, micro>(t_end - t_start).count() / count;
+        }
+        cout << op.first << "\t" << times[0] << "\t" << times[1] << endl;
+    }
+    CPUMatrix<ElemType>::SetNumThreads(maxNumThreads);
+}
+
 template <class ElemType>
 void MandSTest(int count, int devId)
 {
@@ -338,6 +471,10 @@ void MandSTest(int count, int devId)
 
 int wmain()
 {
+    TensorOpParallelThresholdTest<float>(100);
+
+    SparseDenseMultiplyTest<float>(20);
+
     // MandSTest<float>(100, 2);
 
     /*cout<<endl<<"********************Matrix SquareMultiplyAndWeightedAdd10TimesAvg TEST********************"<<endl;
@@ -12,6 +12,7 @@
 #include "../../../Source/Math/CPUMatrix.h"
 #include "../../../Source/Math/GPUMatrix.h"
 #include "../../../Source/Math/BatchNormalizationEngine.h"
+#include "../../../Source/Math/BlockedLayout.h"
 #include "../../../Source/Math/CuDnnFactories.h"
 #include "common.h"
 
@@ -327,6 +328,58 @@ BOOST_AUTO_TEST_CASE(BatchNormalizationBackward)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BatchNormalizationForwardBlocked)
+{
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+    auto randomMatrix = [&](size_t r, size_t c) -> SingleMatrix
+    {
+        vec buf(r * c);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        return SingleMatrix(r, c, buf.data(), CPUDEVICE, matrixFlagNormal);
+    };
+
+    const TensorShape inOutT(7, 5, 16);
+    const size_t n = 3;
+    const double epsilon = 1e-5;
+    BOOST_REQUIRE(BNEng::IsBlockedLayoutSupported(CPUDEVICE, inOutT, true, ImageLayoutKind::CHW));
+    BOOST_REQUIRE(!BNEng::IsBlockedLayoutSupported(CPUDEVICE, TensorShape(7, 5, 12), true, ImageLayoutKind::CHW));
+    BOOST_REQUIRE(!BNEng::IsBlockedLayoutSupported(CPUDEVICE, inOutT, false, ImageLayoutKind::CHW));
+
+    SingleMatrix in = randomMatrix(inOutT.GetNumElements(), n);
+    SingleMatrix scale = randomMatrix(inOutT[2], 1);
+    SingleMatrix bias = randomMatrix(inOutT[2], 1);
+    SingleMatrix runMean = randomMatrix(inOutT[2], 1);
+    SingleMatrix runVariance = randomMatrix(inOutT[2], 1);
+    runVariance.InplaceAbs();
+    SingleMatrix saveMean(CPUDEVICE);
+    SingleMatrix saveInvStdDev(CPUDEVICE);
+
+    auto baseEng = BNEng::Create(CPUDEVICE, inOutT, true, ImageLayoutKind::CHW, BatchNormEngineKind::Cntk);
+    SingleMatrix outB(inOutT.GetNumElements(), n, CPUDEVICE);
+    baseEng->Forward(in, scale, bias, true, 0, 1, runMean, runVariance, outB, epsilon, saveMean, saveInvStdDev);
+
+    SingleMatrix inBlocked(in.GetNumRows(), n, CPUDEVICE);
+    BlockedLayout::ToBlocked(in.Data(), inBlocked.Data(), inOutT[0], inOutT[1], inOutT[2], n);
+    for (bool blockedInput : {false, true})
+    {
+        for (bool blockedOutput : {false, true})
+        {
+            auto testEng = BNEng::Create(CPUDEVICE, inOutT, true, ImageLayoutKind::CHW, BatchNormEngineKind::Cntk);
+            testEng->SetBlockedLayout(blockedInput, blockedOutput);
+            SingleMatrix out(inOutT.GetNumElements(), n, CPUDEVICE);
+            testEng->Forward(blockedInput ? inBlocked : in, scale, bias, true, 0, 1, runMean, runVariance, out, epsilon, saveMean, saveInvStdDev);
+            SingleMatrix plainOut = out.DeepClone();
+            if (blockedOutput)
+                BlockedLayout::FromBlocked(out.Data(), plainOut.Data(), inOutT[0], inOutT[1], inOutT[2], n);
+
+            std::string emsg;
+            BOOST_REQUIRE_MESSAGE(CheckEqual(plainOut, outB, emsg, Err<float>::Rel * 4, Err<float>::Abs * 4),
+                                  "out are not equal, Blocked input: " << blockedInput << ", Blocked output: " << blockedOutput << ". " << emsg);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
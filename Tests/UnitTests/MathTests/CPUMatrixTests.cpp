@@ -4,6 +4,7 @@
 //
 #include "stdafx.h"
 #include "../../../Source/Math/CPUMatrix.h"
+#include "../../../Source/Math/CPUTensorKernels.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -898,6 +899,96 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixSeedingDouble, RandomSeedFixture)
     BOOST_CHECK(m1.IsEqualTo(m2));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUMatrixVectorizedTensorOp, RandomSeedFixture)
+{
+    // compares the AVX2/AVX-512 tensor kernels against the generic code path; trivially passes on CPUs without AVX2
+    const size_t n = 1003; // not a multiple of the vector width, to exercise the scalar tail
+    SMatrix a(n, 1), b(n, 1), c(n, 1);
+    a.SetUniformRandomValue(-1, 1, IncrementCounter());
+    b.SetUniformRandomValue(-1, 1, IncrementCounter());
+    c.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+    const SmallVector<size_t> elementwiseDims(1, n), noDims;
+    const SmallVector<ptrdiff_t> unitStride(1, 1), zeroStride(1, 0), noStrides;
+    const std::array<SmallVector<ptrdiff_t>, 3> binaryStrides = { unitStride, unitStride, unitStride };
+    const std::array<SmallVector<ptrdiff_t>, 3> binaryNoStrides = { noStrides, noStrides, noStrides };
+    const std::array<SmallVector<ptrdiff_t>, 4> ternaryStrides = { unitStride, unitStride, unitStride, unitStride };
+    const std::array<SmallVector<ptrdiff_t>, 4> ternaryNoStrides = { noStrides, noStrides, noStrides, noStrides };
+    const std::array<SmallVector<ptrdiff_t>, 2> unaryNoStrides = { noStrides, noStrides };
+    const std::array<SmallVector<ptrdiff_t>, 2> unaryReducingStrides = { unitStride, zeroStride };
+    const std::array<SmallVector<ptrdiff_t>, 3> binaryReducingStrides = { unitStride, unitStride, zeroStride };
+
+    auto runAll = [&](SMatrix& sum, SMatrix& product, SMatrix& clip, SMatrix& total, SMatrix& maximum)
+    {
+        sum.SetValue(1);
+        sum.TensorOp(0.5f, a, b, 2.0f, ElementWiseOperator::opSum, ElementWiseOperator::opSum, { 0, 0, 0 }, elementwiseDims, binaryStrides, noDims, binaryNoStrides);
+        product.TensorOp(0, a, b, 1, ElementWiseOperator::opElementwiseProduct, ElementWiseOperator::opSum, { 0, 0, 0 }, elementwiseDims, binaryStrides, noDims, binaryNoStrides);
+        clip.TensorOp(0, a, b, c, 1, ElementWiseOperator::opClip, ElementWiseOperator::opSum, { 0, 0, 0, 0 }, elementwiseDims, ternaryStrides, noDims, ternaryNoStrides);
+        total.TensorOp(0, a, b, 1, ElementWiseOperator::opSqrOfDifference, ElementWiseOperator::opSum, { 0, 0, 0 }, noDims, binaryNoStrides, elementwiseDims, binaryReducingStrides);
+        maximum.TensorOp(0, a, 1, ElementWiseOperator::opAbs, ElementWiseOperator::opMax, { 0, 0 }, noDims, unaryNoStrides, elementwiseDims, unaryReducingStrides);
+    };
+
+    SMatrix sum0(n, 1), product0(n, 1), clip0(n, 1), total0(1, 1), maximum0(1, 1);
+    SMatrix sum1(n, 1), product1(n, 1), clip1(n, 1), total1(1, 1), maximum1(1, 1);
+
+    const CPUVectorInstructionSet previous = SetCPUVectorInstructionSet(CPUVectorInstructionSet::None);
+    runAll(sum0, product0, clip0, total0, maximum0);
+    SetCPUVectorInstructionSet(GetSupportedCPUVectorInstructionSet());
+    runAll(sum1, product1, clip1, total1, maximum1);
+    SetCPUVectorInstructionSet(previous);
+
+    // elementwise results are bit-identical; sums may differ in the last bits due to the summation order
+    BOOST_CHECK(sum1.IsEqualTo(sum0, 0));
+    BOOST_CHECK(product1.IsEqualTo(product0, 0));
+    BOOST_CHECK(clip1.IsEqualTo(clip0, 0));
+    BOOST_CHECK(total1.IsEqualTo(total0, c_epsilonFloatE4));
+    BOOST_CHECK_EQUAL(maximum1(0, 0), maximum0(0, 0));
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixTensorOpParallelSchedule, RandomSeedFixture)
+{
+    // runs the same tensor ops serially and in parallel; with a single thread, both are serial
+    const size_t rows = 64, cols = 1000;
+    SMatrix a(rows, cols), b(rows, cols);
+    a.SetUniformRandomValue(-1, 1, IncrementCounter());
+    b.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+    SmallVector<size_t> matrixDims(2), rowDims(1, rows), colDims(1, cols);
+    matrixDims[0] = rows;
+    matrixDims[1] = cols;
+    SmallVector<ptrdiff_t> matrixStrides(2), noStrides, unitStride(1, 1), zeroStride(1, 0), colStride(1, rows);
+    matrixStrides[0] = 1;
+    matrixStrides[1] = rows;
+    SmallVector<ptrdiff_t> zeroStrides(2, 0);
+    const SmallVector<size_t> noDims;
+    const std::array<SmallVector<ptrdiff_t>, 3> elementwiseStrides = { matrixStrides, matrixStrides, matrixStrides };
+    const std::array<SmallVector<ptrdiff_t>, 3> binaryNoStrides = { noStrides, noStrides, noStrides };
+    const std::array<SmallVector<ptrdiff_t>, 2> rowSumRegularStrides = { unitStride, unitStride };
+    const std::array<SmallVector<ptrdiff_t>, 2> rowSumReducingStrides = { colStride, zeroStride };
+    const std::array<SmallVector<ptrdiff_t>, 2> unaryNoStrides = { noStrides, noStrides };
+    const std::array<SmallVector<ptrdiff_t>, 2> totalReducingStrides = { matrixStrides, zeroStrides };
+
+    auto runAll = [&](SMatrix& product, SMatrix& rowSums, SMatrix& total)
+    {
+        product.TensorOp(0, a, b, 1, ElementWiseOperator::opElementwiseProduct, ElementWiseOperator::opSum, { 0, 0, 0 }, matrixDims, elementwiseStrides, noDims, binaryNoStrides);
+        rowSums.TensorOp(0, a, 1, ElementWiseOperator::opSigmoid, ElementWiseOperator::opSum, { 0, 0 }, rowDims, rowSumRegularStrides, colDims, rowSumReducingStrides);
+        total.TensorOp(0, a, 1, ElementWiseOperator::opAbs, ElementWiseOperator::opSum, { 0, 0 }, noDims, unaryNoStrides, matrixDims, totalReducingStrides);
+    };
+
+    SMatrix product0(rows, cols), rowSums0(rows, 1), total0(1, 1);
+    SMatrix product1(rows, cols), rowSums1(rows, 1), total1(1, 1);
+
+    const size_t previous = SMatrix::SetTensorOpParallelThreshold(SIZE_MAX);
+    runAll(product0, rowSums0, total0);
+    SMatrix::SetTensorOpParallelThreshold(0);
+    runAll(product1, rowSums1, total1);
+    SMatrix::SetTensorOpParallelThreshold(previous);
+
+    BOOST_CHECK(product1.IsEqualTo(product0, 0));
+    BOOST_CHECK(rowSums1.IsEqualTo(rowSums0, 0)); // each output is still reduced by a single thread
+    BOOST_CHECK(total1.IsEqualTo(total0, c_epsilonFloatE3));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -0,0 +1,187 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Compares the CPU implementation of OptimizedRNNStack against a straightforward per-sequence evaluation of the
+// cuDNN parameter layout (see CPURNN.h).
+//
+#include "stdafx.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "../../../Source/Math/Matrix.h"
+#include "../../../Source/Math/RNNCommon.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+typedef std::vector<std::vector<double>> Sequence; // frames of one sequence
+
+static double Sigmoid(double x)
+{
+    return 1 / (1 + std::exp(-x));
+}
+
+// evaluates the stacked RNN on each sequence separately, one frame and one gate at a time
+static std::vector<Sequence> ReferenceRNN(const RnnAttributes& attributes, size_t xDim, const std::vector<double>& params, const std::vector<Sequence>& inputs)
+{
+    const size_t H = attributes.m_hiddenSize;
+    const size_t numDirections = attributes.m_bidirectional ? 2 : 1;
+    const size_t numGates = attributes.m_recurrentOp == L"lstm" ? 4 : attributes.m_recurrentOp == L"gru" ? 3 : 1;
+
+    size_t biasOffset = 0;
+    for (size_t layer = 0, inDim = xDim; layer < attributes.m_numLayers; layer++, inDim = numDirections * H)
+        biasOffset += numDirections * numGates * H * (inDim + H);
+
+    std::vector<Sequence> layerInputs = inputs;
+    size_t weightOffset = 0;
+    for (size_t layer = 0; layer < attributes.m_numLayers; layer++)
+    {
+        const size_t inDim = layer == 0 ? xDim : numDirections * H;
+        std::vector<Sequence> layerOutputs(inputs.size());
+        for (size_t s = 0; s < inputs.size(); s++)
+            layerOutputs[s].assign(inputs[s].size(), std::vector<double>(numDirections * H));
+
+        for (size_t direction = 0; direction < numDirections; direction++)
+        {
+            const double* W = &params[weightOffset];
+            const double* R = W + numGates * H * inDim;
+            const double* bW = &params[biasOffset];
+            const double* bR = bW + numGates * H;
+            weightOffset += numGates * H * (inDim + H);
+            biasOffset += 2 * numGates * H;
+
+            for (size_t s = 0; s < inputs.size(); s++)
+            {
+                const size_t T = inputs[s].size();
+                std::vector<double> h(H, 0), c(H, 0), wx(numGates * H), rh(numGates * H);
+                for (size_t step = 0; step < T; step++)
+                {
+                    const size_t t = direction == 1 ? T - 1 - step : step;
+                    const std::vector<double>& x = layerInputs[s][t];
+                    for (size_t k = 0; k < numGates * H; k++)
+                    {
+                        wx[k] = bW[k];
+                        for (size_t i = 0; i < inDim; i++)
+                            wx[k] += W[k * inDim + i] * x[i];
+                        rh[k] = bR[k];
+                        for (size_t j = 0; j < H; j++)
+                            rh[k] += R[k * H + j] * h[j];
+                    }
+                    std::vector<double> newH(H);
+                    for (size_t k = 0; k < H; k++)
+                    {
+                        if (attributes.m_recurrentOp == L"lstm")
+                        {
+                            c[k] = Sigmoid(wx[H + k] + rh[H + k]) * c[k] + Sigmoid(wx[k] + rh[k]) * std::tanh(wx[2 * H + k] + rh[2 * H + k]);
+                            newH[k] = Sigmoid(wx[3 * H + k] + rh[3 * H + k]) * std::tanh(c[k]);
+                        }
+                        else if (attributes.m_recurrentOp == L"gru")
+                        {
+                            double r = Sigmoid(wx[k] + rh[k]);
+                            double z = Sigmoid(wx[H + k] + rh[H + k]);
+                            double candidate = std::tanh(wx[2 * H + k] + r * rh[2 * H + k]);
+                            newH[k] = (1 - z) * candidate + z * h[k];
+                        }
+                        else if (attributes.m_recurrentOp == L"rnnTanh")
+                            newH[k] = std::tanh(wx[k] + rh[k]);
+                        else
+                            newH[k] = std::max(0.0, wx[k] + rh[k]);
+                    }
+                    h = newH;
+                    std::copy(h.begin(), h.end(), layerOutputs[s][t].begin() + direction * H);
+                }
+            }
+        }
+        layerInputs = layerOutputs;
+    }
+    return layerInputs;
+}
+
+// runs Matrix::RNNForward() on the CPU, with the sequences packed frame by frame, and compares it to ReferenceRNN()
+// the sequence lengths must be given from longest to shortest
+template <class ElemType>
+static void TestRNNForward(const RnnAttributes& attributes, size_t xDim, const std::vector<size_t>& sequenceLengths, double tolerance)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> uniform(-0.5, 0.5);
+
+    const size_t numParameters = attributes.GetNumParameters(xDim).first * attributes.GetNumParameters(xDim).second;
+    std::vector<double> params(numParameters);
+    for (auto& p : params)
+        p = uniform(rng);
+
+    std::vector<Sequence> inputs(sequenceLengths.size());
+    for (size_t s = 0; s < inputs.size(); s++)
+    {
+        inputs[s].assign(sequenceLengths[s], std::vector<double>(xDim));
+        for (auto& frame : inputs[s])
+            for (auto& value : frame)
+                value = uniform(rng);
+    }
+
+    std::vector<size_t> numSequencesForFrame(sequenceLengths.empty() ? 0 : sequenceLengths[0]);
+    for (size_t t = 0; t < numSequencesForFrame.size(); t++)
+        numSequencesForFrame[t] = std::count_if(sequenceLengths.begin(), sequenceLengths.end(), [t](size_t length) { return length > t; });
+
+    std::vector<ElemType> packedInput;
+    for (size_t t = 0; t < numSequencesForFrame.size(); t++)
+        for (size_t s = 0; s < numSequencesForFrame[t]; s++)
+            packedInput.insert(packedInput.end(), inputs[s][t].begin(), inputs[s][t].end());
+    std::vector<ElemType> paramsElemType(params.begin(), params.end());
+
+    const size_t yDim = (attributes.m_bidirectional ? 2 : 1) * attributes.m_hiddenSize;
+    const size_t numCols = packedInput.size() / xDim;
+    Matrix<ElemType> inputX(xDim, numCols, packedInput.data(), CPUDEVICE);
+    Matrix<ElemType> paramW(numParameters, 1, paramsElemType.data(), CPUDEVICE);
+    Matrix<ElemType> outputY(yDim, numCols, CPUDEVICE);
+    Matrix<ElemType> reserve(CPUDEVICE);
+    Matrix<ElemType> workspace(CPUDEVICE);
+    outputY.RNNForward(inputX, paramW, xDim, yDim, numSequencesForFrame, attributes, reserve, workspace);
+
+    std::vector<Sequence> expected = ReferenceRNN(attributes, xDim, params, inputs);
+    size_t col = 0;
+    for (size_t t = 0; t < numSequencesForFrame.size(); t++)
+    {
+        for (size_t s = 0; s < numSequencesForFrame[t]; s++, col++)
+        {
+            for (size_t row = 0; row < yDim; row++)
+                BOOST_REQUIRE_SMALL(outputY(row, col) - expected[s][t][row], tolerance);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(CPURNNSuite)
+
+BOOST_AUTO_TEST_CASE(CPURNNForwardLSTM)
+{
+    TestRNNForward<double>(RnnAttributes(false, 2, 7, L"lstm", -1), 5, { 6, 4, 4, 1 }, 1e-10);
+    TestRNNForward<float>(RnnAttributes(true, 2, 7, L"lstm", -1), 5, { 6, 4, 4, 1 }, 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(CPURNNForwardGRU)
+{
+    TestRNNForward<double>(RnnAttributes(false, 1, 6, L"gru", -1), 3, { 5, 5, 2 }, 1e-10);
+    TestRNNForward<double>(RnnAttributes(true, 3, 6, L"gru", -1), 3, { 5, 5, 2 }, 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(CPURNNForwardPlainRNN)
+{
+    TestRNNForward<double>(RnnAttributes(true, 2, 4, L"rnnTanh", -1), 8, { 3, 2, 1 }, 1e-10);
+    TestRNNForward<double>(RnnAttributes(false, 1, 4, L"rnnReLU", -1), 8, { 3, 2, 1 }, 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(CPURNNForwardWrongNumberOfParameters)
+{
+    RnnAttributes attributes(false, 1, 4, L"lstm", -1);
+    std::vector<size_t> numSequencesForFrame = { 1 };
+    Matrix<float> inputX = Matrix<float>::Zeros(3, 1, CPUDEVICE);
+    Matrix<float> paramW = Matrix<float>::Zeros(10, 1, CPUDEVICE);
+    Matrix<float> outputY(4, 1, CPUDEVICE);
+    Matrix<float> reserve(CPUDEVICE);
+    Matrix<float> workspace(CPUDEVICE);
+    BOOST_CHECK_THROW(outputY.RNNForward(inputX, paramW, 3, 4, numSequencesForFrame, attributes, reserve, workspace), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -116,6 +116,170 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndAdd, RandomSeedFixture)
     }
 }
 
+// random CSC matrix with about 'density' nonzero elements, and its dense equivalent
+static void CreateRandomSparseMatrix(size_t rows, size_t cols, double density, unsigned long seed, SparseMatrix& sparse, DenseMatrix& dense)
+{
+    dense.Resize(rows, cols);
+    dense.SetUniformRandomValue(-1, 1, seed);
+    DenseMatrix mask(rows, cols);
+    mask.SetUniformRandomValue(0, 1, seed + 1);
+    sparse = SparseMatrix(MatrixFormat::matrixFormatSparseCSC, rows, cols, 0);
+    foreach_coord (row, col, dense)
+    {
+        if (mask(row, col) < density)
+            sparse.SetValue(row, col, dense(row, col));
+        else
+            dense(row, col) = 0;
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndWeightedAddAllTranspositions, RandomSeedFixture)
+{
+    // large enough for the products to be computed in parallel
+    const size_t m = 300;
+    const size_t k = 200;
+    const size_t n = 150;
+    const double alpha = 0.7;
+    const double beta = 0.3;
+
+    for (bool transposeA : { false, true })
+    {
+        for (bool transposeB : { false, true })
+        {
+            // dense * sparse
+            DenseMatrix dense, sparseAsDense;
+            dense.Resize(transposeA ? k : m, transposeA ? m : k);
+            dense.SetUniformRandomValue(-1, 1, IncrementCounter());
+            SparseMatrix sparse(MatrixFormat::matrixFormatSparseCSC);
+            CreateRandomSparseMatrix(transposeB ? n : k, transposeB ? k : n, 0.05, IncrementCounter(), sparse, sparseAsDense);
+
+            DenseMatrix expected(m, n), result(m, n);
+            expected.SetUniformRandomValue(-1, 1, IncrementCounter());
+            result.SetValue(expected);
+            DenseMatrix::MultiplyAndWeightedAdd(alpha, dense, transposeA, sparseAsDense, transposeB, beta, expected);
+            SparseMatrix::MultiplyAndWeightedAdd(alpha, dense, transposeA, sparse, transposeB, beta, result);
+            BOOST_CHECK(result.IsEqualTo(expected, c_epsilonFloatE4));
+
+            // sparse * dense
+            CreateRandomSparseMatrix(transposeA ? k : m, transposeA ? m : k, 0.05, IncrementCounter(), sparse, sparseAsDense);
+            dense.Resize(transposeB ? n : k, transposeB ? k : n);
+            dense.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+            expected.SetUniformRandomValue(-1, 1, IncrementCounter());
+            result.SetValue(expected);
+            DenseMatrix::MultiplyAndWeightedAdd(alpha, sparseAsDense, transposeA, dense, transposeB, beta, expected);
+            SparseMatrix::MultiplyAndWeightedAdd(alpha, sparse, transposeA, dense, transposeB, beta, result);
+            BOOST_CHECK(result.IsEqualTo(expected, c_epsilonFloatE4));
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndWeightedAddColumnSlice, RandomSeedFixture)
+{
+    // the sparse factor is a column slice, whose nonzero elements do not start at the beginning of the buffers
+    const size_t m = 200;
+    const size_t k = 300;
+    const size_t n = 100;
+
+    DenseMatrix dense(m, k);
+    dense.SetUniformRandomValue(-1, 1, IncrementCounter());
+    SparseMatrix sparse(MatrixFormat::matrixFormatSparseCSC);
+    DenseMatrix sparseAsDense;
+    CreateRandomSparseMatrix(k, 3 * n, 0.1, IncrementCounter(), sparse, sparseAsDense);
+
+    DenseMatrix expected(m, n), result(m, n);
+    DenseMatrix::MultiplyAndWeightedAdd(1, dense, false, sparseAsDense.ColumnSlice(n, n), false, 0, expected);
+    SparseMatrix::MultiplyAndWeightedAdd(1, dense, false, sparse.ColumnSlice(n, n), false, 0, result);
+    BOOST_CHECK(result.IsEqualTo(expected, c_epsilonFloatE4));
+
+    // gradient of a parameter that is multiplied by the slice: dense * slice^T, accumulated into a SparseBlockCol matrix
+    DenseMatrix gradient(m, k);
+    DenseMatrix::MultiplyAndWeightedAdd(1, result, false, sparseAsDense.ColumnSlice(n, n), true, 0, gradient);
+    SparseMatrix sparseGradient(MatrixFormat::matrixFormatSparseBlockCol, m, k, 0);
+    SparseMatrix::MultiplyAndAdd(1, result, false, sparse.ColumnSlice(n, n), true, sparseGradient);
+    foreach_coord (row, col, gradient)
+    {
+        BOOST_CHECK(abs(sparseGradient(row, col) - gradient(row, col)) < c_epsilonFloatE4);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixScatterColumnsToBlockCol, RandomSeedFixture)
+{
+    // gradient of an embedding lookup: the columns of 'a' are added to the looked-up columns, some more than once, one is a gap
+    const size_t m = 20;
+    const size_t n = 10;
+    DenseMatrix a(m, 6);
+    a.SetUniformRandomValue(-1, 1, IncrementCounter());
+    DenseMatrix idx(1, 6);
+    const double indices[] = { 3, 0, 3, -1, 7, 0 };
+    for (size_t j = 0; j < 6; j++)
+        idx(0, j) = indices[j];
+
+    DenseMatrix expected(m, n);
+    expected.SetValue(0);
+    SparseMatrix result(MatrixFormat::matrixFormatSparseBlockCol, m, n, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        expected.DoScatterColumnsOf(1, idx, a, 0.5);
+        result.DoScatterColumnsOf(1, idx, a, 0.5);
+    }
+    BOOST_CHECK_EQUAL(result.GetBlockSize(), 3);
+    foreach_coord (row, col, expected)
+    {
+        BOOST_CHECK(abs(result(row, col) - expected(row, col)) < c_epsilonFloatE4);
+    }
+
+    // weight decay of the touched columns only
+    DenseMatrix values(m, n);
+    values.SetUniformRandomValue(-1, 1, IncrementCounter());
+    SparseMatrix::ScaleAndAdd(0.1, values, result);
+    foreach_coord (row, col, expected)
+    {
+        double decay = (col == 0 || col == 3 || col == 7) ? 0.1 * values(row, col) : 0;
+        BOOST_CHECK(abs(result(row, col) - (expected(row, col) + decay)) < c_epsilonFloatE4);
+    }
+
+    // beta = 0 starts over
+    result.DoScatterColumnsOf(0, idx, a, 1);
+    BOOST_CHECK_EQUAL(result.GetBlockSize(), 3);
+    BOOST_CHECK(abs(result(0, 7) - a(0, 4)) < c_epsilonFloatE4);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixFSAdagradBlockCol, RandomSeedFixture)
+{
+    // the block-sparse update equals the dense one in the columns that have a gradient, and leaves the others alone
+    const size_t m = 30;
+    const size_t n = 8;
+    DenseMatrix a(m, 3);
+    a.SetUniformRandomValue(-1, 1, IncrementCounter());
+    DenseMatrix idx(1, 3);
+    idx(0, 0) = 5;
+    idx(0, 1) = 2;
+    idx(0, 2) = 5;
+    SparseMatrix sparseGradient(MatrixFormat::matrixFormatSparseBlockCol, m, n, 0);
+    sparseGradient.DoScatterColumnsOf(0, idx, a, 1);
+    DenseMatrix gradient(m, n);
+    gradient.SetValue(0);
+    gradient.DoScatterColumnsOf(0, idx, a, 1);
+
+    DenseMatrix initialValues(m, n);
+    initialValues.SetUniformRandomValue(-1, 1, IncrementCounter());
+    DenseMatrix values(initialValues), sparseValues(initialValues);
+    DenseMatrix smoothed, sparseSmoothed;
+    for (int step = 0; step < 3; step++)
+    {
+        smoothed.FSAdagrad(gradient, values, 0.1, 0.9, 0.99, 1, true);
+        sparseGradient.FSAdagrad(sparseSmoothed, sparseValues, 0.1, 0.9, 0.99, 1, true);
+    }
+    foreach_coord (row, col, values)
+    {
+        if (col == 2 || col == 5)
+            BOOST_CHECK(abs(sparseValues(row, col) - values(row, col)) < c_epsilonFloatE4);
+        else
+            BOOST_CHECK_EQUAL(sparseValues(row, col), initialValues(row, col));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
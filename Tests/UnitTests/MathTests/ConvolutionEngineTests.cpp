@@ -14,7 +14,9 @@
 #include "../../../Source/Math/CPUMatrix.h"
 #include "../../../Source/Math/GPUMatrix.h"
 #include "../../../Source/Math/ConvolutionEngine.h"
+#include "../../../Source/Math/BlockedLayout.h"
 #include "../../../Source/Math/CuDnnFactories.h"
+#include "../../../Source/Common/Include/fileutil.h"
 #include "common.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
@@ -62,6 +64,12 @@ std::vector<std::tuple<ConvolutionEngineKind, DEVICEID_TYPE, size_t>> GetTestEng
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 0));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 1));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 3));
+
+    // Winograd engine, CPU only, with fallback to Gemm for the geometries it does not support. Uses temp memory.
+    auto winograd = (ConvolutionEngineKind)((int)ConvolutionEngineKind::Winograd | (int)ConvolutionEngineKind::Gemm);
+    res.push_back(std::make_tuple(winograd, -1, 0));
+    res.push_back(std::make_tuple(winograd, -1, 1));
+    res.push_back(std::make_tuple(winograd, -1, 3));
     return res;
 }
 
@@ -121,6 +129,22 @@ std::vector<ConvolveGeometryPtr> GenerateConvTestConfigs()
         TensorShape(1, 1, 2), TensorShape(1), TensorShape(2, 2, 1),
         ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
         TensorShape(0, 0, 0), TensorShape(0)));
+
+    // 3x3 convolutions with stride 1 that use Winograd, padded with partial tiles at the border and not padded.
+    res.push_back(std::make_shared<ConvolveGeometry>(TensorShape(20, 14, 4),
+        TensorShape(3, 3, 4), TensorShape(8), TensorShape(1, 1, 4),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+        TensorShape(0), TensorShape(0)));
+    res.push_back(std::make_shared<ConvolveGeometry>(TensorShape(16, 16, 3),
+        TensorShape(3, 3, 3), TensorShape(2), TensorShape(1, 1, 3),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
+        TensorShape(0), TensorShape(0)));
+
+    // 1x1 convolution with stride 1 (bottlenecks in ResNet).
+    res.push_back(std::make_shared<ConvolveGeometry>(TensorShape(16, 16, 8),
+        TensorShape(1, 1, 8), TensorShape(4), TensorShape(1, 1, 8),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
+        TensorShape(0, 0, 0), TensorShape(0)));
     return res;
 }
 
@@ -584,6 +608,243 @@ BOOST_AUTO_TEST_CASE(MaxUnpooling)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ConvolutionAutotuning)
+{
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+    auto randomMatrix = [&](size_t r, size_t c) -> SingleMatrix
+    {
+        vec buf(r * c);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        return SingleMatrix(r, c, buf.data(), CPUDEVICE, matrixFlagNormal);
+    };
+    auto countLines = [](const std::wstring& path)
+    {
+        std::string text;
+        FILE* f = fopenOrDie(path, L"r");
+        for (int c; (c = fgetc(f)) != EOF;)
+            text.push_back((char)c);
+        fclose(f);
+        return std::count(text.begin(), text.end(), '\n');
+    };
+
+    const std::wstring cacheFile = L"ConvolutionAutotuning.txt";
+    if (fexists(cacheFile))
+        unlinkOrDie(cacheFile);
+    // the autotuner is process-wide, so it is restored for the other tests even if this one fails
+    const bool wasEnabled = ConvolutionEngineAutotuner::IsEnabled();
+    auto restoreAutotuner = MakeScopeExit([&]()
+    {
+        ConvolutionEngineAutotuner::SetEnabled(wasEnabled);
+        ConvolutionEngineAutotuner::SetCacheFile(L"");
+        if (fexists(cacheFile))
+            unlinkOrDie(cacheFile);
+    });
+    ConvolutionEngineAutotuner::SetEnabled(true);
+
+    // The first pass times the engines and stores the choices, the second one loads them from the file.
+    std::ptrdiff_t numChoices = 0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        ConvolutionEngineAutotuner::SetCacheFile(cacheFile);
+        for (const auto& g : GenerateConvTestConfigs())
+        {
+            auto baseEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+            auto testEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::All);
+
+            const size_t n = 3;
+            size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+            SingleMatrix in = randomMatrix(g->InputShape().GetNumElements(), n);
+            SingleMatrix kernel = randomMatrix(mapCount, g->KernelShape().GetNumElements());
+            SingleMatrix srcGrad = randomMatrix(g->OutputShape().GetNumElements(), n);
+            SingleMatrix out(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+            SingleMatrix outB(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+            SingleMatrix grad = randomMatrix(g->InputShape().GetNumElements(), n);
+            SingleMatrix gradB = grad.DeepClone();
+            SingleMatrix kernelGrad = randomMatrix(mapCount, g->KernelShape().GetNumElements());
+            SingleMatrix kernelGradB = kernelGrad.DeepClone();
+            SingleMatrix workspace(CPUDEVICE);
+            SingleMatrix workspaceB(CPUDEVICE);
+
+            testEng->Forward(in, kernel, out, workspace);
+            baseEng->Forward(in, kernel, outB, workspaceB);
+            testEng->BackwardData(srcGrad, kernel, grad, true, workspace);
+            baseEng->BackwardData(srcGrad, kernel, gradB, true, workspaceB);
+            testEng->BackwardKernel(srcGrad, in, kernelGrad, true, false, workspace);
+            baseEng->BackwardKernel(srcGrad, in, kernelGradB, true, false, workspaceB);
+
+            std::string msg = " are not equal, Geometry: " + (std::string)(*g);
+            float relErr = Err<float>::Rel;
+            float absErr = Err<float>::Abs;
+            std::string emsg;
+            BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr * 4, absErr * 14), "out" << msg << ". " << emsg);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(grad, gradB, emsg, relErr * 16, absErr * 64), "grad" << msg << ". " << emsg);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(kernelGrad, kernelGradB, emsg, relErr * 192, absErr * 64), "kernelGrad" << msg << ". " << emsg);
+        }
+
+        // Nothing is timed again in the second pass.
+        BOOST_REQUIRE(fexists(cacheFile));
+        if (pass == 0)
+            numChoices = countLines(cacheFile);
+        BOOST_CHECK_GT(numChoices, 0);
+        BOOST_CHECK_EQUAL(countLines(cacheFile), numChoices);
+    }
+
+    // A cache file that cannot be written does not stop the autotuning.
+    ConvolutionEngineAutotuner::SetCacheFile(L"ConvolutionAutotuningMissingDirectory/ConvolutionAutotuning.txt");
+    auto g = GenerateConvTestConfigs().front();
+    auto testEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::All);
+    SingleMatrix in = randomMatrix(g->InputShape().GetNumElements(), 2);
+    SingleMatrix kernel = randomMatrix(g->GetMapCount(g->InputShape().GetRank() - 1), g->KernelShape().GetNumElements());
+    SingleMatrix out(g->OutputShape().GetNumElements(), 2, CPUDEVICE);
+    SingleMatrix workspace(CPUDEVICE);
+    testEng->Forward(in, kernel, out, workspace);
+}
+
+BOOST_AUTO_TEST_CASE(BlockedLayoutForward)
+{
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+    auto randomMatrix = [&](size_t r, size_t c) -> SingleMatrix
+    {
+        vec buf(r * c);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        return SingleMatrix(r, c, buf.data(), CPUDEVICE, matrixFlagNormal);
+    };
+    auto toBlocked = [](const SingleMatrix& m, const TensorShape& shape) -> SingleMatrix
+    {
+        SingleMatrix res(m.GetNumRows(), m.GetNumCols(), CPUDEVICE);
+        BlockedLayout::ToBlocked(m.Data(), res.Data(), shape[0], shape[1], shape[2], m.GetNumCols());
+        return res;
+    };
+    auto fromBlocked = [](const SingleMatrix& m, const TensorShape& shape) -> SingleMatrix
+    {
+        SingleMatrix res(m.GetNumRows(), m.GetNumCols(), CPUDEVICE);
+        BlockedLayout::FromBlocked(m.Data(), res.Data(), shape[0], shape[1], shape[2], m.GetNumCols());
+        return res;
+    };
+
+    // The generic configurations with plain inputs and outputs, and configurations with blocks of channels that are wide
+    // enough for the blocks of 8 output pixels.
+    std::vector<std::pair<ConvolveGeometryPtr, PoolKind>> configs;
+    for (const auto& g : GenerateConvTestConfigs())
+        configs.push_back(std::make_pair(g, PoolKind::None));
+    for (auto kind : {PoolKind::Max, PoolKind::Average})
+    {
+        for (const auto& g : GeneratePoolTestConfigs())
+            configs.push_back(std::make_pair(g, kind));
+    }
+    for (size_t stride : {1, 2})
+    {
+        configs.push_back(std::make_pair(std::make_shared<ConvolveGeometry>(TensorShape(19, 7, 8),
+            TensorShape(3, 3, 8), TensorShape(16), TensorShape(stride, stride, 8),
+            ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+            TensorShape(0), TensorShape(0)), PoolKind::None));
+        configs.push_back(std::make_pair(std::make_shared<ConvolveGeometry>(TensorShape(12, 6, 16),
+            TensorShape(1, 1, 16), TensorShape(8), TensorShape(stride, stride, 16),
+            ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
+            TensorShape(0), TensorShape(0)), PoolKind::None));
+        for (auto kind : {PoolKind::Max, PoolKind::Average})
+        {
+            configs.push_back(std::make_pair(std::make_shared<ConvolveGeometry>(TensorShape(9, 7, 16),
+                TensorShape(3, 3, 1), TensorShape(1), TensorShape(stride, stride, 1),
+                ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+                TensorShape(0), TensorShape(0)), kind));
+        }
+    }
+    // RGB input (padded to a block of channels) with blocked output.
+    configs.push_back(std::make_pair(std::make_shared<ConvolveGeometry>(TensorShape(11, 11, 3),
+        TensorShape(5, 5, 3), TensorShape(8), TensorShape(2, 2, 3),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+        TensorShape(0), TensorShape(0)), PoolKind::None));
+
+    size_t numBlockedTests = 0;
+    for (const auto& config : configs)
+    {
+        const auto& g = config.first;
+        const auto kind = config.second;
+        if (!ConvEng::IsBlockedLayoutSupported(g, CPUDEVICE, kind))
+            continue;
+        auto baseEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, kind, ConvolutionEngineKind::Reference);
+        auto testEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, kind, ConvolutionEngineKind::Blocked);
+
+        const size_t n = 3;
+        const auto& inT = g->InputShape();
+        const auto& outT = g->OutputShape();
+        size_t mapCount = g->GetMapCount(inT.GetRank() - 1);
+        SingleMatrix in = randomMatrix(inT.GetNumElements(), n);
+        SingleMatrix kernel = randomMatrix(mapCount, g->KernelShape().GetNumElements());
+        SingleMatrix outB(outT.GetNumElements(), n, CPUDEVICE);
+        SingleMatrix workspace(CPUDEVICE);
+        if (kind == PoolKind::None)
+            baseEng->Forward(in, kernel, outB, workspace);
+        else
+            baseEng->ForwardPooling(in, outB);
+
+        for (bool blockedInput : {false, true})
+        {
+            for (bool blockedOutput : {false, true})
+            {
+                if ((blockedInput && inT[2] % BlockedLayout::ChannelBlockSize != 0) || (blockedOutput && outT[2] % BlockedLayout::ChannelBlockSize != 0))
+                    continue;
+                testEng->SetBlockedLayout(blockedInput, blockedOutput);
+                SingleMatrix testIn = blockedInput ? toBlocked(in, inT) : in.DeepClone();
+                SingleMatrix out(outT.GetNumElements(), n, CPUDEVICE);
+                if (kind == PoolKind::None)
+                    testEng->Forward(testIn, kernel, out, workspace);
+                else
+                    testEng->ForwardPooling(testIn, out);
+                SingleMatrix plainOut = blockedOutput ? fromBlocked(out, outT) : out.DeepClone();
+                numBlockedTests += blockedInput || blockedOutput;
+
+                std::stringstream tmsg;
+                tmsg << " are not equal, Geometry: " << (std::string)(*g) << ", Pool: " << (int)kind << ", Blocked input: " << blockedInput << ", Blocked output: " << blockedOutput;
+                std::string emsg;
+                BOOST_REQUIRE_MESSAGE(CheckEqual(plainOut, outB, emsg, Err<float>::Rel * 4, Err<float>::Abs * 64), "out" << tmsg.str() << ". " << emsg);
+            }
+        }
+    }
+    BOOST_CHECK_GT(numBlockedTests, 0);
+}
+
+BOOST_AUTO_TEST_CASE(BlockedConvolutionKernelUpdate)
+{
+    // The blocked engine caches the reordered kernel; changing the weights in place (as training does) must be seen by the next forward.
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+    auto g = std::make_shared<ConvolveGeometry>(TensorShape(9, 5, 8),
+        TensorShape(3, 3, 8), TensorShape(8), TensorShape(1, 1, 8),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+        TensorShape(0), TensorShape(0));
+    BOOST_REQUIRE(ConvEng::IsBlockedLayoutSupported(g, CPUDEVICE, PoolKind::None));
+    auto baseEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+    auto testEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Blocked);
+
+    const size_t n = 2;
+    const auto& inT = g->InputShape();
+    const auto& outT = g->OutputShape();
+    vec buf(inT.GetNumElements() * n);
+    std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+    SingleMatrix in(inT.GetNumElements(), n, buf.data(), CPUDEVICE, matrixFlagNormal);
+    SingleMatrix kernel(g->GetMapCount(inT.GetRank() - 1), g->KernelShape().GetNumElements(), CPUDEVICE);
+    SingleMatrix workspace(CPUDEVICE);
+
+    for (int step = 0; step < 3; step++)
+    {
+        float* k = kernel.Data();
+        for (size_t i = 0; i < kernel.GetNumElements(); i++)
+            k[i] = nd(rng);
+
+        SingleMatrix outB(outT.GetNumElements(), n, CPUDEVICE);
+        SingleMatrix out(outT.GetNumElements(), n, CPUDEVICE);
+        baseEng->Forward(in, kernel, outB, workspace);
+        testEng->Forward(in, kernel, out, workspace);
+
+        std::string emsg;
+        BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, Err<float>::Rel * 4, Err<float>::Abs * 64), "out are not equal at step " << step << ". " << emsg);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
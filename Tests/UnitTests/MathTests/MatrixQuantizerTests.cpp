@@ -471,6 +471,43 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrix1BitQuantizeDouble, RandomSeedFixture)
     TestQuantization<double>(CPUDEVICE, 100, 50, -0.5f, +0.5f, 2915, 5);
 }
 
+// Quantizing column slices into column slices of a quantized matrix, as QuantizedDistGradAggregator does for the
+// stripes of a gradient, gives the same result as quantizing the whole matrix, since the columns are independent.
+BOOST_FIXTURE_TEST_CASE(CPUMatrixQuantizeColumnSlices, RandomSeedFixture)
+{
+    const size_t numRows = 70;
+    const size_t numCols = 11;
+    for (size_t numBits : { 1, 4 })
+    {
+        std::unique_ptr<MatrixQuantizerImpl<float>> quantizer(MatrixQuantizerImpl<float>::Create(CPUDEVICE, false /*useAsync*/));
+        Matrix<float> inMatrix = Matrix<float>::RandomUniform(numRows, numCols, CPUDEVICE, -1.0f, 1.0f, 1015);
+        Matrix<float> residual(numRows, numCols, CPUDEVICE);
+        residual.SetValue(0.01f);
+        Matrix<float> sliceResidual = residual.DeepClone();
+
+        QuantizedMatrix<float> quantized(numRows, numCols, numBits, CPUDEVICE);
+        quantizer->QuantizeAsync(inMatrix, residual, quantized, residual, true);
+        Matrix<float> outMatrix(numRows, numCols, CPUDEVICE);
+        quantizer->UnquantizeAsync(quantized, outMatrix, false);
+
+        QuantizedMatrix<float> sliceQuantized(numRows, numCols, numBits, CPUDEVICE);
+        Matrix<float> sliceOutMatrix(numRows, numCols, CPUDEVICE);
+        for (size_t begin = 0; begin < numCols; begin += 4)
+        {
+            const size_t n = std::min<size_t>(4, numCols - begin);
+            Matrix<float> inSlice = inMatrix.ColumnSlice(begin, n);
+            Matrix<float> residualSlice = sliceResidual.ColumnSlice(begin, n);
+            Matrix<float> outSlice = sliceOutMatrix.ColumnSlice(begin, n);
+            auto quantizedSlice = sliceQuantized.ColumnSlice(begin, n);
+            quantizer->QuantizeAsync(inSlice, residualSlice, quantizedSlice, residualSlice, true);
+            quantizer->UnquantizeAsync(quantizedSlice, outSlice, false);
+        }
+
+        BOOST_CHECK(outMatrix.IsEqualTo(sliceOutMatrix, 0));
+        BOOST_CHECK(residual.IsEqualTo(sliceResidual, 0));
+    }
+}
+
 /*
         Original test cases were using these parameter:
 
@@ -3,6 +3,7 @@
 // Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
 //
 #include "stdafx.h"
+#include <random>
 #include "../../../Source/Math/QuantizedOperations.h"
 #include "../../../Source/Math/Helpers.h"
 
@@ -50,6 +51,55 @@ BOOST_FIXTURE_TEST_CASE(MultiplyIntToShort, RandomSeedFixture)
         BOOST_CHECK_EQUAL(round(C_upd[i]), C_expected_upd[i]);
 }
 
+BOOST_FIXTURE_TEST_CASE(MultiplyBlocked, RandomSeedFixture)
+{
+    // k covers all block sizes of the block multiplier (128, 64, ..., 8) and a remainder;
+    // n = 8 is processed 4 columns at a time, n = 3 one column at a time
+    int m = 37, k = 128 + 64 + 32 + 16 + 8 + 5;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> values(-1, 1);
+
+    std::vector<float> A(m*k);
+    for (auto& a : A)
+        a = values(rng);
+
+    // bit shift 4 keeps the dot products within the range of int
+    shared_ptr<QuantizerBase<float, short>> quantA(new SymmetricQuantizer<float, short>(4));
+    shared_ptr<QuantizerBase<float, short>> quantB(new SymmetricQuantizer<float, short>(4));
+    QuantizedMultiplier<float> mult(quantA, true, quantB, false);
+
+    for (int n : { 8, 3, 8 })
+    {
+        std::vector<float> B(k*n);
+        for (auto& b : B)
+            b = values(rng);
+
+        std::vector<float> C(m*n);
+        mult.Multiply(m, n, k, A.data(), B.data(), C.data());
+
+        // reference: the same quantization, followed by a plain integer product
+        SymmetricQuantizer<float, short> refQuantA(4), refQuantB(4);
+        std::vector<short> qA(m*k), qB(k*n);
+        ArrayRef<short> refA(qA.data(), qA.size()), refB(qB.data(), qB.size());
+        refQuantA.Quantize(ArrayRef<float>(A.data(), A.size()), refA);
+        refQuantB.Quantize(ArrayRef<float>(B.data(), B.size()), refB);
+        std::vector<float> expected(m*n);
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < n; j++)
+            {
+                int dotProduct = 0;
+                for (int l = 0; l < k; l++)
+                    dotProduct += qA[i + l*m] * qB[l + k*j];
+                expected[i + j*m] = (float)dotProduct;
+            }
+        refQuantB.Dequantize(expected.data(), expected.data(), expected.size());
+        refQuantA.Dequantize(expected.data(), expected.data(), expected.size());
+
+        for (size_t i = 0; i < C.size(); i++)
+            BOOST_CHECK_EQUAL(C[i], expected[i]);
+    }
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -100,6 +100,87 @@ BOOST_AUTO_TEST_CASE(OldRnnForwardProp)
     TestOldRnnForwardPropSRP<float>();
 }
 
+BOOST_AUTO_TEST_CASE(FusedElementwiseChain)
+{
+    Test::TensorTest<float> tensorTester;
+
+    // sigmoid(a + bias) .* c, fused vs. op by op, with a bias broadcasting along columns or rows
+    // The shape is not a multiple of the block size. The per-column bias has stride 0 in the innermost dimension.
+    for (let& biasShape : { TensorShape{ 300 }, TensorShape{ 1, 70 } })
+    {
+        let a    = tensorTester.CreateTensor(TensorShape{ 300, 70 }, 1, CPUDEVICE);
+        let bias = tensorTester.CreateTensor(biasShape, 2, CPUDEVICE);
+        let c    = tensorTester.CreateTensor(TensorShape{ 300, 70 }, 3, CPUDEVICE);
+        auto fused  = tensorTester.CreateTensor(TensorShape{ 300, 70 }, 4, CPUDEVICE, true);
+        auto opByOp = tensorTester.CreateTensor(TensorShape{ 300, 70 }, 4, CPUDEVICE, true);
+
+        ElementwiseOpChain chain(3);
+        chain.Binary(ElementWiseOperator::opElementwiseProduct, chain.Unary(ElementWiseOperator::opSigmoid, chain.Binary(ElementWiseOperator::opSum, 0, 1)), 2);
+        fused.DoChainOf(0.5f, chain, { a, bias, c }, 2.0f);
+
+        auto temp = tensorTester.CreateTensor(TensorShape{ 300, 70 }, 5, CPUDEVICE, true);
+        temp.AssignSumOf(a, bias);
+        temp.AssignSigmoidOf(temp);
+        opByOp.DoElementwiseProductOf(0.5f, temp, c, 2.0f);
+
+        BOOST_CHECK(fused.GetSOB().IsEqualTo(opByOp.GetSOB(), 0));
+    }
+
+    // LSTM cell state c' = sigmoid(f) .* c + sigmoid(i) .* tanh(g), computed in place into c
+    let f = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 6, CPUDEVICE);
+    let i = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 7, CPUDEVICE);
+    let g = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 8, CPUDEVICE);
+    auto cell = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 9, CPUDEVICE, true);
+    auto expected = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 9, CPUDEVICE, true);
+
+    ElementwiseOpChain lstm(4); // f, c, i, g
+    let forget = lstm.Binary(ElementWiseOperator::opElementwiseProduct, lstm.Unary(ElementWiseOperator::opSigmoid, 0), 1);
+    let update = lstm.Binary(ElementWiseOperator::opElementwiseProduct, lstm.Unary(ElementWiseOperator::opSigmoid, 2), lstm.Unary(ElementWiseOperator::opTanh, 3));
+    lstm.Binary(ElementWiseOperator::opSum, forget, update);
+    cell.AssignChainOf(lstm, { f, cell, i, g });
+
+    auto temp1 = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 10, CPUDEVICE, true);
+    auto temp2 = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 11, CPUDEVICE, true);
+    temp1.AssignSigmoidOf(f);
+    expected.AssignElementwiseProductOf(temp1, expected);
+    temp1.AssignSigmoidOf(i);
+    temp2.AssignTanhOf(g);
+    expected.AddElementwiseProductOf(temp1, temp2);
+
+    BOOST_CHECK(cell.GetSOB().IsEqualTo(expected.GetSOB(), 1e-6f));
+}
+
+BOOST_AUTO_TEST_CASE(ElementwiseChainOpByOpWorkspace)
+{
+    Test::TensorTest<float> tensorTester;
+
+    // the LSTM cell state c' = sigmoid(f) .* c + sigmoid(i) .* tanh(g), op by op vs. fused
+    let f = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 6, CPUDEVICE);
+    let c = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 7, CPUDEVICE);
+    let i = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 8, CPUDEVICE);
+    let g = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 9, CPUDEVICE);
+    auto fused  = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 10, CPUDEVICE, true);
+    auto opByOp = tensorTester.CreateTensor(TensorShape{ 512, 16 }, 11, CPUDEVICE, true);
+
+    ElementwiseOpChain lstm(4); // f, c, i, g
+    let forget = lstm.Binary(ElementWiseOperator::opElementwiseProduct, lstm.Unary(ElementWiseOperator::opSigmoid, 0), 1);
+    let update = lstm.Binary(ElementWiseOperator::opElementwiseProduct, lstm.Unary(ElementWiseOperator::opSigmoid, 2), lstm.Unary(ElementWiseOperator::opTanh, 3));
+    lstm.Binary(ElementWiseOperator::opSum, forget, update);
+    fused.AssignChainOf(lstm, { f, c, i, g });
+
+    // The five intermediate results share three workspace columns, which are kept across calls.
+    auto workspace = make_shared<Matrix<float>>(CPUDEVICE);
+    tensorTester.ChainOpByOpTest(opByOp, lstm, { f, c, i, g }, workspace);
+    BOOST_CHECK(opByOp.GetSOB().IsEqualTo(fused.GetSOB(), 1e-6f));
+    BOOST_CHECK_EQUAL(workspace->GetNumRows(), 512 * 16);
+    BOOST_CHECK_EQUAL(workspace->GetNumCols(), 3);
+
+    let data = workspace->Data();
+    tensorTester.ChainOpByOpTest(opByOp, lstm, { f, c, i, g }, workspace);
+    BOOST_CHECK(workspace->Data() == data);
+    BOOST_CHECK(opByOp.GetSOB().IsEqualTo(fused.GetSOB(), 1e-6f));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }}}}
@@ -87,6 +87,12 @@ struct TensorTest
         result.AssignSumOf(input, bias);
         return result;
     }
+
+    // evaluate a chain op by op, as on the GPU
+    void ChainOpByOpTest(TensorView<ElemType>& result, const ElementwiseOpChain& chain, const vector<TensorView<ElemType>>& inputs, shared_ptr<Matrix<ElemType>> workspace)
+    {
+        result.DoChainOpByOpOf(0, chain, inputs, 1, workspace);
+    }
 };
 
 template <class ElemType>
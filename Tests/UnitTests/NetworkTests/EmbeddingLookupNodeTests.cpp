@@ -0,0 +1,178 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/ComputationNetworkLib/ComputationNetwork.h"
+#include "../../../Source/ComputationNetworkLib/ComputationNetworkBuilder.h"
+#include "../../../Source/ComputationNetworkLib/ComputationEnvironment.h"
+#include "../../../Source/ComputationNetworkLib/InputAndParamNodes.h"
+#include "TestHelpers.h"
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(EmbeddingLookupNodeTests)
+
+typedef shared_ptr<ComputationNode<float>> NodePtr;
+
+const size_t c_embeddingDim = 3;
+const size_t c_vocabularySize = 6;
+
+// the embedding matrix [c_embeddingDim x c_vocabularySize], with distinct values
+static NodePtr CreateEmbedding(ComputationNetworkBuilder<float>& builder)
+{
+    auto embedding = builder.CreateLearnableParameter(L"embedding", TensorShape(c_embeddingDim, c_vocabularySize));
+    for (size_t i = 0; i < embedding->Value().GetNumElements(); i++)
+        embedding->Value().Data()[i] = (float)(i + 1) / 8;
+    return embedding;
+}
+
+static NodePtr GetNode(const ComputationNetworkPtr& net, const wstring& name)
+{
+    return dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(name));
+}
+
+// sets the minibatch of an input node; its MBLayout must have been set up already
+static void SetInput(const ComputationNetworkPtr& net, const wstring& name, const vector<float>& values)
+{
+    auto input = GetNode(net, name);
+    const size_t numRows = input->GetSampleLayout().GetNumElements();
+    input->Value().SetValue(numRows, values.size() / numRows, CPUDEVICE, const_cast<float*>(values.data()), matrixFlagNormal);
+}
+
+BOOST_AUTO_TEST_CASE(OutputShape)
+{
+    // a single index per sample is not a tensor dimension of the output; several indices are
+    const vector<pair<TensorShape, SmallVector<size_t>>> shapes = {
+        { TensorShape(1), { c_embeddingDim } },
+        { TensorShape(4), { c_embeddingDim, 4 } },
+        { TensorShape(2, 3), { c_embeddingDim, 2, 3 } },
+    };
+    for (const auto& shape : shapes)
+    {
+        auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+        ComputationNetworkBuilder<float> builder(*net);
+        auto lookup = builder.EmbeddingLookup(CreateEmbedding(builder), builder.CreateInputNode(L"indices", shape.first), L"lookup");
+        net->AddToNodeGroup(L"output", lookup);
+        net->CompileNetwork();
+
+        BOOST_CHECK(lookup->GetSampleLayout().GetDims() == shape.second);
+        BOOST_CHECK(lookup->HasMBLayout());
+    }
+}
+
+// The lookup of indices must give the same as Times() of the embedding with the one-hot vectors of the indices.
+BOOST_AUTO_TEST_CASE(ForwardMatchesTimesWithOneHotInput)
+{
+    const size_t numSamples = 4;
+    const vector<float> allIndices = { 4, 0, 2, 2, 5, 1, 3, 0 };
+    for (size_t numIndicesPerSample : { 1, 2 })
+    {
+        auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+        ComputationNetworkBuilder<float> builder(*net);
+        auto embedding = CreateEmbedding(builder);
+        auto indices = builder.CreateInputNode(L"indices", TensorShape(numIndicesPerSample));
+        auto oneHot = builder.CreateInputNode(L"oneHot", numIndicesPerSample == 1 ? TensorShape(c_vocabularySize) : TensorShape(c_vocabularySize, numIndicesPerSample));
+        auto lookup = builder.EmbeddingLookup(embedding, indices, L"lookup");
+        auto reference = builder.Times(embedding, oneHot, /*outputRank=*/1, L"reference");
+        net->AddToNodeGroup(L"output", lookup);
+        net->AddToNodeGroup(L"output", reference);
+        net->CompileNetwork();
+        BOOST_REQUIRE(lookup->GetSampleLayout() == reference->GetSampleLayout());
+
+        ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+        net->AllocateAllMatrices({}, { lookup, reference }, nullptr);
+        net->StartEvaluateMinibatchLoop(vector<ComputationNodeBasePtr>{ lookup, reference });
+
+        vector<float> indexValues(allIndices.begin(), allIndices.begin() + numSamples * numIndicesPerSample);
+        vector<float> oneHotValues(c_vocabularySize * indexValues.size(), 0);
+        for (size_t j = 0; j < indexValues.size(); j++)
+            oneHotValues[j * c_vocabularySize + (size_t)indexValues[j]] = 1;
+        indices->GetMBLayout()->InitAsFrameMode(numSamples);
+        SetInput(net, L"indices", indexValues);
+        SetInput(net, L"oneHot", oneHotValues);
+        ComputationNetwork::BumpEvalTimeStamp({ indices, oneHot });
+        net->ForwardProp(vector<ComputationNodeBasePtr>{ lookup, reference });
+
+        BOOST_REQUIRE_EQUAL(lookup->Value().GetNumElements(), c_embeddingDim * indexValues.size());
+        BOOST_REQUIRE_EQUAL(reference->Value().GetNumElements(), lookup->Value().GetNumElements());
+        BOOST_CHECK(AreEqual(lookup->Value().Data(), reference->Value().Data(), lookup->Value().GetNumElements(), 1e-6f));
+    }
+}
+
+// The gradient of the embedding is a SparseBlockCol matrix that holds the sum of the output gradients of all frames
+// that looked up a column. Two lookups add into the same gradient, and gap frames contribute nothing.
+BOOST_AUTO_TEST_CASE(BackwardAccumulatesSparseBlockColGradient)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto embedding = CreateEmbedding(builder);
+    auto indices1 = builder.CreateInputNode(L"indices1", TensorShape(1));
+    auto indices2 = builder.CreateInputNode(L"indices2", TensorShape(1));
+    auto weights = builder.CreateInputNode(L"weights", TensorShape(c_embeddingDim));
+    auto lookup1 = builder.EmbeddingLookup(embedding, indices1, L"lookup1");
+    auto lookup2 = builder.EmbeddingLookup(embedding, indices2, L"lookup2");
+    // the output gradient of both lookups is the weights
+    ComputationNodeBasePtr criterion = builder.Sum(builder.ElementTimes(builder.Plus(lookup1, lookup2), weights), L"criterion");
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->CompileNetwork();
+
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->AllocateAllMatrices({}, {}, criterion);
+    net->StartEvaluateMinibatchLoop(criterion);
+
+    // two parallel sequences of 3 and 2 frames; the last frame of the second one is a gap (column 5)
+    const size_t numParallelSequences = 2, numTimeSteps = 3, numColumns = numParallelSequences * numTimeSteps, gapColumn = 5;
+    auto layout = indices1->GetMBLayout();
+    layout->Init(numParallelSequences, numTimeSteps);
+    layout->AddSequence(0, 0, 0, 3);
+    layout->AddSequence(1, 1, 0, 2);
+    layout->AddGap(1, 2, 3);
+
+    // index 1 is repeated in the first lookup; indices 0, 3 and 4 are looked up by both;
+    // index 5 only appears in the gap, and index 2 not at all
+    const vector<float> indexValues1 = { 1, 3, 1, 1, 4, 5 };
+    const vector<float> indexValues2 = { 3, 0, 4, 0, 0, 5 };
+    vector<float> weightValues(c_embeddingDim * numColumns);
+    for (size_t i = 0; i < weightValues.size(); i++)
+        weightValues[i] = (float)(i % c_embeddingDim + 1) + (float)(i / c_embeddingDim) * 10;
+    SetInput(net, L"indices1", indexValues1);
+    SetInput(net, L"indices2", indexValues2);
+    SetInput(net, L"weights", weightValues);
+    ComputationNetwork::BumpEvalTimeStamp({ indices1, indices2, weights });
+    net->ForwardProp(criterion);
+    net->Backprop(criterion);
+
+    const auto& gradient = embedding->Gradient();
+    BOOST_REQUIRE(gradient.GetMatrixType() == SPARSE);
+    BOOST_REQUIRE(gradient.GetFormat() == matrixFormatSparseBlockCol);
+    BOOST_REQUIRE_EQUAL(gradient.GetNumRows(), c_embeddingDim);
+    BOOST_REQUIRE_EQUAL(gradient.GetNumCols(), c_vocabularySize);
+
+    vector<float> expected(c_embeddingDim * c_vocabularySize, 0);
+    for (size_t j = 0; j < numColumns; j++)
+    {
+        if (j == gapColumn)
+            continue;
+        for (size_t i = 0; i < c_embeddingDim; i++)
+        {
+            expected[(size_t)indexValues1[j] * c_embeddingDim + i] += weightValues[j * c_embeddingDim + i];
+            expected[(size_t)indexValues2[j] * c_embeddingDim + i] += weightValues[j * c_embeddingDim + i];
+        }
+    }
+
+    Matrix<float> dense = Matrix<float>::Zeros(c_embeddingDim, c_vocabularySize, CPUDEVICE);
+    Matrix<float>::ScaleAndAdd(1, gradient, dense);
+    BOOST_CHECK(AreEqual(expected.data(), dense.Data(), expected.size(), 1e-4f));
+    // neither the column that is not looked up nor the one that is only looked up in the gap get a gradient
+    for (size_t i = 0; i < c_embeddingDim; i++)
+    {
+        BOOST_CHECK_EQUAL(dense(i, 2), 0);
+        BOOST_CHECK_EQUAL(dense(i, 5), 0);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,330 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Tests of the data-parallel gradient aggregation. They run on however many ranks the test binary is started with: on
+// a single one in the regular unit test run, and on several under mpiexec (see Tests/EndToEndTests/UnitTests/GradientAggregationTests),
+// where every rank must run the same test cases in the same order.
+//
+#include "stdafx.h"
+#include "Matrix.h"
+#include "MPIWrapper.h"
+#include "RingAllReduce.h"
+#include "../../../Source/SGDLib/SimpleDistGradAggregator.h"
+#include "../../../Source/SGDLib/QuantizedDistGradAggregator.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(GradientAggregationTests)
+
+// the MPI instance of the process, created by the first test that needs it
+static MPIWrapperPtr GetMPI()
+{
+    auto mpi = MPIWrapper::GetInstance();
+    return mpi ? mpi : MPIWrapper::GetInstance(/*create=*/ true);
+}
+
+// The values of rank r are (r + 1) * (i % 7 + 1), small integers, so that their sum is exact in any order.
+template <class ElemType>
+static std::vector<ElemType> RankValues(size_t rank, size_t numElements)
+{
+    std::vector<ElemType> values(numElements);
+    for (size_t i = 0; i < numElements; i++)
+        values[i] = (ElemType) ((rank + 1) * (i % 7 + 1));
+    return values;
+}
+
+template <class ElemType>
+static void TestRingAllReduce(bool hierarchical)
+{
+    auto mpi = GetMPI();
+    const size_t numRanks = mpi->NumNodesInUse();
+    RingAllReduce<ElemType> ring(mpi->Communicator(), hierarchical);
+    // fewer elements than ranks leaves some chunks empty; the same object is reused for all sizes
+    for (size_t numElements : { (size_t) 1, numRanks + 1, (size_t) 1000, (size_t) 1001, (size_t) 0 })
+    {
+        auto data = RankValues<ElemType>(mpi->CurrentNodeRank(), numElements);
+        ring.AllReduce(data.data(), numElements);
+        for (size_t i = 0; i < numElements; i++)
+            BOOST_REQUIRE_EQUAL(data[i], (ElemType) (numRanks * (numRanks + 1) / 2 * (i % 7 + 1)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RingAllReduceSum)
+{
+    TestRingAllReduce<float>(/*hierarchical=*/ false);
+    TestRingAllReduce<double>(/*hierarchical=*/ false);
+}
+
+BOOST_AUTO_TEST_CASE(HierarchicalRingAllReduceSum)
+{
+    TestRingAllReduce<float>(/*hierarchical=*/ true);
+    TestRingAllReduce<double>(/*hierarchical=*/ true);
+}
+
+BOOST_AUTO_TEST_CASE(RingAllReduceBusBandwidthFactor)
+{
+    BOOST_CHECK_EQUAL(RingAllReduce<float>::BusBandwidthFactor(1), 0.0);
+    BOOST_CHECK_EQUAL(RingAllReduce<float>::BusBandwidthFactor(2), 1.0);
+    BOOST_CHECK_EQUAL(RingAllReduce<float>::BusBandwidthFactor(4), 1.5);
+}
+
+typedef std::vector<std::shared_ptr<Matrix<float>>> Gradients;
+
+// CPU gradients of the given sizes, in the order in which the aggregator gets them
+static Gradients CreateGradients(const std::vector<std::pair<size_t, size_t>>& sizes)
+{
+    Gradients gradients;
+    for (const auto& size : sizes)
+        gradients.push_back(std::make_shared<Matrix<float>>(size.first, size.second, CPUDEVICE));
+    return gradients;
+}
+
+static std::vector<Matrix<float>*> GetPointers(const Gradients& gradients)
+{
+    std::vector<Matrix<float>*> pointers;
+    for (const auto& gradient : gradients)
+        pointers.push_back(gradient.get());
+    return pointers;
+}
+
+typedef std::unique_ptr<DistGradHeader, void (*)(DistGradHeader*)> HeaderPtr;
+
+static HeaderPtr CreateHeader(int numEvalNodes)
+{
+    return HeaderPtr(DistGradHeader::Create(numEvalNodes), &DistGradHeader::Destroy);
+}
+
+static void SetRankHeader(DistGradHeader* header, size_t rank)
+{
+    header->numSamples = rank + 1;
+    header->numSamplesWithLabel = 2 * (rank + 1);
+    header->criterion = 0.5 * (rank + 1);
+    for (int i = 0; i < header->numEvalNode; i++)
+        header->evalErrors[i] = std::make_pair(0.25 * (rank + 1) * (i + 1), rank + 1);
+}
+
+// checks that the header is the sum of those of all ranks set by SetRankHeader()
+static void CheckAggregatedHeader(const DistGradHeader* header, size_t numRanks)
+{
+    const size_t rankSum = numRanks * (numRanks + 1) / 2;
+    BOOST_CHECK_EQUAL(header->numSamples, rankSum);
+    BOOST_CHECK_EQUAL(header->numSamplesWithLabel, 2 * rankSum);
+    BOOST_CHECK_EQUAL(header->criterion, 0.5 * rankSum);
+    for (int i = 0; i < header->numEvalNode; i++)
+    {
+        BOOST_CHECK_EQUAL(header->evalErrors[i].first, 0.25 * rankSum * (i + 1));
+        BOOST_CHECK_EQUAL(header->evalErrors[i].second, rankSum);
+    }
+}
+
+// Sets the gradients of this rank for a minibatch, from RankValues() offset by the gradient index.
+static void SetRankGradients(const Gradients& gradients, size_t rank, size_t minibatch)
+{
+    for (size_t i = 0; i < gradients.size(); i++)
+    {
+        auto values = RankValues<float>(rank, gradients[i]->GetNumElements());
+        for (size_t j = 0; j < values.size(); j++)
+            gradients[i]->Data()[j] = values[j] * (minibatch + 1) + i;
+    }
+}
+
+// checks that the gradients are the sums of those of all ranks set by SetRankGradients()
+static void CheckAggregatedGradients(const Gradients& gradients, size_t numRanks, size_t minibatch)
+{
+    const size_t rankSum = numRanks * (numRanks + 1) / 2;
+    for (size_t i = 0; i < gradients.size(); i++)
+    {
+        for (size_t j = 0; j < gradients[i]->GetNumElements(); j++)
+            BOOST_REQUIRE_EQUAL(gradients[i]->Data()[j], (float) (rankSum * (j % 7 + 1) * (minibatch + 1) + numRanks * i));
+    }
+}
+
+// Runs a minibatch: reports the gradients to GradientReady() in the given order, aggregates them, and checks the result.
+// Returns the number of buckets started after each report.
+static std::vector<size_t> AggregateMinibatch(SimpleDistGradAggregator<float>& aggregator, const Gradients& gradients,
+                                              const std::vector<size_t>& readyOrder, size_t minibatch)
+{
+    auto mpi = GetMPI();
+    auto header = CreateHeader(2);
+    SetRankHeader(header.get(), mpi->CurrentNodeRank());
+    SetRankGradients(gradients, mpi->CurrentNodeRank(), minibatch);
+
+    std::vector<size_t> numBucketsStarted;
+    for (size_t i : readyOrder)
+    {
+        aggregator.GradientReady(gradients[i].get());
+        numBucketsStarted.push_back(aggregator.NumBucketsStarted());
+    }
+    BOOST_CHECK(aggregator.AggregateGradients(GetPointers(gradients), header.get(), /*resetState=*/ false));
+    BOOST_CHECK_EQUAL(aggregator.NumBucketsStarted(), 0);
+    CheckAggregatedHeader(header.get(), mpi->NumNodesInUse());
+    CheckAggregatedGradients(gradients, mpi->NumNodesInUse(), minibatch);
+    return numBucketsStarted;
+}
+
+BOOST_AUTO_TEST_CASE(SimpleDistGradAggregatorBucketOrder)
+{
+    auto mpi = GetMPI();
+    auto gradients = CreateGradients({ { 4, 3 }, { 10, 1 }, { 2, 2 }, { 8, 8 }, { 3, 1 } });
+    // every gradient gets its own bucket
+    SimpleDistGradAggregator<float> aggregator(mpi, /*useAsyncAggregation=*/ false, CPUDEVICE, /*syncStatsTrace=*/ 0, /*bucketSizeInBytes=*/ 0);
+    BOOST_REQUIRE(aggregator.CanAggregateEarly());
+
+    // The first minibatch records the order. The main node reports some gradients, the others report all in a
+    // different order, so the order of the main node, followed by the other gradients last to first, must be used.
+    std::vector<size_t> firstReadyOrder = mpi->IsMainNode() ? std::vector<size_t>{ 3, 0, 4 } : std::vector<size_t>{ 0, 1, 2, 3, 4 };
+    auto numBucketsStarted = AggregateMinibatch(aggregator, gradients, firstReadyOrder, 0);
+    BOOST_CHECK(numBucketsStarted == std::vector<size_t>(firstReadyOrder.size(), 0));
+    const std::vector<size_t> expectedOrder{ 3, 0, 4, 2, 1 };
+    BOOST_CHECK(aggregator.GradientOrder() == expectedOrder);
+
+    // reported in that order, each bucket is started as soon as its gradient is final
+    numBucketsStarted = AggregateMinibatch(aggregator, gradients, expectedOrder, 1);
+    BOOST_CHECK(numBucketsStarted == std::vector<size_t>({ 1, 2, 3, 4, 5 }));
+
+    // in the reverse order, no bucket can be started before the first one
+    numBucketsStarted = AggregateMinibatch(aggregator, gradients, std::vector<size_t>(expectedOrder.rbegin(), expectedOrder.rend()), 2);
+    BOOST_CHECK(numBucketsStarted == std::vector<size_t>({ 0, 0, 0, 0, 5 }));
+
+    // with some reported, the rest are started by AggregateGradients()
+    numBucketsStarted = AggregateMinibatch(aggregator, gradients, { 3, 4 }, 3);
+    BOOST_CHECK(numBucketsStarted == std::vector<size_t>({ 1, 1 }));
+    BOOST_CHECK(aggregator.GradientOrder() == expectedOrder);
+}
+
+BOOST_AUTO_TEST_CASE(SimpleDistGradAggregatorFusedBuckets)
+{
+    auto mpi = GetMPI();
+    for (auto algorithm : { AllReduceAlgorithm::mpi, AllReduceAlgorithm::ring, AllReduceAlgorithm::hierarchicalRing })
+    {
+        // 64 values per bucket: in the order they are reported, the gradients form the buckets { 4, 3 }, { 2 } and { 1, 0 }
+        auto gradients = CreateGradients({ { 5, 6 }, { 7, 4 }, { 200, 1 }, { 3, 11 }, { 1, 1 } });
+        SimpleDistGradAggregator<float> aggregator(mpi, /*useAsyncAggregation=*/ false, CPUDEVICE, /*syncStatsTrace=*/ 0, 64 * sizeof(float), algorithm);
+        const std::vector<size_t> readyOrder{ 4, 3, 2, 1, 0 };
+        AggregateMinibatch(aggregator, gradients, readyOrder, 0);
+        BOOST_CHECK(aggregator.GradientOrder() == readyOrder);
+        for (size_t minibatch = 1; minibatch < 4; minibatch++)
+        {
+            auto numBucketsStarted = AggregateMinibatch(aggregator, gradients, readyOrder, minibatch);
+            // the ring is only started by AggregateGradients()
+            if (algorithm == AllReduceAlgorithm::mpi)
+                BOOST_CHECK(numBucketsStarted == std::vector<size_t>({ 0, 1, 2, 2, 3 }));
+            else
+                BOOST_CHECK(numBucketsStarted == std::vector<size_t>(readyOrder.size(), 0));
+        }
+    }
+}
+
+// The values of rank r for the quantized aggregation: random multiples of 1/256 in [-1, 1], so that their sums are exact.
+static std::vector<float> RandomRankValues(size_t rank, size_t gradientIndex, size_t numElements)
+{
+    std::mt19937 rng((unsigned int) (1000 * rank + gradientIndex));
+    std::uniform_int_distribution<int> distribution(-256, 256);
+    std::vector<float> values(numElements);
+    for (auto& value : values)
+        value = distribution(rng) / 256.0f;
+    return values;
+}
+
+// Aggregates the same gradients over several minibatches. Checks that the result is identical on all ranks, that
+// the gradients that are not quantized are exact, and that the quantization error is bounded: per minibatch, and in the
+// sum over all minibatches, where the error feedback keeps it from growing with the number of minibatches.
+static void TestQuantizedAggregation(int numGradientBits, float maxError, float maxAccumulatedError)
+{
+    auto mpi = GetMPI();
+    const size_t numRanks = mpi->NumNodesInUse();
+    // quantized: 64 x 10, 16 x 40 as 64 x 10, 200 x 3, and not: a single column, and small ones
+    auto gradients = CreateGradients({ { 64, 10 }, { 5, 3 }, { 16, 40 }, { 128, 1 }, { 200, 3 }, { 1, 1 } });
+    const std::vector<bool> isQuantized{ true, false, true, false, true, false };
+    QuantizedDistGradAggregator<float> aggregator(mpi, numGradientBits, /*zeroThresholdFor1Bit=*/ false, /*syncStatsTrace=*/ 0);
+
+    std::vector<std::vector<float>> expected, accumulated;
+    for (size_t i = 0; i < gradients.size(); i++)
+    {
+        const size_t numElements = gradients[i]->GetNumElements();
+        expected.push_back(std::vector<float>(numElements, 0));
+        for (size_t r = 0; r < numRanks; r++)
+        {
+            auto values = RandomRankValues(r, i, numElements);
+            for (size_t j = 0; j < numElements; j++)
+                expected[i][j] += values[j];
+        }
+        accumulated.push_back(std::vector<float>(numElements, 0));
+    }
+
+    const size_t numMinibatches = 20;
+    for (size_t minibatch = 0; minibatch < numMinibatches; minibatch++)
+    {
+        auto header = CreateHeader(1);
+        SetRankHeader(header.get(), mpi->CurrentNodeRank());
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            auto values = RandomRankValues(mpi->CurrentNodeRank(), i, gradients[i]->GetNumElements());
+            std::copy(values.begin(), values.end(), gradients[i]->Data());
+        }
+        BOOST_CHECK(aggregator.AggregateGradients(GetPointers(gradients), header.get(), /*resetState=*/ false));
+        CheckAggregatedHeader(header.get(), numRanks);
+
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            const size_t numElements = gradients[i]->GetNumElements();
+            std::vector<float> mainNodeValues(gradients[i]->Data(), gradients[i]->Data() + numElements);
+            MPI_Bcast(mainNodeValues.data(), (int) numElements, MPI_FLOAT, (int) mpi->MainNodeRank(), mpi->Communicator()) || MpiFail("MPI_Bcast");
+            float error = 0;
+            for (size_t j = 0; j < numElements; j++)
+            {
+                const float value = gradients[i]->Data()[j];
+                BOOST_REQUIRE_EQUAL(value, mainNodeValues[j]);
+                if (!isQuantized[i])
+                    BOOST_REQUIRE_EQUAL(value, expected[i][j]);
+                error = std::max(error, fabs(value - expected[i][j]));
+                accumulated[i][j] += value;
+            }
+            BOOST_CHECK_LE(error, maxError * numRanks);
+        }
+    }
+
+    for (size_t i = 0; i < gradients.size(); i++)
+    {
+        float error = 0;
+        for (size_t j = 0; j < expected[i].size(); j++)
+            error = std::max(error, fabs(accumulated[i][j] - numMinibatches * expected[i][j]));
+        BOOST_CHECK_LE(error, maxAccumulatedError * numRanks);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(QuantizedDistGradAggregator1Bit)
+{
+    // The 1-bit residuals grow to several times the range of the values before they level off. Without them, the
+    // accumulated error would be about 20 times the error of a minibatch.
+    TestQuantizedAggregation(1, 2.0f, 10.0f);
+}
+
+BOOST_AUTO_TEST_CASE(QuantizedDistGradAggregator2Bits)
+{
+    // Three levels inside +-4 standard deviations, and a fourth above: each of the two quantizations of a value can be off
+    // by about 3 standard deviations. The accumulated error is what is left in the residuals.
+    TestQuantizedAggregation(2, 7.0f, 4.0f);
+}
+
+BOOST_AUTO_TEST_CASE(QuantizedDistGradAggregator8Bits)
+{
+    TestQuantizedAggregation(8, 0.05f, 0.05f);
+}
+
+BOOST_AUTO_TEST_CASE(QuantizedDistGradAggregatorInvalidBits)
+{
+    auto mpi = GetMPI();
+    for (int numGradientBits : { 0, 3, 32 })
+        BOOST_CHECK_THROW(QuantizedDistGradAggregator<float>(mpi, numGradientBits, false, 0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
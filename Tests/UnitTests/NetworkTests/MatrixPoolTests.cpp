@@ -0,0 +1,79 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/ComputationNetworkLib/ComputationNetwork.h"
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(MatrixPoolTests)
+
+typedef shared_ptr<Matrix<float>> MatrixPtr;
+
+BOOST_AUTO_TEST_CASE(BestFitRequest)
+{
+    MatrixPool pool;
+    MatrixPtr small = pool.Request<float>(CPUDEVICE, 10);
+    MatrixPtr large = pool.Request<float>(CPUDEVICE, 100);
+    MatrixPtr medium = pool.Request<float>(CPUDEVICE, 50);
+    BOOST_CHECK(small != large && large != medium && medium != small);
+    pool.Release(small);
+    pool.Release(large);
+    pool.Release(medium);
+
+    // the smallest one that is large enough
+    BOOST_CHECK(pool.Request<float>(CPUDEVICE, 30) == medium);
+    // none is large enough: the largest one
+    BOOST_CHECK(pool.Request<float>(CPUDEVICE, 200) == large);
+    BOOST_CHECK(pool.Request<float>(CPUDEVICE, 5) == small);
+    // the pool is empty
+    MatrixPtr other = pool.Request<float>(CPUDEVICE, 5);
+    BOOST_CHECK(other != small && other != medium && other != large);
+}
+
+BOOST_AUTO_TEST_CASE(BestFitTiesAreLastInFirstOut)
+{
+    MatrixPool pool;
+    MatrixPtr first = pool.Request<float>(CPUDEVICE, 10);
+    MatrixPtr second = pool.Request<float>(CPUDEVICE, 10);
+    pool.Release(first);
+    pool.Release(second);
+    BOOST_CHECK(pool.Request<float>(CPUDEVICE, 10) == second);
+    BOOST_CHECK(pool.Request<float>(CPUDEVICE, 10) == first);
+}
+
+BOOST_AUTO_TEST_CASE(PlannedAndPeakBytes)
+{
+    MatrixPool pool;
+    MatrixPtr a = pool.Request<float>(CPUDEVICE, 10);
+    MatrixPtr b = pool.Request<float>(CPUDEVICE, 20); // 30 live
+    pool.Release(a);                                  // 20 live
+    MatrixPtr c = pool.Request<float>(CPUDEVICE, 5);  // reuses a, 25 live
+    BOOST_CHECK(c == a);
+    pool.Release(b);
+    pool.Release(c);
+    MatrixPtr d = pool.Request<float>(CPUDEVICE, 40); // none fits, b grows to 40, which is live alone
+    BOOST_CHECK(d == b);
+    auto e = pool.Request<double>(CPUDEVICE, 3); // a new matrix, 40 * 4 + 3 * 8 bytes live
+    pool.Release(d);
+    pool.Release(e);
+
+    BOOST_CHECK_EQUAL(pool.GetPeakLiveBytesPerSample(), 40 * sizeof(float) + 3 * sizeof(double));
+    // a: 10, b: 40, e: 3
+    BOOST_CHECK_EQUAL(pool.GetPlannedBytesPerSample(), (10 + 40) * sizeof(float) + 3 * sizeof(double));
+
+    // A new plan starts from scratch, and reuses the released matrices.
+    pool.ResetStatistics();
+    BOOST_CHECK_EQUAL(pool.GetPeakLiveBytesPerSample(), 0);
+    BOOST_CHECK_EQUAL(pool.GetPlannedBytesPerSample(), 0);
+    MatrixPtr f = pool.Request<float>(CPUDEVICE, 8);
+    BOOST_CHECK(f == a || f == b);
+    BOOST_CHECK_EQUAL(pool.GetPeakLiveBytesPerSample(), 8 * sizeof(float));
+    BOOST_CHECK_EQUAL(pool.GetPlannedBytesPerSample(), 8 * sizeof(float));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -29,4 +29,6 @@ BOOST_AUTO_TEST_CASE(NetworkOperatorPlus)
         "../Output/out.txt.v2" /*output*/);
 };
 
-}}}}}
\ No newline at end of file
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
\ No newline at end of file
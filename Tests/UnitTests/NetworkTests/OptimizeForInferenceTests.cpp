@@ -0,0 +1,195 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/ComputationNetworkLib/ComputationNetwork.h"
+#include "../../../Source/ComputationNetworkLib/ComputationNetworkBuilder.h"
+#include "../../../Source/ComputationNetworkLib/ComputationEnvironment.h"
+#include "../../../Source/ComputationNetworkLib/InputAndParamNodes.h"
+#include "../../../Source/ComputationNetworkLib/TrainingNodes.h"
+#include "TestHelpers.h"
+#include <functional>
+#include <random>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(OptimizeForInferenceTests)
+
+typedef shared_ptr<ComputationNode<float>> NodePtr;
+typedef function<NodePtr(ComputationNetworkBuilder<float>&, function<NodePtr(const wstring&, const TensorShape&)>)> NetworkDefinition;
+
+const size_t c_numSamples = 3;
+
+// builds the network, with its parameters initialized from a fixed seed, and an input named "features"
+static ComputationNetworkPtr BuildNetwork(const NetworkDefinition& define)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    auto parameter = [&](const wstring& name, const TensorShape& shape)
+    {
+        auto node = builder.CreateLearnableParameter(name, shape);
+        for (size_t i = 0; i < node->Value().GetNumElements(); i++)
+        {
+            float value = distribution(rng);
+            // running variances have to be positive
+            node->Value().Data()[i] = name.find(L"var") != wstring::npos ? fabs(value) + 0.5f : value;
+        }
+        return node;
+    };
+    auto output = define(builder, parameter);
+    net->AddToNodeGroup(L"output", output);
+    net->CompileNetwork();
+    return net;
+}
+
+static vector<float> Evaluate(const ComputationNetworkPtr& net, const vector<float>& features)
+{
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+    auto output = net->GetNodeFromName(L"output");
+    auto input = dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(L"features"));
+    net->AllocateAllMatrices({}, { output }, nullptr);
+    net->StartEvaluateMinibatchLoop(output);
+
+    const size_t numRows = input->GetSampleLayout().GetNumElements();
+    input->GetMBLayout()->Init(1, c_numSamples);
+    input->GetMBLayout()->AddSequence(0, 0, 0, c_numSamples);
+    input->Value().SetValue(numRows, c_numSamples, CPUDEVICE, const_cast<float*>(features.data()), matrixFlagNormal);
+    ComputationNetwork::BumpEvalTimeStamp({ input });
+    net->ForwardProp(output);
+
+    const auto& value = dynamic_pointer_cast<ComputationNode<float>>(output)->Value();
+    return vector<float>(value.Data(), value.Data() + value.GetNumElements());
+}
+
+static size_t CountNodes(const ComputationNetworkPtr& net, const wstring& operationName)
+{
+    size_t count = 0;
+    for (const auto& node : net->GetAllNodes())
+        count += node->OperationName() == operationName;
+    return count;
+}
+
+// Output nodes are never changed, so the tested nodes are followed by another one.
+static NodePtr Output(ComputationNetworkBuilder<float>& builder, const NodePtr& input)
+{
+    return builder.RectifiedLinear(input, L"output");
+}
+
+// compares the outputs of the network with and without the optimization, and checks that optimizing again changes nothing
+// Returns the optimized network.
+static ComputationNetworkPtr CheckOptimization(const NetworkDefinition& define, const TensorShape& inputShape)
+{
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    vector<float> features(inputShape.GetNumElements() * c_numSamples);
+    for (auto& value : features)
+        value = distribution(rng);
+
+    vector<float> expected = Evaluate(BuildNetwork(define), features);
+
+    auto net = BuildNetwork(define);
+    {
+        ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+        auto outputs = net->OutputNodesByName({ L"output" });
+        BOOST_CHECK_GT(net->OptimizeForInference<float>(outputs), 0);
+        net->CompileNetwork();
+
+        const size_t numNodes = net->GetAllNodes().size();
+        BOOST_CHECK_EQUAL(net->OptimizeForInference<float>(outputs), 0);
+        net->CompileNetwork();
+        BOOST_CHECK_EQUAL(net->GetAllNodes().size(), numNodes);
+    }
+
+    vector<float> actual = Evaluate(net, features);
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    BOOST_CHECK(AreEqual(actual.data(), expected.data(), actual.size(), 1e-4f));
+    return net;
+}
+
+// 5 x 4 images with 8 channels, convolved to 4 channels
+static const TensorShape c_imageShape(5, 4, 8);
+static const size_t c_numMaps = 4;
+
+static NodePtr Convolution(ComputationNetworkBuilder<float>& builder, function<NodePtr(const wstring&, const TensorShape&)> parameter)
+{
+    auto features = builder.CreateInputNode(L"features", c_imageShape);
+    return builder.Convolution(parameter(L"W", TensorShape(c_numMaps, 3 * 3 * c_imageShape[2])), features,
+                               TensorShape(3, 3, c_imageShape[2]), TensorShape(c_numMaps), TensorShape(1, 1, c_imageShape[2]),
+                               { true }, { true, true, false }, TensorShape(0), TensorShape(0), false, ImageLayoutKind::CHW, 0, L"conv");
+}
+
+static NodePtr BatchNormalization(ComputationNetworkBuilder<float>& builder, function<NodePtr(const wstring&, const TensorShape&)> parameter,
+                                  const NodePtr& input, size_t dim, bool spatial)
+{
+    return builder.BatchNormalization(input, parameter(L"scale", TensorShape(dim, 1)), parameter(L"bias", TensorShape(dim, 1)),
+                                      parameter(L"mean", TensorShape(dim, 1)), parameter(L"var", TensorShape(dim, 1)),
+                                      spatial, 0, 0, 1e-5, true, ImageLayoutKind::CHW, L"bn");
+}
+
+BOOST_AUTO_TEST_CASE(FoldBatchNormalizationIntoConvolution)
+{
+    auto net = CheckOptimization([](ComputationNetworkBuilder<float>& builder, function<NodePtr(const wstring&, const TensorShape&)> parameter)
+    {
+        return Output(builder, BatchNormalization(builder, parameter, Convolution(builder, parameter), c_numMaps, /*spatial=*/ true));
+    }, c_imageShape);
+    BOOST_CHECK_EQUAL(CountNodes(net, BatchNormalizationNode<float>::TypeName()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FoldBatchNormalizationIntoConvolutionWithBias)
+{
+    auto net = CheckOptimization([](ComputationNetworkBuilder<float>& builder, function<NodePtr(const wstring&, const TensorShape&)> parameter)
+    {
+        auto conv = builder.Plus(Convolution(builder, parameter), parameter(L"b", TensorShape(1, 1, c_numMaps)), L"convPlusBias");
+        return Output(builder, BatchNormalization(builder, parameter, conv, c_numMaps, /*spatial=*/ true));
+    }, c_imageShape);
+    BOOST_CHECK_EQUAL(CountNodes(net, BatchNormalizationNode<float>::TypeName()), 0);
+    BOOST_CHECK(!net->NodeNameExists(L"convPlusBias"));
+}
+
+BOOST_AUTO_TEST_CASE(FoldBatchNormalizationIntoTimes)
+{
+    auto net = CheckOptimization([](ComputationNetworkBuilder<float>& builder, function<NodePtr(const wstring&, const TensorShape&)> parameter)
+    {
+        auto features = builder.CreateInputNode(L"features", TensorShape(6));
+        return Output(builder, BatchNormalization(builder, parameter, builder.Times(parameter(L"W", TensorShape(5, 6)), features, 1, L"times"), 5, /*spatial=*/ false));
+    }, TensorShape(6));
+    BOOST_CHECK_EQUAL(CountNodes(net, BatchNormalizationNode<float>::TypeName()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(BypassDropoutAndReshape)
+{
+    auto net = CheckOptimization([](ComputationNetworkBuilder<float>& builder, function<NodePtr(const wstring&, const TensorShape&)> parameter)
+    {
+        auto features = builder.CreateInputNode(L"features", TensorShape(6));
+        auto times = builder.Times(parameter(L"W", TensorShape(5, 6)), features, 1, L"times");
+        auto reshape = builder.Reshape(builder.Dropout(times, L"dropout"), TensorShape(5), L"reshape");
+        return builder.Plus(reshape, parameter(L"b", TensorShape(5)), L"output");
+    }, TensorShape(6));
+    BOOST_CHECK(!net->NodeNameExists(L"dropout"));
+    BOOST_CHECK(!net->NodeNameExists(L"reshape"));
+}
+
+BOOST_AUTO_TEST_CASE(FoldParameterOnlySubgraph)
+{
+    auto net = CheckOptimization([](ComputationNetworkBuilder<float>& builder, function<NodePtr(const wstring&, const TensorShape&)> parameter)
+    {
+        auto features = builder.CreateInputNode(L"features", TensorShape(6));
+        auto weights = builder.ElementTimes(parameter(L"W1", TensorShape(5, 6)), parameter(L"W2", TensorShape(5, 6)), L"weights");
+        auto bias = builder.Plus(parameter(L"b1", TensorShape(5)), parameter(L"b2", TensorShape(5)), L"bias");
+        return builder.Plus(builder.Times(weights, features, 1, L"times"), bias, L"output");
+    }, TensorShape(6));
+    BOOST_CHECK_EQUAL(CountNodes(net, L"ElementTimes"), 0);
+    for (const wstring& name : { L"W1", L"W2", L"b1", L"b2" })
+        BOOST_CHECK(!net->NodeNameExists(name));
+    // the folded values keep the names of the nodes they were computed by
+    BOOST_CHECK(net->GetNodeFromName(L"weights")->OperationName() == LearnableParameter<float>::TypeName());
+    BOOST_CHECK(net->GetNodeFromName(L"bias")->OperationName() == LearnableParameter<float>::TypeName());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
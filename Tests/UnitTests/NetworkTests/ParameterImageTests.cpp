@@ -0,0 +1,198 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/ComputationNetworkLib/ComputationNetwork.h"
+#include "../../../Source/ComputationNetworkLib/ComputationNetworkBuilder.h"
+#include "../../../Source/ComputationNetworkLib/InputAndParamNodes.h"
+#include "../../../Source/ComputationNetworkLib/ParameterImage.h"
+#include "fileutil.h"
+#include <thread>
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(ParameterImageTests)
+
+// saves a small network with two parameters and returns their values
+static vector<float> SaveTestModel(const wstring& modelPath, float offset = 0)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto W = builder.CreateLearnableParameter(L"W", 3, 4);
+    auto b = builder.CreateLearnableParameter(L"b", 3, 1);
+    auto features = builder.CreateInputNode(L"features", 4);
+    auto output = builder.Plus(builder.Times(W, features, 1, L"times"), b, L"output");
+    net->AddToNodeGroup(L"output", output);
+
+    vector<float> values;
+    for (auto& parameter : { W, b })
+    {
+        for (size_t i = 0; i < parameter->Value().GetNumElements(); i++)
+        {
+            parameter->Value().Data()[i] = 0.25f * values.size() - 1 + offset;
+            values.push_back(parameter->Value().Data()[i]);
+        }
+    }
+    net->CompileNetwork();
+    net->Save(modelPath);
+    return values;
+}
+
+BOOST_AUTO_TEST_CASE(ReadWithMappedParameters)
+{
+    const wstring modelPath = L"ParameterImageTests.dnn";
+    const wstring imagePath = ParameterImage::PathFor(modelPath);
+    if (fexists(imagePath))
+        unlinkOrDie(imagePath);
+    vector<float> expected = SaveTestModel(modelPath);
+    BOOST_CHECK(!ParameterImage::IsUpToDate(imagePath, modelPath));
+
+    // first load writes the image, the second one uses the existing one
+    for (int pass = 0; pass < 2; pass++)
+    {
+        auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+        net->ReadWithMappedParameters<float>(modelPath);
+        net->CompileNetwork();
+        BOOST_CHECK(ParameterImage::IsUpToDate(imagePath, modelPath));
+
+        size_t i = 0;
+        for (const wstring& name : { L"W", L"b" })
+        {
+            auto parameter = dynamic_pointer_cast<LearnableParameter<float>>(net->GetNodeFromName(name));
+            BOOST_REQUIRE(parameter);
+            BOOST_CHECK(!parameter->Value().OwnBuffer()); // references the mapping
+            BOOST_CHECK_EQUAL(parameter->Value().GetNumRows(), 3);
+            for (size_t k = 0; k < parameter->Value().GetNumElements(); k++)
+                BOOST_CHECK_EQUAL(parameter->Value().Data()[k], expected[i++]);
+
+            // the mapping is copy-on-write: writing to a value does not modify the image
+            parameter->Value().SetValue(0);
+        }
+        BOOST_CHECK_EQUAL(i, expected.size());
+    }
+
+    // a regular load still copies the values out of the model file
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    net->Read<float>(modelPath);
+    BOOST_CHECK(dynamic_pointer_cast<LearnableParameter<float>>(net->GetNodeFromName(L"W"))->Value().OwnBuffer());
+
+    unlinkOrDie(modelPath);
+    unlinkOrDie(imagePath);
+}
+
+BOOST_AUTO_TEST_CASE(StaleParameterImageIsRewritten)
+{
+    const wstring modelPath = L"ParameterImageTests2.dnn";
+    const wstring imagePath = ParameterImage::PathFor(modelPath);
+
+    // an image written for a different file is detected by the size of the model file
+    SaveTestModel(modelPath);
+    {
+        auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+        net->ReadWithMappedParameters<float>(modelPath);
+    }
+    FILE* f = fopenOrDie(modelPath, L"ab");
+    fputc(0, f);
+    fclose(f);
+    BOOST_CHECK(!ParameterImage::IsUpToDate(imagePath, modelPath));
+    {
+        auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+        net->ReadWithMappedParameters<float>(modelPath);
+    }
+    BOOST_CHECK(ParameterImage::IsUpToDate(imagePath, modelPath));
+
+    unlinkOrDie(modelPath);
+    unlinkOrDie(imagePath);
+}
+
+BOOST_AUTO_TEST_CASE(RetrainedModelWithOlderTimeIsDetected)
+{
+    // a model with the same architecture but other weights, deployed with an older time stamp than the image
+    const wstring modelPath = L"ParameterImageTests5.dnn";
+    const wstring imagePath = ParameterImage::PathFor(modelPath);
+    SaveTestModel(modelPath);
+    {
+        auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+        net->ReadWithMappedParameters<float>(modelPath);
+    }
+    BOOST_REQUIRE(ParameterImage::IsUpToDate(imagePath, modelPath));
+    let size = filesize64(modelPath.c_str());
+
+    vector<float> expected = SaveTestModel(modelPath, 0.5f);
+    BOOST_REQUIRE_EQUAL(filesize64(modelPath.c_str()), size);
+    boost::filesystem::last_write_time(boost::filesystem::path(modelPath), boost::filesystem::last_write_time(boost::filesystem::path(imagePath)) - 3600);
+    BOOST_CHECK(!ParameterImage::IsUpToDate(imagePath, modelPath));
+
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    net->ReadWithMappedParameters<float>(modelPath);
+    BOOST_CHECK(ParameterImage::IsUpToDate(imagePath, modelPath));
+    auto W = dynamic_pointer_cast<LearnableParameter<float>>(net->GetNodeFromName(L"W"));
+    BOOST_REQUIRE(W);
+    BOOST_CHECK(!W->Value().OwnBuffer()); // from the rewritten image
+    BOOST_CHECK(equal(expected.begin(), expected.begin() + W->Value().GetNumElements(), W->Value().Data()));
+
+    unlinkOrDie(modelPath);
+    unlinkOrDie(imagePath);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentLoadsWriteTheImageOnce)
+{
+    // loads of the same model that all find the image missing write it under names of their own
+    const wstring modelPath = L"ParameterImageTests3.dnn";
+    const wstring imagePath = ParameterImage::PathFor(modelPath);
+    if (fexists(imagePath))
+        unlinkOrDie(imagePath);
+    vector<float> expected = SaveTestModel(modelPath);
+
+    const size_t numThreads = 8;
+    vector<char> correct(numThreads, false); // not vector<bool>, whose elements share bytes
+    vector<thread> threads;
+    for (size_t t = 0; t < numThreads; t++)
+    {
+        threads.push_back(thread([&, t]()
+        {
+            auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+            net->ReadWithMappedParameters<float>(modelPath);
+            auto W = dynamic_pointer_cast<LearnableParameter<float>>(net->GetNodeFromName(L"W"));
+            correct[t] = equal(expected.begin(), expected.begin() + W->Value().GetNumElements(), W->Value().Data());
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (size_t t = 0; t < numThreads; t++)
+        BOOST_CHECK(correct[t]);
+    BOOST_CHECK(ParameterImage::IsUpToDate(imagePath, modelPath));
+
+    // no temporary files are left behind
+    for (boost::filesystem::directory_iterator file("."), end; file != end; ++file)
+        BOOST_CHECK(file->path().filename().string().find("ParameterImageTests3.dnn.params.") == string::npos);
+
+    unlinkOrDie(modelPath);
+    unlinkOrDie(imagePath);
+}
+
+BOOST_AUTO_TEST_CASE(UnwritableImageFallsBackToRead)
+{
+    // a directory in place of the image cannot be replaced by it
+    const wstring modelPath = L"ParameterImageTests4.dnn";
+    const wstring imagePath = ParameterImage::PathFor(modelPath);
+    vector<float> expected = SaveTestModel(modelPath);
+    boost::filesystem::create_directory(boost::filesystem::path(imagePath));
+
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    net->ReadWithMappedParameters<float>(modelPath);
+    auto W = dynamic_pointer_cast<LearnableParameter<float>>(net->GetNodeFromName(L"W"));
+    BOOST_REQUIRE(W);
+    BOOST_CHECK(W->Value().OwnBuffer()); // copied out of the model file
+    BOOST_CHECK(equal(expected.begin(), expected.begin() + W->Value().GetNumElements(), W->Value().Data()));
+
+    boost::filesystem::remove(boost::filesystem::path(imagePath));
+    unlinkOrDie(modelPath);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,133 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/PerformanceProfilerDll/PerformanceProfiler.h"
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(PerformanceProfilerTests)
+
+// runs the profiler with tracing in a fresh directory and returns the contents of the Chrome trace file
+template <class F>
+static string RunTraceSession(const string& dirName, unsigned long long traceBufferBytes, F record)
+{
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / dirName;
+    boost::filesystem::remove_all(dir);
+
+    ProfilerInit(dir.wstring(), 1024 * 1024, L"test", false, true, traceBufferBytes);
+    ProfilerEnable(true);
+    record();
+    ProfilerClose();
+
+    string trace;
+    for (boost::filesystem::directory_iterator file(dir), end; file != end; ++file)
+    {
+        if (file->path().filename().string().find("_trace_test.json") != string::npos)
+        {
+            std::ifstream in(file->path().string());
+            std::stringstream contents;
+            contents << in.rdbuf();
+            trace = contents.str();
+        }
+    }
+    boost::filesystem::remove_all(dir);
+    return trace;
+}
+
+static size_t CountOccurrences(const string& text, const string& pattern)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != string::npos; pos = text.find(pattern, pos + pattern.size()))
+        count++;
+    return count;
+}
+
+BOOST_AUTO_TEST_CASE(TraceSpansAreExported)
+{
+    string trace = RunTraceSession("cntk_profiler_trace", 16 * 1024 * 1024, []()
+    {
+        {
+            // two spans of the same category in one block
+            wstring innerName = L"inner span";
+            TRACE_SCOPE("outer span", profilerTraceForward);
+            TRACE_SCOPE(innerName, profilerTraceForward);
+        }
+
+        std::thread worker([]()
+        {
+            ProfilerTraceSetThreadName("test worker");
+            for (int i = 0; i < 3; i++)
+            {
+                long long stateId = ProfilerTraceBegin();
+                ProfilerTraceEnd(stateId, "worker span", profilerTraceReader);
+            }
+        });
+        worker.join();
+    });
+
+    BOOST_REQUIRE(!trace.empty());
+    BOOST_CHECK_EQUAL(CountOccurrences(trace, "{\"name\":\"outer span\",\"cat\":\"forward\""), 1);
+    BOOST_CHECK_EQUAL(CountOccurrences(trace, "{\"name\":\"inner span\",\"cat\":\"forward\""), 1);
+    BOOST_CHECK_EQUAL(CountOccurrences(trace, "{\"name\":\"worker span\",\"cat\":\"reader\""), 3);
+    BOOST_CHECK_EQUAL(CountOccurrences(trace, "\"args\":{\"name\":\"test worker\"}"), 1);
+}
+
+BOOST_AUTO_TEST_CASE(TraceSpansAreDroppedWhenTheBufferIsFull)
+{
+    // a budget for a single block of 1024 spans
+    const size_t numSpans = 3000;
+    string trace = RunTraceSession("cntk_profiler_trace_full", 48 * 1024, [numSpans]()
+    {
+        for (size_t i = 0; i < numSpans; i++)
+        {
+            long long stateId = ProfilerTraceBegin();
+            ProfilerTraceEnd(stateId, "span", profilerTraceCustom);
+        }
+    });
+
+    BOOST_REQUIRE(!trace.empty());
+    BOOST_CHECK_EQUAL(CountOccurrences(trace, "{\"name\":\"span\",\"cat\":\"custom\""), 1024);
+}
+
+BOOST_AUTO_TEST_CASE(TraceSpansCanBeRecordedWhileTheProfilerRestarts)
+{
+    // threads keep recording while the profiler is closed and initialized again, which must not free the blocks they write to
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.push_back(std::thread([&stop]()
+        {
+            while (!stop)
+            {
+                long long stateId = ProfilerTraceBegin();
+                ProfilerTraceEnd(stateId, "concurrent span", profilerTraceCustom);
+            }
+        }));
+    }
+
+    for (int session = 0; session < 10; session++)
+    {
+        string trace = RunTraceSession("cntk_profiler_trace_restart", 64 * 1024, []()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        });
+        BOOST_CHECK(!trace.empty());
+    }
+
+    stop = true;
+    for (auto& thread : threads)
+        thread.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
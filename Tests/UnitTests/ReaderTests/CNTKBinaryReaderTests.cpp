@@ -91,6 +91,41 @@ BOOST_AUTO_TEST_CASE(CNTKBinaryReader_Simple_dense2)
         1, false, false, false);
 };
 
+// Same data as above, but read in place from a memory mapping of the file.
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_Simple_sparse_mapped)
+{
+    HelperRunReaderTest<float>(
+        testDataPath() + "/Config/CNTKBinaryReader/test.cntk",
+        testDataPath() + "/Control/CNTKBinaryReader/Simple_sparse.txt",
+        testDataPath() + "/Control/CNTKBinaryReader/Simple_sparse_mapped_Output.txt",
+        "SparseMapped",
+        "reader",
+        1600, // epoch size
+        250,  // mb size
+        1,   // num epochs 
+        2,
+        2,
+        0,
+        1, true, false, false);
+};
+
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_Simple_dense_mapped)
+{
+    HelperRunReaderTest<float>(
+        testDataPath() + "/Config/CNTKBinaryReader/test.cntk",
+        testDataPath() + "/Control/CNTKBinaryReader/Simple_dense.txt",
+        testDataPath() + "/Control/CNTKBinaryReader/Simple_dense_mapped_Output.txt",
+        "SimpleMapped",
+        "reader",
+        1600, // epoch size
+        250,  // mb size
+        1,   // num epochs 
+        4,
+        0,
+        0,
+        1, false, false, false);
+};
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -13,9 +13,13 @@
 #define _fileno fileno
 #endif
 #include <cstdio>
+#include <chrono>
+#include <limits>
+#include <random>
 #include <boost/scope_exit.hpp>
 #include "Common/ReaderTestHelper.h"
 #include "TextParser.h"
+#include "BlockRandomizer.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -33,12 +37,12 @@ public:
     ChunkPtr m_chunk;
 
     CNTKTextFormatReaderTestRunner(const string& filename,
-        const vector<StreamDescriptor>& streams, unsigned int maxErrors) :
+        const vector<StreamDescriptor>& streams, unsigned int maxErrors, size_t chunkSize = SIZE_MAX) :
         m_parser(std::make_shared<CorpusDescriptor>(true), wstring(filename.begin(), filename.end()), streams, true)
     {
         m_parser.SetMaxAllowedErrors(maxErrors);
         m_parser.SetTraceLevel(TextParser<ElemType>::TraceLevel::Info);
-        m_parser.SetChunkSize(SIZE_MAX);
+        m_parser.SetChunkSize(chunkSize);
         m_parser.SetNumRetries(0);
         m_parser.Initialize();
     }
@@ -47,6 +51,16 @@ public:
     {
         m_chunk = m_parser.GetChunk(0);
     }
+    // Switches between the SIMD and the scalar number parsing.
+    void SetUseSimdParsing(bool useSimdParsing)
+    {
+        m_parser.SetUseSimdParsing(useSimdParsing);
+    }
+    // Gives the parser to a randomizer, which must not outlive the runner.
+    IDataDeserializerPtr GetDeserializer()
+    {
+        return IDataDeserializerPtr(&m_parser, [](IDataDeserializer*) {});
+    }
 };
 
 namespace Test {
@@ -843,6 +857,185 @@ BOOST_AUTO_TEST_CASE(CNTKTextFormatReaderNoFirstMinibatchData)
         2);
 };
 
+// Reads all values of the stream "x" in the order given by a block randomizer over the parser.
+vector<float> ReadRandomizedValues(CNTKTextFormatReaderTestRunner<float>& testRunner, size_t randomizationWindow, size_t epochSize, size_t numEpochs,
+                                   bool prefetch, bool multithreaded, size_t prefetchDepth, size_t prefetchThreads)
+{
+    BlockRandomizer randomizer(0, randomizationWindow, testRunner.GetDeserializer(), prefetch, multithreaded, 0, prefetchDepth, prefetchThreads);
+
+    vector<float> values;
+    for (size_t epoch = 0; epoch < numEpochs; epoch++)
+    {
+        EpochConfiguration config;
+        config.m_numberOfWorkers = 1;
+        config.m_workerRank = 0;
+        config.m_minibatchSizeInSamples = 0;
+        config.m_totalEpochSizeInSamples = epochSize;
+        config.m_epochIndex = epoch;
+        randomizer.StartEpoch(config);
+
+        Sequences sequences;
+        do
+        {
+            sequences = randomizer.GetNextSequences(7, 7);
+            for (const auto& sequence : sequences.m_data.empty() ? vector<SequenceDataPtr>() : sequences.m_data[0])
+            {
+                const float* data = static_cast<const float*>(sequence->GetDataBuffer());
+                values.insert(values.end(), data, data + sequence->m_numberOfSamples * 3);
+            }
+        } while (!sequences.m_endOfEpoch);
+    }
+    return values;
+}
+
+// Prefetches many small chunks of a text file with several threads, across sweep boundaries, and checks that
+// the data is the same as when loading each chunk on the main thread.
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_parallel_prefetch)
+{
+    const size_t numSequences = 3000;
+    const string filename = "parallel_prefetch.txt";
+    {
+        ofstream out(filename, ios::binary);
+        for (size_t i = 0; i < numSequences; i++)
+            out << i << " |x " << i << ' ' << i + 0.5 << ' ' << -(double)i << '\n';
+    }
+    BOOST_SCOPE_EXIT(filename)
+    {
+        boost::filesystem::remove(filename);
+    } BOOST_SCOPE_EXIT_END
+
+    vector<StreamDescriptor> streams(1);
+    streams[0].m_alias = "x";
+    streams[0].m_name = L"x";
+    streams[0].m_storageType = StorageType::dense;
+    streams[0].m_elementType = ElementType::tfloat;
+    streams[0].m_sampleDimension = 3;
+
+    // Chunks of about 40 sequences, an epoch that is not a multiple of the sweep.
+    CNTKTextFormatReaderTestRunner<float> testRunner(filename, streams, 0, 1024);
+    const size_t window = 400, epochSize = 2200, numEpochs = 4;
+
+    auto expected = ReadRandomizedValues(testRunner, window, epochSize, numEpochs, false, false, 1, 1);
+    BOOST_REQUIRE_EQUAL(expected.size(), epochSize * numEpochs * 3);
+    for (size_t i = 0; i < expected.size(); i += 3)
+    {
+        BOOST_REQUIRE_EQUAL(expected[i + 1], expected[i] + 0.5f);
+        BOOST_REQUIRE_EQUAL(expected[i + 2], -expected[i]);
+    }
+
+    auto actual = ReadRandomizedValues(testRunner, window, epochSize, numEpochs, true, false, 8, 4);
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+
+    actual = ReadRandomizedValues(testRunner, window, epochSize, numEpochs, true, true, 8, 4);
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+};
+
+// Writes a single long sequence of dense ("x") and sparse ("y") float values, as printed by "%g" and "%.9g",
+// and returns the text of the values.
+vector<StreamDescriptor> WriteNumberParsingInput(const string& filename, size_t numRows,
+    vector<string>& denseValues, vector<string>& sparseValues)
+{
+    const size_t denseDim = 200, sparseDim = 10000, nnzPerRow = 20;
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> distribution(-100, 100);
+    ofstream out(filename, ios::binary);
+    char text[64];
+    for (size_t row = 0; row < numRows; row++)
+    {
+        out << "0 |x";
+        for (size_t i = 0; i < denseDim; i++)
+        {
+            sprintf(text, (i % 4 == 3) ? "%.9g" : "%g", distribution(rng) * pow(10.0, (int)(rng() % 13) - 6));
+            out << ' ' << text;
+            denseValues.push_back(text);
+        }
+        out << "\t|y";
+        for (size_t i = 0; i < nnzPerRow; i++)
+        {
+            sprintf(text, "%g", distribution(rng));
+            out << ' ' << (i * sparseDim / nnzPerRow + rng() % (sparseDim / nnzPerRow)) << ':' << text;
+            sparseValues.push_back(text);
+        }
+        out << '\n';
+    }
+
+    vector<StreamDescriptor> streams(2);
+    streams[0].m_alias = "x";
+    streams[0].m_name = L"x";
+    streams[0].m_storageType = StorageType::dense;
+    streams[0].m_sampleDimension = denseDim;
+    streams[1].m_alias = "y";
+    streams[1].m_name = L"y";
+    streams[1].m_storageType = StorageType::sparse_csc;
+    streams[1].m_sampleDimension = sparseDim;
+    return streams;
+}
+
+// Parses a single long sequence of dense and sparse float values (as printed by "%g" and "%.9g"),
+// and checks the parsed values against strtod().
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_number_parsing)
+{
+    const size_t numRows = 2000;
+    const string filename = "number_parsing.txt";
+
+    vector<string> denseValues, sparseValues;
+    auto streams = WriteNumberParsingInput(filename, numRows, denseValues, sparseValues);
+    BOOST_SCOPE_EXIT(filename)
+    {
+        boost::filesystem::remove(filename);
+    } BOOST_SCOPE_EXIT_END
+
+    CNTKTextFormatReaderTestRunner<float> testRunner(filename, streams, 0);
+    testRunner.LoadChunk();
+
+    vector<SequenceDataPtr> sequence;
+    testRunner.m_chunk->GetSequence(0, sequence);
+    BOOST_REQUIRE_EQUAL(sequence.size(), 2);
+    BOOST_REQUIRE_EQUAL((size_t)sequence[0]->m_numberOfSamples, numRows);
+    const float* dense = static_cast<const float*>(sequence[0]->GetDataBuffer());
+    for (size_t i = 0; i < denseValues.size(); i++)
+        BOOST_REQUIRE_EQUAL(dense[i], (float)strtod(denseValues[i].c_str(), nullptr));
+    const auto& sparse = static_cast<SparseSequenceData&>(*sequence[1]);
+    BOOST_REQUIRE_EQUAL((size_t)sparse.m_totalNnzCount, sparseValues.size());
+    const float* sparseData = static_cast<const float*>(sequence[1]->GetDataBuffer());
+    for (size_t i = 0; i < sparseValues.size(); i++)
+        BOOST_REQUIRE_EQUAL(sparseData[i], (float)strtod(sparseValues[i].c_str(), nullptr));
+};
+
+// Measures the parsing throughput of the scalar and of the SIMD number parsing on the input of
+// CNTKTextFormatReader_number_parsing. This is a benchmark without pass/fail criterion, so it does not run
+// by default; run it with --run_test=ReaderTestSuite/CNTKTextFormatReader_parsing_throughput.
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_parsing_throughput, *boost::unit_test::disabled())
+{
+    const size_t numRows = 10000, numRuns = 3;
+    const string filename = "parsing_throughput.txt";
+
+    vector<string> denseValues, sparseValues;
+    auto streams = WriteNumberParsingInput(filename, numRows, denseValues, sparseValues);
+    BOOST_SCOPE_EXIT(filename)
+    {
+        boost::filesystem::remove(filename);
+    } BOOST_SCOPE_EXIT_END
+
+    double megabytes = boost::filesystem::file_size(filename) / (1024.0 * 1024.0);
+    for (bool useSimdParsing : { false, true })
+    {
+        // the best of several runs, so that the first run pays for reading the file from disk
+        double seconds = std::numeric_limits<double>::max();
+        for (size_t run = 0; run < numRuns; run++)
+        {
+            CNTKTextFormatReaderTestRunner<float> testRunner(filename, streams, 0);
+            testRunner.SetUseSimdParsing(useSimdParsing);
+            auto start = std::chrono::steady_clock::now();
+            testRunner.LoadChunk();
+            seconds = std::min(seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        fprintf(stderr, "CNTKTextFormatReader parsing throughput (%s): %.1f MB/s\n",
+                useSimdParsing ? "SIMD" : "scalar", megabytes / seconds);
+    }
+};
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
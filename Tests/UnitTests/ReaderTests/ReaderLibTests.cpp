@@ -6,14 +6,19 @@
 #include "stdafx.h"
 #include <numeric>
 #include <random>
+#include <atomic>
+#include <future>
+#include <thread>
 #include "NoRandomizer.h"
 #include "DataDeserializer.h"
 #include "BlockRandomizer.h"
+#include "ChunkCache.h"
 #include "CorpusDescriptor.h"
 #include "FramePacker.h"
 #include "SequencePacker.h"
 #include "CudaMemoryProvider.h"
 #include "HeapMemoryProvider.h"
+#include "Indexer.h"
 
 #pragma warning(push)
 // disable warning about possible mod 0 operation in uniform_int_distribution
@@ -637,14 +642,14 @@ BOOST_AUTO_TEST_CASE(BlockRandomizerOneEpochWithChunks1)
     BlockRandomizerOneEpochWithChunks1Test(true);
 }
 
-void BlockRandomizerOneEpochWithChunks2Test(bool prefetch)
+void BlockRandomizerOneEpochWithChunks2Test(bool prefetch, size_t prefetchDepth = 1, size_t prefetchThreads = 1, size_t maxPrefetchBytes = 0)
 {
     vector<float> data(20);
     iota(data.begin(), data.end(), 0.0f);
 
     auto mockDeserializer = make_shared<MockDeserializer>(10, 2, data);
 
-    auto randomizer = make_shared<BlockRandomizer>(0, 18, mockDeserializer, prefetch, false);
+    auto randomizer = make_shared<BlockRandomizer>(0, 18, mockDeserializer, prefetch, false, 0, prefetchDepth, prefetchThreads, maxPrefetchBytes);
 
     EpochConfiguration epochConfiguration;
     epochConfiguration.m_numberOfWorkers = 1;
@@ -682,6 +687,15 @@ BOOST_AUTO_TEST_CASE(BlockRandomizerOneEpochWithChunks2)
     BlockRandomizerOneEpochWithChunks2Test(true);
 }
 
+BOOST_AUTO_TEST_CASE(BlockRandomizerMultiChunkPrefetch)
+{
+    // Prefetching several chunks ahead must not change the order of the sequences.
+    BlockRandomizerOneEpochWithChunks2Test(false, 4);
+    BlockRandomizerOneEpochWithChunks2Test(true, 4, 1);
+    BlockRandomizerOneEpochWithChunks2Test(true, 4, 3);
+    BlockRandomizerOneEpochWithChunks2Test(true, 10, 10, 16); // each chunk holds two float samples, i.e. 8 bytes
+}
+
 void RandomizerChaosMonkeyTest(SequenceEnumerator& randomizer, size_t sweepSize, int seed)
 {
     std::mt19937 rng(seed);
@@ -878,6 +892,119 @@ BOOST_AUTO_TEST_CASE(CheckGetCurrentCursorForRandomizers)
     test(noRandomizer, epochSize);
 }
 
+BOOST_AUTO_TEST_CASE(ChunkCacheEvictsLeastRecentlyUsedChunks)
+{
+    vector<float> data(8);
+    iota(data.begin(), data.end(), 0.0f);
+    auto mockDeserializer = make_shared<MockDeserializer>(4, 2, data);
+
+    // Each chunk holds two one-dimensional float samples, i.e. 8 bytes, so the cache fits two chunks.
+    ChunkCache cache(mockDeserializer, 16);
+
+    ChunkPtr chunk0 = cache.GetChunk(0);
+    cache.GetChunk(1);
+    BOOST_CHECK(cache.GetChunk(0) == chunk0);
+    chunk0.reset();
+
+    cache.GetChunk(2); // evicts chunk 1
+    cache.GetChunk(0);
+    auto statistics = cache.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.m_hits, 2);
+    BOOST_CHECK_EQUAL(statistics.m_misses, 3);
+    BOOST_CHECK_EQUAL(statistics.m_evictions, 1);
+    BOOST_CHECK_EQUAL(statistics.m_sizeInBytes, 16);
+
+    // Chunks that are still referenced (e.g. by the randomizer) are not evicted, even if the cache exceeds its limit.
+    ChunkPtr chunk2 = cache.GetChunk(2);
+    chunk0 = cache.GetChunk(0);
+    cache.GetChunk(3);
+    statistics = cache.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.m_evictions, 1);
+    BOOST_CHECK_EQUAL(statistics.m_sizeInBytes, 24);
+
+    // Once released, they are evicted in LRU order; chunk 0 is still referenced.
+    chunk2.reset();
+    cache.GetChunk(1); // evicts chunks 2 and 3
+    BOOST_CHECK(cache.GetChunk(0) == chunk0);
+    statistics = cache.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.m_hits, 5);
+    BOOST_CHECK_EQUAL(statistics.m_misses, 5);
+    BOOST_CHECK_EQUAL(statistics.m_evictions, 3);
+    BOOST_CHECK_EQUAL(statistics.m_sizeInBytes, 16);
+}
+
+// A thread-safe deserializer whose loads of chunk 0 block until released.
+class BlockingDeserializer : public IDataDeserializer
+{
+    IDataDeserializerPtr m_deserializer;
+    std::promise<void> m_release;
+    std::shared_future<void> m_released;
+    std::atomic<size_t> m_numLoads[2];
+    std::atomic<bool> m_loading;
+
+public:
+    BlockingDeserializer(IDataDeserializerPtr deserializer)
+        : m_deserializer(deserializer), m_released(m_release.get_future().share()), m_loading(false)
+    {
+        m_numLoads[0] = m_numLoads[1] = 0;
+    }
+
+    vector<StreamDescriptionPtr> GetStreamDescriptions() const override { return m_deserializer->GetStreamDescriptions(); }
+    ChunkDescriptions GetChunkDescriptions() override { return m_deserializer->GetChunkDescriptions(); }
+    void GetSequencesForChunk(ChunkIdType chunkId, vector<SequenceDescription>& descriptions) override { m_deserializer->GetSequencesForChunk(chunkId, descriptions); }
+    bool GetSequenceDescription(const SequenceDescription& primary, SequenceDescription& description) override { return m_deserializer->GetSequenceDescription(primary, description); }
+    bool IsGetChunkThreadSafe() const override { return true; }
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override
+    {
+        m_numLoads[chunkId]++;
+        if (chunkId == 0)
+        {
+            m_loading = true;
+            m_released.wait();
+        }
+        return m_deserializer->GetChunk(chunkId);
+    }
+
+    void WaitUntilLoading()
+    {
+        while (!m_loading)
+            std::this_thread::yield();
+    }
+
+    void Release() { m_release.set_value(); }
+    size_t NumLoads(ChunkIdType chunkId) const { return m_numLoads[chunkId]; }
+};
+
+BOOST_AUTO_TEST_CASE(ChunkCacheLoadsWithoutBlockingOtherChunks)
+{
+    vector<float> data(4);
+    iota(data.begin(), data.end(), 0.0f);
+    auto blockingDeserializer = make_shared<BlockingDeserializer>(make_shared<MockDeserializer>(2, 2, data));
+    ChunkCache cache(blockingDeserializer);
+
+    auto load0 = std::async(launch::async, [&cache]() { return cache.GetChunk(0); });
+    blockingDeserializer->WaitUntilLoading();
+    auto load0Again = std::async(launch::async, [&cache]() { return cache.GetChunk(0); });
+
+    // While chunk 0 is being loaded, other chunks and the statistics are available.
+    ChunkPtr chunk1 = cache.GetChunk(1);
+    BOOST_CHECK(chunk1 != nullptr);
+    BOOST_CHECK(cache.GetChunk(1) == chunk1);
+    BOOST_CHECK_EQUAL(cache.GetStatistics().m_misses, 2);
+
+    blockingDeserializer->Release();
+    ChunkPtr chunk0 = load0.get();
+    BOOST_CHECK(chunk0 != nullptr);
+    BOOST_CHECK(load0Again.get() == chunk0);
+    BOOST_CHECK_EQUAL(blockingDeserializer->NumLoads(0), 1);
+    BOOST_CHECK_EQUAL(blockingDeserializer->NumLoads(1), 1);
+
+    auto statistics = cache.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.m_hits, 2);
+    BOOST_CHECK_EQUAL(statistics.m_misses, 2);
+}
+
 BOOST_AUTO_TEST_CASE(DefaultCorpusDescriptor)
 {
     const int seed = 13;
@@ -987,6 +1114,128 @@ BOOST_AUTO_TEST_CASE(CheckEpochBoundarySingleWorker)
     test(underTestNo);
 }
 
+// Writes a text file with sequences of random length, some lines without a sequence id
+// (continuing the current sequence) and a last line without a line break.
+static void WriteIndexerTestFile(const string& path, bool withBom, size_t numSequences)
+{
+    std::mt19937 rng(7);
+    FILE* f = fopenOrDie(path, "wb");
+    if (withBom)
+        fputs("\xEF\xBB\xBF", f);
+    size_t id = 3;
+    for (size_t i = 0; i < numSequences; i++)
+    {
+        id += 1 + rng() % 3;
+        size_t numLines = 1 + rng() % 5;
+        for (size_t j = 0; j < numLines; j++)
+        {
+            if (j == 0 || rng() % 2)
+                fprintf(f, "%d\t", (int)id);
+            fprintf(f, "|a %d %d |b %d", (int)(rng() % 100), (int)i, (int)j);
+            if (i + 1 < numSequences || j + 1 < numLines)
+                fputs(rng() % 10 ? "\n" : "\n\n", f);
+        }
+    }
+    fclose(f);
+}
+
+static void CheckSameIndex(const Index& expected, const Index& actual)
+{
+    BOOST_REQUIRE_EQUAL(expected.m_chunks.size(), actual.m_chunks.size());
+    for (size_t c = 0; c < expected.m_chunks.size(); c++)
+    {
+        const auto& expectedChunk = expected.m_chunks[c];
+        const auto& actualChunk = actual.m_chunks[c];
+        BOOST_REQUIRE_EQUAL(expectedChunk.m_byteSize, actualChunk.m_byteSize);
+        BOOST_REQUIRE_EQUAL(expectedChunk.m_numberOfSamples, actualChunk.m_numberOfSamples);
+        BOOST_REQUIRE_EQUAL(expectedChunk.m_sequences.size(), actualChunk.m_sequences.size());
+        for (size_t i = 0; i < expectedChunk.m_sequences.size(); i++)
+        {
+            const auto& e = expectedChunk.m_sequences[i];
+            const auto& a = actualChunk.m_sequences[i];
+            BOOST_REQUIRE_EQUAL(e.m_fileOffsetBytes, a.m_fileOffsetBytes);
+            BOOST_REQUIRE_EQUAL(e.m_byteSize, a.m_byteSize);
+            BOOST_REQUIRE_EQUAL(e.m_numberOfSamples, a.m_numberOfSamples);
+            BOOST_REQUIRE_EQUAL(e.m_key.m_sequence, a.m_key.m_sequence);
+            BOOST_REQUIRE_EQUAL(e.m_chunkId, a.m_chunkId);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(IndexerParallelBuildMatchesSequentialBuild)
+{
+    const string path = "IndexerParallelBuild.txt";
+    const wstring wpath(path.begin(), path.end());
+    const size_t chunkSize = 4096;
+
+    for (bool withBom : { false, true })
+    {
+        WriteIndexerTestFile(path, withBom, 2000);
+        for (bool skipSequenceIds : { false, true })
+        {
+            FILE* f = fopenOrDie(path, "rbS");
+            Indexer sequential(f, true, skipSequenceIds, '|', chunkSize);
+            sequential.Build(make_shared<CorpusDescriptor>(true));
+            fclose(f);
+
+            for (size_t numThreads : { 2, 3, 7 })
+            {
+                f = fopenOrDie(path, "rbS");
+                Indexer parallel(f, true, skipSequenceIds, '|', chunkSize);
+                parallel.SetFilePath(wpath);
+                parallel.SetNumThreads(numThreads, 1);
+                parallel.Build(make_shared<CorpusDescriptor>(true));
+                fclose(f);
+
+                BOOST_CHECK_EQUAL(sequential.HasSequenceIds(), parallel.HasSequenceIds());
+                CheckSameIndex(sequential.GetIndex(), parallel.GetIndex());
+            }
+        }
+    }
+    _wunlink(wpath.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(IndexerReusesIndexCache)
+{
+    const string path = "IndexerIndexCache.txt";
+    const wstring wpath(path.begin(), path.end());
+    const wstring cachePath = wpath + L".cntkindex";
+    const size_t chunkSize = 4096;
+    WriteIndexerTestFile(path, false, 500);
+    _wunlink(cachePath.c_str());
+
+    FILE* f = fopenOrDie(path, "rbS");
+    Indexer first(f, true, false, '|', chunkSize);
+    first.SetFilePath(wpath);
+    first.SetUseIndexCache(true);
+    first.Build(make_shared<CorpusDescriptor>(true));
+    fclose(f);
+    BOOST_REQUIRE(fexists(cachePath));
+
+    // The second indexer gets its index from the cache, without reading the input file.
+    f = fopenOrDie(path, "rbS");
+    Indexer second(f, true, false, '|', chunkSize);
+    second.SetFilePath(wpath);
+    second.SetUseIndexCache(true);
+    second.Build(make_shared<CorpusDescriptor>(true));
+    BOOST_CHECK_EQUAL(_ftelli64(f), 0);
+    fclose(f);
+    CheckSameIndex(first.GetIndex(), second.GetIndex());
+
+    // A cache written for different settings is not used.
+    f = fopenOrDie(path, "rbS");
+    Indexer third(f, true, true, '|', chunkSize);
+    third.SetFilePath(wpath);
+    third.SetUseIndexCache(true);
+    third.Build(make_shared<CorpusDescriptor>(true));
+    BOOST_CHECK_GT(_ftelli64(f), 0);
+    fclose(f);
+    BOOST_CHECK(!third.HasSequenceIds());
+
+    _wunlink(cachePath.c_str());
+    _wunlink(wpath.c_str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(PackerTests)
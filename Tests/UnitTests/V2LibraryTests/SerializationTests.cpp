@@ -702,6 +702,56 @@ void TestLegacyModelSaving(const DeviceDescriptor& device)
     }
 }
 
+void TestLoadingModelForInference(const DeviceDescriptor& device)
+{
+    const size_t imageSize = 6;
+    const size_t numInputChannels = 3;
+    const size_t numOutputChannels = 4;
+
+    // Convolution followed by a spatial BatchNormalization with non-trivial statistics, which is folded into the weights
+    auto createParameter = [&device](const std::vector<float>& values, bool isConstant) -> Variable
+    {
+        auto value = MakeSharedObject<NDArrayView>(NDShape({ values.size() }), values.data(), values.size(), DeviceDescriptor::CPUDevice())->DeepClone(device);
+        return isConstant ? (Variable)Constant(value) : Parameter(value);
+    };
+    auto features = InputVariable({ imageSize, imageSize, numInputChannels }, DataType::Float, L"features");
+    auto convParams = Parameter({ 3, 3, numInputChannels, numOutputChannels }, DataType::Float, GlorotUniformInitializer(1, -1, 2, 1), device);
+    auto conv = Convolution(convParams, features, { 1, 1, numInputChannels });
+    auto scale = createParameter({ 0.5f, 1.0f, 1.5f, 2.0f }, false);
+    auto bias = createParameter({ 0.1f, -0.2f, 0.3f, -0.4f }, false);
+    auto runningMean = createParameter({ 0.2f, -0.1f, 0.0f, 0.3f }, true);
+    auto runningInvStd = createParameter({ 0.5f, 2.0f, 1.0f, 0.25f }, true);
+    auto batchNorm = BatchNormalization(conv, scale, bias, runningMean, runningInvStd, true /*spatial*/, 0, 0, 1e-5, false);
+    auto classifierOutput = ReLU(batchNorm, L"classifierOutput");
+
+    const wchar_t* modelFile = L"convbn.model";
+    classifierOutput->SaveModel(modelFile);
+
+    auto loadedFunction = Function::LoadModel(modelFile, device);
+    auto optimizedFunction = Internal::LoadModelForInference(modelFile, device);
+    if (optimizedFunction->Parameters().size() != 1)
+        throw std::runtime_error("TestLoadingModelForInference: The BatchNormalization was not folded into the convolution.");
+
+    const size_t numSamples = 3;
+    std::vector<float> inputData(features.Shape().TotalSize() * numSamples);
+    for (size_t i = 0; i < inputData.size(); ++i)
+        inputData[i] = ((float)rand()) / RAND_MAX - 0.5f;
+    auto inputValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(features.Shape().AppendShape({ 1, numSamples }), inputData, true));
+
+    auto evaluate = [&](const FunctionPtr& function)
+    {
+        std::unordered_map<Variable, ValuePtr> outputs = { { function->Output(), nullptr } };
+        function->Forward({ { function->Arguments()[0], inputValue } }, outputs, device);
+        std::vector<std::vector<float>> sequences;
+        outputs[function->Output()]->CopyVariableValueTo(function->Output(), sequences);
+        std::vector<float> result;
+        for (const auto& sequence : sequences)
+            result.insert(result.end(), sequence.begin(), sequence.end());
+        return result;
+    };
+    FloatingPointVectorCompare(evaluate(optimizedFunction), evaluate(loadedFunction), "TestLoadingModelForInference: The outputs of the optimized and the original model do not match");
+}
+
 void TestThatExceptionsAreRaisedForNonExistentPaths()
 {
     VerifyException([]() {
@@ -815,6 +865,7 @@ void SerializationTests()
     
     TestCheckpointing(DeviceDescriptor::CPUDevice());
     TestLegacyModelSaving(DeviceDescriptor::CPUDevice());
+    TestLoadingModelForInference(DeviceDescriptor::CPUDevice());
 
     TestCheckpointingWithStatefulNodes(DeviceDescriptor::CPUDevice());
 
@@ -826,6 +877,7 @@ void SerializationTests()
         TestModelSerializationDuringTraining(DeviceDescriptor::GPUDevice(0));
         TestCheckpointing(DeviceDescriptor::GPUDevice(0));
         TestLegacyModelSaving(DeviceDescriptor::GPUDevice(0));
+        TestLoadingModelForInference(DeviceDescriptor::GPUDevice(0));
 
         TestCheckpointingWithStatefulNodes(DeviceDescriptor::GPUDevice(0));
     }